@@ -0,0 +1,88 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Displacement texels reduced into one tile of level 0. Must match BuildBoundsCS thread group size. */
+#define BOUNDS_TILE_SIZE 16
+
+/** Bounds of displacement within a tile, same layout as float4 in g_OutputBounds */
+struct FVaOceanTileBounds
+{
+	float MinHeight;
+	float MaxHeight;
+
+	/** Max absolute horizontal displacement */
+	float MaxAbsX;
+	float MaxAbsY;
+
+	FVaOceanTileBounds()
+		: MinHeight(0.f)
+		, MaxHeight(0.f)
+		, MaxAbsX(0.f)
+		, MaxAbsY(0.f)
+	{
+	}
+
+	/** Grow bounds to include other */
+	void Merge(const FVaOceanTileBounds& Other)
+	{
+		MinHeight = FMath::Min(MinHeight, Other.MinHeight);
+		MaxHeight = FMath::Max(MaxHeight, Other.MaxHeight);
+		MaxAbsX = FMath::Max(MaxAbsX, Other.MaxAbsX);
+		MaxAbsY = FMath::Max(MaxAbsY, Other.MaxAbsY);
+	}
+};
+
+/**
+ * Min/max reduction pyramid over displacement map. Level 0 has one entry per BOUNDS_TILE_SIZE^2 texels,
+ * each next level halves the dimension until 1x1. Levels are stored one after another, as on GPU.
+ */
+class VAOCEANPLUGIN_API FVaOceanBoundsPyramid
+{
+public:
+	FVaOceanBoundsPyramid();
+
+	/** Number of tiles in all levels for given displacement map size */
+	static int32 GetTotalTileCount(int32 DispMapDimension);
+
+	/** Allocate levels for given displacement map size */
+	void Initialize(int32 DispMapDimension);
+
+	/** Free levels */
+	void Release();
+
+	/** Whether pyramid has data */
+	bool IsValid() const;
+
+	/** Rebuild all levels from displacement planes (dx, dy, dz) */
+	void Build(const FVaOceanCPUMapView& Displacement);
+
+	/** Bounds over the whole map */
+	const FVaOceanTileBounds& GetGlobalBounds() const;
+
+	/**
+	 * Get conservative bounds of displacement taken from texels in rectangle. At most 2x2 tiles are visited.
+	 *
+	 * @param UVMin		Top left corner in displacement map UV (wrapped)
+	 * @param UVMax		Bottom right corner in displacement map UV (wrapped)
+	 */
+	FVaOceanTileBounds GetBounds(const FVector2D& UVMin, const FVector2D& UVMax) const;
+
+protected:
+	/** Tile of given level, coordinates are wrapped */
+	const FVaOceanTileBounds& GetTile(int32 Level, int32 X, int32 Y) const;
+
+protected:
+	/** Displacement map dimension */
+	int32 Dim;
+
+	/** All levels one after another */
+	TArray<FVaOceanTileBounds> Tiles;
+
+	/** Dimension of each level */
+	TArray<int32> LevelDims;
+
+	/** First tile of each level */
+	TArray<int32> LevelOffsets;
+
+};
@@ -0,0 +1,58 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Buoyancy pontoons resolved by one worker task */
+#define BUOYANCY_BATCH_SIZE 64
+
+/**
+ * Pontoons of all floating hulls resolved at once. Hulls append their pontoons one after another,
+ * water under them is resolved BUOYANCY_BATCH_SIZE pontoons per worker task, then each hull gets
+ * its own part back. Arrays keep their allocation between frames.
+ */
+class VAOCEANPLUGIN_API FVaOceanBuoyancyBatch
+{
+public:
+	/** World surface heights under given pontoons, and water velocities when OutVelocities is not null */
+	typedef TFunctionRef<void(const FVector* InLocations, int32 InNum, float* OutHeights, FVector* OutVelocities)> FResolveWater;
+
+	/** Pontoons of one hull with water under them, Num is 0 for a hull skipped by the batch */
+	typedef TFunctionRef<void(int32 HullIndex, const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, int32 Num)> FApplyWater;
+
+	FVaOceanBuoyancyBatch();
+
+	/** Drop hulls of the last frame */
+	void Reset();
+
+	/** Pontoon world locations, a hull appends its pontoons here before AddHull */
+	TArray<FVector>& GetLocations();
+
+	/** Close the hull made of pontoons appended since the previous one, 0 skips it */
+	void AddHull(int32 NumPontoons);
+
+	/** Pontoons of all hulls */
+	int32 GetNumPontoons() const;
+
+	/** Resolve water under all pontoons, batches are processed in parallel */
+	void Resolve(bool bWithVelocity, FResolveWater ResolveWater);
+
+	/** Hand each hull its pontoons and water, in the order hulls were added */
+	void Apply(FApplyWater ApplyWater) const;
+
+protected:
+	/** Pontoon world locations, hulls follow each other */
+	TArray<FVector> Locations;
+
+	/** Pontoons of each hull, 0 for the skipped ones */
+	TArray<int32> PontoonCounts;
+
+	/** World surface height over each pontoon */
+	TArray<float> Heights;
+
+	/** Water velocity at each pontoon, filled when resolved with velocity */
+	TArray<FVector> Velocities;
+
+	/** Last Resolve filled Velocities */
+	bool bWithVelocity;
+
+};
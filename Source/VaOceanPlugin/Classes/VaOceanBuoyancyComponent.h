@@ -0,0 +1,76 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+#include "VaOceanBuoyancyComponent.generated.h"
+
+class AVaOceanSimulator;
+
+/**
+ * Floats the physics body it's attached to with spherical pontoons placed over the hull.
+ *
+ * Component doesn't query the ocean itself: pontoons of all components are gathered by the simulator,
+ * resolved in one parallel batch each frame, and each body receives a single force and torque.
+ * Requires CPU simulation.
+ */
+UCLASS(ClassGroup=Physics, meta=(BlueprintSpawnableComponent))
+class VAOCEANPLUGIN_API UVaOceanBuoyancyComponent : public USceneComponent
+{
+	GENERATED_UCLASS_BODY()
+
+	// Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End UActorComponent Interface
+
+public:
+	/** Simulator that floats the hull, the first one in the world is used when not set */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Buoyancy")
+	AVaOceanSimulator* OceanSimulator;
+
+	/** Pontoon centers relative to the component */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Buoyancy", meta = (MakeEditWidget = ""))
+	TArray<FVector> Pontoons;
+
+	/** Radius of each pontoon sphere */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Buoyancy", meta = (ClampMin = "1.0"))
+	float PontoonRadius;
+
+	/** Water density in kg/m^3, displaced volume is measured in cm^3 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Buoyancy", meta = (ClampMin = "0.0"))
+	float WaterDensity;
+
+	/** Share of body velocity relative to the water removed per second when all pontoons are submerged */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Buoyancy", meta = (ClampMin = "0.0"))
+	float WaterDrag;
+
+	/** Submerged share of pontoon volume [0..1] after the last batch */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Buoyancy")
+	float GetSubmergedRatio() const;
+
+	/** Body that receives buoyancy forces: attach parent or actor root simulating physics */
+	UPrimitiveComponent* GetBuoyantBody() const;
+
+	/** Append world locations of pontoons, returns the number of them */
+	int32 GatherPontoons(TArray<FVector>& OutLocations) const;
+
+	/**
+	 * Apply force and torque of one batch to the body. Submerged ratio is updated without simulating body too.
+	 *
+	 * @param WaterHeights		World surface height over each pontoon gathered by GatherPontoons
+	 * @param WaterVelocities	Water velocity at each pontoon, null when the simulator doesn't provide it
+	 */
+	void ApplyBuoyancy(const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, float GravityZ);
+
+	/** Batch skipped the component (inactive, no body or no CPU simulation): nothing is submerged */
+	void ClearBuoyancy();
+
+protected:
+	/** Simulator the pontoons are registered with */
+	UPROPERTY(Transient)
+	AVaOceanSimulator* RegisteredSimulator;
+
+	/** Result of the last batch */
+	float SubmergedRatio;
+
+};
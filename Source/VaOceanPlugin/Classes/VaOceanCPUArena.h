@@ -0,0 +1,150 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Alignment of arena allocations, one cache line */
+#define CPU_ARENA_ALIGNMENT 64
+
+/** Floats in one CPU_ARENA_ALIGNMENT line */
+#define CPU_ARENA_LINE_FLOATS 16
+
+/** Wrapped texel offsets and weights of one bilinear fetch, shared by all planes of a map */
+struct FVaOceanBilinearTaps
+{
+	/** Top left, top right, bottom left and bottom right texels */
+	int32 Offsets[4];
+
+	/** Fractional position between texel centers */
+	float TX;
+	float TY;
+
+	/** Fetch at texel coordinates (texel centers are integer) of a map with given dimension and row stride, wrapped */
+	FVaOceanBilinearTaps(float X, float Y, int32 Dim, int32 Stride)
+	{
+		const float X0 = FMath::FloorToFloat(X);
+		const float Y0 = FMath::FloorToFloat(Y);
+		const int32 IX = (int32)X0;
+		const int32 IY = (int32)Y0;
+		const int32 Mask = Dim - 1;
+
+		const int32 Row0 = (IY & Mask) * Stride;
+		const int32 Row1 = ((IY + 1) & Mask) * Stride;
+
+		Offsets[0] = Row0 + (IX & Mask);
+		Offsets[1] = Row0 + ((IX + 1) & Mask);
+		Offsets[2] = Row1 + (IX & Mask);
+		Offsets[3] = Row1 + ((IX + 1) & Mask);
+		TX = X - X0;
+		TY = Y - Y0;
+	}
+
+	/** Filter one plane */
+	float Sample(const float* Plane) const
+	{
+		const float Top = Plane[Offsets[0]] * (1.f - TX) + Plane[Offsets[1]] * TX;
+		const float Bottom = Plane[Offsets[2]] * (1.f - TX) + Plane[Offsets[3]] * TX;
+
+		return Top * (1.f - TY) + Bottom * TY;
+	}
+};
+
+/**
+ * Read-only view of a CPU map stored as separate float planes, one per channel (x, y, z, w).
+ * Rows are Stride floats apart, see FVaOceanCPUArena::GetPlaneStride. Views don't own memory
+ * and stay valid until the backend they are taken from is initialized again.
+ */
+struct FVaOceanCPUMapView
+{
+	/** Channel planes, unused ones are null */
+	const float* Planes[4];
+
+	/** Number of valid planes */
+	int32 PlaneCount;
+
+	/** Map dimension */
+	int32 Dim;
+
+	/** Distance between rows in floats */
+	int32 Stride;
+
+	FVaOceanCPUMapView()
+		: PlaneCount(0)
+		, Dim(0)
+		, Stride(0)
+	{
+		Planes[0] = Planes[1] = Planes[2] = Planes[3] = nullptr;
+	}
+
+	/** Whether view points to any data */
+	bool IsValid() const
+	{
+		return Dim > 0 && PlaneCount > 0;
+	}
+
+	/** Row of given channel, Y is wrapped */
+	const float* GetRow(int32 Plane, int32 Y) const
+	{
+		return Planes[Plane] + (Y & (Dim - 1)) * Stride;
+	}
+
+	/** Texel of given channel, coordinates are wrapped */
+	float GetTexel(int32 Plane, int32 X, int32 Y) const
+	{
+		return GetRow(Plane, Y)[X & (Dim - 1)];
+	}
+
+	/** Bilinear fetch at texel coordinates (texel centers are integer), wrapped */
+	FVaOceanBilinearTaps GetBilinearTaps(float X, float Y) const
+	{
+		return FVaOceanBilinearTaps(X, Y, Dim, Stride);
+	}
+};
+
+/**
+ * Linear allocator over one CPU_ARENA_ALIGNMENT aligned block. Allocations are never freed one by one,
+ * the whole arena is rewound or released at once.
+ */
+class VAOCEANPLUGIN_API FVaOceanCPUArena : public FNoncopyable
+{
+public:
+	FVaOceanCPUArena();
+	~FVaOceanCPUArena();
+
+	/**
+	 * Row stride in floats for map of given dimension. Rows are padded to whole cache lines, and by one
+	 * more line when row size is a power of two, so column walks don't hit the same cache set every few rows.
+	 */
+	static int32 GetPlaneStride(int32 Dim);
+
+	/** Bytes taken by one plane. Consecutive planes are shifted by one cache line to avoid 4K aliasing between them. */
+	static SIZE_T GetPlaneSize(int32 Dim);
+
+	/** Rewind arena and make sure it can hold Size bytes. Memory is reallocated only if the block is too small. */
+	void Reserve(SIZE_T Size);
+
+	/** Free the block */
+	void Release();
+
+	/** Take Size bytes aligned to CPU_ARENA_ALIGNMENT. Memory is not initialized. */
+	void* Allocate(SIZE_T Size);
+
+	/** Take one zeroed plane of a map with given dimension */
+	float* AllocatePlane(int32 Dim);
+
+	/** Size of the block */
+	SIZE_T GetCapacity() const;
+
+	/** Bytes taken since the last Reserve */
+	SIZE_T GetUsedSize() const;
+
+private:
+	/** Aligned block */
+	uint8* Memory;
+
+	/** Size of the block */
+	SIZE_T Capacity;
+
+	/** Offset of the next allocation */
+	SIZE_T Offset;
+
+};
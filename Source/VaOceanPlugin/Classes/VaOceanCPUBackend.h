@@ -0,0 +1,283 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Fixed point iterations used to find undisplaced point of choppy surface */
+#define CHOPPY_INVERSE_ITERATIONS 4
+
+/** Per step parameters of CPU simulation */
+struct FVaOceanCPUPerFrame
+{
+	/** Scaled simulation time */
+	float Time;
+
+	/** Simulation time per world second, converts time derivatives to world units */
+	float TimeScale;
+
+	float ChoppyScale;
+	float GridLen;
+
+	/** Foam history multiplier, exp(-FoamDecay * DeltaTime) */
+	float FoamFade;
+
+	/** Foam injection for this step, FoamInjection * DeltaTime */
+	float FoamInjection;
+	float FoamThreshold;
+
+	/** Weight of target spectrum during sea state transition, 0 without it */
+	float SpectrumBlend;
+
+	/** Folding above which texels are put into the spawn list */
+	float SpawnFoldThreshold;
+
+	FVaOceanCPUPerFrame()
+		: SpectrumBlend(0.f)
+		, SpawnFoldThreshold(0.f)
+	{
+	}
+};
+
+/** Entry of fold spawn list, the same as one of CompactSpawnListCS */
+struct FVaOceanFoldTexel
+{
+	/** Texel coordinates in displacement map */
+	int32 X;
+	int32 Y;
+
+	/** Folding (1 - Jacobian) and accumulated foam of the texel */
+	float Fold;
+	float Foam;
+};
+
+/** Channel planes of one CPU simulation step, allocated from backend arena */
+struct FVaOceanCPUStep
+{
+	/** Displacement (dx, dy, dz), w is always 1 */
+	float* Displacement[3];
+
+	/** Velocity (vx, vy, vz), null if velocity is not simulated */
+	float* Velocity[3];
+
+	/** Gradient (x, y), accumulated foam and folding */
+	float* Gradient[4];
+
+	/** Displacement resampled to world grid: height of the surface above each texel center */
+	float* HeightField;
+
+	/** Min/max pyramid over displacement */
+	FVaOceanBoundsPyramid BoundsPyramid;
+
+	FVaOceanCPUStep()
+		: HeightField(nullptr)
+	{
+		FMemory::Memzero(Displacement);
+		FMemory::Memzero(Velocity);
+		FMemory::Memzero(Gradient);
+	}
+};
+
+/**
+ * CPU version of the simulation chain: H(0) -> H(t) -> FFT -> Displacement -> Gradient, Bounds.
+ * With FVaOceanGerstnerWaves displacement is evaluated analytically instead, the rest of the chain is the same.
+ * Mirrors UpdateSpectrumCS, Radix008A_CS, UpdateDisplacementPS, GenGradientFoldingPS and bounds
+ * pyramid shaders, so gameplay code
+ * (and dedicated servers without compute shaders) can query the same waves.
+ *
+ * Unlike GPU buffers, all maps are kept as separate real/imaginary or channel planes with padded rows,
+ * carved out of one aligned arena, see FVaOceanCPUArena.
+ */
+class VAOCEANPLUGIN_API FVaOceanCPUBackend
+{
+public:
+	FVaOceanCPUBackend();
+
+	/**
+	 * Copy spectrum data and allocate working buffers. Arena is reused if it is large enough.
+	 *
+	 * @param InDim		Displacement map dimension, must be power of 2
+	 * @param InH0		Packed H(0) data (xy: h0(k), zw: conj(h0(-k))), InDim * InDim texels
+	 * @param InOmega	Angular frequency, InDim * InDim texels
+	 * @param bInSimulateVelocity	Transform time derivative slices too
+	 * @param InWaves	Evaluate these waves instead of spectrum FFT, spectrum data is not used then. Must outlive the backend data.
+	 * @param InSpawnListCapacity	Entries of fold spawn list built by each step, 0 to skip it
+	 */
+	void Initialize(int32 InDim, const FVector4* InH0, const float* InOmega, bool bInSimulateVelocity = false, const FVaOceanGerstnerWaves* InWaves = nullptr, int32 InSpawnListCapacity = 0);
+
+	/**
+	 * Copy H(0) of the sea state to blend in with FVaOceanCPUPerFrame::SpectrumBlend. It must be generated
+	 * with the same seed and patch length, so omega is shared.
+	 */
+	void SetTargetSpectrum(const FVector4* InH0Target);
+
+	/** Transition is complete: target H(0) becomes the current one */
+	void CommitTargetSpectrum();
+
+	/** Update only wave numbers of the band, see GetSpectrumBandRegion. Initialize starts with the whole spectrum. */
+	void SetSpectrumBand(int32 InBandRadius);
+
+	/** Bytes of arena taken by Initialize with given parameters */
+	static SIZE_T GetArenaSize(int32 InDim, bool bInSimulateVelocity, bool bInGerstnerWaves = false, int32 InSpawnListCapacity = 0);
+
+	/** Free all buffers */
+	void Release();
+
+	/** Whether backend has spectrum data */
+	bool IsInitialized() const;
+
+	/** Run one simulation step, results of the previous one are kept for interpolation */
+	void Update(const FVaOceanCPUPerFrame& PerFrame);
+
+	/** Blend factor between previous (0) and last (1) step used by sampling and bounds queries */
+	void SetInterpolationAlpha(float InAlpha);
+
+	/** Size of displacement map */
+	int32 GetDimension() const;
+
+	/** Displacement texel in the same format as DisplacementTexture. Coordinates are wrapped. */
+	FVector4 GetDisplacementTexel(int32 X, int32 Y) const;
+
+	/** Bilinear displacement sample interpolated between steps, UV is wrapped */
+	FVector SampleDisplacement(const FVector2D& UV) const;
+
+	/** Gradient texel in the same format as GradientTexture: (gradient, foam, fold). Coordinates are wrapped. */
+	FVector4 GetGradientTexel(int32 X, int32 Y) const;
+
+	/** Bilinear velocity sample (vx, vy, vz) interpolated between steps, zero if velocity is not simulated. UV is wrapped. */
+	FVector SampleVelocity(const FVector2D& UV) const;
+
+	/** Bilinear accumulated foam sample [0..1] interpolated between steps, UV is wrapped */
+	float SampleFoam(const FVector2D& UV) const;
+
+	/**
+	 * Height of displaced surface above UV, interpolated between steps. Choppy displacement is
+	 * already inverted in the height field, so it takes a single bilinear fetch. UV is wrapped.
+	 */
+	float SampleHeight(const FVector2D& UV) const;
+
+	/** Conservative displacement bounds of both interpolated steps over UV rectangle, see FVaOceanBoundsPyramid::GetBounds */
+	FVaOceanTileBounds GetBounds(const FVector2D& UVMin, const FVector2D& UVMax) const;
+
+	/** Displacement bounds of both interpolated steps over the whole map */
+	FVaOceanTileBounds GetGlobalBounds() const;
+
+	/** Zero-copy view of displacement planes (dx, dy, dz) of the last or previous step */
+	FVaOceanCPUMapView GetDisplacementView(bool bPrevious = false) const;
+
+	/** Zero-copy view of velocity planes (vx, vy, vz), invalid if velocity is not simulated */
+	FVaOceanCPUMapView GetVelocityView(bool bPrevious = false) const;
+
+	/** Zero-copy view of gradient planes (gradient x, y, foam, fold) */
+	FVaOceanCPUMapView GetGradientView(bool bPrevious = false) const;
+
+	/** Zero-copy view of height field plane */
+	FVaOceanCPUMapView GetHeightFieldView(bool bPrevious = false) const;
+
+	/**
+	 * Texels of the last step folding above FVaOceanCPUPerFrame::SpawnFoldThreshold, in no particular order.
+	 * When there are more of them than the capacity, the ones over it are dropped.
+	 */
+	const FVaOceanFoldTexel* GetSpawnList(int32& OutNum) const;
+
+protected:
+	/** H(0) -> H(t), D(x, t), D(y, t) and optional time derivatives. Blend is weight of target H(0). */
+	void UpdateSpectrum(float Time, float TimeScale, float Blend);
+
+	/** Packed H(0) texels -> four planes */
+	void DeinterleaveH0(const FVector4* InH0, float* const* OutPlanes) const;
+
+	/** In-place 2D FFT of all slices */
+	void ComputeFFT();
+
+	/**
+	 * In-place 1D FFT of Count neighbour transforms at once. Element i of transform c is at Re/Im[i * ElementStride + c],
+	 * so columns are transformed a cache line at a time. Generic radix-2 path of sizes without TVaOceanCPUFFT.
+	 */
+	void FFT1D(float* Re, float* Im, int32 ElementStride, int32 Count) const;
+
+	/** Wrap Dx, Dy, Dz and velocity */
+	void UpdateDisplacement(float ChoppyScale);
+
+	/**
+	 * Displacement -> Normal, Folding, Foam. Rows are processed in blocks, neighbour rows are streamed with wrap-around halo.
+	 * Each block appends its folding texels to the spawn list while they are still in cache.
+	 */
+	void GenGradientFolding(const FVaOceanCPUPerFrame& PerFrame);
+
+	/** Displacement -> height at each undisplaced texel position */
+	void UpdateHeightField(const FVaOceanCPUPerFrame& PerFrame);
+
+	/** Whether previous step takes part in interpolation */
+	bool IsInterpolating() const;
+
+	/** View over given planes of a map */
+	FVaOceanCPUMapView MakeView(float* const* Planes, int32 PlaneCount) const;
+
+	/** Bilinear taps of texel map at UV, wrapped */
+	FVaOceanBilinearTaps GetBilinearTaps(const FVector2D& UV) const;
+
+	/** Bilinear taps of texel map at texel coordinates (texel centers are integer), wrapped */
+	FVaOceanBilinearTaps GetBilinearTaps(float fx, float fy) const;
+
+protected:
+	/** Displacement map dimension */
+	int32 Dim;
+
+	/** log2(Dim) */
+	int32 LogDim;
+
+	/** Row stride of all planes in floats */
+	int32 Stride;
+
+	/** Memory of all planes and FFT tables */
+	FVaOceanCPUArena Arena;
+
+	/** Packed H(0), see InitHeightMap: h0(k) and conj(h0(-k)) real and imaginary planes */
+	float* H0[4];
+
+	/** H(0) of the sea state being blended in, same layout */
+	float* H0Target[4];
+
+	/** Angular frequency */
+	float* Omega;
+
+	/** Texels [BandFirst, BandFirst + BandSize) along both axes hold the energy-bearing band, the rest of H(t) is zero */
+	int32 BandFirst;
+	int32 BandSize;
+
+	/** Number of FFT slices: 3, or 5 with velocity */
+	int32 Slices;
+
+	/**
+	 * Real and imaginary planes of H(t), Dx(t), Dy(t) and optional (dH/dt, dDx/dt), dDy/dt slices,
+	 * transformed in-place into the space domain
+	 */
+	float* HtRe[5];
+	float* HtIm[5];
+
+	/** Results of the last step */
+	FVaOceanCPUStep Last;
+
+	/** Results of the previous step, swapped with the last ones on each update. Foam history is read from here. */
+	FVaOceanCPUStep Prev;
+
+	/** Blend factor between previous and last step */
+	float InterpolationAlpha;
+
+	/** exp(-2 * PI * i * k / Dim) for k < Dim / 2 */
+	float* TwiddleRe;
+	float* TwiddleIm;
+
+	/** Bit-reversal permutation for Dim elements */
+	int32* BitReverse;
+
+	/** Analytic waves replacing spectrum and FFT, null in FFT mode */
+	const FVaOceanGerstnerWaves* Waves;
+
+	/** Fold spawn list of the last step, null without it */
+	FVaOceanFoldTexel* SpawnList;
+	int32 SpawnListCapacity;
+
+	/** Entries appended by the last step, may exceed capacity while blocks are appending */
+	volatile int32 SpawnListNum;
+
+};
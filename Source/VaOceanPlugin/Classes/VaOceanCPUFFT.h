@@ -0,0 +1,386 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** PI in double precision for compile-time twiddles */
+#define CPU_FFT_PI 3.1415926535897932384626433832795
+
+/** Compile-time sin and cos: Taylor series of the angle reduced to [-PI, PI] */
+namespace VaOceanCPUFFT
+{
+	/** Sum of series terms from Term = x^N / N! on */
+	constexpr double Series(double X2, double Term, int32 N)
+	{
+		return (N > 40) ? 0.0 : Term + Series(X2, -Term * X2 / ((N + 1) * (N + 2)), N + 2);
+	}
+
+	constexpr double Sin(double X)
+	{
+		return Series(X * X, X, 1);
+	}
+
+	constexpr double Cos(double X)
+	{
+		return Series(X * X, 1.0, 0);
+	}
+
+	/** Angle of exp(-2 * PI * i * Num / Den), the whole turns are dropped */
+	constexpr double ReducedAngle(int32 Num, int32 Den)
+	{
+		return -2.0 * CPU_FFT_PI * (((Num % Den) * 2 > Den) ? (Num % Den) - Den : (Num % Den)) / Den;
+	}
+
+	/** Output index of FFT butterflies, they leave results in bit-reversed order */
+	constexpr int32 ReverseOutput(int32 Index, int32 Radix)
+	{
+		return (Radix == 8) ? ((Index & 1) << 2) | (Index & 2) | (Index >> 2)
+			: (Radix == 4) ? ((Index & 1) << 1) | (Index >> 1)
+			: Index;
+	}
+
+	/** Compile-time index sequence used to fill constant tables */
+	template<int32... I>
+	struct TIndices
+	{
+	};
+
+	template<int32 N, int32... I>
+	struct TMakeIndices : TMakeIndices<N - 1, N - 1, I...>
+	{
+	};
+
+	template<int32... I>
+	struct TMakeIndices<0, I...>
+	{
+		typedef TIndices<I...> Type;
+	};
+}
+
+/**
+ * Twiddles of one decimation in time stage that merges R transforms of size L: w^(j * k), w = exp(-2 * PI * i / (L * R)),
+ * for input j = 1..R-1 at offset k. Index is (j - 1) * L + k.
+ */
+template<int32 L, int32 R, typename Indices = typename VaOceanCPUFFT::TMakeIndices<(R - 1) * L>::Type>
+struct TVaOceanCPUFFTTwiddles;
+
+template<int32 L, int32 R, int32... I>
+struct TVaOceanCPUFFTTwiddles<L, R, VaOceanCPUFFT::TIndices<I...>>
+{
+	static constexpr float Re[sizeof...(I)] = { (float)VaOceanCPUFFT::Cos(VaOceanCPUFFT::ReducedAngle((I / L + 1) * (I % L), L * R))... };
+	static constexpr float Im[sizeof...(I)] = { (float)VaOceanCPUFFT::Sin(VaOceanCPUFFT::ReducedAngle((I / L + 1) * (I % L), L * R))... };
+};
+
+template<int32 L, int32 R, int32... I>
+constexpr float TVaOceanCPUFFTTwiddles<L, R, VaOceanCPUFFT::TIndices<I...>>::Re[sizeof...(I)];
+
+template<int32 L, int32 R, int32... I>
+constexpr float TVaOceanCPUFFTTwiddles<L, R, VaOceanCPUFFT::TIndices<I...>>::Im[sizeof...(I)];
+
+/**
+ * Input permutation of radices (8, Dim / 64, 8): digits of the index are reversed. The radix sequence is
+ * a palindrome, so the permutation is its own inverse and is done in place with swaps.
+ */
+template<int32 Dim, typename Indices = typename VaOceanCPUFFT::TMakeIndices<Dim>::Type>
+struct TVaOceanCPUFFTDigitReverse;
+
+template<int32 Dim, int32... I>
+struct TVaOceanCPUFFTDigitReverse<Dim, VaOceanCPUFFT::TIndices<I...>>
+{
+	static constexpr int32 Table[Dim] = { (I % 8) * (Dim / 8) + ((I / 8) % (Dim / 64)) * 8 + I / (Dim / 8)... };
+};
+
+template<int32 Dim, int32... I>
+constexpr int32 TVaOceanCPUFFTDigitReverse<Dim, VaOceanCPUFFT::TIndices<I...>>::Table[Dim];
+
+/** Arithmetic of one lane: float for single values, VectorRegister for four neighbour ones */
+template<typename T>
+struct TVaOceanCPUFFTLane;
+
+template<>
+struct TVaOceanCPUFFTLane<float>
+{
+	enum { Width = 1 };
+
+	static FORCEINLINE float Load(const float* Ptr) { return *Ptr; }
+	static FORCEINLINE void Store(float Value, float* Ptr) { *Ptr = Value; }
+	static FORCEINLINE float Set(float Value) { return Value; }
+	static FORCEINLINE float Add(float A, float B) { return A + B; }
+	static FORCEINLINE float Sub(float A, float B) { return A - B; }
+	static FORCEINLINE float Mul(float A, float B) { return A * B; }
+};
+
+template<>
+struct TVaOceanCPUFFTLane<VectorRegister>
+{
+	enum { Width = 4 };
+
+	static FORCEINLINE VectorRegister Load(const float* Ptr) { return VectorLoad(Ptr); }
+	static FORCEINLINE void Store(const VectorRegister& Value, float* Ptr) { VectorStore(Value, Ptr); }
+	static FORCEINLINE VectorRegister Set(float Value) { return VectorSetFloat1(Value); }
+	static FORCEINLINE VectorRegister Add(const VectorRegister& A, const VectorRegister& B) { return VectorAdd(A, B); }
+	static FORCEINLINE VectorRegister Sub(const VectorRegister& A, const VectorRegister& B) { return VectorSubtract(A, B); }
+	static FORCEINLINE VectorRegister Mul(const VectorRegister& A, const VectorRegister& B) { return VectorMultiply(A, B); }
+};
+
+/** Butterflies of VaOcean_FFT.usf on separate real and imaginary parts, results are left in bit-reversed order */
+template<int32 R, typename T>
+struct TVaOceanCPUFFTButterfly;
+
+template<typename T>
+struct TVaOceanCPUFFTButterfly<2, T>
+{
+	typedef TVaOceanCPUFFTLane<T> Lane;
+
+	static FORCEINLINE void Forward(T* Re, T* Im)
+	{
+		FT2(Re[0], Im[0], Re[1], Im[1]);
+	}
+
+	static FORCEINLINE void FT2(T& ar, T& ai, T& br, T& bi)
+	{
+		const T tr = ar;
+		const T ti = ai;
+
+		ar = Lane::Add(ar, br);
+		br = Lane::Sub(tr, br);
+		ai = Lane::Add(ai, bi);
+		bi = Lane::Sub(ti, bi);
+	}
+};
+
+template<typename T>
+struct TVaOceanCPUFFTButterfly<4, T>
+{
+	typedef TVaOceanCPUFFTLane<T> Lane;
+	typedef TVaOceanCPUFFTButterfly<2, T> Radix2;
+
+	/** FFT_forward_4 */
+	static FORCEINLINE void Forward(T* Re, T* Im)
+	{
+		Radix2::FT2(Re[0], Im[0], Re[2], Im[2]);
+		Radix2::FT2(Re[1], Im[1], Re[3], Im[3]);
+		Radix2::FT2(Re[0], Im[0], Re[1], Im[1]);
+
+		UPD_forward(Re[2], Im[2], Re[3], Im[3]);
+	}
+
+	static FORCEINLINE void UPD_forward(T& ar, T& ai, T& br, T& bi)
+	{
+		const T A = ar;
+		const T B = bi;
+
+		ar = Lane::Add(ar, bi);
+		bi = Lane::Add(ai, br);
+		ai = Lane::Sub(ai, br);
+		br = Lane::Sub(A, B);
+	}
+};
+
+template<typename T>
+struct TVaOceanCPUFFTButterfly<8, T>
+{
+	typedef TVaOceanCPUFFTLane<T> Lane;
+	typedef TVaOceanCPUFFTButterfly<2, T> Radix2;
+	typedef TVaOceanCPUFFTButterfly<4, T> Radix4;
+
+	/** FFT_forward_8 */
+	static FORCEINLINE void Forward(T* Re, T* Im)
+	{
+		const T COS_PI_4_16 = Lane::Set(0.70710678118654752440084436210485f);
+
+		Radix2::FT2(Re[0], Im[0], Re[4], Im[4]);
+		Radix2::FT2(Re[1], Im[1], Re[5], Im[5]);
+		Radix2::FT2(Re[2], Im[2], Re[6], Im[6]);
+		Radix2::FT2(Re[3], Im[3], Re[7], Im[7]);
+
+		Radix4::UPD_forward(Re[4], Im[4], Re[6], Im[6]);
+		Radix4::UPD_forward(Re[5], Im[5], Re[7], Im[7]);
+
+		// CMUL_forward by (COS_PI_4_16, -COS_PI_4_16) and (-COS_PI_4_16, -COS_PI_4_16)
+		const T r5 = Re[5];
+		Re[5] = Lane::Mul(Lane::Add(r5, Im[5]), COS_PI_4_16);
+		Im[5] = Lane::Mul(Lane::Sub(Im[5], r5), COS_PI_4_16);
+
+		const T r7 = Re[7];
+		Re[7] = Lane::Mul(Lane::Sub(Im[7], r7), COS_PI_4_16);
+		Im[7] = Lane::Mul(Lane::Add(r7, Im[7]), Lane::Sub(Lane::Set(0.f), COS_PI_4_16));
+
+		Radix4::Forward(Re, Im);
+		Radix2::FT2(Re[4], Im[4], Re[5], Im[5]);
+		Radix2::FT2(Re[6], Im[6], Re[7], Im[7]);
+	}
+};
+
+/**
+ * CPU FFT specialized for transform size: radix (8, Dim / 64, 8) decimation in time stages with unrolled
+ * butterflies of VaOcean_FFT.usf, twiddles and input permutation are constant tables built by the compiler.
+ * Same interface as FVaOceanCPUBackend::FFT1D: element i of transform c is at Re/Im[i * ElementStride + c].
+ *
+ * Columns go four neighbour transforms per vector. A single row goes four offsets of a stage per vector instead,
+ * except the first stage: it has no twiddles and its inputs are 8 elements apart.
+ */
+template<int32 Dim>
+class TVaOceanCPUFFT
+{
+	static_assert(Dim == 128 || Dim == 256 || Dim == 512, "CPU FFT is specialized for 128, 256 and 512 only");
+
+public:
+	/** In-place forward transform of Count neighbour transforms */
+	static void Transform(float* Re, float* Im, int32 ElementStride, int32 Count)
+	{
+		Permute(Re, Im, ElementStride, Count);
+
+		if (Count % 4 == 0)
+		{
+			StageAcross<1, 8, VectorRegister>(Re, Im, ElementStride, Count);
+			StageAcross<8, Dim / 64, VectorRegister>(Re, Im, ElementStride, Count);
+			StageAcross<Dim / 8, 8, VectorRegister>(Re, Im, ElementStride, Count);
+		}
+		else if (Count == 1 && ElementStride == 1)
+		{
+			StageAcross<1, 8, float>(Re, Im, ElementStride, Count);
+			StageAlong<8, Dim / 64>(Re, Im);
+			StageAlong<Dim / 8, 8>(Re, Im);
+		}
+		else
+		{
+			StageAcross<1, 8, float>(Re, Im, ElementStride, Count);
+			StageAcross<8, Dim / 64, float>(Re, Im, ElementStride, Count);
+			StageAcross<Dim / 8, 8, float>(Re, Im, ElementStride, Count);
+		}
+	}
+
+private:
+	static void Permute(float* Re, float* Im, int32 ElementStride, int32 Count)
+	{
+		const int32* Table = TVaOceanCPUFFTDigitReverse<Dim>::Table;
+
+		for (int32 i = 0; i < Dim; i++)
+		{
+			const int32 j = Table[i];
+			if (i < j)
+			{
+				for (int32 c = 0; c < Count; c++)
+				{
+					Swap(Re[i * ElementStride + c], Re[j * ElementStride + c]);
+					Swap(Im[i * ElementStride + c], Im[j * ElementStride + c]);
+				}
+			}
+		}
+	}
+
+	/** Twiddle input j by w^(j * k), then R point butterfly. Output m is written to where input m was read. */
+	template<int32 L, int32 R, typename T>
+	static FORCEINLINE void Butterfly(float* Row_re, float* Row_im, int32 Span, const T* w_re, const T* w_im)
+	{
+		typedef TVaOceanCPUFFTLane<T> Lane;
+
+		T D_re[R];
+		T D_im[R];
+
+		for (int32 j = 0; j < R; j++)
+		{
+			D_re[j] = Lane::Load(Row_re + j * Span);
+			D_im[j] = Lane::Load(Row_im + j * Span);
+		}
+
+		// The first stage merges single elements, its twiddles are all 1
+		if (L > 1)
+		{
+			for (int32 j = 1; j < R; j++)
+			{
+				const T t = D_re[j];
+				D_re[j] = Lane::Sub(Lane::Mul(t, w_re[j - 1]), Lane::Mul(D_im[j], w_im[j - 1]));
+				D_im[j] = Lane::Add(Lane::Mul(t, w_im[j - 1]), Lane::Mul(D_im[j], w_re[j - 1]));
+			}
+		}
+
+		TVaOceanCPUFFTButterfly<R, T>::Forward(D_re, D_im);
+
+		for (int32 m = 0; m < R; m++)
+		{
+			Lane::Store(D_re[VaOceanCPUFFT::ReverseOutput(m, R)], Row_re + m * Span);
+			Lane::Store(D_im[VaOceanCPUFFT::ReverseOutput(m, R)], Row_im + m * Span);
+		}
+	}
+
+	/** Merge transforms of size L into ones of size L * R, lanes are neighbour transforms */
+	template<int32 L, int32 R, typename T>
+	static void StageAcross(float* Re, float* Im, int32 ElementStride, int32 Count)
+	{
+		typedef TVaOceanCPUFFTTwiddles<L, R> FTwiddles;
+		typedef TVaOceanCPUFFTLane<T> Lane;
+
+		const int32 Span = L * ElementStride;
+
+		for (int32 Start = 0; Start < Dim; Start += L * R)
+		{
+			for (int32 k = 0; k < L; k++)
+			{
+				T w_re[R - 1];
+				T w_im[R - 1];
+
+				for (int32 j = 1; j < R; j++)
+				{
+					w_re[j - 1] = Lane::Set(FTwiddles::Re[(j - 1) * L + k]);
+					w_im[j - 1] = Lane::Set(FTwiddles::Im[(j - 1) * L + k]);
+				}
+
+				const int32 Offset = (Start + k) * ElementStride;
+
+				for (int32 c = 0; c < Count; c += Lane::Width)
+				{
+					Butterfly<L, R, T>(Re + Offset + c, Im + Offset + c, Span, w_re, w_im);
+				}
+			}
+		}
+	}
+
+	/** Merge transforms of size L into ones of size L * R of one contiguous transform, lanes are four offsets k */
+	template<int32 L, int32 R>
+	static void StageAlong(float* Re, float* Im)
+	{
+		static_assert(L % 4 == 0, "Offsets of a stage go four per vector");
+
+		typedef TVaOceanCPUFFTTwiddles<L, R> FTwiddles;
+
+		for (int32 Start = 0; Start < Dim; Start += L * R)
+		{
+			for (int32 k = 0; k < L; k += 4)
+			{
+				VectorRegister w_re[R - 1];
+				VectorRegister w_im[R - 1];
+
+				for (int32 j = 1; j < R; j++)
+				{
+					w_re[j - 1] = VectorLoad(FTwiddles::Re + (j - 1) * L + k);
+					w_im[j - 1] = VectorLoad(FTwiddles::Im + (j - 1) * L + k);
+				}
+
+				Butterfly<L, R, VectorRegister>(Re + Start + k, Im + Start + k, L, w_re, w_im);
+			}
+		}
+	}
+};
+
+/** Forward transform of Count neighbour transforms, see TVaOceanCPUFFT::Transform */
+typedef void (*FVaOceanCPUFFTKernel)(float* Re, float* Im, int32 ElementStride, int32 Count);
+
+/** Specialized transform of given size or null when there is none */
+inline FVaOceanCPUFFTKernel GetVaOceanCPUFFTKernel(int32 Dim)
+{
+	switch (Dim)
+	{
+	case 128:
+		return &TVaOceanCPUFFT<128>::Transform;
+
+	case 256:
+		return &TVaOceanCPUFFT<256>::Transform;
+
+	case 512:
+		return &TVaOceanCPUFFT<512>::Transform;
+
+	default:
+		return nullptr;
+	}
+}
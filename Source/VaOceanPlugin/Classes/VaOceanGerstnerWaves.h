@@ -0,0 +1,101 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Analytic fallback of spectrum FFT: sum of the strongest waves picked from H(0) generated by InitHeightMap.
+ *
+ * Each texel k of packed H(0) holds two travelling waves: h0(k) moving along k and conj(h0(-k)) moving
+ * against it. A wave contributes
+ *
+ *		Dz = A * cos(psi), (Dx, Dy) = -ChoppyScale * A * normalize(K) * sin(psi), psi = dot(K, UV) - omega * t + phase
+ *
+ * which is exactly its part of the FFT sum at texel positions. Waves are picked per direction sector and
+ * frequency octave in proportion to the energy of the band, and scaled so each band keeps its energy.
+ * The surface stays statistically close to the FFT one while cost is set by the number of waves.
+ *
+ * Picked without stratification, the strongest waves are a truncated FFT sum. It's evaluated at sparse points
+ * when a few point queries are cheaper than the whole CPU grid.
+ *
+ * Wave parameters are kept as SoA arrays padded to SIMD width with silent waves.
+ */
+class VAOCEANPLUGIN_API FVaOceanGerstnerWaves
+{
+public:
+	FVaOceanGerstnerWaves();
+
+	/**
+	 * Pick waves from spectrum. Safe to call from worker thread.
+	 *
+	 * @param InDim				Displacement map dimension of the spectrum
+	 * @param InH0				Packed H(0) (xy: h0(k), zw: conj(h0(-k))), InDim * InDim texels
+	 * @param InOmega			Angular frequency, InDim * InDim texels
+	 * @param InCount			Number of waves to pick
+	 * @param InDirectionBins	Direction sectors of stratification. With 0 the strongest waves of the whole spectrum are
+	 *							picked as they are, so the sum converges to the FFT surface instead of its statistics.
+	 */
+	void Initialize(int32 InDim, const FVector4* InH0, const float* InOmega, int32 InCount, int32 InDirectionBins);
+
+	/** Bytes of arena taken by Initialize */
+	static SIZE_T GetArenaSize(int32 InCount);
+
+	/** Free all buffers */
+	void Release();
+
+	/** Whether waves were picked */
+	bool IsInitialized() const;
+
+	/** Number of waves, padding included */
+	int32 Num() const;
+
+	/** Waves packed for GerstnerDisplacementPS, two texels each: (K, omega, phase) and (A, -A * normalize(K), 0) */
+	void GetShaderData(TArray<FVector4>& OutData) const;
+
+	/** Exact max absolute displacement (dx, dy, dz) of the sum */
+	FVector GetDisplacementBound(float ChoppyScale) const;
+
+	/**
+	 * Evaluate the sum at texel positions (UV = texel / InDim) of displacement and optional velocity planes,
+	 * in the same units as FFT output. Rows are evaluated in parallel, four texels at a time.
+	 *
+	 * @param Time				Scaled simulation time
+	 * @param TimeScale			Simulation time per world second
+	 * @param OutDisplacement	Planes (dx, dy, dz) with InStride floats per row
+	 * @param OutVelocity		Planes (vx, vy, vz) or null
+	 */
+	void EvaluateGrid(int32 InDim, int32 InStride, float Time, float TimeScale, float ChoppyScale, float* const* OutDisplacement, float* const* OutVelocity) const;
+
+	/**
+	 * Evaluate the sum at arbitrary points without any grid, four waves at a time. Cost is O(points * waves).
+	 *
+	 * @param InUVs				Points in the UV space of EvaluateGrid, texel x is at x / InDim
+	 * @param OutDisplacement	Displacement of each point
+	 * @param OutVelocity		Velocity of each point or null
+	 */
+	void EvaluatePoints(const FVector2D* InUVs, int32 InNum, float Time, float TimeScale, float ChoppyScale, FVector* OutDisplacement, FVector* OutVelocity) const;
+
+protected:
+	/** Number of waves padded to SIMD width */
+	int32 Count;
+
+	/** Memory of wave arrays */
+	FVaOceanCPUArena Arena;
+
+	/** Wave vector in UV space, 2 * PI * k */
+	float* Kx;
+	float* Ky;
+
+	/** Angular frequency */
+	float* Omega;
+
+	/** Phase at t = 0 */
+	float* Phase;
+
+	/** Height amplitude A */
+	float* Amplitude;
+
+	/** Horizontal displacement amplitude -A * normalize(K) */
+	float* ChoppyX;
+	float* ChoppyY;
+
+};
@@ -0,0 +1,112 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Frames of packed wake sources that can be in flight to render thread */
+#define WAKE_SOURCE_RING_SIZE 3
+
+/**
+ * Sizes of all buffers used by one simulator, computed up front from its configuration.
+ * Buffers are allocated once per plan and kept while the plan stays the same, so spectrum
+ * changes (new seed) only regenerate data and steady-state ticks don't reallocate them. Ticks still
+ * allocate engine-side: task graph dispatch of ParallelFor and render command payloads.
+ */
+struct VAOCEANPLUGIN_API FVaOceanMemoryPlan
+{
+	/** Displacement map dimension, 0 for empty plan */
+	int32 Dim;
+
+	/** H(t), Dx(t), Dy(t) and optional velocity slices */
+	int32 FFTSlices;
+
+	/** Second Dxyz buffer for async compute */
+	bool bAsyncCompute;
+
+	/** Number of band-limited gradient mips */
+	int32 SpectrumMipCount;
+
+	/** CPU backend is simulated */
+	bool bCPUSimulation;
+
+	/** Analytic waves replacing spectrum FFT, 0 in FFT mode */
+	int32 GerstnerWaveCount;
+
+	/** Spectrum waves summed by point queries, 0 without them */
+	int32 PointQueryWaveCount;
+
+	/** Height query cache tile side and number of tiles, 0 without the cache */
+	int32 QueryCacheTileSize;
+	int32 QueryCacheTileCount;
+
+	/** Wake grid dimension and source buffer capacity, 0 without wakes */
+	int32 WakeDim;
+	int32 WakeSourceCount;
+
+	/** Entries of fold spawn list, 0 without it */
+	int32 SpawnListCapacity;
+
+	/** GPU: packed H(0) (allocated twice, for sea state transition target) and omega, FFT mode only. Spectrum staging takes them in any mode. */
+	uint32 H0Bytes;
+	uint32 OmegaBytes;
+
+	/** GPU: H(t) slices, Dxyz and FFT temp buffer are of the same size */
+	uint32 SliceBytes;
+
+	/** GPU: all levels of bounds pyramid */
+	uint32 BoundsBytes;
+
+	/** GPU: wake height ring (3 buffers) and source buffer */
+	uint32 WakeBytes;
+
+	/** GPU: fold spawn list entries and its indirect arguments */
+	uint32 SpawnListBytes;
+
+	/** GPU: packed analytic waves, two texels each */
+	uint32 GerstnerBytes;
+
+	/** GPU: H(t), Dxyz and FFT temp buffers of all band-limited mips */
+	uint32 SpectrumMipBytes;
+
+	/** CPU: spectrum generation scratch ((Dim + 1)^2 wave vectors) */
+	SIZE_T SpectrumGenBytes;
+
+	/** CPU: staging arena for H(0), omega and generation scratch */
+	SIZE_T StagingBytes;
+
+	/** CPU: arena of FVaOceanCPUBackend, 0 without CPU simulation */
+	SIZE_T CPUBackendBytes;
+
+	/** CPU: arena of FVaOceanWakeSolver, 0 without CPU simulation or wakes */
+	SIZE_T WakeSolverBytes;
+
+	/** CPU: queued wake sources and ring of packed ones handed to render thread, 0 without wakes */
+	SIZE_T WakeSourceBytes;
+
+	/** CPU: arena of FVaOceanGerstnerWaves, 0 in FFT mode */
+	SIZE_T GerstnerWavesBytes;
+
+	/** CPU: waves of point queries, current and sea state transition target */
+	SIZE_T PointQueryWavesBytes;
+
+	/** CPU: arena of FVaOceanQueryCache, 0 without CPU simulation or the cache */
+	SIZE_T QueryCacheBytes;
+
+	/** Empty plan */
+	FVaOceanMemoryPlan();
+
+	/** Plan for given simulator configuration */
+	FVaOceanMemoryPlan(int32 InDim, bool bInSimulateVelocity, bool bInAsyncCompute, bool bInBandLimitedMips, bool bInCPUSimulation, int32 InWakeDim, int32 InWakeSourceCount, int32 InGerstnerWaveCount, int32 InPointQueryWaveCount, int32 InQueryCacheTileSize, int32 InQueryCacheTileCount, int32 InSpawnListCapacity);
+
+	/** Whether plan has any buffers */
+	bool IsValid() const;
+
+	/** Total size of structured buffers */
+	uint64 GetGPUBytes() const;
+
+	/** Total size of CPU arenas */
+	SIZE_T GetCPUBytes() const;
+
+	/** Buffers of equal plans can be reused */
+	bool operator==(const FVaOceanMemoryPlan& Other) const;
+	bool operator!=(const FVaOceanMemoryPlan& Other) const;
+};
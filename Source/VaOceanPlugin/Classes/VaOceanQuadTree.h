@@ -0,0 +1,118 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Quadtree LOD configuration */
+struct FVaOceanQuadTreeSettings
+{
+	/** World space center of ocean surface */
+	FVector2D Center;
+
+	/** Half size of ocean surface, tiled with root nodes */
+	float Extent;
+
+	/** Size of the finest (LOD 0) patch */
+	float MinPatchSize;
+
+	/** Number of LOD levels, root nodes are MinPatchSize * 2^(LODCount - 1) */
+	int32 LODCount;
+
+	/** Distance covered by LOD 0, each next LOD covers twice as far */
+	float LODBaseRange;
+
+	/** Part of LOD range [0..1] after which vertices start to morph into the next LOD grid */
+	float MorphStartRatio;
+
+	/** Vertical bounds of displaced surface, world space */
+	float MinHeight;
+	float MaxHeight;
+
+	/** Horizontal displacement bound, patches are expanded by it for culling */
+	float HorizontalPadding;
+
+	/** Defaults */
+	FVaOceanQuadTreeSettings()
+		: Center(0.f, 0.f)
+		, Extent(400000.f)
+		, MinPatchSize(2000.f)
+		, LODCount(8)
+		, LODBaseRange(4000.f)
+		, MorphStartRatio(0.7f)
+		, MinHeight(-1000.f)
+		, MaxHeight(1000.f)
+		, HorizontalPadding(0.f)
+	{
+	}
+};
+
+/** Selected surface patch */
+struct FVaOceanPatch
+{
+	/** World space center */
+	FVector2D Center;
+
+	/** Side length */
+	float Size;
+
+	/** LOD level, 0 is the finest */
+	int32 LOD;
+
+	/** Distance range where patch grid morphs into the next LOD grid */
+	float MorphStart;
+	float MorphEnd;
+};
+
+/**
+ * CDLOD style quadtree: selects patches of the shared grid mesh by camera distance and
+ * culls them against view frustum using displacement bounds. Has no engine dependencies,
+ * so it can be used headless (server, tests).
+ */
+class VAOCEANPLUGIN_API FVaOceanQuadTree
+{
+public:
+	FVaOceanQuadTree();
+
+	/** Set configuration and rebuild LOD ranges */
+	void SetSettings(const FVaOceanQuadTreeSettings& InSettings);
+
+	/** Current configuration */
+	const FVaOceanQuadTreeSettings& GetSettings() const;
+
+	/** Distance covered by given LOD */
+	float GetLODRange(int32 LOD) const;
+
+	/**
+	 * Select patches for given view
+	 *
+	 * @param ViewOrigin	Camera location
+	 * @param Frustum		Planes with normals pointing inside, empty array disables culling
+	 * @param OutPatches	Selected patches (array is reset)
+	 */
+	void Select(const FVector& ViewOrigin, const TArray<FPlane>& Frustum, TArray<FVaOceanPatch>& OutPatches) const;
+
+	/**
+	 * Build frustum planes (left, right, top, bottom, far) with normals pointing inside
+	 *
+	 * @param HalfFOV		Horizontal half field of view, radians
+	 * @param AspectRatio	Width / height
+	 */
+	static void BuildFrustum(const FVector& Origin, const FVector& Forward, const FVector& Right, const FVector& Up,
+		float HalfFOV, float AspectRatio, float FarDistance, TArray<FPlane>& OutFrustum);
+
+protected:
+	/** Recursive node selection */
+	void SelectNode(const FVector2D& NodeCenter, float NodeSize, int32 LOD, const FVector& ViewOrigin, const TArray<FPlane>& Frustum, TArray<FVaOceanPatch>& OutPatches) const;
+
+	/** Whether box is at least partially inside frustum */
+	static bool IsBoxInFrustum(const FVector& BoxCenter, const FVector& BoxExtent, const TArray<FPlane>& Frustum);
+
+	/** Whether box intersects sphere */
+	static bool IsBoxInSphere(const FVector& BoxCenter, const FVector& BoxExtent, const FVector& SphereCenter, float Radius);
+
+protected:
+	FVaOceanQuadTreeSettings Settings;
+
+	/** Distance covered by each LOD */
+	TArray<float> LODRanges;
+
+};
@@ -0,0 +1,142 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Slots probed for a tile before the query is answered without the cache */
+#define QUERY_CACHE_MAX_PROBES 4
+
+/** Largest tile side, samples of one tile are gathered on the stack */
+#define QUERY_CACHE_MAX_TILE_SIZE 32
+
+/** Query counters of one cache generation */
+struct FVaOceanQueryCacheStats
+{
+	/** Queries answered from resolved tiles */
+	int32 Hits;
+
+	/** Queries that resolved their tile */
+	int32 Misses;
+
+	/** Queries answered directly: tile was being resolved by another thread or all probed slots were taken */
+	int32 Bypasses;
+
+	FVaOceanQueryCacheStats()
+		: Hits(0)
+		, Misses(0)
+		, Bypasses(0)
+	{
+	}
+
+	/** Share of queries answered from resolved tiles [0..1] */
+	float GetHitRate() const
+	{
+		const int32 Total = Hits + Misses + Bypasses;
+		return (Total > 0) ? (float)Hits / Total : 0.f;
+	}
+};
+
+/**
+ * Frame-scoped cache of resolved height in front of CPU height queries. Buoyancy and other gameplay code
+ * sample many close points each frame, so heights at texel centers of the CPU grid are resolved a tile
+ * at a time and queries are bilinear fetches of the tile.
+ *
+ * Tiles live in a fixed open-addressed table. Each slot is owned through one 64-bit tag
+ * (generation, tile, ready) changed with compare-exchange, so readers on any thread never wait: a tile
+ * being resolved by another thread is answered directly instead. Invalidate starts a new generation,
+ * resolved tiles of older ones are free to be claimed again. A slot whose resolver is still writing it
+ * stays owned by that resolver's generation until it is published.
+ */
+class VAOCEANPLUGIN_API FVaOceanQueryCache
+{
+public:
+	/** Heights of the surface at given UVs of the CPU grid */
+	typedef TFunctionRef<void(const FVector2D* InUVs, int32 InNum, float* OutHeights)> FResolveHeights;
+
+	FVaOceanQueryCache();
+
+	/**
+	 * Allocate slots, all tiles are dropped
+	 *
+	 * @param InDim			CPU grid dimension, power of 2
+	 * @param InTileSize	Texels along tile side, power of 2 not larger than InDim and QUERY_CACHE_MAX_TILE_SIZE
+	 * @param InTileCount	Number of slots, rounded up to power of 2
+	 */
+	void Initialize(int32 InDim, int32 InTileSize, int32 InTileCount);
+
+	/** Bytes of arena taken by Initialize */
+	static SIZE_T GetArenaSize(int32 InTileSize, int32 InTileCount);
+
+	/** Free all buffers */
+	void Release();
+
+	/** Whether cache has slots */
+	bool IsInitialized() const;
+
+	/** Drop all tiles, called when surface changes. Counters of the ending generation are published to stats. Game thread only. */
+	void Invalidate();
+
+	/**
+	 * Height at UV of the CPU grid, bilinear between texel centers the same way as FVaOceanCPUBackend::SampleHeight.
+	 * Safe to call from any thread.
+	 *
+	 * @param Resolve	Computes heights of a missed tile, or of the query itself when the cache is bypassed
+	 */
+	float SampleHeight(const FVector2D& UV, FResolveHeights Resolve) const;
+
+	/** Counters of the last complete generation */
+	const FVaOceanQueryCacheStats& GetLastStats() const;
+
+protected:
+	/** Tag of a slot owned by given tile */
+	static int64 MakeTag(int32 InGeneration, int32 TileKey, bool bReady);
+
+	/** Resolve heights of one tile into slot samples */
+	void ResolveTile(int32 SlotIndex, int32 TileX, int32 TileY, FResolveHeights Resolve) const;
+
+	/** Bilinear fetch of slot samples, X and Y are texel coordinates local to the tile */
+	float SampleTile(int32 SlotIndex, int32 LocalX, int32 LocalY, float TX, float TY) const;
+
+protected:
+	/** CPU grid dimension */
+	int32 Dim;
+
+	/** Texels along tile side and its log2 */
+	int32 TileSize;
+	int32 TileShift;
+
+	/** Tiles along grid side */
+	int32 TilesPerRow;
+
+	/** Number of slots minus one */
+	int32 SlotMask;
+
+	/** Shift of multiplicative tile hash, 32 - log2(number of slots) */
+	int32 SlotShift;
+
+	/** Samples along tile side: one more than texels, so bilinear fetch never leaves the tile */
+	int32 SampleRowSize;
+
+	/** Samples of one tile */
+	int32 SamplesPerTile;
+
+	/** Memory of tags and samples */
+	FVaOceanCPUArena Arena;
+
+	/** Owner of each slot, see MakeTag */
+	volatile int64* Tags;
+
+	/** Resolved heights, SamplesPerTile per slot */
+	float* Samples;
+
+	/** Current generation, tags of other ones are stale */
+	volatile int32 Generation;
+
+	/** Counters of the current generation */
+	mutable FThreadSafeCounter HitCount;
+	mutable FThreadSafeCounter MissCount;
+	mutable FThreadSafeCounter BypassCount;
+
+	/** Counters of the last complete generation */
+	FVaOceanQueryCacheStats LastStats;
+
+};
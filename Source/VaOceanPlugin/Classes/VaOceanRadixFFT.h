@@ -17,7 +17,21 @@
 #define FFT_FORWARD -1
 #define FFT_INVERSE 1
 
-#define FFT_PARAM_SETS 6
+/** 512x512 takes 6 radix-8 passes, smaller sizes can take up to 8 passes with radix-2 ones */
+#define FFT_PARAM_SETS 8
+
+/** log2 of the largest transform size */
+#define FFT_MAX_LOG_DIM 9
+
+/** Frames of pass timings averaged into one r.VaOcean.FFTPassTiming report */
+#define FFT_TIMING_FRAMES 64
+
+/** Radix of FRadix008A_CS and FRadix002A_CS passes */
+#define FFT_RADIX_8 8
+#define FFT_RADIX_2 2
+
+/** Compiled pass of TRadixPassCS from global shader map */
+typedef FRadixPassCS* (*FRadixPassShaderGetter)(TShaderMap<FGlobalShaderType>* ShaderMap);
 
 /** Per frame parameters for FRadix008A_CS shader */
 USTRUCT()
@@ -30,9 +44,15 @@ struct FRadix008A_CSPerFrame
 	uint32 istride;
 	uint32 pstride;
 	float PhaseBase;
+
+	/** FFT_RADIX_8 or FFT_RADIX_2 */
+	uint32 Radix;
+
+	/** Permutation with all of the above but ThreadCount compiled in, picked by RadixCreatePlan */
+	FRadixPassShaderGetter PassShader;
 };
 
-/** Radix FFT data (for 512x512 buffer size) */
+/** Radix FFT data (for 512x512 buffer size by default, any power of two up to it) */
 USTRUCT()
 struct FRadixPlan512
 {
@@ -41,6 +61,12 @@ struct FRadixPlan512
 	// More than one array can be transformed at same time
 	uint32 Slices;
 
+	// Transform size in each dimension
+	uint32 Dim;
+
+	// Number of used param sets, always even so the result ends up in destination buffer
+	uint32 PassCount;
+
 	// For 512x512 config, we need 6 sets of parameters
 	FRadix008A_CSPerFrame PerFrame[FFT_PARAM_SETS];
 
@@ -48,14 +74,95 @@ struct FRadixPlan512
 	FStructuredBufferRHIRef pBuffer_Tmp;
 	FUnorderedAccessViewRHIRef pUAV_Tmp;
 	FShaderResourceViewRHIRef pSRV_Tmp;
+
+	// Timestamps before the first pass and after each pass, created on first timed transform
+	FRenderQueryRHIRef TimingQueries[FFT_PARAM_SETS + 1];
+
+	// Timestamps were written and not read back yet
+	bool bTimingPending;
+
+	// Sums of pass durations (microseconds) and number of timed transforms since the last report
+	uint64 TimingSums[FFT_PARAM_SETS];
+	uint32 TimingFrames;
 };
 
 
-void RadixCreatePlan(FRadixPlan512* Plan, uint32 Slices);
+/** Parameters of all passes of Dim x Dim transform of given slices (columns, then rows). Returns number of passes written to OutPasses. */
+uint32 RadixGetPasses(uint32 Dim, uint32 Slices, FRadix008A_CSPerFrame* OutPasses);
+
+/** Dim is split into radix-8 passes, the remainder takes radix-2 ones */
+void RadixCreatePlan(FRadixPlan512* Plan, uint32 Slices, uint32 Dim = 512);
 void RadixDestroyPlan(FRadixPlan512* Plan);
 
-void RadixCompute(	FRHICommandListImmediate& RHICmdList,
+/** Create pass permutations of all transform sizes, render thread only */
+void RadixPrewarmShaders(TShaderMap<FGlobalShaderType>* ShaderMap);
+
+/** Can be recorded on graphics (FRHICommandListImmediate) or async compute (FRHIAsyncComputeCommandListImmediate) command list */
+template<typename TRHICmdList>
+void RadixCompute(	TRHICmdList& RHICmdList,
 					FRadixPlan512* Plan,
 					FUnorderedAccessViewRHIRef pUAV_Dst,
 					FShaderResourceViewRHIRef pSRV_Dst, 
 					FShaderResourceViewRHIRef pSRV_Src);
+
+/**
+ * Average GPU time of each pass over Iterations transforms, in microseconds. Generic shaders or pass permutations
+ * are picked by bPassPermutations regardless of r.VaOcean.FFTPassPermutations. Waits for every transform, benchmarks only.
+ */
+void RadixMeasurePasses(	FRHICommandListImmediate& RHICmdList,
+							FRadixPlan512* Plan,
+							bool bPassPermutations,
+							uint32 Iterations,
+							FUnorderedAccessViewRHIRef pUAV_Dst,
+							FShaderResourceViewRHIRef pSRV_Dst,
+							FShaderResourceViewRHIRef pSRV_Src,
+							float* OutPassMicroseconds);
+
+
+//////////////////////////////////////////////////////////////////////////
+// Radix pass permutations
+
+/**
+ * One pass of one transform size with compile-time strides and phase base, so address math is folded
+ * and the butterfly is fully unrolled. Permutations that don't exist for the size are not compiled.
+ */
+template<uint32 LogDim, uint32 Pass>
+class TRadixPassCS : public FRadixPassCS
+{
+	DECLARE_SHADER_TYPE(TRadixPassCS, Global);
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		FRadix008A_CSPerFrame Passes[FFT_PARAM_SETS];
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5) && Pass < RadixGetPasses(1 << LogDim, 1, Passes);
+	}
+
+	static void ModifyCompilationEnvironment(EShaderPlatform Platform, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Platform, OutEnvironment);
+
+		FRadix008A_CSPerFrame Passes[FFT_PARAM_SETS];
+		RadixGetPasses(1 << LogDim, 1, Passes);
+
+		OutEnvironment.SetDefine(TEXT("FFT_RADIX"), Passes[Pass].Radix);
+		OutEnvironment.SetDefine(TEXT("FFT_ISTRIDE"), Passes[Pass].istride);
+		OutEnvironment.SetDefine(TEXT("FFT_OSTRIDE"), Passes[Pass].ostride);
+		OutEnvironment.SetDefine(TEXT("FFT_PSTRIDE"), Passes[Pass].pstride);
+	}
+
+	TRadixPassCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FRadixPassCS(Initializer)
+	{
+	}
+
+	TRadixPassCS()
+	{
+	}
+};
+
+template<uint32 LogDim, uint32 Pass>
+FRadixPassCS* GetRadixPassShader(TShaderMap<FGlobalShaderType>* ShaderMap)
+{
+	return *TShaderMapRef<TRadixPassCS<LogDim, Pass>>(ShaderMap);
+}
@@ -0,0 +1,68 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Number of rays processed by one worker task */
+#define RAYCAST_BATCH_SIZE 64
+
+/** Ray to be traced against ocean surface */
+struct FVaOceanRay
+{
+	FVector Origin;
+
+	/** Normalized direction */
+	FVector Direction;
+
+	float MaxDistance;
+};
+
+/** Result of ray trace */
+struct FVaOceanRayHit
+{
+	bool bHit;
+
+	/** Distance along the ray */
+	float Distance;
+
+	FVector Location;
+};
+
+/**
+ * Traces rays against the surface simulated by CPU backend. Rays skip tiles with the bounds pyramid,
+ * march the remaining parts with sub-texel steps and refine crossing with the displacement field.
+ * Ocean patch is tiled each PatchLength, SeaLevel is world height of undisplaced surface.
+ */
+class VAOCEANPLUGIN_API FVaOceanRayCaster
+{
+public:
+	FVaOceanRayCaster(const FVaOceanCPUBackend& InBackend, float InPatchLength, float InSeaLevel);
+
+	/** Trace all rays, batches are processed in parallel */
+	void RaycastBatch(const TArray<FVaOceanRay>& Rays, TArray<FVaOceanRayHit>& OutHits) const;
+
+	/** Trace one ray */
+	bool Raycast(const FVaOceanRay& Ray, FVaOceanRayHit& OutHit) const;
+
+	/** World height of displaced surface above given point */
+	float GetHeightAt(const FVector2D& WorldXY) const;
+
+protected:
+	/** Height of ray point above surface, negative when under water */
+	float GetHeightAboveSurface(const FVector& Point) const;
+
+	/** Conservative world height bounds of the surface over segment of the ray */
+	void GetSegmentBounds(const FVector& Start, const FVector& End, float& OutMinHeight, float& OutMaxHeight) const;
+
+protected:
+	const FVaOceanCPUBackend& Backend;
+
+	float PatchLength;
+	float SeaLevel;
+
+	/** World size of one displacement texel */
+	float TexelSize;
+
+	/** World size of level 0 bounds tile */
+	float TileSize;
+
+};
@@ -10,6 +10,12 @@
 
 #define BLOCK_SIZE_X 16
 #define BLOCK_SIZE_Y 16
+#define BOUNDS_REDUCE_BLOCK 8
+
+/** Spawn list arguments: thread group count x, y, z for consumers of SPAWN_LIST_CONSUMER_BLOCK entries each, then entry count */
+#define SPAWN_LIST_ARGS_SIZE 4
+#define SPAWN_LIST_ARGS_COUNT 3
+#define SPAWN_LIST_CONSUMER_BLOCK 64
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -17,6 +23,8 @@
 
 BEGIN_UNIFORM_BUFFER_STRUCT(FUpdateSpectrumUniformParameters, )
 	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, Time)
+	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, TimeScale)
+	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, SpectrumBlend)
 END_UNIFORM_BUFFER_STRUCT(FUpdateSpectrumUniformParameters)
 
 typedef TUniformBufferRef<FUpdateSpectrumUniformParameters> FUpdateSpectrumUniformBufferRef;
@@ -33,6 +41,15 @@ struct FUpdateSpectrumCSImmutable
 	uint32 g_OutHeight;
 	uint32 g_DtxAddressOffset;
 	uint32 g_DtyAddressOffset;
+
+	/** First velocity slice (Vz, Vx), next one is Vy. 0 if velocity is not simulated. */
+	uint32 g_VelocityAddressOffset;
+
+	/** First texel of the central H(0) region transformed by band-limited mip, 0 for top level */
+	uint32 g_SpectrumOffset;
+
+	/** Phase shift per wave number that moves band-limited samples to mip texel centers */
+	float g_SpectrumShift;
 };
 
 /** Per frame parameters for UpdateSpectrumCS shader */
@@ -45,11 +62,38 @@ struct FUpdateSpectrumCSPerFrame
 	FShaderResourceViewRHIRef m_pSRV_Omega;
 	FUnorderedAccessViewRHIRef m_pUAV_Ht;
 
+	/** H(0) of the sea state being blended in, read only with g_SpectrumBlend > 0 */
+	FShaderResourceViewRHIRef m_pSRV_H0Target;
+
+	// FFT input and output
+	FShaderResourceViewRHIRef m_pSRV_Ht;
+	FUnorderedAccessViewRHIRef m_pUAV_Dxyz;
+	FShaderResourceViewRHIRef m_pSRV_Dxyz;
+
 	// Used to pass params into render thread
 	float g_Time;
+	float g_TimeScale;
 	float g_ChoppyScale;
+
+	/** Weight of target H(0), 0 without sea state transition */
+	float g_SpectrumBlend;
+
+	/** Wave numbers further than this from the spectrum center along either axis carry no energy, see GetSpectrumBandRegion */
+	uint32 g_BandRadius;
 };
 
+/**
+ * Square of texels [OutFirst, OutFirst + OutSize) along both axes of a spectrum of InDim, centered the same way as H(0),
+ * that holds wave numbers within InBandRadius. Texels outside of it stay zero.
+ */
+inline void GetSpectrumBandRegion(uint32 InDim, uint32 InBandRadius, uint32& OutFirst, uint32& OutSize)
+{
+	const uint32 Center = InDim / 2;
+
+	OutFirst = (InBandRadius < Center) ? Center - InBandRadius : 0;
+	OutSize = FMath::Min(InDim, Center + InBandRadius + 1) - OutFirst;
+}
+
 /**
  * H(0) -> H(t), D(x,t), D(y,t)
  */
@@ -69,12 +113,18 @@ public:
 		ActualDim.Bind(Initializer.ParameterMap, TEXT("g_ActualDim"), SPF_Mandatory);
 		InWidth.Bind(Initializer.ParameterMap, TEXT("g_InWidth"), SPF_Mandatory);
 		OutWidth.Bind(Initializer.ParameterMap, TEXT("g_OutWidth"), SPF_Mandatory);
-		OutHeight.Bind(Initializer.ParameterMap, TEXT("g_OutHeight"), SPF_Mandatory);
+		OutHeight.Bind(Initializer.ParameterMap, TEXT("g_OutHeight"));
 		DtxAddressOffset.Bind(Initializer.ParameterMap, TEXT("g_DtxAddressOffset"), SPF_Mandatory);
 		DtyAddressOffset.Bind(Initializer.ParameterMap, TEXT("g_DtyAddressOffset"), SPF_Mandatory);
+		VelocityAddressOffset.Bind(Initializer.ParameterMap, TEXT("g_VelocityAddressOffset"));
+		SpectrumOffset.Bind(Initializer.ParameterMap, TEXT("g_SpectrumOffset"));
+		SpectrumShift.Bind(Initializer.ParameterMap, TEXT("g_SpectrumShift"));
+		RegionOffset.Bind(Initializer.ParameterMap, TEXT("g_RegionOffset"));
+		RegionSize.Bind(Initializer.ParameterMap, TEXT("g_RegionSize"), SPF_Mandatory);
 
 		InputH0.Bind(Initializer.ParameterMap, TEXT("g_InputH0"), SPF_Mandatory);
 		InputOmega.Bind(Initializer.ParameterMap, TEXT("g_InputOmega"), SPF_Mandatory);
+		InputH0Target.Bind(Initializer.ParameterMap, TEXT("g_InputH0Target"));
 
 		OutputHtRW.Bind(Initializer.ParameterMap, TEXT("g_OutputHt"), SPF_Mandatory);
 	}
@@ -83,14 +133,16 @@ public:
 	{
 	}
 
+	template<typename TRHICmdList>
 	void SetParameters(
-		FRHICommandList& RHICmdList,
+		TRHICmdList& RHICmdList,
 		uint32 ParamActualDim,
 		uint32 ParamInWidth,
 		uint32 ParamOutWidth,
 		uint32 ParamOutHeight,
 		uint32 ParamDtxAddressOffset,
-		uint32 ParamDtyAddressOffset
+		uint32 ParamDtyAddressOffset,
+		uint32 ParamVelocityAddressOffset
 		)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
@@ -101,13 +153,34 @@ public:
 		SetShaderValue(RHICmdList, ComputeShaderRHI, OutHeight, ParamOutHeight);
 		SetShaderValue(RHICmdList, ComputeShaderRHI, DtxAddressOffset, ParamDtxAddressOffset);
 		SetShaderValue(RHICmdList, ComputeShaderRHI, DtyAddressOffset, ParamDtyAddressOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, VelocityAddressOffset, ParamVelocityAddressOffset);
 	}
 
+	template<typename TRHICmdList>
+	void SetBandLimitParameters(TRHICmdList& RHICmdList, uint32 ParamSpectrumOffset, float ParamSpectrumShift)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SpectrumOffset, ParamSpectrumOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SpectrumShift, ParamSpectrumShift);
+	}
+
+	template<typename TRHICmdList>
+	void SetRegionParameters(TRHICmdList& RHICmdList, uint32 ParamRegionOffset, uint32 ParamRegionSize)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, RegionOffset, ParamRegionOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, RegionSize, ParamRegionSize);
+	}
+
+	template<typename TRHICmdList>
 	void SetParameters(
-		FRHICommandList& RHICmdList,
+		TRHICmdList& RHICmdList,
 		const FUpdateSpectrumUniformBufferRef& UniformBuffer,
 		FShaderResourceViewRHIRef ParamInputH0,
-		FShaderResourceViewRHIRef ParamInputOmega
+		FShaderResourceViewRHIRef ParamInputOmega,
+		FShaderResourceViewRHIRef ParamInputH0Target
 		)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
@@ -116,18 +189,31 @@ public:
 
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputH0.GetBaseIndex(), ParamInputH0);
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputOmega.GetBaseIndex(), ParamInputOmega);
+
+		// Without transition the branch is never taken, but the slot is bound anyway
+		if (InputH0Target.IsBound())
+		{
+			RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputH0Target.GetBaseIndex(), ParamInputH0Target ? ParamInputH0Target : ParamInputH0);
+		}
 	}
 
-	void UnsetParameters(FRHICommandList &RHICmdList)
+	template<typename TRHICmdList>
+	void UnsetParameters(TRHICmdList& RHICmdList)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 		FShaderResourceViewRHIParamRef NullSRV = FShaderResourceViewRHIParamRef();
 
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputH0.GetBaseIndex(), NullSRV);
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputOmega.GetBaseIndex(), NullSRV);
+
+		if (InputH0Target.IsBound())
+		{
+			RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, InputH0Target.GetBaseIndex(), NullSRV);
+		}
 	}
 
-	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputHtRW)
+	template<typename TRHICmdList>
+	void SetOutput(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputHtRW)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 		if (OutputHtRW.IsBound())
@@ -136,7 +222,8 @@ public:
 		}
 	}
 
-	void UnbindBuffers(FRHICommandList& RHICmdList)
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 		if (OutputHtRW.IsBound())
@@ -148,8 +235,8 @@ public:
 	virtual bool Serialize(FArchive& Ar)
 	{
 		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
-		Ar << ActualDim << InWidth << OutWidth << OutHeight << DtxAddressOffset << DtyAddressOffset
-			<< InputH0 << InputOmega << OutputHtRW;
+		Ar << ActualDim << InWidth << OutWidth << OutHeight << DtxAddressOffset << DtyAddressOffset << VelocityAddressOffset
+			<< SpectrumOffset << SpectrumShift << RegionOffset << RegionSize << InputH0 << InputOmega << InputH0Target << OutputHtRW;
 
 		return bShaderHasOutdatedParameters;
 	}
@@ -162,15 +249,333 @@ private:
 	FShaderParameter OutHeight;
 	FShaderParameter DtxAddressOffset;
 	FShaderParameter DtyAddressOffset;
+	FShaderParameter VelocityAddressOffset;
+	FShaderParameter SpectrumOffset;
+	FShaderParameter SpectrumShift;
+	FShaderParameter RegionOffset;
+	FShaderParameter RegionSize;
 
 	// Buffers
 	FShaderResourceParameter InputH0;
 	FShaderResourceParameter InputOmega;
+	FShaderResourceParameter InputH0Target;
 	FShaderResourceParameter OutputHtRW;
 
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+// Displacement bounds pyramid compute shaders
+
+/**
+ * Displacement -> level 0 of bounds pyramid
+ */
+class FBuildBoundsCS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FBuildBoundsCS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FBuildBoundsCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		DstOffset.Bind(Initializer.ParameterMap, TEXT("g_DstOffset"));
+		DstDim.Bind(Initializer.ParameterMap, TEXT("g_DstDim"));
+
+		InputDisplacement.Bind(Initializer.ParameterMap, TEXT("g_InputDisplacement"));
+		OutputBoundsRW.Bind(Initializer.ParameterMap, TEXT("g_OutputBounds"));
+	}
+
+	FBuildBoundsCS()
+	{
+	}
+
+	void SetParameters(FRHICommandList& RHICmdList, uint32 ParamDstOffset, uint32 ParamDstDim, FTextureRHIParamRef ParamInputDisplacement)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, DstOffset, ParamDstOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, DstDim, ParamDstDim);
+
+		RHICmdList.SetShaderTexture(ComputeShaderRHI, InputDisplacement.GetBaseIndex(), ParamInputDisplacement);
+	}
+
+	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputBoundsRW)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputBoundsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputBoundsRW.GetBaseIndex(), ParamOutputBoundsRW);
+		}
+	}
+
+	void UnbindBuffers(FRHICommandList& RHICmdList)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		RHICmdList.SetShaderTexture(ComputeShaderRHI, InputDisplacement.GetBaseIndex(), FTextureRHIParamRef());
+		if (OutputBoundsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputBoundsRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << DstOffset << DstDim << InputDisplacement << OutputBoundsRW;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter DstOffset;
+	FShaderParameter DstDim;
+
+	FShaderResourceParameter InputDisplacement;
+	FShaderResourceParameter OutputBoundsRW;
+
+};
+
+/**
+ * Bounds pyramid level N -> level N + 1
+ */
+class FReduceBoundsCS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FReduceBoundsCS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FReduceBoundsCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		SrcOffset.Bind(Initializer.ParameterMap, TEXT("g_SrcOffset"));
+		SrcDim.Bind(Initializer.ParameterMap, TEXT("g_SrcDim"));
+		DstOffset.Bind(Initializer.ParameterMap, TEXT("g_DstOffset"));
+		DstDim.Bind(Initializer.ParameterMap, TEXT("g_DstDim"));
+
+		OutputBoundsRW.Bind(Initializer.ParameterMap, TEXT("g_OutputBounds"));
+	}
+
+	FReduceBoundsCS()
+	{
+	}
+
+	void SetParameters(FRHICommandList& RHICmdList, uint32 ParamSrcOffset, uint32 ParamSrcDim, uint32 ParamDstOffset, uint32 ParamDstDim)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SrcOffset, ParamSrcOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SrcDim, ParamSrcDim);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, DstOffset, ParamDstOffset);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, DstDim, ParamDstDim);
+	}
+
+	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputBoundsRW)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputBoundsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputBoundsRW.GetBaseIndex(), ParamOutputBoundsRW);
+		}
+	}
+
+	void UnbindBuffers(FRHICommandList& RHICmdList)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputBoundsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputBoundsRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << SrcOffset << SrcDim << DstOffset << DstDim << OutputBoundsRW;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter SrcOffset;
+	FShaderParameter SrcDim;
+	FShaderParameter DstOffset;
+	FShaderParameter DstDim;
+
+	FShaderResourceParameter OutputBoundsRW;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// Fold spawn list compute shaders
+
+/**
+ * Gradient -> spawn list of texels folding above threshold (texel x, texel y, fold, foam)
+ */
+class FCompactSpawnListCS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FCompactSpawnListCS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FCompactSpawnListCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		OutWidth.Bind(Initializer.ParameterMap, TEXT("g_OutWidth"));
+		OutHeight.Bind(Initializer.ParameterMap, TEXT("g_OutHeight"));
+		SpawnListCapacity.Bind(Initializer.ParameterMap, TEXT("g_SpawnListCapacity"));
+		SpawnFoldThreshold.Bind(Initializer.ParameterMap, TEXT("g_SpawnFoldThreshold"));
+
+		InputGradient.Bind(Initializer.ParameterMap, TEXT("g_InputGradient"));
+		OutputSpawnListRW.Bind(Initializer.ParameterMap, TEXT("g_OutputSpawnList"));
+		OutputSpawnArgsRW.Bind(Initializer.ParameterMap, TEXT("g_OutputSpawnArgs"));
+	}
+
+	FCompactSpawnListCS()
+	{
+	}
+
+	void SetParameters(FRHICommandList& RHICmdList, uint32 ParamOutWidth, uint32 ParamOutHeight, uint32 ParamSpawnListCapacity,
+		float ParamSpawnFoldThreshold, FTextureRHIParamRef ParamInputGradient)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, OutWidth, ParamOutWidth);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, OutHeight, ParamOutHeight);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SpawnListCapacity, ParamSpawnListCapacity);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SpawnFoldThreshold, ParamSpawnFoldThreshold);
+
+		RHICmdList.SetShaderTexture(ComputeShaderRHI, InputGradient.GetBaseIndex(), ParamInputGradient);
+	}
+
+	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputSpawnListRW, FUnorderedAccessViewRHIParamRef ParamOutputSpawnArgsRW)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputSpawnListRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnListRW.GetBaseIndex(), ParamOutputSpawnListRW);
+		}
+		if (OutputSpawnArgsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnArgsRW.GetBaseIndex(), ParamOutputSpawnArgsRW);
+		}
+	}
+
+	void UnbindBuffers(FRHICommandList& RHICmdList)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		RHICmdList.SetShaderTexture(ComputeShaderRHI, InputGradient.GetBaseIndex(), FTextureRHIParamRef());
+		if (OutputSpawnListRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnListRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+		if (OutputSpawnArgsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnArgsRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << OutWidth << OutHeight << SpawnListCapacity << SpawnFoldThreshold << InputGradient << OutputSpawnListRW << OutputSpawnArgsRW;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter OutWidth;
+	FShaderParameter OutHeight;
+	FShaderParameter SpawnListCapacity;
+	FShaderParameter SpawnFoldThreshold;
+
+	FShaderResourceParameter InputGradient;
+	FShaderResourceParameter OutputSpawnListRW;
+	FShaderResourceParameter OutputSpawnArgsRW;
+
+};
+
+/**
+ * Appended entry count -> indirect dispatch arguments, entries over capacity are dropped
+ */
+class FFinalizeSpawnArgsCS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FFinalizeSpawnArgsCS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FFinalizeSpawnArgsCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		SpawnListCapacity.Bind(Initializer.ParameterMap, TEXT("g_SpawnListCapacity"));
+
+		OutputSpawnArgsRW.Bind(Initializer.ParameterMap, TEXT("g_OutputSpawnArgs"));
+	}
+
+	FFinalizeSpawnArgsCS()
+	{
+	}
+
+	void SetParameters(FRHICommandList& RHICmdList, uint32 ParamSpawnListCapacity)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, SpawnListCapacity, ParamSpawnListCapacity);
+	}
+
+	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputSpawnArgsRW)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputSpawnArgsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnArgsRW.GetBaseIndex(), ParamOutputSpawnArgsRW);
+		}
+	}
+
+	void UnbindBuffers(FRHICommandList& RHICmdList)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputSpawnArgsRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputSpawnArgsRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << SpawnListCapacity << OutputSpawnArgsRW;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter SpawnListCapacity;
+
+	FShaderResourceParameter OutputSpawnArgsRW;
+
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 // Radix008A_CS compute shader
 
@@ -185,7 +590,7 @@ END_UNIFORM_BUFFER_STRUCT(FRadixFFTUniformParameters)
 typedef TUniformBufferRef<FRadixFFTUniformParameters> FRadixFFTUniformBufferRef;
 
 /**
- * FFT calculations for istride > 1 
+ * Generic radix-8 pass, strides and phase base are read from PerFrameFFT uniform buffer
  */
 class FRadix008A_CS : public FGlobalShader
 {
@@ -208,22 +613,78 @@ public:
 	{
 	}
 
-	void SetParameters(FRHICommandList& RHICmdList, const FRadixFFTUniformBufferRef& UniformBuffer)
+	template<typename TRHICmdList>
+	void SetParameters(TRHICmdList& RHICmdList, const FRadixFFTUniformBufferRef& UniformBuffer)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetUniformBufferParameter(RHICmdList, ComputeShaderRHI, GetUniformBufferParameter<FRadixFFTUniformParameters>(), UniformBuffer);
+	}
+
+	template<typename TRHICmdList>
+	void SetParameters(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef ParamSrcData, FUnorderedAccessViewRHIRef ParamDstData)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, SrcData.GetBaseIndex(), ParamSrcData);
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, DstData.GetBaseIndex(), ParamDstData);
+	}
+
+	template<typename TRHICmdList>
+	void UnsetParameters(TRHICmdList& RHICmdList)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
-		SetUniformBufferParameter(RHICmdList, ComputeShaderRHI, GetUniformBufferParameter<FRadixFFTUniformParameters>(), UniformBuffer);
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, SrcData.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, DstData.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << SrcData << DstData;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	// Buffers
+	FShaderResourceParameter SrcData;
+	FShaderResourceParameter DstData;
+
+};
+
+/**
+ * Radix pass with strides and phase base compiled in, base of TRadixPassCS permutations (see VaOceanRadixFFT.h).
+ * Only the thread count is left to runtime, it depends on number of transformed slices.
+ */
+class FRadixPassCS : public FGlobalShader
+{
+public:
+	FRadixPassCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		ThreadCount.Bind(Initializer.ParameterMap, TEXT("g_ThreadCount"));
+		SrcData.Bind(Initializer.ParameterMap, TEXT("g_SrcData"));
+		DstData.Bind(Initializer.ParameterMap, TEXT("g_DstData"));
+	}
+
+	FRadixPassCS()
+	{
 	}
 
-	void SetParameters(FRHICommandList& RHICmdList, FShaderResourceViewRHIRef ParamSrcData, FUnorderedAccessViewRHIRef ParamDstData)
+	template<typename TRHICmdList>
+	void SetParameters(TRHICmdList& RHICmdList, uint32 ParamThreadCount, FShaderResourceViewRHIRef ParamSrcData, FUnorderedAccessViewRHIRef ParamDstData)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
+		SetShaderValue(RHICmdList, ComputeShaderRHI, ThreadCount, ParamThreadCount);
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, SrcData.GetBaseIndex(), ParamSrcData);
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, DstData.GetBaseIndex(), ParamDstData);
 	}
 
-	void UnsetParameters(FRHICommandList& RHICmdList)
+	template<typename TRHICmdList>
+	void UnsetParameters(TRHICmdList& RHICmdList)
 	{
 		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -234,12 +695,14 @@ public:
 	virtual bool Serialize(FArchive& Ar)
 	{
 		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
-		Ar << SrcData << DstData;
+		Ar << ThreadCount << SrcData << DstData;
 
 		return bShaderHasOutdatedParameters;
 	}
 
 private:
+	FShaderParameter ThreadCount;
+
 	// Buffers
 	FShaderResourceParameter SrcData;
 	FShaderResourceParameter DstData;
@@ -247,19 +710,19 @@ private:
 };
 
 /**
- * pstride and istride parameters are excess here, but we use inheritance as its easier for now
+ * Generic radix-2 pass for transform sizes that are not power of 8
  */
-class FRadix008A_CS2 : public FRadix008A_CS
+class FRadix002A_CS : public FRadix008A_CS
 {
-	DECLARE_SHADER_TYPE(FRadix008A_CS2, Global)
+	DECLARE_SHADER_TYPE(FRadix002A_CS, Global)
 
 public:
-	FRadix008A_CS2(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+	FRadix002A_CS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
 		: FRadix008A_CS(Initializer)
 	{
 	}
 
-	FRadix008A_CS2()
+	FRadix002A_CS()
 	{
 	}
 };
@@ -323,6 +786,9 @@ public:
 BEGIN_UNIFORM_BUFFER_STRUCT(FUpdateDisplacementUniformParameters, )
 	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, ChoppyScale)
 	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, GridLen)
+	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, FoamFade)
+	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, FoamInjection)
+	DECLARE_UNIFORM_BUFFER_STRUCT_MEMBER(float, FoamThreshold)
 END_UNIFORM_BUFFER_STRUCT(FUpdateDisplacementUniformParameters)
 
 typedef TUniformBufferRef<FUpdateDisplacementUniformParameters> FUpdateDisplacementUniformBufferRef;
@@ -434,11 +900,164 @@ private:
 
 };
 
+/**
+ * Post-FFT data wrap up: dDz/dt, dDx/dt, dDy/dt -> Velocity
+ */
+class FUpdateVelocityPS : public FUpdateDisplacementPS
+{
+	DECLARE_SHADER_TYPE(FUpdateVelocityPS, Global)
+
+public:
+	FUpdateVelocityPS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FUpdateDisplacementPS(Initializer)
+	{
+		VelocityAddressOffset.Bind(Initializer.ParameterMap, TEXT("g_VelocityAddressOffset"));
+	}
+
+	FUpdateVelocityPS()
+	{
+	}
+
+	void SetVelocityParameters(FRHICommandList& RHICmdList, uint32 ParamVelocityAddressOffset)
+	{
+		SetShaderValue(RHICmdList, GetPixelShader(), VelocityAddressOffset, ParamVelocityAddressOffset);
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FUpdateDisplacementPS::Serialize(Ar);
+		Ar << VelocityAddressOffset;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter VelocityAddressOffset;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// Analytic waves
+
+/** Per frame parameters for GerstnerDisplacementPS shader */
+USTRUCT()
+struct FGerstnerPSPerFrame
+{
+	GENERATED_USTRUCT_BODY()
+
+	FVector4 m_pQuadVB[4];
+
+	FShaderResourceViewRHIRef g_GerstnerWaves;
+
+	// Used to pass params into render thread
+	uint32 g_GerstnerWaveCount;
+	float g_Time;
+	float g_TimeScale;
+	float g_ChoppyScale;
+	float g_GridLen;
+};
+
+/**
+ * Sum of analytic waves -> Displacement
+ */
+class FGerstnerDisplacementPS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FGerstnerDisplacementPS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FGerstnerDisplacementPS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		ActualDim.Bind(Initializer.ParameterMap, TEXT("g_ActualDim"));
+		GerstnerWaveCount.Bind(Initializer.ParameterMap, TEXT("g_GerstnerWaveCount"));
+		GerstnerTime.Bind(Initializer.ParameterMap, TEXT("g_GerstnerTime"));
+		GerstnerTimeScale.Bind(Initializer.ParameterMap, TEXT("g_GerstnerTimeScale"));
+
+		GerstnerWaves.Bind(Initializer.ParameterMap, TEXT("g_GerstnerWaves"));
+	}
+
+	FGerstnerDisplacementPS()
+	{
+	}
+
+	void SetParameters(
+		FRHICommandList& RHICmdList,
+		const FUpdateDisplacementUniformBufferRef& UniformBuffer,
+		uint32 ParamActualDim,
+		uint32 ParamGerstnerWaveCount,
+		float ParamGerstnerTime,
+		float ParamGerstnerTimeScale,
+		FShaderResourceViewRHIRef ParamGerstnerWaves
+		)
+	{
+		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
+
+		SetUniformBufferParameter(RHICmdList, PixelShaderRHI, GetUniformBufferParameter<FUpdateDisplacementUniformParameters>(), UniformBuffer);
+
+		SetShaderValue(RHICmdList, PixelShaderRHI, ActualDim, ParamActualDim);
+		SetShaderValue(RHICmdList, PixelShaderRHI, GerstnerWaveCount, ParamGerstnerWaveCount);
+		SetShaderValue(RHICmdList, PixelShaderRHI, GerstnerTime, ParamGerstnerTime);
+		SetShaderValue(RHICmdList, PixelShaderRHI, GerstnerTimeScale, ParamGerstnerTimeScale);
+
+		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI, GerstnerWaves.GetBaseIndex(), ParamGerstnerWaves);
+	}
+
+	void UnsetParameters(FRHICommandList& RHICmdList)
+	{
+		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
+
+		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI, GerstnerWaves.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << ActualDim << GerstnerWaveCount << GerstnerTime << GerstnerTimeScale << GerstnerWaves;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter ActualDim;
+	FShaderParameter GerstnerWaveCount;
+	FShaderParameter GerstnerTime;
+	FShaderParameter GerstnerTimeScale;
+
+	// Buffers
+	FShaderResourceParameter GerstnerWaves;
+
+};
+
+/**
+ * Sum of analytic waves -> Velocity
+ */
+class FGerstnerVelocityPS : public FGerstnerDisplacementPS
+{
+	DECLARE_SHADER_TYPE(FGerstnerVelocityPS, Global)
+
+public:
+	FGerstnerVelocityPS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGerstnerDisplacementPS(Initializer)
+	{
+	}
+
+	FGerstnerVelocityPS()
+	{
+	}
+
+};
+
 
 //////////////////////////////////////////////////////////////////////////
 // Generate Normal
 
-/** Per frame parameters for UpdateDisplacementPS shader */
+/** Per frame parameters for GenGradientFoldingPS shader */
 USTRUCT()
 struct FGenGradientFoldingPSPerFrame
 {
@@ -449,10 +1068,13 @@ struct FGenGradientFoldingPSPerFrame
 	// Used to pass params into render thread
 	float g_ChoppyScale;
 	float g_GridLen;
+	float g_FoamFade;
+	float g_FoamInjection;
+	float g_FoamThreshold;
 };
 
 /**
- * Displacement -> Normal, Folding
+ * Displacement, Foam(t - 1) -> Normal, Folding, Foam(t)
  */
 class FGenGradientFoldingPS : public FGlobalShader
 {
@@ -476,6 +1098,8 @@ public:
 
 		DisplacementMap.Bind(Initializer.ParameterMap, TEXT("DisplacementMap"));
 		DisplacementMapSampler.Bind(Initializer.ParameterMap, TEXT("DisplacementMapSampler"));
+		FoamMap.Bind(Initializer.ParameterMap, TEXT("FoamMap"));
+		FoamMapSampler.Bind(Initializer.ParameterMap, TEXT("FoamMapSampler"));
 	}
 
 	FGenGradientFoldingPS()
@@ -505,7 +1129,8 @@ public:
 	void SetParameters(
 		FRHICommandList& RHICmdList,
 		const FUpdateDisplacementUniformBufferRef& UniformBuffer,
-		FTextureRHIParamRef DisplacementMapRHI
+		FTextureRHIParamRef DisplacementMapRHI,
+		FTextureRHIParamRef FoamMapRHI
 		)
 	{
 		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
@@ -514,6 +1139,10 @@ public:
 
 		FSamplerStateRHIParamRef SamplerStateLinear = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
 		SetTextureParameter(RHICmdList, PixelShaderRHI, DisplacementMap, DisplacementMapSampler, SamplerStateLinear, DisplacementMapRHI);
+
+		// Foam history is read texel to texel
+		FSamplerStateRHIParamRef SamplerStatePoint = TStaticSamplerState<SF_Point, AM_Wrap, AM_Wrap, AM_Wrap>::GetRHI();
+		SetTextureParameter(RHICmdList, PixelShaderRHI, FoamMap, FoamMapSampler, SamplerStatePoint, FoamMapRHI);
 	}
 
 	void UnsetParameters(FRHICommandList& RHICmdList) {}
@@ -522,7 +1151,7 @@ public:
 	{
 		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
 		Ar << ActualDim << InWidth << OutWidth << OutHeight << DtxAddressOffset << DtyAddressOffset
-			<< DisplacementMap << DisplacementMapSampler;
+			<< DisplacementMap << DisplacementMapSampler << FoamMap << FoamMapSampler;
 
 		return bShaderHasOutdatedParameters;
 	}
@@ -540,5 +1169,259 @@ private:
 	FShaderResourceParameter DisplacementMap;
 	FShaderResourceParameter DisplacementMapSampler;
 
+	// Foam accumulated on previous frame
+	FShaderResourceParameter FoamMap;
+	FShaderResourceParameter FoamMapSampler;
+
+};
+
+
+/**
+ * Post-FFT Dx, Dy, Dz of band-limited spectrum, Foam(t) -> Normal, Folding, Foam of gradient mip
+ */
+class FGenGradientFoldingMipPS : public FUpdateDisplacementPS
+{
+	DECLARE_SHADER_TYPE(FGenGradientFoldingMipPS, Global)
+
+public:
+	FGenGradientFoldingMipPS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FUpdateDisplacementPS(Initializer)
+	{
+		MipTexelScale.Bind(Initializer.ParameterMap, TEXT("g_MipTexelScale"));
+		FoamMap.Bind(Initializer.ParameterMap, TEXT("FoamMap"));
+		FoamMapSampler.Bind(Initializer.ParameterMap, TEXT("FoamMapSampler"));
+	}
+
+	FGenGradientFoldingMipPS()
+	{
+	}
+
+	void SetMipParameters(FRHICommandList& RHICmdList, float ParamMipTexelScale, FTextureRHIParamRef FoamMapRHI)
+	{
+		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
+
+		SetShaderValue(RHICmdList, PixelShaderRHI, MipTexelScale, ParamMipTexelScale);
+
+		// Foam of the top level is averaged over mip texel
+		FSamplerStateRHIParamRef SamplerStateLinear = TStaticSamplerState<SF_Bilinear, AM_Wrap, AM_Wrap, AM_Wrap>::GetRHI();
+		SetTextureParameter(RHICmdList, PixelShaderRHI, FoamMap, FoamMapSampler, SamplerStateLinear, FoamMapRHI);
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FUpdateDisplacementPS::Serialize(Ar);
+		Ar << MipTexelScale << FoamMap << FoamMapSampler;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter MipTexelScale;
+
+	FShaderResourceParameter FoamMap;
+	FShaderResourceParameter FoamMapSampler;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// Local wave layer (wakes)
+
+/** Per frame parameters of wake layer, see AVaOceanSimulator::UpdateWakes */
+USTRUCT()
+struct FWakeStepPerFrame
+{
+	GENERATED_USTRUCT_BODY()
+
+	FVector4 m_pQuadVB[4];
+
+	/** Height ring: the step reads current and previous buffer and writes the next one */
+	FUnorderedAccessViewRHIRef m_pUAV_Height[3];
+	FShaderResourceViewRHIRef m_pSRV_Height[3];
+
+	/** Grid origin each buffer was written at, heights are shifted by the difference when grid has moved */
+	FIntPoint BufferOrigin[3];
+
+	FStructuredBufferRHIRef m_pBuffer_Sources;
+	FShaderResourceViewRHIRef m_pSRV_Sources;
+
+	/** Packed sources (cell x, cell y, radius in cells, strength), slice of the simulator's source ring */
+	const FVector4* Sources;
+	int32 NumSources;
+
+	// Used to pass params into render thread
+	uint32 g_WakeDim;
+	float g_WakeCellSize;
+	FVector4 g_WakeStep;
+	FIntPoint Origin;
+	int32 ReadIndex;
+	int32 NumSteps;
+};
+
+/**
+ * Current, previous wake height -> next wake height
+ */
+class FWakeStepCS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FWakeStepCS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FWakeStepCS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		WakeDim.Bind(Initializer.ParameterMap, TEXT("g_WakeDim"));
+		WakeShiftCur.Bind(Initializer.ParameterMap, TEXT("g_WakeShiftCur"));
+		WakeShiftPrev.Bind(Initializer.ParameterMap, TEXT("g_WakeShiftPrev"));
+		WakeStep.Bind(Initializer.ParameterMap, TEXT("g_WakeStep"));
+		WakeSourceCount.Bind(Initializer.ParameterMap, TEXT("g_WakeSourceCount"));
+
+		WakeSources.Bind(Initializer.ParameterMap, TEXT("g_WakeSources"));
+		WakeHeight.Bind(Initializer.ParameterMap, TEXT("g_WakeHeight"));
+		WakePrevHeight.Bind(Initializer.ParameterMap, TEXT("g_WakePrevHeight"));
+		OutputWakeHeightRW.Bind(Initializer.ParameterMap, TEXT("g_OutputWakeHeight"));
+	}
+
+	FWakeStepCS()
+	{
+	}
+
+	void SetParameters(
+		FRHICommandList& RHICmdList,
+		uint32 ParamWakeDim,
+		const FIntPoint& ParamWakeShiftCur,
+		const FIntPoint& ParamWakeShiftPrev,
+		const FVector4& ParamWakeStep,
+		uint32 ParamWakeSourceCount,
+		FShaderResourceViewRHIParamRef ParamWakeSources,
+		FShaderResourceViewRHIParamRef ParamWakeHeight,
+		FShaderResourceViewRHIParamRef ParamWakePrevHeight
+		)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+		SetShaderValue(RHICmdList, ComputeShaderRHI, WakeDim, ParamWakeDim);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, WakeShiftCur, ParamWakeShiftCur);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, WakeShiftPrev, ParamWakeShiftPrev);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, WakeStep, ParamWakeStep);
+		SetShaderValue(RHICmdList, ComputeShaderRHI, WakeSourceCount, ParamWakeSourceCount);
+
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakeSources.GetBaseIndex(), ParamWakeSources);
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakeHeight.GetBaseIndex(), ParamWakeHeight);
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakePrevHeight.GetBaseIndex(), ParamWakePrevHeight);
+	}
+
+	void SetOutput(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIParamRef ParamOutputWakeHeightRW)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		if (OutputWakeHeightRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputWakeHeightRW.GetBaseIndex(), ParamOutputWakeHeightRW);
+		}
+	}
+
+	void UnbindBuffers(FRHICommandList& RHICmdList)
+	{
+		FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+		FShaderResourceViewRHIParamRef NullSRV = FShaderResourceViewRHIParamRef();
+
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakeSources.GetBaseIndex(), NullSRV);
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakeHeight.GetBaseIndex(), NullSRV);
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, WakePrevHeight.GetBaseIndex(), NullSRV);
+		if (OutputWakeHeightRW.IsBound())
+		{
+			RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputWakeHeightRW.GetBaseIndex(), FUnorderedAccessViewRHIParamRef());
+		}
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << WakeDim << WakeShiftCur << WakeShiftPrev << WakeStep << WakeSourceCount
+			<< WakeSources << WakeHeight << WakePrevHeight << OutputWakeHeightRW;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter WakeDim;
+	FShaderParameter WakeShiftCur;
+	FShaderParameter WakeShiftPrev;
+	FShaderParameter WakeStep;
+	FShaderParameter WakeSourceCount;
+
+	FShaderResourceParameter WakeSources;
+	FShaderResourceParameter WakeHeight;
+	FShaderResourceParameter WakePrevHeight;
+	FShaderResourceParameter OutputWakeHeightRW;
+
+};
+
+/**
+ * Wake height -> (height, gradient) render target
+ */
+class FWakeGradientPS : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FWakeGradientPS, Global)
+
+public:
+	static bool ShouldCache(EShaderPlatform Platform)
+	{
+		return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM5);
+	}
+
+	FWakeGradientPS(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+		: FGlobalShader(Initializer)
+	{
+		WakeDim.Bind(Initializer.ParameterMap, TEXT("g_WakeDim"));
+		WakeCellSize.Bind(Initializer.ParameterMap, TEXT("g_WakeCellSize"));
+		InputWakeHeight.Bind(Initializer.ParameterMap, TEXT("g_InputWakeHeight"));
+	}
+
+	FWakeGradientPS()
+	{
+	}
+
+	void SetParameters(FRHICommandList& RHICmdList, uint32 ParamWakeDim, float ParamWakeCellSize, FShaderResourceViewRHIParamRef ParamInputWakeHeight)
+	{
+		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
+
+		SetShaderValue(RHICmdList, PixelShaderRHI, WakeDim, ParamWakeDim);
+		SetShaderValue(RHICmdList, PixelShaderRHI, WakeCellSize, ParamWakeCellSize);
+
+		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI, InputWakeHeight.GetBaseIndex(), ParamInputWakeHeight);
+	}
+
+	void UnsetParameters(FRHICommandList& RHICmdList)
+	{
+		FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
+
+		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI, InputWakeHeight.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	}
+
+	virtual bool Serialize(FArchive& Ar)
+	{
+		bool bShaderHasOutdatedParameters = FGlobalShader::Serialize(Ar);
+		Ar << WakeDim << WakeCellSize << InputWakeHeight;
+
+		return bShaderHasOutdatedParameters;
+	}
+
+private:
+	FShaderParameter WakeDim;
+	FShaderParameter WakeCellSize;
+
+	FShaderResourceParameter InputWakeHeight;
+
 };
 
+
+//////////////////////////////////////////////////////////////////////////
+// Prewarm
+
+/** Resolve all ocean shaders of the map, so their RHI resources are ready before the first simulation step. Render thread only. */
+extern void PrewarmOceanShaders(TShaderMap<FGlobalShaderType>* ShaderMap);
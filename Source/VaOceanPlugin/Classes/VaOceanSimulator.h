@@ -9,6 +9,26 @@
 
 #define PAD16(n) (((n)+15)/16*16)
 
+class UVaOceanBuoyancyComponent;
+
+/** Band-limited spectrum of one gradient mip: central region of H(0) transformed by a smaller FFT */
+struct FVaOceanSpectrumMip
+{
+	FUpdateSpectrumCSImmutable ImmutableParams;
+
+	FRadixPlan512 FFTPlan;
+
+	/** H(t), Dx(t) and Dy(t) of the central region */
+	FStructuredBufferRHIRef m_pBuffer_Float2_Ht;
+	FUnorderedAccessViewRHIRef m_pUAV_Ht;
+	FShaderResourceViewRHIRef m_pSRV_Ht;
+
+	/** Dx, Dy and Dz sampled at mip texel centers */
+	FStructuredBufferRHIRef m_pBuffer_Float_Dxyz;
+	FUnorderedAccessViewRHIRef m_pUAV_Dxyz;
+	FShaderResourceViewRHIRef m_pSRV_Dxyz;
+};
+
 /**
  * Renders normals and heightmap from Phillips spectrum
  */
@@ -22,29 +42,64 @@ class VAOCEANPLUGIN_API AVaOceanSimulator : public AActor
 	// Initialization
 
 protected:
-	/** Initialize all buffers and prepare shaders */
+	/** Finish spectrum generation started by BeginSpectrumGeneration and upload it. Simulator stays uninitialized until the task is complete. */
 	void InitializeInternalData();
 
-	/** Initialize the vector field */
-	void InitHeightMap(const FSpectrumData& Params, TResourceArray<FVector2D>& out_h0, TResourceArray<float>& out_omega);
+	/** Allocate buffers if memory plan has changed and generate spectrum on a worker thread */
+	void BeginSpectrumGeneration();
+
+	/**
+	 * Generate H(0) of given config into StagingArena on a worker thread, displacement bound goes to OutBound and
+	 * energy-bearing band to OutBandRadius. Waves are picked into OutWaves and OutPointQueryWaves if not null.
+	 */
+	void LaunchSpectrumTask(const FSpectrumData& Params, FVector* OutBound, int32* OutBandRadius, FVaOceanGerstnerWaves* OutWaves, FVaOceanGerstnerWaves* OutPointQueryWaves);
+
+	/** Start spectrum generation and shader lookup ahead of the first tick */
+	void PrewarmInternalData();
+
+	/** Allocate all buffers of the plan */
+	void AllocateInternalData(const FVaOceanMemoryPlan& Plan);
 
-	/** Initialize buffers for shader */
+public:
+	/** Initialize the vector field. h0_full is generation scratch of (dim + 1)^2 texels. Safe to call from worker thread. */
+	void InitHeightMap(const FSpectrumData& Params, int32 Seed, FVector4* out_h0, float* out_omega, FVector2D* h0_full) const;
+
+	/** Estimate how far the surface can be displaced from H(0). Safe to call from worker thread. */
+	void InitDisplacementBound(const FSpectrumData& Params, const FVector4* h0, FVector& OutBound) const;
+
+	/**
+	 * Smallest band radius (in texels, along either axis from the spectrum center) that keeps all but EnergyCutoff
+	 * of height and slope energy. Phillips damping of short waves leaves high wave numbers at practically zero energy.
+	 * Safe to call from worker thread.
+	 */
+	int32 InitSpectrumBand(const FSpectrumData& Params, const FVector4* h0, float EnergyCutoff) const;
+
+protected:
+	/** Restrict spectrum update to the band, H(t) outside of it is cleared once */
+	void SetSpectrumBand(int32 BandRadius);
+
+	/** Initialize buffers for shader. Without Data buffer of byte_width is created uninitialized. */
 	void CreateBufferAndUAV(FResourceArrayInterface* Data, uint32 byte_width, uint32 byte_stride, FStructuredBufferRHIRef* ppBuffer, FUnorderedAccessViewRHIRef* ppUAV, FShaderResourceViewRHIRef* ppSRV);
 
 	/** Clear internal buffers and shader data */
 	void ClearInternalData();
 
-	/** Clear buffers and re-initalize them */
+	/** Regenerate spectrum, buffers are reused if configuration allows */
 	void ResetInternalData();
 
 	// Begin UObject Interface
 	virtual void BeginDestroy() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif // WITH_EDITOR
 	// End UObject Interface
 
+	// Begin AActor Interface
+	virtual void BeginPlay() override;
+	// End AActor Interface
+
 	/** Allow tick in editor */
 	virtual bool ShouldTickIfViewportsOnly() const override;
 
@@ -57,8 +112,40 @@ public:
 	virtual void Tick(float DeltaSeconds) override;
 
 protected:
+	/** Derive simulation time from replicated server world time */
+	void UpdateSimulationTime(float DeltaSeconds);
+
+	/** Simulate waves at given time on GPU and CPU */
+	void RunSimulationStep(float WorldTime, float DeltaTime);
+
+	/** Copy last displacement and gradient to previous frame targets */
+	void CopyToPreviousFrame();
+
 	/** Update normals and heightmap from spectrum */
-	void UpdateDisplacementMap(float WorldTime);
+	void UpdateDisplacementMap(float WorldTime, float DeltaTime);
+
+	/** Spectrum and FFT of the step -> DisplacementTexture, VelocityTexture */
+	void UpdateSpectrumDisplacement(float WorldTime, float DeltaTime);
+
+	/** Sum of analytic waves of the step -> DisplacementTexture, VelocityTexture */
+	void UpdateGerstnerDisplacement(float WorldTime);
+
+	/** Run spectrum and FFT for given time on async compute pipe, result is consumed by the next step of that time */
+	void UpdateSpectrumAsync(float WorldTime);
+
+	/** Drop async result that doesn't belong to the next step, graphics pipe recomputes it */
+	void DiscardAsyncSpectrum();
+
+	/** Fill gradient mips from band-limited spectrum, or box filter them with bBandLimitedMips off */
+	void UpdateGradientMips(float WorldTime, FTextureRenderTargetResource* FoamRenderTarget);
+
+public:
+	/** Blend factor between previous (0) and last (1) simulated step */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	float GetSimulationAlpha() const;
+
+	/** Displacement bounds pyramid generated on GPU each frame, for render thread consumers */
+	FShaderResourceViewRHIRef GetBoundsPyramidSRV() const;
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -69,11 +156,392 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "VaOcean|FFT")
 	const FSpectrumData& GetSpectrumConfig() const;
 
+	/** Get max absolute displacement (dx, dy, dz) in DisplacementTexture units */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|FFT")
+	FVector GetDisplacementBound() const;
+
+	/** Change random seed of the spectrum, waves are regenerated on every machine */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "VaOcean|FFT")
+	void SetSpectrumSeed(int32 NewSeed);
+
+	/**
+	 * Blend waves towards another sea state over Duration seconds. Target spectrum is generated in background
+	 * and crossfaded in spectrum update, so waves don't pop. Patch length change can't be blended and is applied
+	 * at once, as any change with zero Duration. Time scale of the current config is kept. Transition requested
+	 * during another one starts after it. Transitions are local, call it on every machine with the same StartTime
+	 * to keep waves in sync. Blend is held at 0 until the target is generated, then evaluated from StartTime, so
+	 * pick StartTime a bit ahead of GetSimulationTime() to let every machine finish generation before it.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|FFT")
+	void TransitionToSpectrum(const FSpectrumData& TargetConfig, float Duration, float StartTime);
+
+	/** Simulation time, server world time since the simulation has started. Same on every machine. */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	float GetSimulationTime() const;
+
+	/** Whether sea state transition is being generated or blended */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|FFT")
+	bool IsSpectrumTransitionActive() const;
+
 protected:
+	/** Start queued transition, begin blending when its target is generated and commit it when fully blended */
+	void UpdateSpectrumTransition();
+
+	/** Drop transition in progress, its target is queued again unless there is a newer one */
+	void CancelSpectrumTransition();
+
+	/** Weight of target H(0) at given simulation time */
+	float GetSpectrumBlend(float WorldTime) const;
+
+	/** Choppy scale blended between current and target sea state */
+	float GetChoppyScale(float WorldTime) const;
+
 	/** Ocean spectrum data */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
 	FSpectrumData SpectrumConfig;
 
+	/** Whitecaps accumulation */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FFoamData FoamConfig;
+
+	/** Simulation steps per second, results are interpolated between steps. 0 means a step each frame. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config, meta = (ClampMin = "0.0"))
+	float SimulationRate;
+
+	/** Collection that receives OceanSimulationAlpha, blend factor between previous and last frame targets */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	UMaterialParameterCollection* SimulationParameters;
+
+	/** Random seed of the spectrum. Replicated, so clients simulate the same waves as server. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_SpectrumSeed, Category = Config)
+	int32 SpectrumSeed;
+
+	/** Server world time when simulation has started */
+	UPROPERTY(Replicated)
+	float SimulationEpoch;
+
+	UFUNCTION()
+	void OnRep_SpectrumSeed();
+
+	/** Sea state requested by TransitionToSpectrum while another one is in progress */
+	FSpectrumData QueuedTransitionTarget;
+	float QueuedTransitionDuration;
+	float QueuedTransitionStartTime;
+	bool bTransitionQueued;
+
+	/** Sea state being generated or blended in */
+	FSpectrumData TransitionTarget;
+	float TransitionDuration;
+
+	/** Simulation time when blending starts, shared by every machine */
+	float TransitionStartTime;
+
+	/** Simulation time when the last committed transition was fully blended, queued one can't start before it */
+	float TransitionChainTime;
+
+	/** Target H(0) is uploaded and blended */
+	bool bTransitionActive;
+
+	/** Max absolute displacement of target spectrum */
+	FVector TransitionDisplacementBound;
+
+	/** Energy-bearing band of target spectrum */
+	int32 TransitionBandRadius;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// CPU simulation
+
+public:
+	/** Whether CPU copy of the waves is simulated (always true for dedicated server) */
+	bool ShouldSimulateOnCPU() const;
+
+	/** CPU copy of the waves, its map views give gameplay code direct access to simulated planes */
+	const FVaOceanCPUBackend& GetCPUBackend() const;
+
+	/**
+	 * Get displacement of ocean surface at given world location. Requires CPU simulation.
+	 * The value is in the same units as DisplacementTexture, patch is tiled each PatchLength.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	FVector GetOceanDisplacement(const FVector& WorldLocation) const;
+
+	/**
+	 * Get velocity of water particle at given world location, sampled the same way as displacement.
+	 * Requires CPU simulation with bSimulateVelocity.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	FVector GetOceanVelocity(const FVector& WorldLocation) const;
+
+	/** Get accumulated foam coverage [0..1] at given world location. Requires CPU simulation. */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	float GetOceanFoam(const FVector& WorldLocation) const;
+
+	/**
+	 * Get conservative height bounds of displaced surface over world rectangle, in constant time.
+	 * Without CPU simulation the statistical bound of the whole spectrum is returned.
+	 *
+	 * @return	True if bounds are taken from simulated displacement
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	bool GetOceanHeightBounds(const FVector2D& WorldMin, const FVector2D& WorldMax, float& OutMinHeight, float& OutMaxHeight) const;
+
+	/**
+	 * Get world height of displaced surface at given location, choppy waves are taken into account.
+	 * Undisplaced surface rests at the simulator actor height. Requires CPU simulation.
+	 * With QueryCacheConfig the height is fetched from tiles resolved once per frame.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	float GetOceanHeight(const FVector& WorldLocation) const;
+
+	/**
+	 * Trace line against displaced ocean surface. Requires CPU simulation.
+	 *
+	 * @return	True if surface is crossed between Start and End
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	bool OceanLineTrace(const FVector& Start, const FVector& End, FVector& OutHitLocation) const;
+
+	/** Trace many rays at once, batches are processed in parallel. Requires CPU simulation. */
+	void OceanRaycastBatch(const TArray<FVaOceanRay>& Rays, TArray<FVaOceanRayHit>& OutHits) const;
+
+protected:
+	/**
+	 * Run spectrum and FFT on async compute pipe, overlapped with the rest of the frame. The next step is
+	 * simulated ahead, so graphics passes consume the result of the previous frame. Needs SimulationRate,
+	 * since only fixed steps know the time of the next one. Ignored without RHI support.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	bool bUseAsyncCompute;
+
+	/** Simulate analytic surface velocity, time derivative of displacement. Costs two more FFT slices. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	bool bSimulateVelocity;
+
+	/**
+	 * Generate GradientTexture mips with smaller FFTs of the central spectrum region instead of box filtering
+	 * the top level. Gradient and folding of lower mips are computed from alias-free displacement.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	bool bBandLimitedMips;
+
+	/**
+	 * Share of spectrum height energy that may be dropped at high wave numbers. Spectrum update and the first CPU
+	 * FFT pass only touch the band that holds the rest. 0 keeps every wave number with any energy.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config, meta = (ClampMin = "0.0", ClampMax = "0.01"))
+	float SpectrumEnergyCutoff;
+
+	/** Simulate waves on CPU too, so gameplay can query them */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	bool bSimulateOnCPU;
+
+	/** CPU version of the simulation chain */
+	FVaOceanCPUBackend CPUBackend;
+
+	/** Sum of waves picked from the spectrum, evaluated instead of FFT on both GPU and CPU */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FGerstnerData GerstnerConfig;
+
+	/** Waves picked by the last spectrum task with GerstnerConfig.bUseGerstnerWaves */
+	FVaOceanGerstnerWaves GerstnerWaves;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Point queries
+
+public:
+	/** Whether point queries are summed from waves while the CPU grid step is skipped */
+	bool IsPointQueryModeActive() const;
+
+protected:
+	/** Choose between point queries and the CPU grid by the demand since the last update, once for all steps of a tick */
+	void UpdatePointQueryMode(float DeltaTime);
+
+	/** CPU copy of the wave parameters for given step */
+	FVaOceanCPUPerFrame MakeCPUPerFrame(float WorldTime, float DeltaTime) const;
+
+	/** Simulate the CPU grid for the last step, and for the one before it when it was skipped too */
+	void UpdateCPUGrid();
+
+	/** Count a query that needs the CPU grid, grid skipped in point query mode is simulated first */
+	void RequireCPUGrid() const;
+
+	/** Waves summed by point queries: analytic waves themselves or the strongest spectrum waves */
+	const FVaOceanGerstnerWaves& GetPointQueryWaves() const;
+
+	/** Displacement and optional velocity at UV of the CPU grid, summed from point query waves at current time */
+	void EvaluatePointQuery(const FVector2D& UV, FVector* OutDisplacement, FVector* OutVelocity) const;
+
+	/** Point query version of CPU height field */
+	float EvaluatePointQueryHeight(const FVector2D& UV) const;
+
+	/** Few point queries are summed from the strongest waves instead of the CPU grid */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FPointQueryData PointQueryConfig;
+
+	/** Strongest waves of the current spectrum and of the transition target, FFT mode only. Swapped when transition is complete. */
+	FVaOceanGerstnerWaves PointQueryWaves[2];
+
+	/** PointQueryWaves of the current spectrum */
+	int32 PointQueryWavesIndex;
+
+	/** Point evaluations summed from waves since the last mode update */
+	mutable FThreadSafeCounter PointQueryEvaluations;
+
+	/** Point evaluations that queries answered by the grid would take: one per displacement or velocity, CHOPPY_INVERSE_ITERATIONS per height */
+	mutable FThreadSafeCounter PointQueryDemand;
+
+	/** Queries since the last step that need the CPU grid */
+	mutable FThreadSafeCounter GridQueryCount;
+
+	/** Simulation seconds since the last step with grid queries */
+	float GridQueryIdleTime;
+
+	/** Simulation seconds since the last mode update */
+	float PointQueryModeDeltaTime;
+
+	/** CPU grid step is skipped, point queries are summed from waves */
+	bool bPointQueryMode;
+
+	/** Time and duration of the last step, the grid is simulated for them on demand */
+	float LastStepTime;
+	float LastStepDeltaTime;
+
+	/** Grid holds an older step than the last one */
+	bool bGridStale;
+
+	/** Serializes grid simulation requested by queries */
+	mutable FCriticalSection GridStepLock;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Query cache
+
+public:
+	/** Share of height queries answered from resolved tiles during the last frame [0..1], 0 without the cache */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	float GetQueryCacheHitRate() const;
+
+protected:
+	/** Heights of the surface at given UVs of the CPU grid, from the grid or from point query waves */
+	void ResolveQueryHeights(const FVector2D* InUVs, int32 InNum, float* OutHeights) const;
+
+	/** Frame-scoped tiles of resolved height in front of GetOceanHeight */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FQueryCacheData QueryCacheConfig;
+
+	/** Tiles resolved at QueryCacheTime */
+	FVaOceanQueryCache QueryCache;
+
+	/** Simulation time of cached tiles */
+	float QueryCacheTime;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Wakes
+
+public:
+	/**
+	 * Disturb local wave layer during wake steps of the next tick: boat hull, splash, etc. Sources outside of the layer
+	 * and ones over MaxSources are ignored. Sources are dropped after each tick, whether a step ran or not, so each
+	 * step splats a source added every frame once at any frame rate. Call it each frame for continuous disturbances.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Wakes")
+	void AddWakeSource(const FVector& WorldLocation, float Radius, float Strength);
+
+	/** Move local wave layer so it stays centered at given location (usually the player). Waves stay in world space. */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Wakes")
+	void SetWakeCenter(const FVector& WorldLocation);
+
+protected:
+	/** Advance local wave layer with fixed steps and render WakeTexture */
+	void UpdateWakes(float DeltaSeconds);
+
+	/** Local interactive wave layer */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FWakeData WakeConfig;
+
+	/** CPU copy of the wake layer, simulated with bSimulateOnCPU */
+	FVaOceanWakeSolver WakeSolver;
+
+	/** Sources added since the last tick, reserved for MaxSources */
+	TArray<FVaOceanWakeSource> WakeSources;
+
+	/** Packed sources handed to render thread, WAKE_SOURCE_RING_SIZE slices of MaxSources so frames in flight keep theirs */
+	TArray<FVector4> WakeSourceRing;
+
+	/** Ring slice written by the next wake step */
+	int32 WakeSourceRingSlice;
+
+	/** Render thread is done with the source ring */
+	FRenderCommandFence WakeSourceFence;
+
+	/** World location the wake layer follows */
+	FVector2D WakeCenter;
+
+	/** World time not yet consumed by wake steps */
+	float WakeTimeAccumulator;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Buoyancy
+
+public:
+	/** Add component to the batch of pontoons floated each frame */
+	void RegisterBuoyancyComponent(UVaOceanBuoyancyComponent* Component);
+
+	/** Remove component from the batch */
+	void UnregisterBuoyancyComponent(UVaOceanBuoyancyComponent* Component);
+
+protected:
+	/** Resolve water under pontoons of all registered components in one parallel batch, then push their bodies */
+	void UpdateBuoyancy();
+
+	/** Components floated by the simulator */
+	UPROPERTY(Transient)
+	TArray<UVaOceanBuoyancyComponent*> BuoyancyComponents;
+
+	/** Pontoons of the current frame, one hull per component in BuoyancyComponents order */
+	FVaOceanBuoyancyBatch BuoyancyBatch;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// Spawn list
+
+public:
+	/** Texels of the last GPU step folding above SpawnListConfig.FoldThreshold (texel x, texel y, fold, foam), for render thread consumers */
+	FShaderResourceViewRHIRef GetSpawnListSRV() const;
+
+	/**
+	 * Indirect arguments of the spawn list: thread group count x, y, z of a consumer running SPAWN_LIST_CONSUMER_BLOCK
+	 * threads per group, then entry count. Can be passed to DispatchIndirectComputeShader as is.
+	 */
+	FVertexBufferRHIRef GetSpawnArgsBuffer() const;
+
+	/** Spawn list arguments as uint buffer */
+	FShaderResourceViewRHIRef GetSpawnArgsSRV() const;
+
+	/** Texels of the last CPU step folding above SpawnListConfig.FoldThreshold, in no particular order. Requires CPU simulation. */
+	const FVaOceanFoldTexel* GetSpawnTexels(int32& OutNum) const;
+
+	/**
+	 * Get world locations of displaced surface over CPU spawn list texels. Patch is tiled, so each texel is
+	 * placed into the tile closest to Center. Requires CPU simulation.
+	 *
+	 * @return	Number of locations
+	 */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Simulation")
+	int32 GetSpawnLocations(const FVector& Center, TArray<FVector>& OutLocations) const;
+
+protected:
+	/** Gradient -> compact spawn list and its indirect arguments */
+	void UpdateSpawnList(FTextureRenderTargetResource* GradientRenderTarget);
+
+	/** Compact list of strongly folding texels for spray and foam particles */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	FSpawnListData SpawnListConfig;
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Shader output targets
@@ -83,10 +551,37 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
 	UTextureRenderTarget2D* DisplacementTexture;
 
-	/** Render target for height map that can be used by the editor */
+	/** Render target for height map that can be used by the editor. Accumulated foam is stored in blue channel. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
 	UTextureRenderTarget2D* GradientTexture;
 
+	/** Render target for velocity (vx, vy, vz, 0) in displacement units per second, written with bSimulateVelocity */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	UTextureRenderTarget2D* VelocityTexture;
+
+	/** Previous step of DisplacementTexture for interpolation with fixed SimulationRate. Must match its format and size. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	UTextureRenderTarget2D* PrevDisplacementTexture;
+
+	/** Previous step of GradientTexture for interpolation with fixed SimulationRate. Must match its format and size. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	UTextureRenderTarget2D* PrevGradientTexture;
+
+	/**
+	 * Render target for local wave layer (height, gradient x, gradient y, 0), written with bEnableWakes.
+	 * Must be float RGBA of WakeConfig.Resolution. Placed in the world by OceanWakeRect of SimulationParameters.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Config)
+	UTextureRenderTarget2D* WakeTexture;
+
+protected:
+	/** Foam history, ping-ponged each frame by gradient pass */
+	UPROPERTY(Transient)
+	UTextureRenderTarget2D* FoamTextures[2];
+
+	/** Foam history to be written on next frame */
+	int32 FoamWriteIndex;
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Parameters that will be send to rendering thread
@@ -99,11 +594,16 @@ protected:
 	// Spectrum simulation data
 
 protected:
-	/** Initial height field H(0) generated by Phillips spectrum & Gauss distribution. */
-	FStructuredBufferRHIRef m_pBuffer_Float2_H0;
+	/** Initial height field H(0) generated by Phillips spectrum & Gauss distribution. Packed as (h0(k), conj(h0(-k))). */
+	FStructuredBufferRHIRef m_pBuffer_Float4_H0;
 	FUnorderedAccessViewRHIRef m_pUAV_H0;
 	FShaderResourceViewRHIRef m_pSRV_H0;
 
+	/** H(0) of the sea state being blended in, swapped with H(0) when transition is complete */
+	FStructuredBufferRHIRef m_pBuffer_Float4_H0Target;
+	FUnorderedAccessViewRHIRef m_pUAV_H0Target;
+	FShaderResourceViewRHIRef m_pSRV_H0Target;
+
 	/** Angular frequency */
 	FStructuredBufferRHIRef m_pBuffer_Float_Omega;
 	FUnorderedAccessViewRHIRef m_pUAV_Omega;
@@ -119,17 +619,110 @@ protected:
 	FUnorderedAccessViewRHIRef m_pUAV_Dxyz;
 	FShaderResourceViewRHIRef m_pSRV_Dxyz;
 
+	/** Dxyz of the next step written by async compute, swapped with Dxyz after dispatch */
+	FStructuredBufferRHIRef m_pBuffer_Float_DxyzAsync;
+	FUnorderedAccessViewRHIRef m_pUAV_DxyzAsync;
+	FShaderResourceViewRHIRef m_pSRV_DxyzAsync;
+
+	/** Written by graphics when buffers are handed over to async compute, created once and reused each step */
+	FComputeFenceRHIRef AsyncGraphicsFence;
+
+	/** Written by async compute when Dxyz is ready, created once and reused each step */
+	FComputeFenceRHIRef AsyncComputeFence;
+
+	/** Displacement bounds pyramid (min height, max height, max |dx|, max |dy|), see FVaOceanBoundsPyramid */
+	FStructuredBufferRHIRef m_pBuffer_Float4_Bounds;
+	FUnorderedAccessViewRHIRef m_pUAV_Bounds;
+	FShaderResourceViewRHIRef m_pSRV_Bounds;
+
+	/** Fold spawn list (texel x, texel y, fold, foam) and its indirect arguments */
+	FStructuredBufferRHIRef m_pBuffer_Float4_SpawnList;
+	FUnorderedAccessViewRHIRef m_pUAV_SpawnList;
+	FShaderResourceViewRHIRef m_pSRV_SpawnList;
+	FVertexBufferRHIRef m_pBuffer_Uint_SpawnArgs;
+	FUnorderedAccessViewRHIRef m_pUAV_SpawnArgs;
+	FShaderResourceViewRHIRef m_pSRV_SpawnArgs;
+
+	/** Analytic waves packed by FVaOceanGerstnerWaves::GetShaderData */
+	FStructuredBufferRHIRef m_pBuffer_Float4_GerstnerWaves;
+	FUnorderedAccessViewRHIRef m_pUAV_GerstnerWaves;
+	FShaderResourceViewRHIRef m_pSRV_GerstnerWaves;
+
+	/** Wake height of three steps, rotated each step: previous, current and next */
+	FStructuredBufferRHIRef m_pBuffer_Float_Wake[3];
+	FUnorderedAccessViewRHIRef m_pUAV_Wake[3];
+	FShaderResourceViewRHIRef m_pSRV_Wake[3];
+
+	/** Wake sources of the frame (cell x, cell y, radius in cells, strength) */
+	FStructuredBufferRHIRef m_pBuffer_Float4_WakeSources;
+	FUnorderedAccessViewRHIRef m_pUAV_WakeSources;
+	FShaderResourceViewRHIRef m_pSRV_WakeSources;
+
+	/** Wake buffer holding the last step */
+	int32 WakeReadIndex;
+
+	/** Grid origin each wake buffer was written with, scroll is applied when it is read */
+	FIntPoint WakeBufferOrigin[3];
+
 	FVector4 m_pQuadVB[4];
 
 	/** FFT wrap-up */
 	FRadixPlan512 FFTPlan;
 
+	/** Band-limited spectrum of gradient mips 1, 2, ... with bBandLimitedMips */
+	TArray<FVaOceanSpectrumMip> SpectrumMips;
+
+	/** Sizes of allocated buffers */
+	FVaOceanMemoryPlan MemoryPlan;
+
+	/** Spectrum generation and upload memory, reused by every reset */
+	FVaOceanCPUArena StagingArena;
+
+	/** Passed when render thread has uploaded spectrum from StagingArena */
+	FRenderCommandFence SpectrumUploadFence;
+
+	/** Spectrum generation running on a worker thread, null when idle */
+	FGraphEventRef SpectrumTask;
+
+	/** Seed the running (or last) spectrum task was started with */
+	int32 SpectrumTaskSeed;
+
+	/** Running task generates transition target instead of the current spectrum */
+	bool bSpectrumTaskIsTarget;
+
+	/** Results of spectrum task in StagingArena */
+	FVector4* SpectrumH0;
+	float* SpectrumOmega;
+	FVector SpectrumTaskDisplacementBound;
+	int32 SpectrumTaskBandRadius;
+
+	/** Band of spectrum update, see SetSpectrumBand. INDEX_NONE while H(t) is not cleared yet. */
+	int32 SpectrumBandRadius;
+
+	/** Max absolute displacement, see InitDisplacementBound */
+	FVector DisplacementBound;
+
 	/** Initialization flags */
 	bool bSimulatorInitializated;
 
-	/** Internal world simulation time */
+	/** Async compute is requested and supported */
+	bool bAsyncComputeActive;
+
+	/** Dxyz holds the result of async step */
+	bool bAsyncComputeResultReady;
+
+	/** Simulation time the async result was computed for */
+	float AsyncComputeResultTime;
+
+	/** Simulation time, server world time since SimulationEpoch */
 	float SimulationWorldTime;
 
+	/** Index of the last simulated step with fixed SimulationRate */
+	int32 SimulationStep;
+
+	/** Blend factor between previous and last step */
+	float SimulationAlpha;
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Utilities
@@ -0,0 +1,102 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+#include "VaOceanQuadTree.h"
+#include "VaOceanSurfaceComponent.generated.h"
+
+class AVaOceanSimulator;
+
+/**
+ * Ocean surface rendered as instances of one shared grid patch, selected by quadtree LOD.
+ * Vertex count follows screen coverage instead of world size.
+ *
+ * Patch mesh must be a flat square grid of PatchResolution x PatchResolution quads centered at origin.
+ * Instance scale gives the patch size, so material can morph vertices into the next LOD grid with
+ * OceanLODBaseRange, OceanMorphStartRatio, OceanMinPatchSize and OceanPatchResolution parameters.
+ */
+UCLASS(ClassGroup=Environment, meta=(BlueprintSpawnableComponent))
+class VAOCEANPLUGIN_API UVaOceanSurfaceComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_UCLASS_BODY()
+
+	// Begin UActorComponent Interface
+	virtual void OnRegister() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+	// End UActorComponent Interface
+
+public:
+	/** Simulator used to get displacement bounds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ocean Surface")
+	AVaOceanSimulator* OceanSimulator;
+
+	/** Half size of ocean surface */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface")
+	float OceanExtent;
+
+	/** Size of the finest patch */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface")
+	float MinPatchSize;
+
+	/** Number of LOD levels */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface", meta = (ClampMin = "1", ClampMax = "16"))
+	int32 LODCount;
+
+	/** Distance covered by the finest LOD, doubled for each next one */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface")
+	float LODBaseRange;
+
+	/** Part of LOD range after which vertices start to morph into the next LOD */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MorphStartRatio;
+
+	/** Number of quads along patch mesh side */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface")
+	int32 PatchResolution;
+
+	/** World units per displacement map unit, as it's applied by surface material */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ocean Surface")
+	float DisplacementScale;
+
+	/** Number of patches rendered */
+	UFUNCTION(BlueprintCallable, Category = "VaOcean|Surface")
+	int32 GetVisiblePatchCount() const;
+
+protected:
+	/** Get current view. Frustum is empty when only view location is known. */
+	void GetView(FVector& OutViewOrigin, TArray<FPlane>& OutFrustum) const;
+
+	/** Push quadtree configuration */
+	void UpdateQuadTreeSettings();
+
+	/** Sync instances with selected patches */
+	void UpdateInstances();
+
+	/** Whether both selections place instances the same way */
+	static bool IsSameSelection(const TArray<FVaOceanPatch>& A, const TArray<FVaOceanPatch>& B);
+
+	/** Pass LOD configuration to the material */
+	void UpdateMaterialParameters();
+
+protected:
+	/** LOD selection */
+	FVaOceanQuadTree QuadTree;
+
+	/** Patches selected for the current view */
+	TArray<FVaOceanPatch> SelectedPatches;
+
+	/** Patches instances were built from */
+	TArray<FVaOceanPatch> RenderedPatches;
+
+	/** Surface height and mesh size instances were built with */
+	float RenderedSurfaceZ;
+	float RenderedMeshSize;
+
+	/** Reused frustum planes */
+	TArray<FPlane> ViewFrustum;
+
+	/** Material with LOD parameters */
+	UPROPERTY(Transient)
+	UMaterialInstanceDynamic* SurfaceMaterial;
+
+};
@@ -56,3 +56,200 @@ struct FSpectrumData
 		ChoppyScale = 1.3f;
 	}
 };
+
+/** Foam accumulation configuration */
+USTRUCT(BlueprintType)
+struct FFoamData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** How fast accumulated foam fades out (1/s). Bigger value means shorter whitecaps. */
+	UPROPERTY(EditAnywhere)
+	float FoamDecay;
+
+	/** Amount of foam injected per second by folding surface */
+	UPROPERTY(EditAnywhere)
+	float FoamInjection;
+
+	/** Folding value (1 - Jacobian) above which foam starts to appear. Around 0 ~ 0.5 */
+	UPROPERTY(EditAnywhere)
+	float FoamThreshold;
+
+	/** Defaults */
+	FFoamData()
+	{
+		FoamDecay = 0.8f;
+		FoamInjection = 4.0f;
+		FoamThreshold = 0.1f;
+	}
+};
+
+/** Local interactive wave layer (wakes, splashes) configuration */
+USTRUCT(BlueprintType)
+struct FWakeData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Simulate wave layer around SetWakeCenter location */
+	UPROPERTY(EditAnywhere)
+	bool bEnableWakes;
+
+	/** Cells along the grid side. Cost of a step doesn't depend on anything else. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "16", ClampMax = "1024"))
+	int32 Resolution;
+
+	/** World size of the grid side */
+	UPROPERTY(EditAnywhere)
+	float GridSize;
+
+	/** Speed of wake waves, world units per second. Clamped to keep the solver stable. */
+	UPROPERTY(EditAnywhere)
+	float WaveSpeed;
+
+	/** How fast wake waves fade out (1/s) */
+	UPROPERTY(EditAnywhere)
+	float WaveDecay;
+
+	/** Fixed solver steps per second */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1.0"))
+	float StepRate;
+
+	/** Max solver steps per frame, time above it is dropped */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1"))
+	int32 MaxStepsPerFrame;
+
+	/** Max sources per frame, the rest of them is ignored */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1"))
+	int32 MaxSources;
+
+	/** Defaults */
+	FWakeData()
+	{
+		bEnableWakes = false;
+		Resolution = 128;
+		GridSize = 6400.0f;
+		WaveSpeed = 400.0f;
+		WaveDecay = 0.6f;
+		StepRate = 60.0f;
+		MaxStepsPerFrame = 2;
+		MaxSources = 64;
+	}
+};
+
+/** Analytic sum-of-waves fallback configuration */
+USTRUCT(BlueprintType)
+struct FGerstnerData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Replace spectrum FFT with a sum of the strongest waves of the same spectrum, on both GPU and CPU */
+	UPROPERTY(EditAnywhere)
+	bool bUseGerstnerWaves;
+
+	/** Number of summed waves. Cost of each texel grows linearly with it. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "4", ClampMax = "1024"))
+	int32 WaveCount;
+
+	/** Direction sectors waves are picked from, so they don't all line up with the wind */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1", ClampMax = "32"))
+	int32 DirectionBins;
+
+	/** Defaults */
+	FGerstnerData()
+	{
+		bUseGerstnerWaves = false;
+		WaveCount = 64;
+		DirectionBins = 8;
+	}
+};
+
+/** Sparse evaluation of CPU point queries */
+USTRUCT(BlueprintType)
+struct FPointQueryData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/**
+	 * Answer displacement, velocity and height queries by summing the strongest spectrum waves at each point,
+	 * and skip the CPU grid step while that is cheaper. Foam, height bounds and traces need the grid, so any
+	 * of them switches it back on.
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bEnablePointQueries;
+
+	/** Number of summed waves. More of them get closer to the grid surface, cost of each point grows linearly. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "16", ClampMax = "8192"))
+	int32 WaveCount;
+
+	/** Seconds without grid queries before the grid step is skipped */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0.0"))
+	float GridIdleTime;
+
+	/** Defaults */
+	FPointQueryData()
+	{
+		bEnablePointQueries = false;
+		WaveCount = 1024;
+		GridIdleTime = 1.0f;
+	}
+};
+
+/** Frame-scoped cache of CPU height queries */
+USTRUCT(BlueprintType)
+struct FQueryCacheData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/**
+	 * Resolve height a tile of texels at a time and answer the rest of the frame's height queries from it.
+	 * Pays off when many queries land close to each other, like buoyancy points of one hull.
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bEnableQueryCache;
+
+	/** Texels along tile side, power of 2. Smaller tiles resolve less surface per miss, larger ones miss less often. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "2", ClampMax = "32"))
+	int32 TileSize;
+
+	/** Tiles kept per frame, queries over more of them are answered directly */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "16", ClampMax = "16384"))
+	int32 TileCount;
+
+	/** Defaults */
+	FQueryCacheData()
+	{
+		bEnableQueryCache = false;
+		TileSize = 8;
+		TileCount = 256;
+	}
+};
+
+/** Compact list of strongly folding texels for spray and foam particles */
+USTRUCT(BlueprintType)
+struct FSpawnListData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/**
+	 * Collect texels folding above FoldThreshold after each step, on GPU into an append buffer with indirect
+	 * dispatch arguments and on CPU into the backend list. Consumers read a few hundred entries instead of the whole map.
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bEnableSpawnList;
+
+	/** Folding value (1 - Jacobian) above which texel is listed. Usually above FoamThreshold, so spray marks the crests. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0.0"))
+	float FoldThreshold;
+
+	/** Entries kept per step, texels over it are dropped */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "16", ClampMax = "65536"))
+	int32 MaxTexels;
+
+	/** Defaults */
+	FSpawnListData()
+	{
+		bEnableSpawnList = false;
+		FoldThreshold = 0.5f;
+		MaxTexels = 1024;
+	}
+};
@@ -0,0 +1,123 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+/** Max footprint radius of one source in cells, keeps splat cost of a source bounded */
+#define WAKE_MAX_SOURCE_CELLS 16.f
+
+/** Disturbance of the wake layer: boat hull, splash, etc. */
+struct FVaOceanWakeSource
+{
+	/** World location (x, y) */
+	FVector2D Location;
+
+	/** Footprint radius in world units */
+	float Radius;
+
+	/** Height change rate in the middle of footprint, world units per second. Negative pushes water down. */
+	float Strength;
+};
+
+/** Coefficients of one wake solver step, shared by CPU solver and WakeStepCS */
+struct FVaOceanWakeStep
+{
+	/** (WaveSpeed * DeltaTime / CellSize)^2, clamped for stability */
+	float Courant2;
+
+	/** Damped update h' = B * (A * h - h_prev + Courant2 * laplacian(h)): A = 2 - WaveDecay * dt, B = 1 / (1 + WaveDecay * dt) */
+	float DampingA;
+	float DampingB;
+
+	/** Source strength multiplier */
+	float DeltaTime;
+
+	FVaOceanWakeStep(float WaveSpeed, float WaveDecay, float InDeltaTime, float CellSize);
+};
+
+/**
+ * Local interactive wave layer: damped wave equation on a small grid that follows a point of interest.
+ * Its height is added on top of FFT waves. Step cost only depends on grid resolution and source cap,
+ * so any number of boats fits the same per-frame budget. Border cells are fixed at rest.
+ *
+ * Height planes are carved from FVaOceanCPUArena, rows are updated in parallel blocks four texels at a time.
+ */
+class VAOCEANPLUGIN_API FVaOceanWakeSolver
+{
+public:
+	FVaOceanWakeSolver();
+
+	/** Allocate planes of InDim^2 cells of InCellSize world units, waves are reset */
+	void Initialize(int32 InDim, float InCellSize);
+
+	/** Bytes of arena taken by Initialize */
+	static SIZE_T GetArenaSize(int32 InDim);
+
+	/** Free all buffers */
+	void Release();
+
+	/** Whether solver has buffers */
+	bool IsInitialized() const;
+
+	/** Grid origin cell that keeps given world location in the middle */
+	static FIntPoint GetOriginForCenter(const FVector2D& Center, int32 InDim, float InCellSize);
+
+	/** Move grid by whole cells, so it's centered at given world location. Waves stay in place. */
+	void SetCenter(const FVector2D& Center);
+
+	/** World location of the first cell center is Origin * CellSize */
+	FIntPoint GetOrigin() const;
+
+	/** Advance waves by one step and splat sources into the new height */
+	void Step(const FVaOceanWakeStep& StepParams, const FVaOceanWakeSource* Sources, int32 NumSources);
+
+	/** Bilinear height at world location, 0 outside of the grid */
+	float SampleHeight(const FVector2D& WorldLocation) const;
+
+	/** Max absolute height after the last step */
+	float GetMaxAbsHeight() const;
+
+	/** Zero-copy view of height plane */
+	FVaOceanCPUMapView GetHeightView() const;
+
+	/** Cells along grid side */
+	int32 GetDimension() const;
+
+	/** World size of one cell */
+	float GetCellSize() const;
+
+protected:
+	/** Move waves by Shift cells in both planes, uncovered cells are at rest */
+	void Scroll(const FIntPoint& Shift);
+
+	/** Add source footprints to height, max height is updated too */
+	void AddSources(const FVaOceanWakeSource* Sources, int32 NumSources, float DeltaTime);
+
+protected:
+	/** Grid dimension */
+	int32 Dim;
+
+	/** Row stride of planes in floats */
+	int32 Stride;
+
+	/** World size of one cell */
+	float CellSize;
+
+	/** First cell of the grid in world cells */
+	FIntPoint Origin;
+
+	/** Memory of height planes */
+	FVaOceanCPUArena Arena;
+
+	/** Height of the last step */
+	float* Height;
+
+	/** Height of the previous step, overwritten in-place by the next one */
+	float* PrevHeight;
+
+	/** Max absolute height of each row block of the last step */
+	TArray<float> BlockMaxHeight;
+
+	/** Max absolute height after the last step */
+	float MaxAbsHeight;
+
+};
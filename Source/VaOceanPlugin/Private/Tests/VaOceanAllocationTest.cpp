@@ -0,0 +1,219 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanAllocationTest
+{
+	/** Forwards everything to the engine allocator, counting allocations made by the thread that created it */
+	class FAllocationCounter : public FMalloc
+	{
+	public:
+		explicit FAllocationCounter(FMalloc* InInner)
+			: Inner(InInner)
+			, ThreadId(FPlatformTLS::GetCurrentThreadId())
+		{
+		}
+
+		int32 GetAllocations() const
+		{
+			return Allocations.GetValue();
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			// Realloc to zero is a free
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			Inner->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return Inner->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim() override
+		{
+			Inner->Trim();
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			Inner->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			Inner->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return Inner->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return Inner->GetDescriptiveName();
+		}
+
+	protected:
+		/** Other engine threads keep running while the counter is installed, their allocations are not ours */
+		void CountAllocation()
+		{
+			if (FPlatformTLS::GetCurrentThreadId() == ThreadId)
+			{
+				Allocations.Increment();
+			}
+		}
+
+		FMalloc* Inner;
+		uint32 ThreadId;
+		FThreadSafeCounter Allocations;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanSingleThreadCPUAllocationTest, "VaOcean.Memory.SingleThreadCPUPath", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanSingleThreadCPUAllocationTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanAllocationTest;
+
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	// CPU simulation and queries with every feature on: velocity, spawn list, point queries, query cache, wakes and ray casts.
+	// It's not a whole AVaOceanSimulator::Tick: render commands and task graph dispatch of ParallelFor allocate on every step.
+	FVaOceanGerstnerWaves PointQueryWaves;
+	PointQueryWaves.Initialize(Dim, H0.GetData(), Omega.GetData(), 256, 8);
+
+	FVaOceanCPUBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData(), true, nullptr, 1024);
+
+	// Largest tiles, their samples are gathered on the stack too
+	FVaOceanQueryCache QueryCache;
+	QueryCache.Initialize(Dim, QUERY_CACHE_MAX_TILE_SIZE, 64);
+
+	FVaOceanWakeSolver WakeSolver;
+	WakeSolver.Initialize(64, 50.f);
+
+	const FVaOceanRayCaster RayCaster(Backend, Params.PatchLength, 0.f);
+	const FVaOceanWakeStep WakeStep(1000.f, 0.6f, 1.f / 30.f, 50.f);
+
+	FVaOceanWakeSource Boats[4];
+	for (int32 Index = 0; Index < ARRAY_COUNT(Boats); Index++)
+	{
+		Boats[Index].Location = FVector2D(Index * 300.f, 0.f);
+		Boats[Index].Radius = 100.f;
+		Boats[Index].Strength = -50.f;
+	}
+
+	FVector2D UVs[BUOYANCY_BATCH_SIZE];
+	FVector PointDisplacement[BUOYANCY_BATCH_SIZE];
+	FVector PointVelocity[BUOYANCY_BATCH_SIZE];
+
+	auto Tick = [&](int32 Frame)
+	{
+		const FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, Frame / 30.f);
+		Backend.Update(PerFrame);
+		Backend.SetInterpolationAlpha(0.5f);
+		QueryCache.Invalidate();
+
+		// Buoyancy batch through the cache and point queries
+		for (int32 Index = 0; Index < BUOYANCY_BATCH_SIZE; Index++)
+		{
+			UVs[Index] = FVector2D(0.1f + Index * 0.002f, 0.3f + Frame * 0.001f);
+			QueryCache.SampleHeight(UVs[Index], [&](const FVector2D* InUVs, int32 InNum, float* OutHeights)
+			{
+				for (int32 QueryIndex = 0; QueryIndex < InNum; QueryIndex++)
+				{
+					OutHeights[QueryIndex] = Backend.SampleHeight(InUVs[QueryIndex]);
+				}
+			});
+		}
+		PointQueryWaves.EvaluatePoints(UVs, BUOYANCY_BATCH_SIZE, PerFrame.Time, PerFrame.TimeScale, PerFrame.ChoppyScale, PointDisplacement, PointVelocity);
+
+		// Boats move, so wake grid scrolls
+		for (FVaOceanWakeSource& Boat : Boats)
+		{
+			Boat.Location.X += 10.f;
+		}
+		WakeSolver.SetCenter(Boats[0].Location);
+		WakeSolver.Step(WakeStep, Boats, ARRAY_COUNT(Boats));
+
+		FVaOceanRay Ray;
+		Ray.Origin = FVector(Frame * 10.f, 0.f, 1000.f);
+		Ray.Direction = FVector(0.6f, 0.f, -0.8f);
+		Ray.MaxDistance = 5000.f;
+
+		FVaOceanRayHit Hit;
+		RayCaster.Raycast(Ray, Hit);
+
+		int32 NumSpawnTexels = 0;
+		Backend.GetSpawnList(NumSpawnTexels);
+	};
+
+	// Only the single-threaded path is allocation-free, task graph dispatch of ParallelFor allocates its own data
+	IConsoleVariable* SingleThreadCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.VaOcean.CPUSingleThread"));
+	const int32 PreviousSingleThread = SingleThreadCVar->GetInt();
+	SingleThreadCVar->Set(1);
+
+	// Warm-up: first steps may still size lazily created state
+	const int32 WarmUpTicks = 8;
+	const int32 CountedTicks = 60;
+	for (int32 Frame = 0; Frame < WarmUpTicks; Frame++)
+	{
+		Tick(Frame);
+	}
+
+	FMalloc* EngineMalloc = GMalloc;
+	FAllocationCounter Counter(EngineMalloc);
+
+	GMalloc = &Counter;
+	for (int32 Frame = WarmUpTicks; Frame < WarmUpTicks + CountedTicks; Frame++)
+	{
+		Tick(Frame);
+	}
+	GMalloc = EngineMalloc;
+
+	SingleThreadCVar->Set(PreviousSingleThread);
+
+	AddLogItem(FString::Printf(TEXT("%d allocations over %d ticks"), Counter.GetAllocations(), CountedTicks));
+	TestEqual(TEXT("Single-threaded CPU steps and queries don't allocate"), Counter.GetAllocations(), 0);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,178 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanBuoyancyBatchTest, "VaOcean.Buoyancy.BatchMatchesSingleHull", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanBuoyancyBatchTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	FVaOceanCPUBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData(), true);
+	Backend.Update(VaOceanTest::MakePerFrame(Params, 5.f));
+
+	FVaOceanQueryCache Cache;
+	Cache.Initialize(Dim, 8, 64);
+
+	// Same path as AVaOceanSimulator::UpdateBuoyancy with the simulator at zero height and no wakes
+	auto ResolveWater = [&](const FVector* InLocations, int32 InNum, float* OutHeights, FVector* OutVelocities)
+	{
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			const FVector2D UV = FVector2D(InLocations[Index]) / Params.PatchLength;
+
+			OutHeights[Index] = Cache.SampleHeight(UV, [&](const FVector2D* InUVs, int32 InResolveNum, float* OutResolveHeights)
+			{
+				for (int32 ResolveIndex = 0; ResolveIndex < InResolveNum; ResolveIndex++)
+				{
+					OutResolveHeights[ResolveIndex] = Backend.SampleHeight(InUVs[ResolveIndex]);
+				}
+			});
+
+			if (OutVelocities)
+			{
+				OutVelocities[Index] = Backend.SampleVelocity(UV);
+			}
+		}
+	};
+
+	// Hulls of different sizes, the larger ones span batches of workers. Marked ones are skipped in the second frame.
+	const int32 PontoonCounts[] = { 7, 12, 40, 5, 64, 3, 30 };
+	const bool bSkippedLater[] = { false, true, false, true, false, false, true };
+	const int32 NumHulls = ARRAY_COUNT(PontoonCounts);
+
+	FRandomStream Stream(11);
+	TArray<UVaOceanBuoyancyComponent*> Hulls;
+	TArray<TArray<FVector>> HullLocations;
+	for (int32 HullIndex = 0; HullIndex < NumHulls; HullIndex++)
+	{
+		UVaOceanBuoyancyComponent* Hull = NewObject<UVaOceanBuoyancyComponent>();
+		const FVector Center(Stream.FRandRange(-3.f, 3.f) * Params.PatchLength, Stream.FRandRange(-3.f, 3.f) * Params.PatchLength, 0.f);
+
+		// Pontoons around the surface, so hulls are partially submerged
+		TArray<FVector> Locations;
+		for (int32 Index = 0; Index < PontoonCounts[HullIndex]; Index++)
+		{
+			Hull->Pontoons.Add(FVector(Stream.FRandRange(-500.f, 500.f), Stream.FRandRange(-200.f, 200.f), Stream.FRandRange(-100.f, 100.f)));
+			Locations.Add(Center + Hull->Pontoons.Last());
+		}
+
+		Hulls.Add(Hull);
+		HullLocations.Add(Locations);
+	}
+
+	// Frame with every hull in one batch
+	FVaOceanBuoyancyBatch Batch;
+	Batch.Reset();
+	for (int32 HullIndex = 0; HullIndex < NumHulls; HullIndex++)
+	{
+		Batch.GetLocations().Append(HullLocations[HullIndex]);
+		Batch.AddHull(PontoonCounts[HullIndex]);
+	}
+	Batch.Resolve(true, ResolveWater);
+	const int32 NumPontoons = Batch.GetNumPontoons();
+
+	TArray<float> BatchRatios;
+	float MaxHeight = 0.f;
+	float MaxHeightError = 0.f;
+	float MaxVelocityError = 0.f;
+	bool bLocationsMatch = true;
+
+	Batch.Apply([&](int32 HullIndex, const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, int32 Num)
+	{
+		Hulls[HullIndex]->ApplyBuoyancy(Locations, WaterHeights, WaterVelocities, -980.f);
+		BatchRatios.Add(Hulls[HullIndex]->GetSubmergedRatio());
+
+		// The same hull floated alone
+		FVaOceanBuoyancyBatch Single;
+		Single.GetLocations().Append(HullLocations[HullIndex]);
+		Single.AddHull(PontoonCounts[HullIndex]);
+		Single.Resolve(true, ResolveWater);
+
+		Single.Apply([&](int32 SingleIndex, const FVector* SingleLocations, const float* SingleHeights, const FVector* SingleVelocities, int32 SingleNum)
+		{
+			bLocationsMatch &= (SingleNum == Num);
+
+			for (int32 Index = 0; Index < FMath::Min(Num, SingleNum); Index++)
+			{
+				const FVector2D UV = FVector2D(Locations[Index]) / Params.PatchLength;
+
+				bLocationsMatch &= Locations[Index].Equals(SingleLocations[Index], 0.f);
+				MaxHeight = FMath::Max(MaxHeight, FMath::Abs(SingleHeights[Index]));
+				MaxHeightError = FMath::Max(MaxHeightError, FMath::Abs(WaterHeights[Index] - SingleHeights[Index]));
+				MaxHeightError = FMath::Max(MaxHeightError, FMath::Abs(WaterHeights[Index] - Backend.SampleHeight(UV)));
+				MaxVelocityError = FMath::Max(MaxVelocityError, (WaterVelocities[Index] - SingleVelocities[Index]).GetAbsMax());
+			}
+		});
+
+		UVaOceanBuoyancyComponent* SingleHull = NewObject<UVaOceanBuoyancyComponent>();
+		SingleHull->Pontoons = Hulls[HullIndex]->Pontoons;
+		Single.Apply([&](int32 SingleIndex, const FVector* SingleLocations, const float* SingleHeights, const FVector* SingleVelocities, int32 SingleNum)
+		{
+			SingleHull->ApplyBuoyancy(SingleLocations, SingleHeights, SingleVelocities, -980.f);
+		});
+
+		TestEqual(FString::Printf(TEXT("Hull %d submerged ratio matches single hull"), HullIndex), BatchRatios.Last(), SingleHull->GetSubmergedRatio(), 1e-5f);
+	});
+
+	bool bAnySubmerged = false;
+	for (const float Ratio : BatchRatios)
+	{
+		bAnySubmerged |= (Ratio > 0.f);
+	}
+
+	// Next frame some hulls lose their bodies: they are skipped and don't keep the ratio of the last batch
+	Batch.Reset();
+	for (int32 HullIndex = 0; HullIndex < NumHulls; HullIndex++)
+	{
+		if (!bSkippedLater[HullIndex])
+		{
+			Batch.GetLocations().Append(HullLocations[HullIndex]);
+		}
+		Batch.AddHull(bSkippedLater[HullIndex] ? 0 : PontoonCounts[HullIndex]);
+	}
+	Batch.Resolve(false, ResolveWater);
+
+	Batch.Apply([&](int32 HullIndex, const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, int32 Num)
+	{
+		TestTrue(TEXT("Velocities are not handed out without velocity"), WaterVelocities == nullptr);
+
+		if (Num > 0)
+		{
+			Hulls[HullIndex]->ApplyBuoyancy(Locations, WaterHeights, WaterVelocities, -980.f);
+		}
+		else
+		{
+			Hulls[HullIndex]->ClearBuoyancy();
+		}
+	});
+
+	for (int32 HullIndex = 0; HullIndex < NumHulls; HullIndex++)
+	{
+		const float Expected = bSkippedLater[HullIndex] ? 0.f : BatchRatios[HullIndex];
+		TestEqual(FString::Printf(TEXT("Hull %d ratio after skip frame"), HullIndex), Hulls[HullIndex]->GetSubmergedRatio(), Expected, 1e-5f);
+	}
+
+	AddLogItem(FString::Printf(TEXT("%d pontoons, max height %g, max height error %g, max velocity error %g"),
+		NumPontoons, MaxHeight, MaxHeightError, MaxVelocityError));
+
+	TestTrue(TEXT("Some pontoons are submerged"), bAnySubmerged);
+	TestTrue(TEXT("Each hull gets its own pontoons"), bLocationsMatch);
+	TestTrue(TEXT("Batched height matches single hull and grid"), MaxHeightError <= MaxHeight * 1e-5f);
+	TestEqual(TEXT("Batched velocity matches single hull"), MaxVelocityError, 0.f);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,393 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanCPUBackendTest
+{
+	/** Largest difference of displacement texels, relative to the largest displacement of the reference */
+	float GetDisplacementError(const FVaOceanCPUBackend& Backend, const FVaOceanCPUBackend& Reference)
+	{
+		const int32 Dim = Reference.GetDimension();
+
+		float MaxError = 0.f;
+		float MaxValue = SMALL_NUMBER;
+		for (int32 Y = 0; Y < Dim; Y++)
+		{
+			for (int32 X = 0; X < Dim; X++)
+			{
+				const FVector4 Value = Backend.GetDisplacementTexel(X, Y);
+				const FVector4 ReferenceValue = Reference.GetDisplacementTexel(X, Y);
+
+				MaxError = FMath::Max(MaxError, FVector(Value - ReferenceValue).GetAbsMax());
+				MaxValue = FMath::Max(MaxValue, FVector(ReferenceValue).GetAbsMax());
+			}
+		}
+
+		return MaxError / MaxValue;
+	}
+
+	/** Exposes wrap-up passes of one step */
+	class FWrapUpBackend : public FVaOceanCPUBackend
+	{
+	public:
+		using FVaOceanCPUBackend::UpdateDisplacement;
+		using FVaOceanCPUBackend::GenGradientFolding;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUSpectrumTransitionTest, "VaOcean.CPUBackend.SpectrumTransition", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUSpectrumTransitionTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanCPUBackendTest;
+
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	// Doubled sea state and the one halfway to it
+	TArray<FVector4> H0Double;
+	TArray<FVector4> H0Halfway;
+	for (const FVector4& Texel : H0)
+	{
+		H0Double.Add(Texel * 2.f);
+		H0Halfway.Add(Texel * 1.5f);
+	}
+
+	FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+
+	FVaOceanCPUBackend Current;
+	Current.Initialize(Params.DispMapDimension, H0.GetData(), Omega.GetData());
+	Current.Update(PerFrame);
+
+	FVaOceanCPUBackend Halfway;
+	Halfway.Initialize(Params.DispMapDimension, H0Halfway.GetData(), Omega.GetData());
+	Halfway.Update(PerFrame);
+
+	FVaOceanCPUBackend Blended;
+	Blended.Initialize(Params.DispMapDimension, H0.GetData(), Omega.GetData());
+	Blended.SetTargetSpectrum(H0Double.GetData());
+
+	// Target doesn't change anything until it's blended in
+	Blended.Update(PerFrame);
+	TestEqual(TEXT("Zero blend matches the current sea state"), GetDisplacementError(Blended, Current), 0.f, 0.f);
+
+	PerFrame.SpectrumBlend = 0.5f;
+	Blended.Update(PerFrame);
+	TestEqual(TEXT("Half blend towards doubled spectrum scales displacement by 1.5"), GetDisplacementError(Blended, Halfway), 0.f, 1e-5f);
+
+	// Committed target is the sea state to blend from
+	Blended.CommitTargetSpectrum();
+	PerFrame.SpectrumBlend = 0.f;
+	Blended.Update(PerFrame);
+
+	FVaOceanCPUBackend Doubled;
+	Doubled.Initialize(Params.DispMapDimension, H0Double.GetData(), Omega.GetData());
+	Doubled.Update(PerFrame);
+	TestEqual(TEXT("Committed target matches the target sea state"), GetDisplacementError(Blended, Doubled), 0.f, 0.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUSpectrumBandTest, "VaOcean.CPUBackend.SpectrumBand", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUSpectrumBandTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanCPUBackendTest;
+
+	// Strong wind damps short waves hard enough for the band to shrink
+	FSpectrumData Params;
+	Params.WindSpeed = 3000.f;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	const int32 BandRadius = GetDefault<AVaOceanSimulator>()->InitSpectrumBand(Params, H0.GetData(), 1e-6f);
+
+	const FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+
+	FVaOceanCPUBackend Full;
+	Full.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Full.Update(PerFrame);
+
+	FVaOceanCPUBackend Band;
+	Band.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Band.SetSpectrumBand(BandRadius);
+	Band.Update(PerFrame);
+
+	// Gradient picks up the slope energy the band keeps too
+	float MaxGradient = SMALL_NUMBER;
+	float MaxGradientError = 0.f;
+	for (int32 Y = 0; Y < Dim; Y++)
+	{
+		for (int32 X = 0; X < Dim; X++)
+		{
+			const FVector4 Expected = Full.GetGradientTexel(X, Y);
+			const FVector4 Gradient = Band.GetGradientTexel(X, Y);
+
+			MaxGradient = FMath::Max(MaxGradient, FMath::Max(FMath::Abs(Expected.X), FMath::Abs(Expected.Y)));
+			MaxGradientError = FMath::Max(MaxGradientError, FMath::Max(FMath::Abs(Gradient.X - Expected.X), FMath::Abs(Gradient.Y - Expected.Y)));
+		}
+	}
+
+	const float DisplacementError = GetDisplacementError(Band, Full);
+	const float GradientError = MaxGradientError / MaxGradient;
+
+	AddLogItem(FString::Printf(TEXT("band radius %d of %d, displacement error %g, gradient error %g"), BandRadius, Dim / 2, DisplacementError, GradientError));
+
+	TestTrue(TEXT("Band is smaller than the spectrum"), BandRadius < Dim / 2);
+
+	// Dropped energy is below 1e-6, so amplitude error is around its square root
+	TestTrue(TEXT("Band displacement matches the full spectrum"), DisplacementError <= 1e-3f);
+	TestTrue(TEXT("Band gradient matches the full spectrum"), GradientError <= 1e-3f);
+
+	// Initialize starts with the whole spectrum again
+	Band.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Band.Update(PerFrame);
+	TestEqual(TEXT("Initialize resets the band"), GetDisplacementError(Band, Full), 0.f, 0.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUSpawnListTest, "VaOcean.CPUBackend.SpawnList", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUSpawnListTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 128;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+	PerFrame.SpawnFoldThreshold = 0.05f;
+
+	// Whole map fits into the list, then only part of the folding texels do
+	const int32 Capacities[] = { Dim * Dim, 100 };
+	for (const int32 Capacity : Capacities)
+	{
+		FVaOceanCPUBackend Backend;
+		Backend.Initialize(Dim, H0.GetData(), Omega.GetData(), false, nullptr, Capacity);
+		Backend.Update(PerFrame);
+
+		// Brute-force scan of the gradient map
+		int32 NumFolding = 0;
+		for (int32 Y = 0; Y < Dim; Y++)
+		{
+			for (int32 X = 0; X < Dim; X++)
+			{
+				NumFolding += (Backend.GetGradientTexel(X, Y).W > PerFrame.SpawnFoldThreshold) ? 1 : 0;
+			}
+		}
+
+		int32 Num = 0;
+		const FVaOceanFoldTexel* SpawnList = Backend.GetSpawnList(Num);
+
+		// Each entry is a folding texel with its own fold and foam, listed once
+		TArray<uint8> Listed;
+		Listed.SetNumZeroed(Dim * Dim);
+
+		int32 NumInvalid = 0;
+		for (int32 Index = 0; Index < Num; Index++)
+		{
+			const FVaOceanFoldTexel& Texel = SpawnList[Index];
+			const FVector4 Gradient = Backend.GetGradientTexel(Texel.X, Texel.Y);
+			const int32 TexelIndex = Texel.Y * Dim + Texel.X;
+
+			const bool bValid = Texel.X >= 0 && Texel.X < Dim && Texel.Y >= 0 && Texel.Y < Dim && !Listed[TexelIndex]
+				&& Gradient.W > PerFrame.SpawnFoldThreshold && Gradient.W == Texel.Fold && Gradient.Z == Texel.Foam;
+
+			NumInvalid += bValid ? 0 : 1;
+			Listed[FMath::Clamp(TexelIndex, 0, Dim * Dim - 1)] = 1;
+		}
+
+		AddLogItem(FString::Printf(TEXT("capacity %d: %d folding texels, %d listed"), Capacity, NumFolding, Num));
+
+		TestTrue(TEXT("Surface folds above threshold"), NumFolding > Capacities[1]);
+		TestEqual(FString::Printf(TEXT("Capacity %d: list holds all folding texels it can"), Capacity), Num, FMath::Min(NumFolding, Capacity));
+		TestEqual(FString::Printf(TEXT("Capacity %d: entries match the gradient map"), Capacity), NumInvalid, 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUInverseHeightTest, "VaOcean.CPUBackend.InverseHeight", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUInverseHeightTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	FVaOceanCPUBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Backend.Update(VaOceanTest::MakePerFrame(Params, 5.f));
+
+	// Brute force inversion runs the same fixed point iteration to convergence
+	const int32 ReferenceIterations = 64;
+	const float ConvergedResidual = 1e-3f / Dim;
+
+	FRandomStream Stream(7);
+	float MaxHeight = 0.f;
+	float MaxError = 0.f;
+	float MaxUninvertedError = 0.f;
+	int32 NumConverged = 0;
+	const int32 NumPoints = 512;
+
+	for (int32 Index = 0; Index < NumPoints; Index++)
+	{
+		// Texel centers, so the height field is read without filtering
+		const int32 X = FMath::Min((int32)(Stream.GetFraction() * Dim), Dim - 1);
+		const int32 Y = FMath::Min((int32)(Stream.GetFraction() * Dim), Dim - 1);
+		const FVector2D Target((X + 0.5f) / Dim, (Y + 0.5f) / Dim);
+
+		// Find the point displaced onto the target, displacement is in world units
+		FVector2D Point = Target;
+		for (int32 Iteration = 0; Iteration < ReferenceIterations; Iteration++)
+		{
+			Point = Target - FVector2D(Backend.SampleDisplacement(Point)) / Params.PatchLength;
+		}
+
+		// Folded texels have no single source point
+		const FVector Displacement = Backend.SampleDisplacement(Point);
+		const FVector2D Residual = Point + FVector2D(Displacement) / Params.PatchLength - Target;
+		if (Residual.GetAbsMax() > ConvergedResidual)
+		{
+			continue;
+		}
+
+		NumConverged++;
+		MaxHeight = FMath::Max(MaxHeight, FMath::Abs(Displacement.Z));
+		MaxError = FMath::Max(MaxError, FMath::Abs(Backend.SampleHeight(Target) - Displacement.Z));
+		MaxUninvertedError = FMath::Max(MaxUninvertedError, FMath::Abs(Backend.SampleDisplacement(Target).Z - Displacement.Z));
+	}
+
+	AddLogItem(FString::Printf(TEXT("%d of %d points converged, max height %g, max error %g (%d iterations), without inversion %g"),
+		NumConverged, NumPoints, MaxHeight, MaxError, CHOPPY_INVERSE_ITERATIONS, MaxUninvertedError));
+
+	TestTrue(TEXT("Surface has waves"), MaxHeight > 0.f);
+	TestTrue(TEXT("Most points have a single source point"), NumConverged > NumPoints * 9 / 10);
+	TestTrue(TEXT("Inverse height matches brute force inversion"), MaxError <= MaxHeight * 0.05f);
+	TestTrue(TEXT("Choppy displacement is inverted"), MaxError < MaxUninvertedError * 0.5f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUVelocityTest, "VaOcean.CPUBackend.Velocity", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUVelocityTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	// Velocity is per world second, so is the step of central difference
+	const float Time = 5.f;
+	const float DeltaTime = 0.01f;
+
+	FVaOceanCPUBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData(), true);
+	Backend.Update(VaOceanTest::MakePerFrame(Params, Time));
+
+	FVaOceanCPUBackend Before;
+	Before.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Before.Update(VaOceanTest::MakePerFrame(Params, Time - DeltaTime));
+
+	FVaOceanCPUBackend After;
+	After.Initialize(Dim, H0.GetData(), Omega.GetData());
+	After.Update(VaOceanTest::MakePerFrame(Params, Time + DeltaTime));
+
+	float MaxVelocity = 0.f;
+	float MaxError = 0.f;
+	for (int32 Y = 0; Y < Dim; Y++)
+	{
+		for (int32 X = 0; X < Dim; X++)
+		{
+			const FVector Difference = (FVector(After.GetDisplacementTexel(X, Y)) - FVector(Before.GetDisplacementTexel(X, Y))) / (2.f * DeltaTime);
+			const FVector Velocity = Backend.SampleVelocity(FVector2D((X + 0.5f) / Dim, (Y + 0.5f) / Dim));
+
+			MaxVelocity = FMath::Max(MaxVelocity, Difference.GetAbsMax());
+			MaxError = FMath::Max(MaxError, (Velocity - Difference).GetAbsMax());
+		}
+	}
+
+	AddLogItem(FString::Printf(TEXT("max velocity %g, max error %g"), MaxVelocity, MaxError));
+
+	TestTrue(TEXT("Surface moves"), MaxVelocity > 0.f);
+	TestTrue(TEXT("Velocity matches central difference of displacement"), MaxError <= MaxVelocity * 1e-3f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUWrapUpBenchmark, "VaOcean.CPUBackend.WrapUpBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FVaOceanCPUWrapUpBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanCPUBackendTest;
+
+	FSpectrumData Params;
+	Params.DispMapDimension = 512;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	const FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+
+	FWrapUpBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Backend.Update(PerFrame);
+
+	// Single thread first, then the way the simulator runs it
+	IConsoleVariable* SingleThreadCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.VaOcean.CPUSingleThread"));
+	const int32 PreviousSingleThread = SingleThreadCVar->GetInt();
+	const int32 Iterations = 20;
+
+	for (int32 SingleThread = 1; SingleThread >= 0; SingleThread--)
+	{
+		SingleThreadCVar->Set(SingleThread);
+
+		// Best of several runs of each pass
+		double DisplacementTime = MAX_dbl;
+		double GradientTime = MAX_dbl;
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			Backend.UpdateDisplacement(PerFrame.ChoppyScale);
+			DisplacementTime = FMath::Min(DisplacementTime, FPlatformTime::Seconds() - StartTime);
+
+			StartTime = FPlatformTime::Seconds();
+			Backend.GenGradientFolding(PerFrame);
+			GradientTime = FMath::Min(GradientTime, FPlatformTime::Seconds() - StartTime);
+		}
+
+		AddLogItem(FString::Printf(TEXT("%dx%d %s: displacement %.1f us, gradient and folding %.1f us, wrap-up %.1f us"),
+			Dim, Dim, SingleThread ? TEXT("one thread") : TEXT("task graph"), DisplacementTime * 1e6, GradientTime * 1e6, (DisplacementTime + GradientTime) * 1e6));
+	}
+
+	SingleThreadCVar->Set(PreviousSingleThread);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,221 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanCPUFFTTest
+{
+	/** Sizes with TVaOceanCPUFFT kernels */
+	static const int32 Sizes[] = { 128, 256, 512 };
+
+	/** Exposes generic radix-2 path of the backend */
+	class FGenericFFT : public FVaOceanCPUBackend
+	{
+	public:
+		explicit FGenericFFT(int32 InDim)
+		{
+			TArray<FVector4> H0;
+			TArray<float> Omega;
+			H0.SetNumZeroed(InDim * InDim);
+			Omega.SetNumZeroed(InDim * InDim);
+
+			Initialize(InDim, H0.GetData(), Omega.GetData());
+		}
+
+		using FVaOceanCPUBackend::FFT1D;
+	};
+
+	/** Dim x Dim random values, rows padded the same way as backend planes */
+	struct FSignal
+	{
+		int32 Dim;
+		int32 Stride;
+		TArray<float> Re;
+		TArray<float> Im;
+
+		FSignal(int32 InDim, int32 Seed)
+			: Dim(InDim)
+			, Stride(InDim + 16)
+		{
+			FRandomStream Stream(Seed);
+
+			Re.SetNumUninitialized(Dim * Stride);
+			Im.SetNumUninitialized(Dim * Stride);
+			for (int32 Index = 0; Index < Re.Num(); Index++)
+			{
+				Re[Index] = Stream.GetFraction() - 0.5f;
+				Im[Index] = Stream.GetFraction() - 0.5f;
+			}
+		}
+	};
+
+	/**
+	 * Largest difference of Count transforms starting at First (stride between elements ElementStride)
+	 * from double precision DFT of the source, relative to the largest magnitude of the DFT
+	 */
+	float GetTransformError(const FSignal& Source, const FSignal& Transformed, int32 First, int32 ElementStride, int32 Count)
+	{
+		const int32 Dim = Source.Dim;
+
+		TArray<double> CosTable;
+		TArray<double> SinTable;
+		for (int32 Index = 0; Index < Dim; Index++)
+		{
+			CosTable.Add(cos(2.0 * PI * Index / Dim));
+			SinTable.Add(-sin(2.0 * PI * Index / Dim));
+		}
+
+		double MaxError = 0.0;
+		double MaxMagnitude = SMALL_NUMBER;
+		for (int32 Transform = 0; Transform < Count; Transform++)
+		{
+			const int32 Base = First + Transform;
+
+			for (int32 K = 0; K < Dim; K++)
+			{
+				double SumRe = 0.0;
+				double SumIm = 0.0;
+				for (int32 N = 0; N < Dim; N++)
+				{
+					const int32 Phase = (K * N) & (Dim - 1);
+					const double Re = Source.Re[Base + N * ElementStride];
+					const double Im = Source.Im[Base + N * ElementStride];
+
+					SumRe += Re * CosTable[Phase] - Im * SinTable[Phase];
+					SumIm += Re * SinTable[Phase] + Im * CosTable[Phase];
+				}
+
+				const int32 Index = Base + K * ElementStride;
+				MaxError = FMath::Max(MaxError, FMath::Max(FMath::Abs(Transformed.Re[Index] - SumRe), FMath::Abs(Transformed.Im[Index] - SumIm)));
+				MaxMagnitude = FMath::Max(MaxMagnitude, FMath::Max(FMath::Abs(SumRe), FMath::Abs(SumIm)));
+			}
+		}
+
+		return (float)(MaxError / MaxMagnitude);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUFFTAccuracyTest, "VaOcean.CPUFFT.MatchesDFT", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanCPUFFTAccuracyTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanCPUFFTTest;
+
+	for (const int32 Dim : Sizes)
+	{
+		const FVaOceanCPUFFTKernel Kernel = GetVaOceanCPUFFTKernel(Dim);
+		if (!Kernel)
+		{
+			AddError(FString::Printf(TEXT("No specialized kernel of size %d"), Dim));
+			continue;
+		}
+
+		FGenericFFT Generic(Dim);
+		const FSignal Source(Dim, Dim);
+
+		// Column block of vector lanes, column block with scalar tail (Count % 4 != 0) and single row
+		struct FCase
+		{
+			const TCHAR* Name;
+			int32 First;
+			int32 ElementStride;
+			int32 Count;
+		};
+		const FCase Cases[] =
+		{
+			{ TEXT("columns"), 16, Source.Stride, 16 },
+			{ TEXT("odd columns"), 3, Source.Stride, 6 },
+			{ TEXT("row"), 5 * Source.Stride, 1, 1 },
+		};
+
+		for (const FCase& Case : Cases)
+		{
+			FSignal Specialized = Source;
+			Kernel(Specialized.Re.GetData() + Case.First, Specialized.Im.GetData() + Case.First, Case.ElementStride, Case.Count);
+
+			FSignal Reference = Source;
+			Generic.FFT1D(Reference.Re.GetData() + Case.First, Reference.Im.GetData() + Case.First, Case.ElementStride, Case.Count);
+
+			const float SpecializedError = GetTransformError(Source, Specialized, Case.First, Case.ElementStride, Case.Count);
+			const float GenericError = GetTransformError(Source, Reference, Case.First, Case.ElementStride, Case.Count);
+
+			AddLogItem(FString::Printf(TEXT("%d %s: specialized error %g, generic error %g"), Dim, Case.Name, SpecializedError, GenericError));
+
+			TestTrue(FString::Printf(TEXT("%d %s match DFT"), Dim, Case.Name), SpecializedError <= 1e-6f);
+			TestTrue(FString::Printf(TEXT("%d %s are as accurate as generic path"), Dim, Case.Name), SpecializedError <= FMath::Max(GenericError * 2.f, 1e-7f));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanCPUFFTBenchmark, "VaOcean.CPUFFT.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FVaOceanCPUFFTBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanCPUFFTTest;
+
+	// Columns are transformed a cache line at a time, the same as ComputeFFT does
+	const int32 ColumnBlock = 16;
+	const int32 Iterations = 20;
+
+	for (const int32 Dim : Sizes)
+	{
+		const FVaOceanCPUFFTKernel Kernel = GetVaOceanCPUFFTKernel(Dim);
+		FGenericFFT Generic(Dim);
+		FSignal Plane(Dim, Dim);
+
+		// Best of several single-thread runs of all rows and all columns of one plane
+		double BestTime[2] = { MAX_dbl, MAX_dbl };
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (int32 Path = 0; Path < 2; Path++)
+			{
+				float* Re = Plane.Re.GetData();
+				float* Im = Plane.Im.GetData();
+
+				const double StartTime = FPlatformTime::Seconds();
+				for (int32 Y = 0; Y < Dim; Y++)
+				{
+					if (Path == 0)
+					{
+						Generic.FFT1D(Re + Y * Plane.Stride, Im + Y * Plane.Stride, 1, 1);
+					}
+					else
+					{
+						Kernel(Re + Y * Plane.Stride, Im + Y * Plane.Stride, 1, 1);
+					}
+				}
+				for (int32 X = 0; X < Dim; X += ColumnBlock)
+				{
+					if (Path == 0)
+					{
+						Generic.FFT1D(Re + X, Im + X, Plane.Stride, ColumnBlock);
+					}
+					else
+					{
+						Kernel(Re + X, Im + X, Plane.Stride, ColumnBlock);
+					}
+				}
+				BestTime[Path] = FMath::Min(BestTime[Path], FPlatformTime::Seconds() - StartTime);
+
+				// Keep values in range, a 2D transform of random values grows them by Dim
+				const float Scale = 1.f / Dim;
+				for (int32 Index = 0; Index < Plane.Re.Num(); Index++)
+				{
+					Re[Index] *= Scale;
+					Im[Index] *= Scale;
+				}
+			}
+		}
+
+		AddLogItem(FString::Printf(TEXT("%dx%d plane: generic %.1f us, specialized %.1f us (%.2fx)"),
+			Dim, Dim, BestTime[0] * 1e6, BestTime[1] * 1e6, BestTime[0] / BestTime[1]));
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
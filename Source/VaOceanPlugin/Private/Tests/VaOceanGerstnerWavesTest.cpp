@@ -0,0 +1,132 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanGerstnerGridTest, "VaOcean.GerstnerWaves.MatchesFFT", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanGerstnerGridTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 32;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	// Every texel holds two waves, with all of them picked the sum is the FFT one
+	FVaOceanGerstnerWaves Waves;
+	Waves.Initialize(Dim, H0.GetData(), Omega.GetData(), 2 * Dim * Dim, 8);
+
+	FVaOceanCPUBackend Spectrum;
+	Spectrum.Initialize(Dim, H0.GetData(), Omega.GetData(), true);
+
+	FVaOceanCPUBackend Analytic;
+	Analytic.Initialize(Dim, H0.GetData(), Omega.GetData(), true, &Waves);
+
+	const FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+	Spectrum.Update(PerFrame);
+	Analytic.Update(PerFrame);
+
+	const FVector Bound = Waves.GetDisplacementBound(PerFrame.ChoppyScale);
+
+	float MaxDisplacement = 0.f;
+	float MaxError = 0.f;
+	float MaxVelocityError = 0.f;
+	bool bInsideBound = true;
+
+	for (int32 Y = 0; Y < Dim; Y++)
+	{
+		for (int32 X = 0; X < Dim; X++)
+		{
+			const FVector Expected(Spectrum.GetDisplacementTexel(X, Y));
+			const FVector Displacement(Analytic.GetDisplacementTexel(X, Y));
+
+			MaxDisplacement = FMath::Max(MaxDisplacement, Expected.GetAbsMax());
+			MaxError = FMath::Max(MaxError, (Displacement - Expected).GetAbsMax());
+
+			const FVector2D UV((X + 0.5f) / Dim, (Y + 0.5f) / Dim);
+			MaxVelocityError = FMath::Max(MaxVelocityError, (Analytic.SampleVelocity(UV) - Spectrum.SampleVelocity(UV)).GetAbsMax());
+
+			const FVector AbsDisplacement = Displacement.GetAbs();
+			bInsideBound &= AbsDisplacement.X <= Bound.X && AbsDisplacement.Y <= Bound.Y && AbsDisplacement.Z <= Bound.Z;
+		}
+	}
+
+	AddLogItem(FString::Printf(TEXT("%d waves: max displacement %g, max error %g, max velocity error %g"), Waves.Num(), MaxDisplacement, MaxError, MaxVelocityError));
+
+	TestTrue(TEXT("Surface has waves"), MaxDisplacement > 0.f);
+	TestTrue(TEXT("Analytic displacement matches FFT"), MaxError <= MaxDisplacement * 1e-4f);
+	TestTrue(TEXT("Analytic velocity matches FFT"), MaxVelocityError <= MaxDisplacement * 1e-4f);
+	TestTrue(TEXT("Displacement is inside the bound"), bInsideBound);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanGerstnerPointTest, "VaOcean.GerstnerWaves.PointQueries", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanGerstnerPointTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 32;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	// Strongest waves without stratification are a truncated FFT sum, with all of them it's the whole sum
+	FVaOceanGerstnerWaves Waves;
+	Waves.Initialize(Dim, H0.GetData(), Omega.GetData(), 2 * Dim * Dim, 0);
+
+	FVaOceanCPUBackend Spectrum;
+	Spectrum.Initialize(Dim, H0.GetData(), Omega.GetData(), true);
+
+	const FVaOceanCPUPerFrame PerFrame = VaOceanTest::MakePerFrame(Params, 5.f);
+	Spectrum.Update(PerFrame);
+
+	// Texel centers of tiles away from the origin, so bilinear samples of the grid are exact
+	FRandomStream Stream(3);
+	TArray<FVector2D> TexelUVs;
+	TArray<FVector2D> PointUVs;
+	for (int32 Index = 0; Index < 256; Index++)
+	{
+		const int32 X = FMath::Min((int32)(Stream.GetFraction() * Dim), Dim - 1);
+		const int32 Y = FMath::Min((int32)(Stream.GetFraction() * Dim), Dim - 1);
+
+		TexelUVs.Add(FVector2D((X + 0.5f) / Dim + 3.f, (Y + 0.5f) / Dim - 7.f));
+		PointUVs.Add(FVector2D((float)X / Dim + 3.f, (float)Y / Dim - 7.f));
+	}
+
+	TArray<FVector> Displacement;
+	TArray<FVector> Velocity;
+	Displacement.SetNumUninitialized(PointUVs.Num());
+	Velocity.SetNumUninitialized(PointUVs.Num());
+	Waves.EvaluatePoints(PointUVs.GetData(), PointUVs.Num(), PerFrame.Time, PerFrame.TimeScale, PerFrame.ChoppyScale, Displacement.GetData(), Velocity.GetData());
+
+	float MaxDisplacement = 0.f;
+	float MaxError = 0.f;
+	float MaxVelocityError = 0.f;
+	for (int32 Index = 0; Index < PointUVs.Num(); Index++)
+	{
+		const FVector Expected = Spectrum.SampleDisplacement(TexelUVs[Index]);
+
+		MaxDisplacement = FMath::Max(MaxDisplacement, Expected.GetAbsMax());
+		MaxError = FMath::Max(MaxError, (Displacement[Index] - Expected).GetAbsMax());
+		MaxVelocityError = FMath::Max(MaxVelocityError, (Velocity[Index] - Spectrum.SampleVelocity(TexelUVs[Index])).GetAbsMax());
+	}
+
+	AddLogItem(FString::Printf(TEXT("%d waves: max displacement %g, max error %g, max velocity error %g"), Waves.Num(), MaxDisplacement, MaxError, MaxVelocityError));
+
+	TestTrue(TEXT("Surface has waves"), MaxDisplacement > 0.f);
+	TestTrue(TEXT("Point displacement matches the grid"), MaxError <= MaxDisplacement * 1e-4f);
+	TestTrue(TEXT("Point velocity matches the grid"), MaxVelocityError <= MaxDisplacement * 1e-4f);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
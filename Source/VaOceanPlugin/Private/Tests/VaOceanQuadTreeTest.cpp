@@ -0,0 +1,224 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanQuadTreeTest
+{
+	/** Distance from point to displacement bounds of the patch, same box the selector uses */
+	float GetPatchDistance(const FVaOceanQuadTreeSettings& Settings, const FVaOceanPatch& Patch, const FVector& Point)
+	{
+		const float HalfSize = Patch.Size * 0.5f + Settings.HorizontalPadding;
+		const FVector BoxCenter(Patch.Center.X, Patch.Center.Y, (Settings.MinHeight + Settings.MaxHeight) * 0.5f);
+		const FVector BoxExtent(HalfSize, HalfSize, (Settings.MaxHeight - Settings.MinHeight) * 0.5f);
+
+		float DistSquared = 0.f;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			const float Delta = FMath::Max(FMath::Abs(Point[Axis] - BoxCenter[Axis]) - BoxExtent[Axis], 0.f);
+			DistSquared += Delta * Delta;
+		}
+
+		return FMath::Sqrt(DistSquared);
+	}
+
+	bool IsPointInPatch(const FVaOceanPatch& Patch, float X, float Y)
+	{
+		const float HalfSize = Patch.Size * 0.5f;
+		return FMath::Abs(X - Patch.Center.X) <= HalfSize && FMath::Abs(Y - Patch.Center.Y) <= HalfSize;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanQuadTreeLODTest, "VaOcean.QuadTree.LODSelection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanQuadTreeLODTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanQuadTreeTest;
+
+	FVaOceanQuadTreeSettings Settings;
+	Settings.Extent = 200000.f;
+	Settings.MinHeight = -300.f;
+	Settings.MaxHeight = 300.f;
+
+	FVaOceanQuadTree QuadTree;
+	QuadTree.SetSettings(Settings);
+
+	for (int32 LOD = 0; LOD < Settings.LODCount; LOD++)
+	{
+		TestEqual(FString::Printf(TEXT("Range of LOD %d"), LOD), QuadTree.GetLODRange(LOD), Settings.LODBaseRange * (float)(1 << LOD));
+	}
+	TestEqual(TEXT("Range above the last LOD is clamped"), QuadTree.GetLODRange(Settings.LODCount + 3), QuadTree.GetLODRange(Settings.LODCount - 1));
+
+	const FVector ViewOrigin(1000.f, 300.f, 500.f);
+	TArray<FPlane> NoCulling;
+	TArray<FVaOceanPatch> Patches;
+	QuadTree.Select(ViewOrigin, NoCulling, Patches);
+
+	if (!TestTrue(TEXT("Patches are selected"), Patches.Num() > 0))
+	{
+		return false;
+	}
+
+	// Without culling the patches tile whole root grid once
+	const float RootSize = Settings.MinPatchSize * (float)(1 << (Settings.LODCount - 1));
+	const int32 RootCount = FMath::CeilToInt((Settings.Center.X + Settings.Extent) / RootSize) - FMath::FloorToInt((Settings.Center.X - Settings.Extent) / RootSize);
+
+	double CoveredArea = 0.0;
+	int32 PatchesUnderView = 0;
+
+	for (const FVaOceanPatch& Patch : Patches)
+	{
+		CoveredArea += (double)Patch.Size * Patch.Size;
+
+		TestEqual(TEXT("Patch size matches its LOD"), Patch.Size, Settings.MinPatchSize * (float)(1 << Patch.LOD));
+		TestEqual(TEXT("Morph ends at LOD range"), Patch.MorphEnd, QuadTree.GetLODRange(Patch.LOD));
+		TestTrue(TEXT("Morph starts inside LOD range"), Patch.MorphStart <= Patch.MorphEnd && Patch.MorphStart >= (Patch.LOD > 0 ? QuadTree.GetLODRange(Patch.LOD - 1) : 0.f));
+
+		// Coarse patch is only chosen when its bounds are out of reach of the finer LOD
+		if (Patch.LOD > 0 && GetPatchDistance(Settings, Patch, ViewOrigin) <= QuadTree.GetLODRange(Patch.LOD - 1))
+		{
+			AddError(FString::Printf(TEXT("Patch LOD %d at (%.0f, %.0f) is within range of LOD %d"), Patch.LOD, Patch.Center.X, Patch.Center.Y, Patch.LOD - 1));
+		}
+
+		if (IsPointInPatch(Patch, ViewOrigin.X, ViewOrigin.Y))
+		{
+			PatchesUnderView++;
+			TestEqual(TEXT("Patch under the view is the finest"), Patch.LOD, 0);
+		}
+	}
+
+	TestEqual(TEXT("Patches tile the root grid"), (float)(CoveredArea / ((double)RootSize * RootSize * RootCount * RootCount)), 1.f, 1e-5f);
+	TestEqual(TEXT("Patches under the view"), PatchesUnderView, 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanQuadTreeCullingTest, "VaOcean.QuadTree.FrustumCulling", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanQuadTreeCullingTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanQuadTreeTest;
+
+	FVaOceanQuadTreeSettings Settings;
+	Settings.Extent = 200000.f;
+	Settings.MinHeight = -300.f;
+	Settings.MaxHeight = 300.f;
+
+	FVaOceanQuadTree QuadTree;
+	QuadTree.SetSettings(Settings);
+
+	// Looking along +X, root grid is aligned to origin so no patch straddles X = 0 or Y = 0
+	const FVector ViewOrigin(1000.f, 300.f, 500.f);
+	const float FarDistance = 150000.f;
+
+	TArray<FPlane> Frustum;
+	FVaOceanQuadTree::BuildFrustum(ViewOrigin, FVector(1.f, 0.f, 0.f), FVector(0.f, 1.f, 0.f), FVector(0.f, 0.f, 1.f), PI / 4.f, 16.f / 9.f, FarDistance, Frustum);
+	TestEqual(TEXT("Frustum planes"), Frustum.Num(), 5);
+
+	TArray<FPlane> NoCulling;
+	TArray<FVaOceanPatch> AllPatches;
+	TArray<FVaOceanPatch> Patches;
+	QuadTree.Select(ViewOrigin, NoCulling, AllPatches);
+	QuadTree.Select(ViewOrigin, Frustum, Patches);
+
+	TestTrue(TEXT("Culling removes patches"), Patches.Num() > 0 && Patches.Num() * 2 < AllPatches.Num());
+
+	for (const FVaOceanPatch& Patch : Patches)
+	{
+		// Culling only drops nodes, it never changes LOD of the ones that stay
+		bool bFound = false;
+		for (const FVaOceanPatch& Other : AllPatches)
+		{
+			if (Other.LOD == Patch.LOD && Other.Center.X == Patch.Center.X && Other.Center.Y == Patch.Center.Y)
+			{
+				bFound = true;
+				break;
+			}
+		}
+		TestTrue(TEXT("Culled selection is a subset of full selection"), bFound);
+
+		if (Patch.Center.X + Patch.Size * 0.5f <= 0.f)
+		{
+			AddError(FString::Printf(TEXT("Patch LOD %d at (%.0f, %.0f) behind the view is not culled"), Patch.LOD, Patch.Center.X, Patch.Center.Y));
+		}
+
+		if (Patch.Center.X - Patch.Size * 0.5f > ViewOrigin.X + FarDistance)
+		{
+			AddError(FString::Printf(TEXT("Patch LOD %d at (%.0f, %.0f) beyond far plane is not culled"), Patch.LOD, Patch.Center.X, Patch.Center.Y));
+		}
+	}
+
+	// Surface along the view direction must stay covered
+	for (float Distance = 2000.f; Distance < FarDistance; Distance *= 1.5f)
+	{
+		const float X = ViewOrigin.X + Distance;
+		const float Y = ViewOrigin.Y;
+
+		bool bCovered = false;
+		for (const FVaOceanPatch& Patch : Patches)
+		{
+			bCovered |= IsPointInPatch(Patch, X, Y);
+		}
+
+		if (!bCovered)
+		{
+			AddError(FString::Printf(TEXT("Visible surface at (%.0f, %.0f) is culled"), X, Y));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanQuadTreePaddingTest, "VaOcean.QuadTree.DisplacementPadding", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanQuadTreePaddingTest::RunTest(const FString& Parameters)
+{
+	FVaOceanQuadTreeSettings Settings;
+	Settings.Extent = 20000.f;
+	Settings.MinPatchSize = 2000.f;
+	Settings.LODCount = 3;
+	Settings.MinHeight = -300.f;
+	Settings.MaxHeight = 300.f;
+
+	// Keeps X >= 50, patches whose grid ends at X = 0 are only kept when displacement can reach over the plane
+	TArray<FPlane> Frustum;
+	Frustum.Add(FPlane(FVector(50.f, 0.f, 0.f), FVector(1.f, 0.f, 0.f)));
+
+	const FVector ViewOrigin(1000.f, 1000.f, 0.f);
+
+	FVaOceanQuadTree QuadTree;
+	TArray<FVaOceanPatch> Patches;
+
+	QuadTree.SetSettings(Settings);
+	QuadTree.Select(ViewOrigin, Frustum, Patches);
+
+	for (const FVaOceanPatch& Patch : Patches)
+	{
+		TestTrue(TEXT("Patch without padding is in front of the plane"), Patch.Center.X + Patch.Size * 0.5f >= 50.f);
+	}
+
+	const int32 UnpaddedCount = Patches.Num();
+
+	Settings.HorizontalPadding = 100.f;
+	QuadTree.SetSettings(Settings);
+	QuadTree.Select(ViewOrigin, Frustum, Patches);
+
+	int32 PaddedOnly = 0;
+	for (const FVaOceanPatch& Patch : Patches)
+	{
+		TestTrue(TEXT("Patch with padding reaches the plane"), Patch.Center.X + Patch.Size * 0.5f + Settings.HorizontalPadding >= 50.f);
+		if (Patch.Center.X + Patch.Size * 0.5f < 50.f)
+		{
+			PaddedOnly++;
+		}
+	}
+
+	TestTrue(TEXT("Padding keeps patches displaced over the plane"), PaddedOnly > 0);
+	TestTrue(TEXT("Padding never culls more"), Patches.Num() >= UnpaddedCount);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,145 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanQueryCacheTest, "VaOcean.QueryCache.MatchesGrid", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanQueryCacheTest::RunTest(const FString& Parameters)
+{
+	FSpectrumData Params;
+	Params.DispMapDimension = 64;
+	const int32 Dim = Params.DispMapDimension;
+
+	TArray<FVector4> H0;
+	TArray<float> Omega;
+	VaOceanTest::InitSpectrum(Params, H0, Omega);
+
+	FVaOceanCPUBackend Backend;
+	Backend.Initialize(Dim, H0.GetData(), Omega.GetData());
+	Backend.Update(VaOceanTest::MakePerFrame(Params, 5.f));
+
+	FThreadSafeCounter Resolved;
+	auto Resolve = [&](const FVector2D* InUVs, int32 InNum, float* OutHeights)
+	{
+		Resolved.Add(InNum);
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			OutHeights[Index] = Backend.SampleHeight(InUVs[Index]);
+		}
+	};
+
+	FVaOceanQueryCache Cache;
+	Cache.Initialize(Dim, 8, 64);
+
+	// Points of a few hulls spread over several tiles, away from the origin tile
+	FRandomStream Stream(5);
+	TArray<FVector2D> UVs;
+	for (int32 Index = 0; Index < 4096; Index++)
+	{
+		const FVector2D Hull((Index % 4) * 0.23f - 2.f, (Index % 4) * 0.31f + 5.f);
+		UVs.Add(Hull + FVector2D(Stream.GetFraction(), Stream.GetFraction()) * 0.1f);
+	}
+
+	// Physics threads query at once, answers must not depend on who resolved the tile
+	TArray<float> Heights;
+	Heights.SetNumUninitialized(UVs.Num());
+	ParallelFor(UVs.Num(), [&](int32 Index)
+	{
+		Heights[Index] = Cache.SampleHeight(UVs[Index], Resolve);
+	});
+
+	float MaxHeight = 0.f;
+	float MaxError = 0.f;
+	for (int32 Index = 0; Index < UVs.Num(); Index++)
+	{
+		const float Expected = Backend.SampleHeight(UVs[Index]);
+
+		MaxHeight = FMath::Max(MaxHeight, FMath::Abs(Expected));
+		MaxError = FMath::Max(MaxError, FMath::Abs(Heights[Index] - Expected));
+	}
+
+	// Queries of the same generation don't resolve anything anymore
+	const int32 FirstPassResolved = Resolved.GetValue();
+	for (const FVector2D& UV : UVs)
+	{
+		Cache.SampleHeight(UV, Resolve);
+	}
+	const int32 SecondPassResolved = Resolved.GetValue() - FirstPassResolved;
+
+	Cache.Invalidate();
+	const FVaOceanQueryCacheStats Stats = Cache.GetLastStats();
+
+	// New generation resolves its tiles again
+	Cache.SampleHeight(UVs[0], Resolve);
+	const bool bInvalidated = Resolved.GetValue() > FirstPassResolved + SecondPassResolved;
+
+	AddLogItem(FString::Printf(TEXT("max height %g, max error %g, hits %d, misses %d, bypasses %d, hit rate %.3f"),
+		MaxHeight, MaxError, Stats.Hits, Stats.Misses, Stats.Bypasses, Stats.GetHitRate()));
+
+	TestTrue(TEXT("Surface has waves"), MaxHeight > 0.f);
+	TestTrue(TEXT("Cached height matches the grid"), MaxError <= MaxHeight * 1e-5f);
+	TestEqual(TEXT("Second pass is answered from resolved tiles"), SecondPassResolved, 0);
+	TestEqual(TEXT("All queries are counted"), Stats.Hits + Stats.Misses + Stats.Bypasses, 2 * UVs.Num());
+	TestTrue(TEXT("Close points mostly hit"), Stats.GetHitRate() > 0.9f);
+	TestTrue(TEXT("Invalidate drops resolved tiles"), bInvalidated);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanQueryCacheInvalidateTest, "VaOcean.QueryCache.InvalidateWhileResolving", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanQueryCacheInvalidateTest::RunTest(const FString& Parameters)
+{
+	FVaOceanQueryCache Cache;
+	Cache.Initialize(64, 8, 4);
+
+	const FVector2D UV(0.3f, 0.6f);
+	const float OldHeight = 1.f;
+	const float NewHeight = 2.f;
+
+	auto ResolveNew = [&](const FVector2D* InUVs, int32 InNum, float* OutHeights)
+	{
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			OutHeights[Index] = NewHeight;
+		}
+	};
+
+	// Surface changes while a tile of the old one is resolved: the next generation queries the same tile
+	// before the old resolver writes its samples, as another thread would
+	float NestedHeight = 0.f;
+	bool bInvalidated = false;
+	auto ResolveOld = [&](const FVector2D* InUVs, int32 InNum, float* OutHeights)
+	{
+		if (!bInvalidated)
+		{
+			bInvalidated = true;
+			Cache.Invalidate();
+			NestedHeight = Cache.SampleHeight(UV, ResolveNew);
+		}
+
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			OutHeights[Index] = OldHeight;
+		}
+	};
+
+	const float OuterHeight = Cache.SampleHeight(UV, ResolveOld);
+
+	// Tile of the new generation must not be overwritten by the late resolver
+	const float LaterHeight = Cache.SampleHeight(UV, ResolveNew);
+
+	AddLogItem(FString::Printf(TEXT("outer %g, nested %g, later %g"), OuterHeight, NestedHeight, LaterHeight));
+
+	TestEqual(TEXT("Old generation query gets old surface"), OuterHeight, OldHeight);
+	TestEqual(TEXT("New generation query gets new surface"), NestedHeight, NewHeight);
+	TestEqual(TEXT("Resolved tile of new generation keeps new surface"), LaterHeight, NewHeight);
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
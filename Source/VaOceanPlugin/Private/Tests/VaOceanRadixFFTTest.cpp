@@ -0,0 +1,96 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanRadixFFTTest
+{
+	/** Transform sizes of the displacement map and its spectrum mips */
+	static const uint32 Sizes[] = { 64, 128, 256, 512 };
+
+	/** Displacement map transforms Dx, Dy and Dz at once */
+	static const uint32 Slices = 3;
+
+	/** Timed transforms of each shader set */
+	static const uint32 Iterations = 64;
+
+	/** Per-pass times of generic shaders [0] and pass permutations [1] */
+	struct FPassTimings
+	{
+		uint32 PassCount;
+		float PassMicroseconds[2][FFT_PARAM_SETS];
+	};
+
+	static FString FormatPasses(const float* PassMicroseconds, uint32 PassCount, float& OutTotal)
+	{
+		FString Passes;
+		OutTotal = 0.f;
+		for (uint32 i = 0; i < PassCount; i++)
+		{
+			Passes += FString::Printf(TEXT(" %.1f"), PassMicroseconds[i]);
+			OutTotal += PassMicroseconds[i];
+		}
+		return Passes;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanRadixFFTPassBenchmark, "VaOcean.RadixFFT.PassBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FVaOceanRadixFFTPassBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanRadixFFTTest;
+
+	// Pass permutations and timestamps need a real SM5 device
+	if (!FApp::CanEverRender() || GMaxRHIFeatureLevel < ERHIFeatureLevel::SM5)
+	{
+		AddWarning(TEXT("No SM5 RHI, FFT passes are not measured"));
+		return true;
+	}
+
+	for (const uint32 Dim : Sizes)
+	{
+		FPassTimings Timings;
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+			MeasureRadixPassesCommand,
+			uint32, Dim, Dim,
+			VaOceanRadixFFTTest::FPassTimings*, Timings, &Timings,
+			{
+				const uint32 BytesPerElement = sizeof(float) * 2;
+				const uint32 NumElements = Dim * Dim * VaOceanRadixFFTTest::Slices;
+
+				FRHIResourceCreateInfo ResourceCreateInfo;
+				FStructuredBufferRHIRef SrcBuffer = RHICreateStructuredBuffer(BytesPerElement, BytesPerElement * NumElements, (BUF_UnorderedAccess | BUF_ShaderResource), ResourceCreateInfo);
+				FStructuredBufferRHIRef DstBuffer = RHICreateStructuredBuffer(BytesPerElement, BytesPerElement * NumElements, (BUF_UnorderedAccess | BUF_ShaderResource), ResourceCreateInfo);
+				FShaderResourceViewRHIRef SrcSRV = RHICreateShaderResourceView(SrcBuffer);
+				FUnorderedAccessViewRHIRef DstUAV = RHICreateUnorderedAccessView(DstBuffer, false, false);
+				FShaderResourceViewRHIRef DstSRV = RHICreateShaderResourceView(DstBuffer);
+
+				FRadixPlan512 Plan;
+				RadixCreatePlan(&Plan, VaOceanRadixFFTTest::Slices, Dim);
+				Timings->PassCount = Plan.PassCount;
+
+				RadixMeasurePasses(RHICmdList, &Plan, false, VaOceanRadixFFTTest::Iterations, DstUAV, DstSRV, SrcSRV, Timings->PassMicroseconds[0]);
+				RadixMeasurePasses(RHICmdList, &Plan, true, VaOceanRadixFFTTest::Iterations, DstUAV, DstSRV, SrcSRV, Timings->PassMicroseconds[1]);
+
+				RadixDestroyPlan(&Plan);
+			});
+		FlushRenderingCommands();
+
+		float GenericTotal, SpecializedTotal;
+		const FString GenericPasses = FormatPasses(Timings.PassMicroseconds[0], Timings.PassCount, GenericTotal);
+		const FString SpecializedPasses = FormatPasses(Timings.PassMicroseconds[1], Timings.PassCount, SpecializedTotal);
+
+		AddLogItem(FString::Printf(TEXT("%dx%d, %d slices: generic passes (us)%s, total %.1f us"), Dim, Dim, Slices, *GenericPasses, GenericTotal));
+		AddLogItem(FString::Printf(TEXT("%dx%d, %d slices: specialized passes (us)%s, total %.1f us (%.2fx)"),
+			Dim, Dim, Slices, *SpecializedPasses, SpecializedTotal, GenericTotal / FMath::Max(SpecializedTotal, KINDA_SMALL_NUMBER)));
+
+		TestTrue(TEXT("Passes are timed"), GenericTotal > 0.f && SpecializedTotal > 0.f);
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
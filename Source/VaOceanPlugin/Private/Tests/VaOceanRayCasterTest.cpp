@@ -0,0 +1,175 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+#include "VaOceanTestHelpers.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace VaOceanRayCasterTest
+{
+	const int32 Dim = 128;
+	const float SeaLevel = 100.f;
+
+	/** Backend stepped once with the default sea state */
+	void InitBackend(FVaOceanCPUBackend& Backend, FSpectrumData& OutParams)
+	{
+		OutParams.DispMapDimension = Dim;
+
+		TArray<FVector4> H0;
+		TArray<float> Omega;
+		VaOceanTest::InitSpectrum(OutParams, H0, Omega);
+
+		Backend.Initialize(Dim, H0.GetData(), Omega.GetData());
+		Backend.Update(VaOceanTest::MakePerFrame(OutParams, 10.f));
+	}
+
+	/** Rays looking down on the water from above, the way gameplay traces do */
+	void MakeRays(int32 Count, float MaxDistance, TArray<FVaOceanRay>& OutRays)
+	{
+		FRandomStream Stream(7);
+
+		OutRays.SetNumUninitialized(Count);
+		for (FVaOceanRay& Ray : OutRays)
+		{
+			Ray.Origin = FVector((Stream.GetFraction() - 0.5f) * 20000.f, (Stream.GetFraction() - 0.5f) * 20000.f, SeaLevel + 500.f + Stream.GetFraction() * 1000.f);
+			Ray.Direction = FVector(Stream.GetFraction() - 0.5f, Stream.GetFraction() - 0.5f, -0.05f - Stream.GetFraction()).GetSafeNormal();
+			Ray.MaxDistance = MaxDistance;
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanRayCasterHitTest, "VaOcean.RayCaster.Hits", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanRayCasterHitTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanRayCasterTest;
+
+	FSpectrumData Params;
+	FVaOceanCPUBackend Backend;
+	InitBackend(Backend, Params);
+
+	const FVaOceanRayCaster RayCaster(Backend, Params.PatchLength, SeaLevel);
+	const float TexelSize = Params.PatchLength / Dim;
+
+	TArray<FVaOceanRay> Rays;
+	TArray<FVaOceanRayHit> Hits;
+	MakeRays(512, 8000.f, Rays);
+	RayCaster.RaycastBatch(Rays, Hits);
+
+	int32 HitCount = 0;
+	for (int32 Index = 0; Index < Rays.Num(); Index++)
+	{
+		const FVaOceanRay& Ray = Rays[Index];
+		const FVaOceanRayHit& Hit = Hits[Index];
+
+		if (Hit.bHit)
+		{
+			HitCount++;
+
+			const float Height = RayCaster.GetHeightAt(FVector2D(Hit.Location.X, Hit.Location.Y));
+			if (FMath::Abs(Hit.Location.Z - Height) > 1.f)
+			{
+				AddError(FString::Printf(TEXT("Ray %d hit %.2f away from the surface"), Index, Hit.Location.Z - Height));
+			}
+			continue;
+		}
+
+		// Brute force march with the step finer than the caster's one must not find a crossing either
+		for (float T = 0.f; T < Ray.MaxDistance; T += TexelSize * 0.25f)
+		{
+			const FVector Point = Ray.Origin + Ray.Direction * T;
+			if (Point.Z < RayCaster.GetHeightAt(FVector2D(Point.X, Point.Y)))
+			{
+				AddError(FString::Printf(TEXT("Ray %d missed the surface at %.1f"), Index, T));
+				break;
+			}
+		}
+	}
+
+	TestTrue(TEXT("Rays hit the water"), HitCount > Rays.Num() / 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanRayCasterLongRayTest, "VaOcean.RayCaster.LongRays", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanRayCasterLongRayTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanRayCasterTest;
+
+	FSpectrumData Params;
+	FVaOceanCPUBackend Backend;
+	InitBackend(Backend, Params);
+
+	const FVaOceanRayCaster RayCaster(Backend, Params.PatchLength, SeaLevel);
+	const FVaOceanTileBounds Bounds = Backend.GetGlobalBounds();
+
+	// Ray enters the surface slab 2.5e8 away, where fine step is below float precision of the distance
+	FVaOceanRay Ray;
+	FVaOceanRayHit Hit;
+	Ray.Origin = FVector(1.e7f, -3.e7f, SeaLevel + Bounds.MaxHeight + 5.f);
+	Ray.Direction = FVector(0.6f, 0.8f, -2.e-8f);
+	Ray.MaxDistance = 1.e9f;
+
+	const double StartTime = FPlatformTime::Seconds();
+	RayCaster.Raycast(Ray, Hit);
+	TestTrue(TEXT("Hit of nearly horizontal ray is on the ray"), !Hit.bHit || (Hit.Distance >= 2.5e8f && Hit.Distance <= Ray.MaxDistance));
+	AddLogItem(FString::Printf(TEXT("Nearly horizontal ray: %s at %.0f in %.1f ms"), Hit.bHit ? TEXT("hit") : TEXT("miss"), Hit.Distance, (FPlatformTime::Seconds() - StartTime) * 1000.0));
+
+	Ray.MaxDistance = 1.e8f;
+
+	// Horizontal ray over the highest crest never reaches the water
+	Ray.Origin.Z = SeaLevel + Bounds.MaxHeight + 10.f;
+	Ray.Direction = FVector(0.6f, 0.8f, 0.f);
+	TestFalse(TEXT("Horizontal ray over the crests hits"), RayCaster.Raycast(Ray, Hit));
+
+	// Horizontal ray at sea level crosses the first wave it meets
+	Ray.Origin.Z = SeaLevel;
+	TestTrue(TEXT("Horizontal ray at sea level hits"), RayCaster.Raycast(Ray, Hit));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanRayCasterThroughputTest, "VaOcean.RayCaster.Throughput", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FVaOceanRayCasterThroughputTest::RunTest(const FString& Parameters)
+{
+	using namespace VaOceanRayCasterTest;
+
+	FSpectrumData Params;
+	FVaOceanCPUBackend Backend;
+	InitBackend(Backend, Params);
+
+	const FVaOceanRayCaster RayCaster(Backend, Params.PatchLength, SeaLevel);
+
+	TArray<FVaOceanRay> Rays;
+	TArray<FVaOceanRayHit> Hits;
+	MakeRays(16384, 8000.f, Rays);
+
+	double BestBatchTime = MAX_dbl;
+	for (int32 Run = 0; Run < 5; Run++)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		RayCaster.RaycastBatch(Rays, Hits);
+		BestBatchTime = FMath::Min(BestBatchTime, FPlatformTime::Seconds() - StartTime);
+	}
+
+	double BestSerialTime = MAX_dbl;
+	for (int32 Run = 0; Run < 3; Run++)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Rays.Num(); Index++)
+		{
+			RayCaster.Raycast(Rays[Index], Hits[Index]);
+		}
+		BestSerialTime = FMath::Min(BestSerialTime, FPlatformTime::Seconds() - StartTime);
+	}
+
+	AddLogItem(FString::Printf(TEXT("%d rays: batch %.2f ms (%.2f M rays/s), one thread %.2f ms (%.0f ns per ray)"),
+		Rays.Num(), BestBatchTime * 1000.0, Rays.Num() / BestBatchTime * 1e-6, BestSerialTime * 1000.0, BestSerialTime / Rays.Num() * 1e9));
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
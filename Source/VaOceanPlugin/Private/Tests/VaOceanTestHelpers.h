@@ -0,0 +1,36 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+namespace VaOceanTest
+{
+	/** Spectrum of default sea state, generated the same way the simulator does it */
+	inline void InitSpectrum(const FSpectrumData& Params, TArray<FVector4>& OutH0, TArray<float>& OutOmega, int32 Seed = 0)
+	{
+		const int32 Dim = Params.DispMapDimension;
+
+		TArray<FVector2D> H0Full;
+		H0Full.SetNumUninitialized((Dim + 1) * (Dim + 1));
+		OutH0.SetNumUninitialized(Dim * Dim);
+		OutOmega.SetNumUninitialized(Dim * Dim);
+
+		GetDefault<AVaOceanSimulator>()->InitHeightMap(Params, Seed, OutH0.GetData(), OutOmega.GetData(), H0Full.GetData());
+	}
+
+	/** CPU step parameters the simulator uses for given spectrum and time */
+	inline FVaOceanCPUPerFrame MakePerFrame(const FSpectrumData& Params, float WorldTime, float DeltaTime = 1.f / 30.f)
+	{
+		const FFoamData Foam;
+
+		FVaOceanCPUPerFrame PerFrame;
+		PerFrame.Time = WorldTime * Params.TimeScale;
+		PerFrame.TimeScale = Params.TimeScale;
+		PerFrame.ChoppyScale = Params.ChoppyScale;
+		PerFrame.GridLen = Params.DispMapDimension / Params.PatchLength;
+		PerFrame.FoamFade = FMath::Exp(-Foam.FoamDecay * DeltaTime);
+		PerFrame.FoamInjection = Foam.FoamInjection * DeltaTime;
+		PerFrame.FoamThreshold = Foam.FoamThreshold;
+
+		return PerFrame;
+	}
+}
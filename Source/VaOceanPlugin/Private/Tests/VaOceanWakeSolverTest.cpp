@@ -0,0 +1,120 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanWakeStabilityTest, "VaOcean.WakeSolver.Stability", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanWakeStabilityTest::RunTest(const FString& Parameters)
+{
+	FVaOceanWakeSolver Solver;
+	Solver.Initialize(128, 50.f);
+	Solver.SetCenter(FVector2D::ZeroVector);
+
+	// Wave speed is over the stable one for this step, solver must clamp it
+	const FVaOceanWakeStep StepParams(4000.f, 0.6f, 1.f / 60.f, 50.f);
+	TestTrue(TEXT("Courant number is clamped"), StepParams.Courant2 <= 0.5f);
+
+	FVaOceanWakeSource Boat;
+	Boat.Location = FVector2D(-1000.f, 0.f);
+	Boat.Radius = 200.f;
+	Boat.Strength = -100.f;
+
+	float PeakHeight = 0.f;
+	for (int32 Step = 0; Step < 400; Step++)
+	{
+		Boat.Location.X += 5.f;
+		Solver.Step(StepParams, &Boat, 1);
+		PeakHeight = FMath::Max(PeakHeight, Solver.GetMaxAbsHeight());
+	}
+
+	TestTrue(TEXT("Boat makes waves"), PeakHeight > 0.f);
+	TestTrue(TEXT("Waves stay bounded"), PeakHeight < 100.f);
+
+	// Without sources waves fade out
+	for (int32 Step = 0; Step < 600; Step++)
+	{
+		Solver.Step(StepParams, nullptr, 0);
+	}
+
+	TestTrue(TEXT("Waves decay without sources"), Solver.GetMaxAbsHeight() < PeakHeight * 0.1f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanWakeSymmetryTest, "VaOcean.WakeSolver.Symmetry", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanWakeSymmetryTest::RunTest(const FString& Parameters)
+{
+	FVaOceanWakeSolver Solver;
+	Solver.Initialize(64, 10.f);
+	Solver.SetCenter(FVector2D(5.f, 5.f));
+
+	const FVaOceanWakeStep StepParams(100.f, 0.1f, 0.05f, 10.f);
+
+	// Splash at a cell center spreads the same way along both axes
+	FVaOceanWakeSource Splash;
+	Splash.Location = FVector2D::ZeroVector;
+	Splash.Radius = 40.f;
+	Splash.Strength = 10.f;
+
+	for (int32 Step = 0; Step < 50; Step++)
+	{
+		Solver.Step(StepParams, Step < 5 ? &Splash : nullptr, Step < 5 ? 1 : 0);
+	}
+
+	const float Height = Solver.SampleHeight(FVector2D(100.f, 0.f));
+	const float Tolerance = FMath::Max(FMath::Abs(Height), Solver.GetMaxAbsHeight()) * 1e-4f;
+
+	TestTrue(TEXT("Splash made waves"), Solver.GetMaxAbsHeight() > 0.f);
+	TestEqual(TEXT("Wave at -X"), Solver.SampleHeight(FVector2D(-100.f, 0.f)), Height, Tolerance);
+	TestEqual(TEXT("Wave at +Y"), Solver.SampleHeight(FVector2D(0.f, 100.f)), Height, Tolerance);
+	TestEqual(TEXT("Wave at -Y"), Solver.SampleHeight(FVector2D(0.f, -100.f)), Height, Tolerance);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVaOceanWakeScrollTest, "VaOcean.WakeSolver.Scroll", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVaOceanWakeScrollTest::RunTest(const FString& Parameters)
+{
+	FVaOceanWakeSolver Solver;
+	Solver.Initialize(128, 50.f);
+	Solver.SetCenter(FVector2D::ZeroVector);
+
+	const FVaOceanWakeStep StepParams(400.f, 0.6f, 1.f / 60.f, 50.f);
+
+	FVaOceanWakeSource Splash;
+	Splash.Location = FVector2D(500.f, 300.f);
+	Splash.Radius = 200.f;
+	Splash.Strength = -100.f;
+
+	for (int32 Step = 0; Step < 30; Step++)
+	{
+		Solver.Step(StepParams, &Splash, 1);
+	}
+
+	// Locations covered by both the old and the new grid
+	const FVector2D Probes[] = { FVector2D(500.f, 300.f), FVector2D(730.f, 120.f), FVector2D(260.f, 410.f) };
+	float Heights[ARRAY_COUNT(Probes)];
+	for (int32 Index = 0; Index < ARRAY_COUNT(Probes); Index++)
+	{
+		Heights[Index] = Solver.SampleHeight(Probes[Index]);
+	}
+
+	Solver.SetCenter(FVector2D(1234.f, -700.f));
+	TestTrue(TEXT("Grid has moved"), Solver.GetOrigin() != FVaOceanWakeSolver::GetOriginForCenter(FVector2D::ZeroVector, 128, 50.f));
+
+	// Bilinear weights are computed from the new origin, so heights may differ in the last bits
+	const float Tolerance = Solver.GetMaxAbsHeight() * 1e-5f;
+	for (int32 Index = 0; Index < ARRAY_COUNT(Probes); Index++)
+	{
+		TestEqual(FString::Printf(TEXT("Height at (%.0f, %.0f) stays in place"), Probes[Index].X, Probes[Index].Y), Solver.SampleHeight(Probes[Index]), Heights[Index], Tolerance);
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
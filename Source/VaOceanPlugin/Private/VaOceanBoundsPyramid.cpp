@@ -0,0 +1,168 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+FVaOceanBoundsPyramid::FVaOceanBoundsPyramid()
+	: Dim(0)
+{
+}
+
+int32 FVaOceanBoundsPyramid::GetTotalTileCount(int32 DispMapDimension)
+{
+	int32 Total = 0;
+	for (int32 LevelDim = FMath::Max(DispMapDimension / BOUNDS_TILE_SIZE, 1); LevelDim > 0; LevelDim >>= 1)
+	{
+		Total += LevelDim * LevelDim;
+	}
+
+	return Total;
+}
+
+void FVaOceanBoundsPyramid::Initialize(int32 DispMapDimension)
+{
+	check(FMath::IsPowerOfTwo(DispMapDimension));
+
+	Dim = DispMapDimension;
+
+	LevelDims.Reset();
+	LevelOffsets.Reset();
+
+	int32 Total = 0;
+	for (int32 LevelDim = FMath::Max(Dim / BOUNDS_TILE_SIZE, 1); LevelDim > 0; LevelDim >>= 1)
+	{
+		LevelDims.Add(LevelDim);
+		LevelOffsets.Add(Total);
+		Total += LevelDim * LevelDim;
+	}
+
+	Tiles.SetNum(Total);
+}
+
+void FVaOceanBoundsPyramid::Release()
+{
+	Dim = 0;
+
+	Tiles.Empty();
+	LevelDims.Empty();
+	LevelOffsets.Empty();
+}
+
+bool FVaOceanBoundsPyramid::IsValid() const
+{
+	return Dim > 0;
+}
+
+void FVaOceanBoundsPyramid::Build(const FVaOceanCPUMapView& Displacement)
+{
+	check(IsValid());
+	check(Displacement.Dim == Dim && Displacement.PlaneCount >= 3);
+
+	// Level 0 from texels
+	const int32 TileDim = LevelDims[0];
+	const int32 TileSize = Dim / TileDim;
+
+	VaOceanParallelFor(TileDim, [&](int32 TileY)
+	{
+		for (int32 TileX = 0; TileX < TileDim; TileX++)
+		{
+			FVaOceanTileBounds Bounds;
+			Bounds.MinHeight = MAX_flt;
+			Bounds.MaxHeight = -MAX_flt;
+
+			for (int32 y = TileY * TileSize; y < (TileY + 1) * TileSize; y++)
+			{
+				const float* RowX = Displacement.GetRow(0, y);
+				const float* RowY = Displacement.GetRow(1, y);
+				const float* RowZ = Displacement.GetRow(2, y);
+				for (int32 x = TileX * TileSize; x < (TileX + 1) * TileSize; x++)
+				{
+					Bounds.MinHeight = FMath::Min(Bounds.MinHeight, RowZ[x]);
+					Bounds.MaxHeight = FMath::Max(Bounds.MaxHeight, RowZ[x]);
+					Bounds.MaxAbsX = FMath::Max(Bounds.MaxAbsX, FMath::Abs(RowX[x]));
+					Bounds.MaxAbsY = FMath::Max(Bounds.MaxAbsY, FMath::Abs(RowY[x]));
+				}
+			}
+
+			Tiles[TileY * TileDim + TileX] = Bounds;
+		}
+	});
+
+	// Upper levels are small, so reduce them serially
+	for (int32 Level = 1; Level < LevelDims.Num(); Level++)
+	{
+		const int32 SrcDim = LevelDims[Level - 1];
+		const int32 SrcOffset = LevelOffsets[Level - 1];
+		const int32 DstDim = LevelDims[Level];
+		const int32 DstOffset = LevelOffsets[Level];
+
+		for (int32 y = 0; y < DstDim; y++)
+		{
+			for (int32 x = 0; x < DstDim; x++)
+			{
+				const int32 Src = SrcOffset + (y * 2) * SrcDim + x * 2;
+
+				FVaOceanTileBounds Bounds = Tiles[Src];
+				Bounds.Merge(Tiles[Src + 1]);
+				Bounds.Merge(Tiles[Src + SrcDim]);
+				Bounds.Merge(Tiles[Src + SrcDim + 1]);
+
+				Tiles[DstOffset + y * DstDim + x] = Bounds;
+			}
+		}
+	}
+}
+
+const FVaOceanTileBounds& FVaOceanBoundsPyramid::GetGlobalBounds() const
+{
+	return Tiles.Last();
+}
+
+FVaOceanTileBounds FVaOceanBoundsPyramid::GetBounds(const FVector2D& UVMin, const FVector2D& UVMax) const
+{
+	const float MinX = UVMin.X * Dim;
+	const float MinY = UVMin.Y * Dim;
+	const float MaxX = UVMax.X * Dim;
+	const float MaxY = UVMax.Y * Dim;
+
+	// Bilinear filter touches one more texel around the rect
+	const float Size = FMath::Max(MaxX - MinX, MaxY - MinY) + 2.f;
+
+	// Find the finest level where rect covers no more than 2x2 tiles
+	int32 Level = 0;
+	float TileTexels = (float)(Dim / LevelDims[0]);
+	while (TileTexels < Size && Level < LevelDims.Num() - 1)
+	{
+		Level++;
+		TileTexels *= 2.f;
+	}
+
+	if (Level == LevelDims.Num() - 1)
+	{
+		return GetGlobalBounds();
+	}
+
+	const int32 TileMinX = FMath::FloorToInt((MinX - 1.f) / TileTexels);
+	const int32 TileMinY = FMath::FloorToInt((MinY - 1.f) / TileTexels);
+	const int32 TileMaxX = FMath::FloorToInt((MaxX + 1.f) / TileTexels);
+	const int32 TileMaxY = FMath::FloorToInt((MaxY + 1.f) / TileTexels);
+
+	FVaOceanTileBounds Bounds = GetTile(Level, TileMinX, TileMinY);
+	for (int32 y = TileMinY; y <= TileMaxY; y++)
+	{
+		for (int32 x = TileMinX; x <= TileMaxX; x++)
+		{
+			Bounds.Merge(GetTile(Level, x, y));
+		}
+	}
+
+	return Bounds;
+}
+
+const FVaOceanTileBounds& FVaOceanBoundsPyramid::GetTile(int32 Level, int32 X, int32 Y) const
+{
+	const int32 LevelDim = LevelDims[Level];
+	const int32 Mask = LevelDim - 1;
+
+	return Tiles[LevelOffsets[Level] + (Y & Mask) * LevelDim + (X & Mask)];
+}
@@ -0,0 +1,66 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+FVaOceanBuoyancyBatch::FVaOceanBuoyancyBatch()
+	: bWithVelocity(false)
+{
+}
+
+void FVaOceanBuoyancyBatch::Reset()
+{
+	Locations.Reset();
+	PontoonCounts.Reset();
+	Heights.Reset();
+	Velocities.Reset();
+	bWithVelocity = false;
+}
+
+TArray<FVector>& FVaOceanBuoyancyBatch::GetLocations()
+{
+	return Locations;
+}
+
+void FVaOceanBuoyancyBatch::AddHull(int32 NumPontoons)
+{
+	PontoonCounts.Add(NumPontoons);
+}
+
+int32 FVaOceanBuoyancyBatch::GetNumPontoons() const
+{
+	return Locations.Num();
+}
+
+void FVaOceanBuoyancyBatch::Resolve(bool bInWithVelocity, FResolveWater ResolveWater)
+{
+	const int32 NumPontoons = Locations.Num();
+	Heights.SetNumUninitialized(NumPontoons, false);
+	Velocities.SetNumUninitialized(bInWithVelocity ? NumPontoons : 0, false);
+	bWithVelocity = bInWithVelocity;
+
+	// Pontoons of all hulls share one fan-out over workers
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumPontoons, BUOYANCY_BATCH_SIZE);
+	VaOceanParallelFor(NumBatches, [&](int32 BatchIndex)
+	{
+		const int32 First = BatchIndex * BUOYANCY_BATCH_SIZE;
+		const int32 Num = FMath::Min(NumPontoons - First, BUOYANCY_BATCH_SIZE);
+
+		ResolveWater(Locations.GetData() + First, Num, Heights.GetData() + First, bWithVelocity ? Velocities.GetData() + First : nullptr);
+	});
+}
+
+void FVaOceanBuoyancyBatch::Apply(FApplyWater ApplyWater) const
+{
+	// Hulls added after the last Resolve have no water yet
+	check(Heights.Num() == Locations.Num());
+
+	int32 First = 0;
+	for (int32 HullIndex = 0; HullIndex < PontoonCounts.Num(); HullIndex++)
+	{
+		const int32 Num = PontoonCounts[HullIndex];
+		ApplyWater(HullIndex, Locations.GetData() + First, Heights.GetData() + First, bWithVelocity ? Velocities.GetData() + First : nullptr, Num);
+
+		First += Num;
+	}
+}
@@ -0,0 +1,147 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "EngineUtils.h"
+
+UVaOceanBuoyancyComponent::UVaOceanBuoyancyComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	OceanSimulator = nullptr;
+	PontoonRadius = 60.f;
+	WaterDensity = 1027.f;
+	WaterDrag = 0.5f;
+
+	RegisteredSimulator = nullptr;
+	SubmergedRatio = 0.f;
+}
+
+void UVaOceanBuoyancyComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!OceanSimulator)
+	{
+		TActorIterator<AVaOceanSimulator> It(GetWorld());
+		OceanSimulator = It ? *It : nullptr;
+	}
+
+	if (OceanSimulator)
+	{
+		OceanSimulator->RegisterBuoyancyComponent(this);
+		RegisteredSimulator = OceanSimulator;
+	}
+	else
+	{
+		UE_LOG(LogVaOcean, Warning, TEXT("%s: no ocean simulator to float on"), *GetPathName());
+	}
+}
+
+void UVaOceanBuoyancyComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (RegisteredSimulator)
+	{
+		RegisteredSimulator->UnregisterBuoyancyComponent(this);
+		RegisteredSimulator = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+float UVaOceanBuoyancyComponent::GetSubmergedRatio() const
+{
+	return SubmergedRatio;
+}
+
+UPrimitiveComponent* UVaOceanBuoyancyComponent::GetBuoyantBody() const
+{
+	UPrimitiveComponent* Body = Cast<UPrimitiveComponent>(GetAttachParent());
+
+	if (!Body || !Body->IsSimulatingPhysics())
+	{
+		AActor* Owner = GetOwner();
+		Body = Owner ? Cast<UPrimitiveComponent>(Owner->GetRootComponent()) : nullptr;
+	}
+
+	return (Body && Body->IsSimulatingPhysics()) ? Body : nullptr;
+}
+
+int32 UVaOceanBuoyancyComponent::GatherPontoons(TArray<FVector>& OutLocations) const
+{
+	if (!IsActive() || !GetBuoyantBody())
+	{
+		return 0;
+	}
+
+	for (const FVector& Pontoon : Pontoons)
+	{
+		OutLocations.Add(ComponentToWorld.TransformPosition(Pontoon));
+	}
+
+	return Pontoons.Num();
+}
+
+void UVaOceanBuoyancyComponent::ClearBuoyancy()
+{
+	SubmergedRatio = 0.f;
+}
+
+void UVaOceanBuoyancyComponent::ApplyBuoyancy(const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, float GravityZ)
+{
+	if (Pontoons.Num() == 0)
+	{
+		SubmergedRatio = 0.f;
+		return;
+	}
+
+	// Submerged share depends on water alone, it's kept for a hull without simulating body too
+	UPrimitiveComponent* Body = GetBuoyantBody();
+
+	const FVector CenterOfMass = Body ? Body->GetCenterOfMass() : FVector::ZeroVector;
+	const float PontoonVolume = 4.f / 3.f * PI * FMath::Pow(PontoonRadius, 3.f);
+	const float PontoonDrag = Body ? Body->GetMass() * WaterDrag / Pontoons.Num() : 0.f;
+
+	// Density is given per m^3, volume is in cm^3
+	const float Lift = WaterDensity * 1e-6f * -GravityZ;
+
+	FVector Force = FVector::ZeroVector;
+	FVector Torque = FVector::ZeroVector;
+	float SubmergedVolume = 0.f;
+
+	for (int32 Index = 0; Index < Pontoons.Num(); Index++)
+	{
+		const float Depth = FMath::Clamp(WaterHeights[Index] - (Locations[Index].Z - PontoonRadius), 0.f, 2.f * PontoonRadius);
+		if (Depth <= 0.f)
+		{
+			continue;
+		}
+
+		// Volume of spherical cap under the surface
+		const float Volume = PI * Depth * Depth * (3.f * PontoonRadius - Depth) / 3.f;
+		SubmergedVolume += Volume;
+
+		if (!Body)
+		{
+			continue;
+		}
+
+		FVector RelativeVelocity = Body->GetPhysicsLinearVelocityAtPoint(Locations[Index]);
+		if (WaterVelocities)
+		{
+			RelativeVelocity -= WaterVelocities[Index];
+		}
+
+		const FVector PontoonForce = FVector(0.f, 0.f, Lift * Volume) - RelativeVelocity * (PontoonDrag * Volume / PontoonVolume);
+
+		Force += PontoonForce;
+		Torque += (Locations[Index] - CenterOfMass) ^ PontoonForce;
+	}
+
+	SubmergedRatio = SubmergedVolume / (PontoonVolume * Pontoons.Num());
+
+	// Whole hull is pushed once, forces of pontoons are already summed around the center of mass
+	if (Body && SubmergedVolume > 0.f)
+	{
+		Body->AddForce(Force);
+		Body->AddTorque(Torque);
+	}
+}
@@ -0,0 +1,100 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+static TAutoConsoleVariable<int32> CVarVaOceanCPUSingleThread(
+	TEXT("r.VaOcean.CPUSingleThread"),
+	0,
+	TEXT("0: CPU simulation, queries and ray casts are spread over task graph workers (default)\n")
+	TEXT("1: they run on the calling thread, for profiling and allocation tests"),
+	ECVF_Default);
+
+bool IsVaOceanCPUSingleThread()
+{
+	return CVarVaOceanCPUSingleThread.GetValueOnAnyThread() != 0;
+}
+
+FVaOceanCPUArena::FVaOceanCPUArena()
+	: Memory(nullptr)
+	, Capacity(0)
+	, Offset(0)
+{
+}
+
+FVaOceanCPUArena::~FVaOceanCPUArena()
+{
+	Release();
+}
+
+int32 FVaOceanCPUArena::GetPlaneStride(int32 Dim)
+{
+	int32 Stride = Align(Dim, CPU_ARENA_LINE_FLOATS);
+	if (FMath::IsPowerOfTwo(Stride))
+	{
+		Stride += CPU_ARENA_LINE_FLOATS;
+	}
+
+	return Stride;
+}
+
+SIZE_T FVaOceanCPUArena::GetPlaneSize(int32 Dim)
+{
+	return Align((SIZE_T)GetPlaneStride(Dim) * Dim * sizeof(float), CPU_ARENA_ALIGNMENT) + CPU_ARENA_ALIGNMENT;
+}
+
+void FVaOceanCPUArena::Reserve(SIZE_T Size)
+{
+	Offset = 0;
+
+	if (Size <= Capacity)
+	{
+		return;
+	}
+
+	Release();
+
+	Memory = (uint8*)FMemory::Malloc(Size, CPU_ARENA_ALIGNMENT);
+	Capacity = Size;
+}
+
+void FVaOceanCPUArena::Release()
+{
+	if (Memory)
+	{
+		FMemory::Free(Memory);
+	}
+
+	Memory = nullptr;
+	Capacity = 0;
+	Offset = 0;
+}
+
+void* FVaOceanCPUArena::Allocate(SIZE_T Size)
+{
+	const SIZE_T Start = Align(Offset, CPU_ARENA_ALIGNMENT);
+	check(Start + Size <= Capacity);
+
+	Offset = Start + Size;
+	return Memory + Start;
+}
+
+float* FVaOceanCPUArena::AllocatePlane(int32 Dim)
+{
+	const SIZE_T Size = GetPlaneSize(Dim);
+
+	float* Plane = (float*)Allocate(Size);
+	FMemory::Memzero(Plane, Size);
+
+	return Plane;
+}
+
+SIZE_T FVaOceanCPUArena::GetCapacity() const
+{
+	return Capacity;
+}
+
+SIZE_T FVaOceanCPUArena::GetUsedSize() const
+{
+	return Offset;
+}
@@ -0,0 +1,868 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+/** Rows of gradient map processed by one worker task */
+#define GRADIENT_BLOCK_ROWS 8
+
+/** Fold texels a gradient task collects on stack before it reserves their range of the spawn list */
+#define SPAWN_LIST_CHUNK_SIZE 64
+
+static TAutoConsoleVariable<int32> CVarVaOceanCPUFFTSpecialized(
+	TEXT("r.VaOcean.CPUFFTSpecialized"),
+	1,
+	TEXT("0: CPU FFT uses generic radix-2 path for all sizes\n")
+	TEXT("1: CPU FFT of size 128, 256 and 512 uses specialized radix-8 kernels (default)"),
+	ECVF_Default);
+
+FVaOceanCPUBackend::FVaOceanCPUBackend()
+	: Dim(0)
+	, LogDim(0)
+	, Stride(0)
+	, Omega(nullptr)
+	, BandFirst(0)
+	, BandSize(0)
+	, Slices(3)
+	, InterpolationAlpha(1.f)
+	, TwiddleRe(nullptr)
+	, TwiddleIm(nullptr)
+	, BitReverse(nullptr)
+	, Waves(nullptr)
+	, SpawnList(nullptr)
+	, SpawnListCapacity(0)
+	, SpawnListNum(0)
+{
+	FMemory::Memzero(H0);
+	FMemory::Memzero(H0Target);
+	FMemory::Memzero(HtRe);
+	FMemory::Memzero(HtIm);
+}
+
+void FVaOceanCPUBackend::Initialize(int32 InDim, const FVector4* InH0, const float* InOmega, bool bInSimulateVelocity, const FVaOceanGerstnerWaves* InWaves, int32 InSpawnListCapacity)
+{
+	check(FMath::IsPowerOfTwo(InDim));
+
+	Dim = InDim;
+	LogDim = FMath::FloorLog2(Dim);
+	Stride = FVaOceanCPUArena::GetPlaneStride(Dim);
+	Slices = bInSimulateVelocity ? 5 : 3;
+	Waves = InWaves;
+	BandFirst = 0;
+	BandSize = Dim;
+
+	// Memory of the same size is reused
+	Arena.Reserve(GetArenaSize(Dim, bInSimulateVelocity, Waves != nullptr, InSpawnListCapacity));
+
+	FMemory::Memzero(H0);
+	FMemory::Memzero(H0Target);
+	FMemory::Memzero(HtRe);
+	FMemory::Memzero(HtIm);
+	Omega = nullptr;
+	TwiddleRe = nullptr;
+	TwiddleIm = nullptr;
+	BitReverse = nullptr;
+
+	// Analytic waves don't need spectrum and FFT memory
+	if (!Waves)
+	{
+		for (int32 Plane = 0; Plane < 4; Plane++)
+		{
+			H0[Plane] = Arena.AllocatePlane(Dim);
+			H0Target[Plane] = Arena.AllocatePlane(Dim);
+		}
+		Omega = Arena.AllocatePlane(Dim);
+
+		DeinterleaveH0(InH0, H0);
+		for (int32 y = 0; y < Dim; y++)
+		{
+			FMemory::Memcpy(Omega + y * Stride, InOmega + y * Dim, Dim * sizeof(float));
+		}
+
+		for (int32 Slice = 0; Slice < Slices; Slice++)
+		{
+			HtRe[Slice] = Arena.AllocatePlane(Dim);
+			HtIm[Slice] = Arena.AllocatePlane(Dim);
+		}
+	}
+
+	FVaOceanCPUStep* Steps[2] = { &Last, &Prev };
+	for (FVaOceanCPUStep* Step : Steps)
+	{
+		*Step = FVaOceanCPUStep();
+
+		for (int32 Channel = 0; Channel < 3; Channel++)
+		{
+			Step->Displacement[Channel] = Arena.AllocatePlane(Dim);
+			Step->Velocity[Channel] = bInSimulateVelocity ? Arena.AllocatePlane(Dim) : nullptr;
+		}
+		for (int32 Channel = 0; Channel < 4; Channel++)
+		{
+			Step->Gradient[Channel] = Arena.AllocatePlane(Dim);
+		}
+		Step->HeightField = Arena.AllocatePlane(Dim);
+		Step->BoundsPyramid.Initialize(Dim);
+	}
+
+	SpawnListCapacity = InSpawnListCapacity;
+	SpawnList = (SpawnListCapacity > 0) ? (FVaOceanFoldTexel*)Arena.Allocate(SpawnListCapacity * sizeof(FVaOceanFoldTexel)) : nullptr;
+	SpawnListNum = 0;
+
+	if (Waves)
+	{
+		return;
+	}
+
+	// Forward transform, same as PhaseBase sign used by Radix008A_CS
+	TwiddleRe = (float*)Arena.Allocate(Dim / 2 * sizeof(float));
+	TwiddleIm = (float*)Arena.Allocate(Dim / 2 * sizeof(float));
+	for (int32 k = 0; k < Dim / 2; k++)
+	{
+		const double Phase = -TWO_PI * k / Dim;
+		TwiddleRe[k] = (float)FMath::Cos(Phase);
+		TwiddleIm[k] = (float)FMath::Sin(Phase);
+	}
+
+	BitReverse = (int32*)Arena.Allocate(Dim * sizeof(int32));
+	for (int32 i = 0; i < Dim; i++)
+	{
+		int32 Reversed = 0;
+		for (int32 Bit = 0; Bit < LogDim; Bit++)
+		{
+			Reversed |= ((i >> Bit) & 1) << (LogDim - 1 - Bit);
+		}
+		BitReverse[i] = Reversed;
+	}
+}
+
+SIZE_T FVaOceanCPUBackend::GetArenaSize(int32 InDim, bool bInSimulateVelocity, bool bInGerstnerWaves, int32 InSpawnListCapacity)
+{
+	// Both steps: displacement, optional velocity, gradient and height
+	const int32 StepPlanes = 3 + (bInSimulateVelocity ? 3 : 0) + 4 + 1;
+	const SIZE_T SpawnListSize = Align(InSpawnListCapacity * sizeof(FVaOceanFoldTexel), CPU_ARENA_ALIGNMENT);
+	if (bInGerstnerWaves)
+	{
+		return StepPlanes * 2 * FVaOceanCPUArena::GetPlaneSize(InDim) + SpawnListSize;
+	}
+
+	// Current and target H(0), omega, FFT slices and tables
+	const int32 InSlices = bInSimulateVelocity ? 5 : 3;
+	const int32 PlaneCount = 9 + InSlices * 2 + StepPlanes * 2;
+	const SIZE_T TableSize = Align(InDim / 2 * sizeof(float), CPU_ARENA_ALIGNMENT) * 2 + Align(InDim * sizeof(int32), CPU_ARENA_ALIGNMENT);
+
+	return PlaneCount * FVaOceanCPUArena::GetPlaneSize(InDim) + TableSize + SpawnListSize;
+}
+
+void FVaOceanCPUBackend::Release()
+{
+	Dim = 0;
+	LogDim = 0;
+	Stride = 0;
+	BandFirst = 0;
+	BandSize = 0;
+
+	FMemory::Memzero(H0);
+	FMemory::Memzero(H0Target);
+	FMemory::Memzero(HtRe);
+	FMemory::Memzero(HtIm);
+	Omega = nullptr;
+	TwiddleRe = nullptr;
+	TwiddleIm = nullptr;
+	BitReverse = nullptr;
+	Waves = nullptr;
+	SpawnList = nullptr;
+	SpawnListCapacity = 0;
+	SpawnListNum = 0;
+
+	Last = FVaOceanCPUStep();
+	Prev = FVaOceanCPUStep();
+
+	Arena.Release();
+}
+
+void FVaOceanCPUBackend::SetTargetSpectrum(const FVector4* InH0Target)
+{
+	if (IsInitialized() && !Waves)
+	{
+		DeinterleaveH0(InH0Target, H0Target);
+	}
+}
+
+void FVaOceanCPUBackend::CommitTargetSpectrum()
+{
+	for (int32 Plane = 0; Plane < 4; Plane++)
+	{
+		Swap(H0[Plane], H0Target[Plane]);
+	}
+}
+
+void FVaOceanCPUBackend::SetSpectrumBand(int32 InBandRadius)
+{
+	uint32 First, Size;
+	GetSpectrumBandRegion(Dim, InBandRadius, First, Size);
+
+	BandFirst = First;
+	BandSize = Size;
+}
+
+void FVaOceanCPUBackend::DeinterleaveH0(const FVector4* InH0, float* const* OutPlanes) const
+{
+	for (int32 y = 0; y < Dim; y++)
+	{
+		for (int32 x = 0; x < Dim; x++)
+		{
+			const FVector4& h0 = InH0[y * Dim + x];
+			const int32 Index = y * Stride + x;
+
+			OutPlanes[0][Index] = h0.X;
+			OutPlanes[1][Index] = h0.Y;
+			OutPlanes[2][Index] = h0.Z;
+			OutPlanes[3][Index] = h0.W;
+		}
+	}
+}
+
+bool FVaOceanCPUBackend::IsInitialized() const
+{
+	return Dim > 0;
+}
+
+void FVaOceanCPUBackend::Update(const FVaOceanCPUPerFrame& PerFrame)
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	// Last results become previous ones, their memory is reused for the new step
+	Swap(Last, Prev);
+
+	if (Waves)
+	{
+		Waves->EvaluateGrid(Dim, Stride, PerFrame.Time, PerFrame.TimeScale, PerFrame.ChoppyScale, Last.Displacement, (Slices > 3) ? Last.Velocity : nullptr);
+	}
+	else
+	{
+		UpdateSpectrum(PerFrame.Time, PerFrame.TimeScale, PerFrame.SpectrumBlend);
+		ComputeFFT();
+		UpdateDisplacement(PerFrame.ChoppyScale);
+	}
+
+	GenGradientFolding(PerFrame);
+	UpdateHeightField(PerFrame);
+	Last.BoundsPyramid.Build(GetDisplacementView());
+}
+
+void FVaOceanCPUBackend::SetInterpolationAlpha(float InAlpha)
+{
+	InterpolationAlpha = FMath::Clamp(InAlpha, 0.f, 1.f);
+}
+
+int32 FVaOceanCPUBackend::GetDimension() const
+{
+	return Dim;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Simulation steps
+
+void FVaOceanCPUBackend::UpdateSpectrum(float Time, float TimeScale, float Blend)
+{
+	const bool bSimulateVelocity = Slices > 3;
+
+	// Target planes are only touched during transition
+	float* const* BlendPlanes = (Blend > 0.f) ? H0Target : H0;
+
+	// Planes are transformed in place, so texels outside of the band are zeroed on each step instead of computed
+	const int32 BandEnd = BandFirst + BandSize;
+
+	VaOceanParallelFor(Dim, [&](int32 y)
+	{
+		const int32 Row = y * Stride;
+
+		if (y < BandFirst || y >= BandEnd)
+		{
+			for (int32 Slice = 0; Slice < Slices; Slice++)
+			{
+				FMemory::Memzero(HtRe[Slice] + Row, Dim * sizeof(float));
+				FMemory::Memzero(HtIm[Slice] + Row, Dim * sizeof(float));
+			}
+			return;
+		}
+
+		for (int32 Slice = 0; Slice < Slices; Slice++)
+		{
+			FMemory::Memzero(HtRe[Slice] + Row, BandFirst * sizeof(float));
+			FMemory::Memzero(HtIm[Slice] + Row, BandFirst * sizeof(float));
+			FMemory::Memzero(HtRe[Slice] + Row + BandEnd, (Dim - BandEnd) * sizeof(float));
+			FMemory::Memzero(HtIm[Slice] + Row + BandEnd, (Dim - BandEnd) * sizeof(float));
+		}
+
+		const float* h0_re = H0[0] + Row;
+		const float* h0_im = H0[1] + Row;
+		const float* h0_conj_re = H0[2] + Row;
+		const float* h0_conj_im = H0[3] + Row;
+		const float* target_re = BlendPlanes[0] + Row;
+		const float* target_im = BlendPlanes[1] + Row;
+		const float* target_conj_re = BlendPlanes[2] + Row;
+		const float* target_conj_im = BlendPlanes[3] + Row;
+		const float* omega_row = Omega + Row;
+
+		const float ky_raw = y - Dim * 0.5f;
+
+		for (int32 x = BandFirst; x < BandEnd; x++)
+		{
+			// Sea state transition, see UpdateSpectrumCS
+			const float h0_k_re = FMath::Lerp(h0_re[x], target_re[x], Blend);
+			const float h0_k_im = FMath::Lerp(h0_im[x], target_im[x], Blend);
+			const float h0_mk_re = FMath::Lerp(h0_conj_re[x], target_conj_re[x], Blend);
+			const float h0_mk_im = FMath::Lerp(h0_conj_im[x], target_conj_im[x], Blend);
+
+			// H(0) -> H(t), see UpdateSpectrumCS
+			float sin_v, cos_v;
+			FMath::SinCos(&sin_v, &cos_v, omega_row[x] * Time);
+
+			const float ht_re = (h0_k_re + h0_mk_re) * cos_v - (h0_k_im - h0_mk_im) * sin_v;
+			const float ht_im = (h0_k_re - h0_mk_re) * sin_v + (h0_k_im + h0_mk_im) * cos_v;
+
+			// H(t) -> Dx(t), Dy(t)
+			float kx = x - Dim * 0.5f;
+			float ky = ky_raw;
+			float sqr_k = kx * kx + ky * ky;
+			float rsqr_k = (sqr_k > 1e-12f) ? FMath::InvSqrt(sqr_k) : 0.f;
+
+			// Nyquist Dx and Dy are anti-Hermitian and vanish after FFT, see UpdateSpectrumCS
+			kx = (x == 0) ? 0.f : kx * rsqr_k;
+			ky = (y == 0) ? 0.f : ky * rsqr_k;
+
+			HtRe[0][Row + x] = ht_re;
+			HtIm[0][Row + x] = ht_im;
+			HtRe[1][Row + x] = ht_im * kx;
+			HtIm[1][Row + x] = -ht_re * kx;
+			HtRe[2][Row + x] = ht_im * ky;
+			HtIm[2][Row + x] = -ht_re * ky;
+
+			// Time derivatives, real after FFT so Vz and Vx share one slice
+			if (bSimulateVelocity)
+			{
+				const float omega = omega_row[x] * TimeScale;
+
+				const float dht_re = -omega * ((h0_k_re + h0_mk_re) * sin_v + (h0_k_im - h0_mk_im) * cos_v);
+				const float dht_im = omega * ((h0_k_re - h0_mk_re) * cos_v - (h0_k_im + h0_mk_im) * sin_v);
+
+				const float dv_x_re = dht_im * kx;
+				const float dv_x_im = -dht_re * kx;
+
+				HtRe[3][Row + x] = dht_re - dv_x_im;
+				HtIm[3][Row + x] = dht_im + dv_x_re;
+				HtRe[4][Row + x] = dht_im * ky;
+				HtIm[4][Row + x] = -dht_re * ky;
+			}
+		}
+	});
+}
+
+void FVaOceanCPUBackend::ComputeFFT()
+{
+	// Generic path stays for other sizes and for comparison
+	const FVaOceanCPUFFTKernel Kernel = (CVarVaOceanCPUFFTSpecialized.GetValueOnAnyThread() != 0) ? GetVaOceanCPUFFTKernel(Dim) : nullptr;
+
+	// Rows of all slices. Rows outside of the band are zero, so is their transform.
+	VaOceanParallelFor(Slices * BandSize, [&](int32 Row)
+	{
+		const int32 Slice = Row / BandSize;
+		const int32 Offset = (BandFirst + Row % BandSize) * Stride;
+
+		if (Kernel)
+		{
+			Kernel(HtRe[Slice] + Offset, HtIm[Slice] + Offset, 1, 1);
+		}
+		else
+		{
+			FFT1D(HtRe[Slice] + Offset, HtIm[Slice] + Offset, 1, 1);
+		}
+	});
+
+	// Columns of all slices, one cache line of neighbour columns per task
+	const int32 ColumnBlock = FMath::Min(Dim, (int32)CPU_ARENA_LINE_FLOATS);
+	const int32 BlockCount = Dim / ColumnBlock;
+
+	VaOceanParallelFor(Slices * BlockCount, [&](int32 Block)
+	{
+		const int32 Slice = Block / BlockCount;
+		const int32 Offset = (Block % BlockCount) * ColumnBlock;
+
+		if (Kernel)
+		{
+			Kernel(HtRe[Slice] + Offset, HtIm[Slice] + Offset, Stride, ColumnBlock);
+		}
+		else
+		{
+			FFT1D(HtRe[Slice] + Offset, HtIm[Slice] + Offset, Stride, ColumnBlock);
+		}
+	});
+}
+
+void FVaOceanCPUBackend::FFT1D(float* Re, float* Im, int32 ElementStride, int32 Count) const
+{
+	for (int32 i = 0; i < Dim; i++)
+	{
+		const int32 j = BitReverse[i];
+		if (i < j)
+		{
+			for (int32 c = 0; c < Count; c++)
+			{
+				Swap(Re[i * ElementStride + c], Re[j * ElementStride + c]);
+				Swap(Im[i * ElementStride + c], Im[j * ElementStride + c]);
+			}
+		}
+	}
+
+	// Iterative radix-2 butterflies
+	for (int32 Len = 2; Len <= Dim; Len <<= 1)
+	{
+		const int32 Half = Len >> 1;
+		const int32 TwiddleStep = Dim / Len;
+
+		for (int32 Start = 0; Start < Dim; Start += Len)
+		{
+			for (int32 k = 0; k < Half; k++)
+			{
+				const float w_re = TwiddleRe[k * TwiddleStep];
+				const float w_im = TwiddleIm[k * TwiddleStep];
+
+				float* a_re = Re + (Start + k) * ElementStride;
+				float* a_im = Im + (Start + k) * ElementStride;
+				float* b_re = Re + (Start + k + Half) * ElementStride;
+				float* b_im = Im + (Start + k + Half) * ElementStride;
+
+				for (int32 c = 0; c < Count; c++)
+				{
+					const float t_re = b_re[c] * w_re - b_im[c] * w_im;
+					const float t_im = b_re[c] * w_im + b_im[c] * w_re;
+
+					b_re[c] = a_re[c] - t_re;
+					b_im[c] = a_im[c] - t_im;
+					a_re[c] = a_re[c] + t_re;
+					a_im[c] = a_im[c] + t_im;
+				}
+			}
+		}
+	}
+}
+
+void FVaOceanCPUBackend::UpdateDisplacement(float ChoppyScale)
+{
+	const bool bSimulateVelocity = Slices > 3;
+
+	// Four texels at a time, the scalar loop handles maps narrower than a vector
+	const int32 VectorEnd = Dim & ~3;
+
+	VaOceanParallelFor(Dim, [&](int32 y)
+	{
+		const int32 Row = y * Stride;
+
+		// cos(pi * (m1 + m2)) alternates along the row, so it's the same for each group of four texels
+		const float RowSign = (y & 1) ? -1.f : 1.f;
+		const VectorRegister Sign = MakeVectorRegister(RowSign, -RowSign, RowSign, -RowSign);
+		const VectorRegister ChoppySign = VectorMultiply(Sign, VectorSetFloat1(ChoppyScale));
+
+		for (int32 x = 0; x < VectorEnd; x += 4)
+		{
+			const int32 Index = Row + x;
+
+			VectorStore(VectorMultiply(VectorLoad(HtRe[1] + Index), ChoppySign), Last.Displacement[0] + Index);
+			VectorStore(VectorMultiply(VectorLoad(HtRe[2] + Index), ChoppySign), Last.Displacement[1] + Index);
+			VectorStore(VectorMultiply(VectorLoad(HtRe[0] + Index), Sign), Last.Displacement[2] + Index);
+
+			// See UpdateVelocityPS
+			if (bSimulateVelocity)
+			{
+				VectorStore(VectorMultiply(VectorLoad(HtIm[3] + Index), ChoppySign), Last.Velocity[0] + Index);
+				VectorStore(VectorMultiply(VectorLoad(HtRe[4] + Index), ChoppySign), Last.Velocity[1] + Index);
+				VectorStore(VectorMultiply(VectorLoad(HtRe[3] + Index), Sign), Last.Velocity[2] + Index);
+			}
+		}
+
+		for (int32 x = VectorEnd; x < Dim; x++)
+		{
+			const int32 Index = Row + x;
+			const float sign_correction = ((x + y) & 1) ? -1.f : 1.f;
+
+			Last.Displacement[0][Index] = HtRe[1][Index] * sign_correction * ChoppyScale;
+			Last.Displacement[1][Index] = HtRe[2][Index] * sign_correction * ChoppyScale;
+			Last.Displacement[2][Index] = HtRe[0][Index] * sign_correction;
+
+			if (bSimulateVelocity)
+			{
+				Last.Velocity[0][Index] = HtIm[3][Index] * sign_correction * ChoppyScale;
+				Last.Velocity[1][Index] = HtRe[4][Index] * sign_correction * ChoppyScale;
+				Last.Velocity[2][Index] = HtRe[3][Index] * sign_correction;
+			}
+		}
+	});
+}
+
+void FVaOceanCPUBackend::GenGradientFolding(const FVaOceanCPUPerFrame& PerFrame)
+{
+	const float DispScale = PerFrame.ChoppyScale * PerFrame.GridLen;
+	const int32 Mask = Dim - 1;
+	const int32 BlockCount = (Dim + GRADIENT_BLOCK_ROWS - 1) / GRADIENT_BLOCK_ROWS;
+
+	// Step constants are copied out, so stores to the maps don't make the compiler reload them per texel
+	const float FoamFade = PerFrame.FoamFade;
+	const float FoamThreshold = PerFrame.FoamThreshold;
+	const float FoamInjection = PerFrame.FoamInjection;
+	const float SpawnFoldThreshold = PerFrame.SpawnFoldThreshold;
+
+	const VectorRegister VecDispScale = VectorSetFloat1(DispScale);
+	const VectorRegister VecFoamFade = VectorSetFloat1(FoamFade);
+	const VectorRegister VecFoamThreshold = VectorSetFloat1(FoamThreshold);
+	const VectorRegister VecFoamInjection = VectorSetFloat1(FoamInjection);
+	const VectorRegister VecOne = VectorSetFloat1(1.f);
+	const VectorRegister VecZero = VectorZero();
+
+	SpawnListNum = 0;
+
+	VaOceanParallelFor(BlockCount, [&](int32 Block)
+	{
+		const int32 FirstRow = Block * GRADIENT_BLOCK_ROWS;
+		const int32 LastRow = FMath::Min(FirstRow + GRADIENT_BLOCK_ROWS, Dim);
+
+		// Texels are appended a chunk at a time, so tasks contend for the list once per chunk and nothing spills to heap
+		FVaOceanFoldTexel SpawnChunk[SPAWN_LIST_CHUNK_SIZE];
+		int32 SpawnChunkNum = 0;
+
+		// Same as CompactSpawnListCS: the range is reserved even when it's over capacity, the rest is dropped
+		auto FlushSpawnChunk = [&]()
+		{
+			const int32 First = FPlatformAtomics::InterlockedAdd(&SpawnListNum, SpawnChunkNum);
+			const int32 Num = FMath::Min(SpawnChunkNum, SpawnListCapacity - First);
+
+			if (Num > 0)
+			{
+				FMemory::Memcpy(SpawnList + First, SpawnChunk, Num * sizeof(FVaOceanFoldTexel));
+			}
+			SpawnChunkNum = 0;
+		};
+
+		for (int32 y = FirstRow; y < LastRow; y++)
+		{
+			// Vertical neighbours are whole rows, halo rows wrap around
+			const int32 Back = ((y - 1) & Mask) * Stride;
+			const int32 Row = y * Stride;
+			const int32 Front = ((y + 1) & Mask) * Stride;
+
+			const float* dx_back = Last.Displacement[0] + Back;
+			const float* dy_back = Last.Displacement[1] + Back;
+			const float* dz_back = Last.Displacement[2] + Back;
+			const float* dx_row = Last.Displacement[0] + Row;
+			const float* dy_row = Last.Displacement[1] + Row;
+			const float* dz_row = Last.Displacement[2] + Row;
+			const float* dx_front = Last.Displacement[0] + Front;
+			const float* dy_front = Last.Displacement[1] + Front;
+			const float* dz_front = Last.Displacement[2] + Front;
+			const float* prev_foam = Prev.Gradient[2] + Row;
+
+			float* gradient_x = Last.Gradient[0] + Row;
+			float* gradient_y = Last.Gradient[1] + Row;
+			float* foam_row = Last.Gradient[2] + Row;
+			float* fold_row = Last.Gradient[3] + Row;
+
+			// See GenGradientFoldingPS
+			auto GradientTexel = [&](int32 Left, int32 x, int32 Right)
+			{
+				gradient_x[x] = dz_row[Left] - dz_row[Right];
+				gradient_y[x] = dz_back[x] - dz_front[x];
+
+				const float Dx_x = (dx_row[Right] - dx_row[Left]) * DispScale;
+				const float Dx_y = (dy_row[Right] - dy_row[Left]) * DispScale;
+				const float Dy_x = (dx_front[x] - dx_back[x]) * DispScale;
+				const float Dy_y = (dy_front[x] - dy_back[x]) * DispScale;
+				const float J = (1.0f + Dx_x) * (1.0f + Dy_y) - Dx_y * Dy_x;
+
+				const float fold = FMath::Max(1.0f - J, 0.f);
+
+				float foam = prev_foam[x] * FoamFade;
+				foam += FMath::Max(fold - FoamThreshold, 0.f) * FoamInjection;
+
+				foam_row[x] = FMath::Clamp(foam, 0.f, 1.f);
+				fold_row[x] = fold;
+			};
+
+			// Horizontal halo texels wrap around, inner ones are read without masking four at a time
+			GradientTexel(Mask, 0, 1 & Mask);
+
+			int32 x = 1;
+			for (; x + 4 <= Dim - 1; x += 4)
+			{
+				const VectorRegister dz_left = VectorLoad(dz_row + x - 1);
+				const VectorRegister dz_right = VectorLoad(dz_row + x + 1);
+				VectorStore(VectorSubtract(dz_left, dz_right), gradient_x + x);
+				VectorStore(VectorSubtract(VectorLoad(dz_back + x), VectorLoad(dz_front + x)), gradient_y + x);
+
+				const VectorRegister Dx_x = VectorMultiply(VectorSubtract(VectorLoad(dx_row + x + 1), VectorLoad(dx_row + x - 1)), VecDispScale);
+				const VectorRegister Dx_y = VectorMultiply(VectorSubtract(VectorLoad(dy_row + x + 1), VectorLoad(dy_row + x - 1)), VecDispScale);
+				const VectorRegister Dy_x = VectorMultiply(VectorSubtract(VectorLoad(dx_front + x), VectorLoad(dx_back + x)), VecDispScale);
+				const VectorRegister Dy_y = VectorMultiply(VectorSubtract(VectorLoad(dy_front + x), VectorLoad(dy_back + x)), VecDispScale);
+				const VectorRegister J = VectorSubtract(VectorMultiply(VectorAdd(VecOne, Dx_x), VectorAdd(VecOne, Dy_y)), VectorMultiply(Dx_y, Dy_x));
+
+				const VectorRegister fold = VectorMax(VectorSubtract(VecOne, J), VecZero);
+
+				VectorRegister foam = VectorMultiply(VectorLoad(prev_foam + x), VecFoamFade);
+				foam = VectorAdd(foam, VectorMultiply(VectorMax(VectorSubtract(fold, VecFoamThreshold), VecZero), VecFoamInjection));
+
+				VectorStore(VectorMin(VectorMax(foam, VecZero), VecOne), foam_row + x);
+				VectorStore(fold, fold_row + x);
+			}
+
+			for (; x < Dim - 1; x++)
+			{
+				GradientTexel(x - 1, x, x + 1);
+			}
+
+			if (Dim > 1)
+			{
+				GradientTexel(Dim - 2, Dim - 1, 0);
+			}
+
+			if (SpawnListCapacity > 0)
+			{
+				for (int32 x = 0; x < Dim; x++)
+				{
+					if (fold_row[x] > SpawnFoldThreshold)
+					{
+						FVaOceanFoldTexel& Texel = SpawnChunk[SpawnChunkNum++];
+						Texel.X = x;
+						Texel.Y = y;
+						Texel.Fold = fold_row[x];
+						Texel.Foam = foam_row[x];
+
+						if (SpawnChunkNum == SPAWN_LIST_CHUNK_SIZE)
+						{
+							FlushSpawnChunk();
+						}
+					}
+				}
+			}
+		}
+
+		if (SpawnChunkNum > 0)
+		{
+			FlushSpawnChunk();
+		}
+	});
+
+	SpawnListNum = FMath::Min<int32>(SpawnListNum, SpawnListCapacity);
+}
+
+void FVaOceanCPUBackend::UpdateHeightField(const FVaOceanCPUPerFrame& PerFrame)
+{
+	// Displacement is in world units, GridLen converts it to texels
+	const float TexelsPerUnit = PerFrame.GridLen;
+
+	VaOceanParallelFor(Dim, [&](int32 y)
+	{
+		const int32 Row = y * Stride;
+
+		for (int32 x = 0; x < Dim; x++)
+		{
+			// Find the point that choppy displacement moves onto this texel center
+			float dx = Last.Displacement[0][Row + x];
+			float dy = Last.Displacement[1][Row + x];
+			float dz = Last.Displacement[2][Row + x];
+
+			for (int32 Iteration = 1; Iteration < CHOPPY_INVERSE_ITERATIONS; Iteration++)
+			{
+				const FVaOceanBilinearTaps Taps = GetBilinearTaps(x - dx * TexelsPerUnit, y - dy * TexelsPerUnit);
+				dx = Taps.Sample(Last.Displacement[0]);
+				dy = Taps.Sample(Last.Displacement[1]);
+				dz = Taps.Sample(Last.Displacement[2]);
+			}
+
+			Last.HeightField[Row + x] = dz;
+		}
+	});
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Queries
+
+FVector4 FVaOceanCPUBackend::GetDisplacementTexel(int32 X, int32 Y) const
+{
+	const int32 Mask = Dim - 1;
+	const int32 Index = (Y & Mask) * Stride + (X & Mask);
+
+	return FVector4(Last.Displacement[0][Index], Last.Displacement[1][Index], Last.Displacement[2][Index], 1.f);
+}
+
+FVector FVaOceanCPUBackend::SampleDisplacement(const FVector2D& UV) const
+{
+	if (!IsInitialized())
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FVaOceanBilinearTaps Taps = GetBilinearTaps(UV);
+	const FVector Sample(Taps.Sample(Last.Displacement[0]), Taps.Sample(Last.Displacement[1]), Taps.Sample(Last.Displacement[2]));
+
+	if (!IsInterpolating())
+	{
+		return Sample;
+	}
+
+	const FVector PrevSample(Taps.Sample(Prev.Displacement[0]), Taps.Sample(Prev.Displacement[1]), Taps.Sample(Prev.Displacement[2]));
+
+	return PrevSample + (Sample - PrevSample) * InterpolationAlpha;
+}
+
+FVector FVaOceanCPUBackend::SampleVelocity(const FVector2D& UV) const
+{
+	if (!IsInitialized() || !Last.Velocity[0])
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FVaOceanBilinearTaps Taps = GetBilinearTaps(UV);
+	const FVector Sample(Taps.Sample(Last.Velocity[0]), Taps.Sample(Last.Velocity[1]), Taps.Sample(Last.Velocity[2]));
+
+	if (!IsInterpolating())
+	{
+		return Sample;
+	}
+
+	const FVector PrevSample(Taps.Sample(Prev.Velocity[0]), Taps.Sample(Prev.Velocity[1]), Taps.Sample(Prev.Velocity[2]));
+
+	return PrevSample + (Sample - PrevSample) * InterpolationAlpha;
+}
+
+FVector4 FVaOceanCPUBackend::GetGradientTexel(int32 X, int32 Y) const
+{
+	const int32 Mask = Dim - 1;
+	const int32 Index = (Y & Mask) * Stride + (X & Mask);
+
+	return FVector4(Last.Gradient[0][Index], Last.Gradient[1][Index], Last.Gradient[2][Index], Last.Gradient[3][Index]);
+}
+
+float FVaOceanCPUBackend::SampleFoam(const FVector2D& UV) const
+{
+	if (!IsInitialized())
+	{
+		return 0.f;
+	}
+
+	const FVaOceanBilinearTaps Taps = GetBilinearTaps(UV);
+
+	if (!IsInterpolating())
+	{
+		return Taps.Sample(Last.Gradient[2]);
+	}
+
+	return FMath::Lerp(Taps.Sample(Prev.Gradient[2]), Taps.Sample(Last.Gradient[2]), InterpolationAlpha);
+}
+
+float FVaOceanCPUBackend::SampleHeight(const FVector2D& UV) const
+{
+	if (!IsInitialized())
+	{
+		return 0.f;
+	}
+
+	const FVaOceanBilinearTaps Taps = GetBilinearTaps(UV);
+
+	if (!IsInterpolating())
+	{
+		return Taps.Sample(Last.HeightField);
+	}
+
+	return FMath::Lerp(Taps.Sample(Prev.HeightField), Taps.Sample(Last.HeightField), InterpolationAlpha);
+}
+
+FVaOceanTileBounds FVaOceanCPUBackend::GetBounds(const FVector2D& UVMin, const FVector2D& UVMax) const
+{
+	FVaOceanTileBounds Bounds = Last.BoundsPyramid.GetBounds(UVMin, UVMax);
+
+	// Interpolated texel lies between its values of both steps
+	if (IsInterpolating())
+	{
+		Bounds.Merge(Prev.BoundsPyramid.GetBounds(UVMin, UVMax));
+	}
+
+	return Bounds;
+}
+
+FVaOceanTileBounds FVaOceanCPUBackend::GetGlobalBounds() const
+{
+	FVaOceanTileBounds Bounds = Last.BoundsPyramid.GetGlobalBounds();
+
+	if (IsInterpolating())
+	{
+		Bounds.Merge(Prev.BoundsPyramid.GetGlobalBounds());
+	}
+
+	return Bounds;
+}
+
+FVaOceanCPUMapView FVaOceanCPUBackend::GetDisplacementView(bool bPrevious) const
+{
+	return MakeView((bPrevious ? Prev : Last).Displacement, 3);
+}
+
+FVaOceanCPUMapView FVaOceanCPUBackend::GetVelocityView(bool bPrevious) const
+{
+	const FVaOceanCPUStep& Step = bPrevious ? Prev : Last;
+	return MakeView(Step.Velocity, Step.Velocity[0] ? 3 : 0);
+}
+
+FVaOceanCPUMapView FVaOceanCPUBackend::GetGradientView(bool bPrevious) const
+{
+	return MakeView((bPrevious ? Prev : Last).Gradient, 4);
+}
+
+FVaOceanCPUMapView FVaOceanCPUBackend::GetHeightFieldView(bool bPrevious) const
+{
+	return MakeView(&(bPrevious ? Prev : Last).HeightField, 1);
+}
+
+const FVaOceanFoldTexel* FVaOceanCPUBackend::GetSpawnList(int32& OutNum) const
+{
+	OutNum = SpawnList ? SpawnListNum : 0;
+	return SpawnList;
+}
+
+bool FVaOceanCPUBackend::IsInterpolating() const
+{
+	return InterpolationAlpha < 1.f;
+}
+
+FVaOceanCPUMapView FVaOceanCPUBackend::MakeView(float* const* Planes, int32 PlaneCount) const
+{
+	FVaOceanCPUMapView View;
+	if (!IsInitialized())
+	{
+		return View;
+	}
+
+	for (int32 Plane = 0; Plane < PlaneCount; Plane++)
+	{
+		View.Planes[Plane] = Planes[Plane];
+	}
+	View.PlaneCount = PlaneCount;
+	View.Dim = Dim;
+	View.Stride = Stride;
+
+	return View;
+}
+
+FVaOceanBilinearTaps FVaOceanCPUBackend::GetBilinearTaps(const FVector2D& UV) const
+{
+	// Texel centers are at (i + 0.5) / Dim
+	return GetBilinearTaps(UV.X * Dim - 0.5f, UV.Y * Dim - 0.5f);
+}
+
+FVaOceanBilinearTaps FVaOceanCPUBackend::GetBilinearTaps(float fx, float fy) const
+{
+	return FVaOceanBilinearTaps(fx, fy, Dim, Stride);
+}
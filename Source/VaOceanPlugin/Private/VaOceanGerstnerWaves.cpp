@@ -0,0 +1,434 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+/** Wave arrays are padded to this many waves */
+#define GERSTNER_SIMD_WIDTH 4
+
+/** Spectrum wave considered for picking */
+struct FVaOceanGerstnerCandidate
+{
+	/** Squared amplitude */
+	float Energy;
+
+	/** Texel index * 2, plus 1 for the conj(h0(-k)) wave */
+	int32 Index;
+
+	/** Octave * DirectionBins + direction sector */
+	int32 Band;
+};
+
+FVaOceanGerstnerWaves::FVaOceanGerstnerWaves()
+	: Count(0)
+	, Kx(nullptr)
+	, Ky(nullptr)
+	, Omega(nullptr)
+	, Phase(nullptr)
+	, Amplitude(nullptr)
+	, ChoppyX(nullptr)
+	, ChoppyY(nullptr)
+{
+}
+
+void FVaOceanGerstnerWaves::Initialize(int32 InDim, const FVector4* InH0, const float* InOmega, int32 InCount, int32 InDirectionBins)
+{
+	check(FMath::IsPowerOfTwo(InDim));
+
+	Count = Align(FMath::Max(InCount, 1), GERSTNER_SIMD_WIDTH);
+
+	// Memory of the same size is reused, padding waves are silent
+	Arena.Reserve(GetArenaSize(InCount));
+
+	float** Arrays[7] = { &Kx, &Ky, &Omega, &Phase, &Amplitude, &ChoppyX, &ChoppyY };
+	for (float** Array : Arrays)
+	{
+		*Array = (float*)Arena.Allocate(Count * sizeof(float));
+		FMemory::Memzero(*Array, Count * sizeof(float));
+	}
+
+	// Octaves of |k| in texels, the map corner is below InDim. Unstratified picking is one band of the whole spectrum.
+	const bool bStratified = InDirectionBins > 0;
+	const int32 DirectionBins = FMath::Max(InDirectionBins, 1);
+	const int32 OctaveCount = bStratified ? FMath::Max((int32)FMath::FloorLog2(InDim), 1) : 1;
+	const int32 BandCount = DirectionBins * OctaveCount;
+
+	TArray<FVaOceanGerstnerCandidate> Candidates;
+	Candidates.Reserve(2 * InDim * InDim);
+
+	TArray<double> BandEnergy;
+	TArray<int32> BandSize;
+	BandEnergy.AddZeroed(BandCount);
+	BandSize.AddZeroed(BandCount);
+	double TotalEnergy = 0.0;
+
+	for (int32 y = 0; y < InDim; y++)
+	{
+		for (int32 x = 0; x < InDim; x++)
+		{
+			const int32 kx = x - InDim / 2;
+			const int32 ky = y - InDim / 2;
+			if (kx == 0 && ky == 0)
+			{
+				continue;
+			}
+
+			const FVector4& h0 = InH0[y * InDim + x];
+			const int32 Octave = FMath::Clamp(FMath::FloorToInt(FMath::Log2(FMath::Sqrt((float)(kx * kx + ky * ky)))), 0, OctaveCount - 1);
+
+			// h0(k) moves along k, conj(h0(-k)) against it
+			for (int32 Wave = 0; Wave < 2; Wave++)
+			{
+				const float Energy = (Wave == 0) ? (h0.X * h0.X + h0.Y * h0.Y) : (h0.Z * h0.Z + h0.W * h0.W);
+				if (Energy <= 0.f)
+				{
+					continue;
+				}
+
+				const float Sign = (Wave == 0) ? 1.f : -1.f;
+				const float Angle = FMath::Atan2(Sign * ky, Sign * kx);
+				const int32 Sector = FMath::Clamp(FMath::FloorToInt((Angle + PI) / (2.f * PI) * DirectionBins), 0, DirectionBins - 1);
+
+				FVaOceanGerstnerCandidate Candidate;
+				Candidate.Energy = Energy;
+				Candidate.Index = (y * InDim + x) * 2 + Wave;
+				Candidate.Band = Octave * DirectionBins + Sector;
+				Candidates.Add(Candidate);
+
+				BandEnergy[Candidate.Band] += Energy;
+				BandSize[Candidate.Band]++;
+				TotalEnergy += Energy;
+			}
+		}
+	}
+
+	if (TotalEnergy <= 0.0)
+	{
+		return;
+	}
+
+	// Wave budget of each band is proportional to its energy, leftovers go to the bands short of their share the most
+	TArray<int32> BandQuota;
+	BandQuota.AddZeroed(BandCount);
+	int32 Assigned = 0;
+
+	for (int32 Band = 0; Band < BandCount; Band++)
+	{
+		const double Share = InCount * BandEnergy[Band] / TotalEnergy;
+		BandQuota[Band] = FMath::Min(FMath::FloorToInt(Share), BandSize[Band]);
+		Assigned += BandQuota[Band];
+	}
+
+	while (Assigned < InCount)
+	{
+		int32 BestBand = INDEX_NONE;
+		double BestDeficit = -MAX_dbl;
+
+		for (int32 Band = 0; Band < BandCount; Band++)
+		{
+			const double Deficit = InCount * BandEnergy[Band] / TotalEnergy - BandQuota[Band];
+			if (BandQuota[Band] < BandSize[Band] && Deficit > BestDeficit)
+			{
+				BestBand = Band;
+				BestDeficit = Deficit;
+			}
+		}
+
+		if (BestBand == INDEX_NONE)
+		{
+			break;
+		}
+
+		BandQuota[BestBand]++;
+		Assigned++;
+	}
+
+	// Bands left without waves are too weak to matter for the look, but their energy is spread over the rest
+	double CoveredEnergy = 0.0;
+	for (int32 Band = 0; Band < BandCount; Band++)
+	{
+		CoveredEnergy += (BandQuota[Band] > 0) ? BandEnergy[Band] : 0.0;
+	}
+
+	// The strongest waves of each band are picked
+	Candidates.Sort([](const FVaOceanGerstnerCandidate& A, const FVaOceanGerstnerCandidate& B)
+	{
+		return (A.Band != B.Band) ? (A.Band < B.Band) : (A.Energy > B.Energy);
+	});
+
+	int32 WaveIndex = 0;
+	for (int32 First = 0; First < Candidates.Num(); )
+	{
+		const int32 Band = Candidates[First].Band;
+		const int32 Picked = BandQuota[Band];
+
+		int32 End = First;
+		double PickedEnergy = 0.0;
+		while (End < Candidates.Num() && Candidates[End].Band == Band)
+		{
+			if (End - First < Picked)
+			{
+				PickedEnergy += Candidates[End].Energy;
+			}
+			End++;
+		}
+
+		// Picked waves carry the energy of the whole band, so surface variance is kept. Unstratified waves are
+		// the exact terms of the FFT sum, so they are left as they are.
+		float Scale = 1.f;
+		if (bStratified)
+		{
+			Scale = (PickedEnergy > 0.0) ? (float)FMath::Sqrt(BandEnergy[Band] / PickedEnergy * TotalEnergy / CoveredEnergy) : 0.f;
+		}
+
+		for (int32 i = First; i < First + Picked; i++)
+		{
+			const int32 Texel = Candidates[i].Index / 2;
+			const bool bAgainstK = (Candidates[i].Index & 1) != 0;
+			const FVector4& h0 = InH0[Texel];
+
+			const float Sign = bAgainstK ? -1.f : 1.f;
+			const FVector2D K(Sign * (Texel % InDim - InDim / 2), Sign * (Texel / InDim - InDim / 2));
+			const FVector2D Direction = K.GetSafeNormal();
+			const float WaveAmplitude = FMath::Sqrt(Candidates[i].Energy) * Scale;
+
+			Kx[WaveIndex] = 2.f * PI * K.X;
+			Ky[WaveIndex] = 2.f * PI * K.Y;
+			Omega[WaveIndex] = InOmega[Texel];
+			Phase[WaveIndex] = bAgainstK ? FMath::Atan2(h0.W, h0.Z) : -FMath::Atan2(h0.Y, h0.X);
+			Amplitude[WaveIndex] = WaveAmplitude;
+			ChoppyX[WaveIndex] = -WaveAmplitude * Direction.X;
+			ChoppyY[WaveIndex] = -WaveAmplitude * Direction.Y;
+			WaveIndex++;
+		}
+
+		First = End;
+	}
+}
+
+SIZE_T FVaOceanGerstnerWaves::GetArenaSize(int32 InCount)
+{
+	const SIZE_T ArraySize = Align(FMath::Max(InCount, 1), GERSTNER_SIMD_WIDTH) * sizeof(float);
+	return 7 * Align(ArraySize, CPU_ARENA_ALIGNMENT);
+}
+
+void FVaOceanGerstnerWaves::Release()
+{
+	Count = 0;
+	Kx = nullptr;
+	Ky = nullptr;
+	Omega = nullptr;
+	Phase = nullptr;
+	Amplitude = nullptr;
+	ChoppyX = nullptr;
+	ChoppyY = nullptr;
+
+	Arena.Release();
+}
+
+bool FVaOceanGerstnerWaves::IsInitialized() const
+{
+	return Count > 0;
+}
+
+int32 FVaOceanGerstnerWaves::Num() const
+{
+	return Count;
+}
+
+void FVaOceanGerstnerWaves::GetShaderData(TArray<FVector4>& OutData) const
+{
+	OutData.Reset(Count * 2);
+
+	for (int32 i = 0; i < Count; i++)
+	{
+		OutData.Add(FVector4(Kx[i], Ky[i], Omega[i], Phase[i]));
+		OutData.Add(FVector4(Amplitude[i], ChoppyX[i], ChoppyY[i], 0.f));
+	}
+}
+
+FVector FVaOceanGerstnerWaves::GetDisplacementBound(float ChoppyScale) const
+{
+	FVector Bound = FVector::ZeroVector;
+
+	for (int32 i = 0; i < Count; i++)
+	{
+		Bound.X += FMath::Abs(ChoppyX[i]);
+		Bound.Y += FMath::Abs(ChoppyY[i]);
+		Bound.Z += Amplitude[i];
+	}
+
+	return FVector(Bound.X * ChoppyScale, Bound.Y * ChoppyScale, Bound.Z);
+}
+
+void FVaOceanGerstnerWaves::EvaluateGrid(int32 InDim, int32 InStride, float Time, float TimeScale, float ChoppyScale, float* const* OutDisplacement, float* const* OutVelocity) const
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	const float InvDim = 1.f / InDim;
+
+	VaOceanParallelFor(InDim, [&](int32 y)
+	{
+		float* dx = OutDisplacement[0] + y * InStride;
+		float* dy = OutDisplacement[1] + y * InStride;
+		float* dz = OutDisplacement[2] + y * InStride;
+		float* vx = OutVelocity ? OutVelocity[0] + y * InStride : nullptr;
+		float* vy = OutVelocity ? OutVelocity[1] + y * InStride : nullptr;
+		float* vz = OutVelocity ? OutVelocity[2] + y * InStride : nullptr;
+
+		float* Rows[6] = { dx, dy, dz, vx, vy, vz };
+		for (float* Row : Rows)
+		{
+			if (Row)
+			{
+				FMemory::Memzero(Row, InDim * sizeof(float));
+			}
+		}
+
+		const float v = y * InvDim;
+
+		for (int32 i = 0; i < Count; i++)
+		{
+			if (Amplitude[i] == 0.f)
+			{
+				continue;
+			}
+
+			// Phase of four neighbour texels, advanced along the row by rotation instead of sin/cos per texel
+			const float RowPhase = Ky[i] * v - Omega[i] * Time + Phase[i];
+			const float TexelPhase = Kx[i] * InvDim;
+
+			float LaneSin[GERSTNER_SIMD_WIDTH];
+			float LaneCos[GERSTNER_SIMD_WIDTH];
+			for (int32 Lane = 0; Lane < GERSTNER_SIMD_WIDTH; Lane++)
+			{
+				FMath::SinCos(&LaneSin[Lane], &LaneCos[Lane], RowPhase + TexelPhase * Lane);
+			}
+
+			float StepSin, StepCos;
+			FMath::SinCos(&StepSin, &StepCos, TexelPhase * GERSTNER_SIMD_WIDTH);
+
+			VectorRegister Sin = VectorLoad(LaneSin);
+			VectorRegister Cos = VectorLoad(LaneCos);
+			const VectorRegister RotSin = VectorSetFloat1(StepSin);
+			const VectorRegister RotCos = VectorSetFloat1(StepCos);
+
+			const VectorRegister A = VectorSetFloat1(Amplitude[i]);
+			const VectorRegister CX = VectorSetFloat1(ChoppyX[i] * ChoppyScale);
+			const VectorRegister CY = VectorSetFloat1(ChoppyY[i] * ChoppyScale);
+
+			// d(psi)/dt in world seconds is -omega * TimeScale
+			const float WorldOmega = Omega[i] * TimeScale;
+			const VectorRegister VA = VectorSetFloat1(Amplitude[i] * WorldOmega);
+			const VectorRegister VCX = VectorSetFloat1(-ChoppyX[i] * ChoppyScale * WorldOmega);
+			const VectorRegister VCY = VectorSetFloat1(-ChoppyY[i] * ChoppyScale * WorldOmega);
+
+			// Planes are padded to whole cache lines, so the last group never runs out of the row
+			for (int32 x = 0; x < InDim; x += GERSTNER_SIMD_WIDTH)
+			{
+				VectorStore(VectorMultiplyAdd(CX, Sin, VectorLoad(dx + x)), dx + x);
+				VectorStore(VectorMultiplyAdd(CY, Sin, VectorLoad(dy + x)), dy + x);
+				VectorStore(VectorMultiplyAdd(A, Cos, VectorLoad(dz + x)), dz + x);
+
+				if (OutVelocity)
+				{
+					VectorStore(VectorMultiplyAdd(VCX, Cos, VectorLoad(vx + x)), vx + x);
+					VectorStore(VectorMultiplyAdd(VCY, Cos, VectorLoad(vy + x)), vy + x);
+					VectorStore(VectorMultiplyAdd(VA, Sin, VectorLoad(vz + x)), vz + x);
+				}
+
+				const VectorRegister NextCos = VectorSubtract(VectorMultiply(Cos, RotCos), VectorMultiply(Sin, RotSin));
+				Sin = VectorMultiplyAdd(Sin, RotCos, VectorMultiply(Cos, RotSin));
+				Cos = NextCos;
+			}
+		}
+	});
+}
+
+void FVaOceanGerstnerWaves::EvaluatePoints(const FVector2D* InUVs, int32 InNum, float Time, float TimeScale, float ChoppyScale, FVector* OutDisplacement, FVector* OutVelocity) const
+{
+	if (!IsInitialized())
+	{
+		for (int32 Point = 0; Point < InNum; Point++)
+		{
+			OutDisplacement[Point] = FVector::ZeroVector;
+			if (OutVelocity)
+			{
+				OutVelocity[Point] = FVector::ZeroVector;
+			}
+		}
+		return;
+	}
+
+	const VectorRegister VTime = VectorSetFloat1(Time);
+
+	for (int32 Point = 0; Point < InNum; Point++)
+	{
+		// Wave vectors are whole periods of the patch, so UV is wrapped to keep phase precise far from the origin
+		const VectorRegister U = VectorSetFloat1(InUVs[Point].X - FMath::FloorToFloat(InUVs[Point].X));
+		const VectorRegister V = VectorSetFloat1(InUVs[Point].Y - FMath::FloorToFloat(InUVs[Point].Y));
+
+		VectorRegister DX = VectorZero();
+		VectorRegister DY = VectorZero();
+		VectorRegister DZ = VectorZero();
+		VectorRegister VX = VectorZero();
+		VectorRegister VY = VectorZero();
+		VectorRegister VZ = VectorZero();
+
+		// Four waves at a time, padding waves are silent
+		for (int32 i = 0; i < Count; i += GERSTNER_SIMD_WIDTH)
+		{
+			const VectorRegister W = VectorLoad(Omega + i);
+
+			VectorRegister Psi = VectorMultiplyAdd(VectorLoad(Kx + i), U, VectorLoad(Phase + i));
+			Psi = VectorMultiplyAdd(VectorLoad(Ky + i), V, Psi);
+			Psi = VectorSubtract(Psi, VectorMultiply(W, VTime));
+
+			VectorRegister Sin, Cos;
+			VectorSinCos(&Sin, &Cos, &Psi);
+
+			const VectorRegister A = VectorLoad(Amplitude + i);
+			const VectorRegister CX = VectorLoad(ChoppyX + i);
+			const VectorRegister CY = VectorLoad(ChoppyY + i);
+
+			DX = VectorMultiplyAdd(CX, Sin, DX);
+			DY = VectorMultiplyAdd(CY, Sin, DY);
+			DZ = VectorMultiplyAdd(A, Cos, DZ);
+
+			if (OutVelocity)
+			{
+				const VectorRegister WCos = VectorMultiply(W, Cos);
+
+				VX = VectorSubtract(VX, VectorMultiply(CX, WCos));
+				VY = VectorSubtract(VY, VectorMultiply(CY, WCos));
+				VZ = VectorMultiplyAdd(A, VectorMultiply(W, Sin), VZ);
+			}
+		}
+
+		float Lanes[3][4];
+		VectorStore(DX, Lanes[0]);
+		VectorStore(DY, Lanes[1]);
+		VectorStore(DZ, Lanes[2]);
+
+		OutDisplacement[Point] = FVector(
+			(Lanes[0][0] + Lanes[0][1] + Lanes[0][2] + Lanes[0][3]) * ChoppyScale,
+			(Lanes[1][0] + Lanes[1][1] + Lanes[1][2] + Lanes[1][3]) * ChoppyScale,
+			Lanes[2][0] + Lanes[2][1] + Lanes[2][2] + Lanes[2][3]);
+
+		if (OutVelocity)
+		{
+			VectorStore(VX, Lanes[0]);
+			VectorStore(VY, Lanes[1]);
+			VectorStore(VZ, Lanes[2]);
+
+			// d(psi)/dt in world seconds is -omega * TimeScale
+			OutVelocity[Point] = FVector(
+				(Lanes[0][0] + Lanes[0][1] + Lanes[0][2] + Lanes[0][3]) * ChoppyScale * TimeScale,
+				(Lanes[1][0] + Lanes[1][1] + Lanes[1][2] + Lanes[1][3]) * ChoppyScale * TimeScale,
+				(Lanes[2][0] + Lanes[2][1] + Lanes[2][2] + Lanes[2][3]) * TimeScale);
+		}
+	}
+}
@@ -0,0 +1,154 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+
+FVaOceanMemoryPlan::FVaOceanMemoryPlan()
+	: Dim(0)
+	, FFTSlices(0)
+	, bAsyncCompute(false)
+	, SpectrumMipCount(0)
+	, bCPUSimulation(false)
+	, GerstnerWaveCount(0)
+	, PointQueryWaveCount(0)
+	, QueryCacheTileSize(0)
+	, QueryCacheTileCount(0)
+	, WakeDim(0)
+	, WakeSourceCount(0)
+	, SpawnListCapacity(0)
+	, H0Bytes(0)
+	, OmegaBytes(0)
+	, SliceBytes(0)
+	, BoundsBytes(0)
+	, WakeBytes(0)
+	, SpawnListBytes(0)
+	, GerstnerBytes(0)
+	, SpectrumMipBytes(0)
+	, SpectrumGenBytes(0)
+	, StagingBytes(0)
+	, CPUBackendBytes(0)
+	, WakeSolverBytes(0)
+	, WakeSourceBytes(0)
+	, GerstnerWavesBytes(0)
+	, PointQueryWavesBytes(0)
+	, QueryCacheBytes(0)
+{
+}
+
+FVaOceanMemoryPlan::FVaOceanMemoryPlan(int32 InDim, bool bInSimulateVelocity, bool bInAsyncCompute, bool bInBandLimitedMips, bool bInCPUSimulation, int32 InWakeDim, int32 InWakeSourceCount, int32 InGerstnerWaveCount, int32 InPointQueryWaveCount, int32 InQueryCacheTileSize, int32 InQueryCacheTileCount, int32 InSpawnListCapacity)
+	: FVaOceanMemoryPlan()
+{
+	check(FMath::IsPowerOfTwo(InDim));
+
+	Dim = InDim;
+	bCPUSimulation = bInCPUSimulation;
+
+	const uint32 MapSize = Dim * Dim;
+	H0Bytes = MapSize * sizeof(FVector4);
+	OmegaBytes = MapSize * sizeof(float);
+	BoundsBytes = FVaOceanBoundsPyramid::GetTotalTileCount(Dim) * sizeof(FVector4);
+
+	// Analytic waves take no FFT buffers at all
+	if (InGerstnerWaveCount > 0)
+	{
+		GerstnerWaveCount = InGerstnerWaveCount;
+		GerstnerBytes = Align(GerstnerWaveCount, 4) * 2 * sizeof(FVector4);
+		GerstnerWavesBytes = FVaOceanGerstnerWaves::GetArenaSize(GerstnerWaveCount);
+	}
+	else
+	{
+		FFTSlices = bInSimulateVelocity ? 5 : 3;
+		bAsyncCompute = bInAsyncCompute;
+		SliceBytes = FFTSlices * MapSize * sizeof(FVector2D);
+	}
+
+	// Mips transform 3 slices each: H(t), Dxyz and FFT temp buffer
+	if (bInBandLimitedMips && GerstnerWaveCount == 0)
+	{
+		for (int32 MipDim = Dim / 2; MipDim >= 2; MipDim /= 2)
+		{
+			SpectrumMipCount++;
+			SpectrumMipBytes += 3 * (3 * MipDim * MipDim * sizeof(FVector2D));
+		}
+	}
+
+	SpectrumGenBytes = FMath::Square(Dim + 1) * sizeof(FVector2D);
+
+	StagingBytes = Align((SIZE_T)H0Bytes, CPU_ARENA_ALIGNMENT) + Align((SIZE_T)OmegaBytes, CPU_ARENA_ALIGNMENT) + Align(SpectrumGenBytes, CPU_ARENA_ALIGNMENT);
+
+	// Spawn list can't hold more texels than the map has
+	if (InSpawnListCapacity > 0)
+	{
+		SpawnListCapacity = FMath::Min<uint32>(InSpawnListCapacity, MapSize);
+		SpawnListBytes = SpawnListCapacity * sizeof(FVector4) + SPAWN_LIST_ARGS_SIZE * sizeof(uint32);
+	}
+
+	CPUBackendBytes = bCPUSimulation ? FVaOceanCPUBackend::GetArenaSize(Dim, bInSimulateVelocity, GerstnerWaveCount > 0, SpawnListCapacity) : 0;
+
+	// Analytic waves answer point queries themselves
+	if (bCPUSimulation && InPointQueryWaveCount > 0 && GerstnerWaveCount == 0)
+	{
+		PointQueryWaveCount = InPointQueryWaveCount;
+		PointQueryWavesBytes = 2 * FVaOceanGerstnerWaves::GetArenaSize(PointQueryWaveCount);
+	}
+
+	// Tiles can't be larger than the grid
+	if (bCPUSimulation && InQueryCacheTileCount > 0)
+	{
+		QueryCacheTileSize = FMath::Min((int32)FMath::RoundUpToPowerOfTwo(FMath::Max(InQueryCacheTileSize, 1)), Dim);
+		QueryCacheTileCount = InQueryCacheTileCount;
+		QueryCacheBytes = FVaOceanQueryCache::GetArenaSize(QueryCacheTileSize, QueryCacheTileCount);
+	}
+
+	// Wake grid is a power of two, so CPU map views can address it
+	if (InWakeDim > 0)
+	{
+		WakeDim = FMath::RoundUpToPowerOfTwo(InWakeDim);
+		WakeSourceCount = FMath::Max(InWakeSourceCount, 1);
+		WakeBytes = 3 * WakeDim * WakeDim * sizeof(float) + WakeSourceCount * sizeof(FVector4);
+		WakeSolverBytes = bCPUSimulation ? FVaOceanWakeSolver::GetArenaSize(WakeDim) : 0;
+		WakeSourceBytes = WakeSourceCount * (sizeof(FVaOceanWakeSource) + WAKE_SOURCE_RING_SIZE * sizeof(FVector4));
+	}
+}
+
+bool FVaOceanMemoryPlan::IsValid() const
+{
+	return Dim > 0;
+}
+
+uint64 FVaOceanMemoryPlan::GetGPUBytes() const
+{
+	// H(t), Dxyz, FFT temp and optional async Dxyz
+	const uint64 SliceBuffers = bAsyncCompute ? 4 : 3;
+
+	// Current and sea state transition target H(0)
+	const uint64 SpectrumBytes = (GerstnerWaveCount > 0) ? GerstnerBytes : 2 * (uint64)H0Bytes + OmegaBytes;
+
+	return SpectrumBytes + SliceBuffers * SliceBytes + BoundsBytes + SpectrumMipBytes + WakeBytes + SpawnListBytes;
+}
+
+SIZE_T FVaOceanMemoryPlan::GetCPUBytes() const
+{
+	return StagingBytes + CPUBackendBytes + WakeSolverBytes + WakeSourceBytes + GerstnerWavesBytes + PointQueryWavesBytes + QueryCacheBytes;
+}
+
+bool FVaOceanMemoryPlan::operator==(const FVaOceanMemoryPlan& Other) const
+{
+	// Sizes are derived from configuration
+	return Dim == Other.Dim
+		&& FFTSlices == Other.FFTSlices
+		&& bAsyncCompute == Other.bAsyncCompute
+		&& SpectrumMipCount == Other.SpectrumMipCount
+		&& bCPUSimulation == Other.bCPUSimulation
+		&& GerstnerWaveCount == Other.GerstnerWaveCount
+		&& PointQueryWaveCount == Other.PointQueryWaveCount
+		&& QueryCacheTileSize == Other.QueryCacheTileSize
+		&& QueryCacheTileCount == Other.QueryCacheTileCount
+		&& WakeDim == Other.WakeDim
+		&& WakeSourceCount == Other.WakeSourceCount
+		&& SpawnListCapacity == Other.SpawnListCapacity;
+}
+
+bool FVaOceanMemoryPlan::operator!=(const FVaOceanMemoryPlan& Other) const
+{
+	return !(*this == Other);
+}
@@ -0,0 +1,14 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#pragma once
+
+#include "ParallelFor.h"
+
+/** Whether r.VaOcean.CPUSingleThread keeps CPU work of the plugin on the calling thread */
+bool IsVaOceanCPUSingleThread();
+
+/** ParallelFor of CPU simulation and queries. Task graph dispatch allocates, so it can be turned off for profiling and allocation tests. */
+inline void VaOceanParallelFor(int32 Num, TFunctionRef<void(int32)> Body)
+{
+	ParallelFor(Num, Body, IsVaOceanCPUSingleThread());
+}
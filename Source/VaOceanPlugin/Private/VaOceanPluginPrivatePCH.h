@@ -15,10 +15,24 @@
 #include "ModuleManager.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogVaOcean, Log, All);
+DECLARE_STATS_GROUP(TEXT("VaOcean"), STATGROUP_VaOcean, STATCAT_Advanced);
 
 #include "IVaOceanPlugin.h"
 
 #include "VaOceanTypes.h"
 #include "VaOceanShaders.h"
 #include "VaOceanRadixFFT.h"
+#include "VaOceanCPUArena.h"
+#include "VaOceanBoundsPyramid.h"
+#include "VaOceanGerstnerWaves.h"
+#include "VaOceanQueryCache.h"
+#include "VaOceanCPUFFT.h"
+#include "VaOceanCPUBackend.h"
+#include "VaOceanWakeSolver.h"
+#include "VaOceanMemoryPlan.h"
+#include "VaOceanRayCaster.h"
+#include "VaOceanBuoyancyBatch.h"
 #include "VaOceanSimulator.h"
+#include "VaOceanQuadTree.h"
+#include "VaOceanSurfaceComponent.h"
+#include "VaOceanBuoyancyComponent.h"
@@ -0,0 +1,135 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+
+FVaOceanQuadTree::FVaOceanQuadTree()
+{
+	SetSettings(FVaOceanQuadTreeSettings());
+}
+
+void FVaOceanQuadTree::SetSettings(const FVaOceanQuadTreeSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.LODCount = FMath::Max(Settings.LODCount, 1);
+
+	LODRanges.SetNumUninitialized(Settings.LODCount);
+	for (int32 LOD = 0; LOD < Settings.LODCount; LOD++)
+	{
+		LODRanges[LOD] = Settings.LODBaseRange * (float)(1 << LOD);
+	}
+}
+
+const FVaOceanQuadTreeSettings& FVaOceanQuadTree::GetSettings() const
+{
+	return Settings;
+}
+
+float FVaOceanQuadTree::GetLODRange(int32 LOD) const
+{
+	return LODRanges[FMath::Clamp(LOD, 0, Settings.LODCount - 1)];
+}
+
+void FVaOceanQuadTree::Select(const FVector& ViewOrigin, const TArray<FPlane>& Frustum, TArray<FVaOceanPatch>& OutPatches) const
+{
+	OutPatches.Reset();
+
+	const int32 RootLOD = Settings.LODCount - 1;
+	const float RootSize = Settings.MinPatchSize * (float)(1 << RootLOD);
+
+	// Root grid is aligned to world origin, so patches don't swim when ocean is moved
+	const int32 MinX = FMath::FloorToInt((Settings.Center.X - Settings.Extent) / RootSize);
+	const int32 MaxX = FMath::CeilToInt((Settings.Center.X + Settings.Extent) / RootSize);
+	const int32 MinY = FMath::FloorToInt((Settings.Center.Y - Settings.Extent) / RootSize);
+	const int32 MaxY = FMath::CeilToInt((Settings.Center.Y + Settings.Extent) / RootSize);
+
+	for (int32 y = MinY; y < MaxY; y++)
+	{
+		for (int32 x = MinX; x < MaxX; x++)
+		{
+			const FVector2D RootCenter((x + 0.5f) * RootSize, (y + 0.5f) * RootSize);
+			SelectNode(RootCenter, RootSize, RootLOD, ViewOrigin, Frustum, OutPatches);
+		}
+	}
+}
+
+void FVaOceanQuadTree::SelectNode(const FVector2D& NodeCenter, float NodeSize, int32 LOD, const FVector& ViewOrigin, const TArray<FPlane>& Frustum, TArray<FVaOceanPatch>& OutPatches) const
+{
+	const float HalfSize = NodeSize * 0.5f;
+	const FVector BoxCenter(NodeCenter.X, NodeCenter.Y, (Settings.MinHeight + Settings.MaxHeight) * 0.5f);
+	const FVector BoxExtent(HalfSize + Settings.HorizontalPadding, HalfSize + Settings.HorizontalPadding, (Settings.MaxHeight - Settings.MinHeight) * 0.5f);
+
+	if (!IsBoxInFrustum(BoxCenter, BoxExtent, Frustum))
+	{
+		return;
+	}
+
+	// Node is far enough for its own LOD
+	if (LOD == 0 || !IsBoxInSphere(BoxCenter, BoxExtent, ViewOrigin, LODRanges[LOD - 1]))
+	{
+		FVaOceanPatch Patch;
+		Patch.Center = NodeCenter;
+		Patch.Size = NodeSize;
+		Patch.LOD = LOD;
+		Patch.MorphEnd = LODRanges[LOD];
+		Patch.MorphStart = FMath::Lerp(LOD > 0 ? LODRanges[LOD - 1] : 0.f, Patch.MorphEnd, Settings.MorphStartRatio);
+
+		OutPatches.Add(Patch);
+		return;
+	}
+
+	const float ChildOffset = NodeSize * 0.25f;
+	const float ChildSize = HalfSize;
+
+	SelectNode(FVector2D(NodeCenter.X - ChildOffset, NodeCenter.Y - ChildOffset), ChildSize, LOD - 1, ViewOrigin, Frustum, OutPatches);
+	SelectNode(FVector2D(NodeCenter.X + ChildOffset, NodeCenter.Y - ChildOffset), ChildSize, LOD - 1, ViewOrigin, Frustum, OutPatches);
+	SelectNode(FVector2D(NodeCenter.X - ChildOffset, NodeCenter.Y + ChildOffset), ChildSize, LOD - 1, ViewOrigin, Frustum, OutPatches);
+	SelectNode(FVector2D(NodeCenter.X + ChildOffset, NodeCenter.Y + ChildOffset), ChildSize, LOD - 1, ViewOrigin, Frustum, OutPatches);
+}
+
+bool FVaOceanQuadTree::IsBoxInFrustum(const FVector& BoxCenter, const FVector& BoxExtent, const TArray<FPlane>& Frustum)
+{
+	for (const FPlane& Plane : Frustum)
+	{
+		// Box corner that is the most inside the plane
+		const FVector PositiveVertex(
+			BoxCenter.X + (Plane.X >= 0.f ? BoxExtent.X : -BoxExtent.X),
+			BoxCenter.Y + (Plane.Y >= 0.f ? BoxExtent.Y : -BoxExtent.Y),
+			BoxCenter.Z + (Plane.Z >= 0.f ? BoxExtent.Z : -BoxExtent.Z));
+
+		if (Plane.PlaneDot(PositiveVertex) < 0.f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FVaOceanQuadTree::IsBoxInSphere(const FVector& BoxCenter, const FVector& BoxExtent, const FVector& SphereCenter, float Radius)
+{
+	float DistSquared = 0.f;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		const float Delta = FMath::Max(FMath::Abs(SphereCenter[Axis] - BoxCenter[Axis]) - BoxExtent[Axis], 0.f);
+		DistSquared += Delta * Delta;
+	}
+
+	return DistSquared <= Radius * Radius;
+}
+
+void FVaOceanQuadTree::BuildFrustum(const FVector& Origin, const FVector& Forward, const FVector& Right, const FVector& Up,
+	float HalfFOV, float AspectRatio, float FarDistance, TArray<FPlane>& OutFrustum)
+{
+	const float HalfFOVVertical = FMath::Atan(FMath::Tan(HalfFOV) / FMath::Max(AspectRatio, KINDA_SMALL_NUMBER));
+
+	float SinH, CosH, SinV, CosV;
+	FMath::SinCos(&SinH, &CosH, HalfFOV);
+	FMath::SinCos(&SinV, &CosV, HalfFOVVertical);
+
+	OutFrustum.Reset();
+	OutFrustum.Add(FPlane(Origin, Right * CosH + Forward * SinH));		// Left
+	OutFrustum.Add(FPlane(Origin, -Right * CosH + Forward * SinH));		// Right
+	OutFrustum.Add(FPlane(Origin, -Up * CosV + Forward * SinV));		// Top
+	OutFrustum.Add(FPlane(Origin, Up * CosV + Forward * SinV));			// Bottom
+	OutFrustum.Add(FPlane(Origin + Forward * FarDistance, -Forward));	// Far
+}
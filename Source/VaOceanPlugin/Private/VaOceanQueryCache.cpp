@@ -0,0 +1,227 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Query cache hits"), STAT_VaOceanQueryCacheHits, STATGROUP_VaOcean);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Query cache misses"), STAT_VaOceanQueryCacheMisses, STATGROUP_VaOcean);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Query cache bypasses"), STAT_VaOceanQueryCacheBypasses, STATGROUP_VaOcean);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Query cache hit rate %"), STAT_VaOceanQueryCacheHitRate, STATGROUP_VaOcean);
+
+/** Slot count of given number of tiles */
+static int32 GetSlotCount(int32 InTileCount)
+{
+	return FMath::RoundUpToPowerOfTwo(FMath::Max(InTileCount, QUERY_CACHE_MAX_PROBES));
+}
+
+FVaOceanQueryCache::FVaOceanQueryCache()
+	: Dim(0)
+	, TileSize(0)
+	, TileShift(0)
+	, TilesPerRow(0)
+	, SlotMask(0)
+	, SlotShift(0)
+	, SampleRowSize(0)
+	, SamplesPerTile(0)
+	, Tags(nullptr)
+	, Samples(nullptr)
+	, Generation(1)
+{
+}
+
+void FVaOceanQueryCache::Initialize(int32 InDim, int32 InTileSize, int32 InTileCount)
+{
+	check(FMath::IsPowerOfTwo(InDim));
+	check(FMath::IsPowerOfTwo(InTileSize) && InTileSize <= QUERY_CACHE_MAX_TILE_SIZE);
+
+	const int32 SlotCount = GetSlotCount(InTileCount);
+
+	Dim = InDim;
+	TileSize = FMath::Min(InTileSize, InDim);
+	TileShift = FMath::FloorLog2(TileSize);
+	TilesPerRow = Dim / TileSize;
+	SlotMask = SlotCount - 1;
+	SlotShift = 32 - FMath::FloorLog2(SlotCount);
+	SampleRowSize = TileSize + 1;
+	SamplesPerTile = SampleRowSize * SampleRowSize;
+
+	// Ready tags of generation 0, so all slots start stale
+	Arena.Reserve(GetArenaSize(TileSize, InTileCount));
+	Tags = (volatile int64*)Arena.Allocate(SlotCount * sizeof(int64));
+	Samples = (float*)Arena.Allocate(SlotCount * SamplesPerTile * sizeof(float));
+	for (int32 SlotIndex = 0; SlotIndex < SlotCount; SlotIndex++)
+	{
+		Tags[SlotIndex] = MakeTag(0, 0, true);
+	}
+
+	Generation = 1;
+	HitCount.Reset();
+	MissCount.Reset();
+	BypassCount.Reset();
+	LastStats = FVaOceanQueryCacheStats();
+}
+
+SIZE_T FVaOceanQueryCache::GetArenaSize(int32 InTileSize, int32 InTileCount)
+{
+	const SIZE_T SlotCount = GetSlotCount(InTileCount);
+	const SIZE_T SamplesPerTile = FMath::Square(InTileSize + 1);
+
+	return Align(SlotCount * sizeof(int64), CPU_ARENA_ALIGNMENT) + Align(SlotCount * SamplesPerTile * sizeof(float), CPU_ARENA_ALIGNMENT);
+}
+
+void FVaOceanQueryCache::Release()
+{
+	Dim = 0;
+	Tags = nullptr;
+	Samples = nullptr;
+	LastStats = FVaOceanQueryCacheStats();
+
+	Arena.Release();
+}
+
+bool FVaOceanQueryCache::IsInitialized() const
+{
+	return Dim > 0;
+}
+
+void FVaOceanQueryCache::Invalidate()
+{
+	LastStats.Hits = HitCount.Reset();
+	LastStats.Misses = MissCount.Reset();
+	LastStats.Bypasses = BypassCount.Reset();
+
+	// Readers still working with the old generation see their slots claimed and answer directly.
+	// Resolvers keep their slots until they're done writing samples, see SampleHeight.
+	FPlatformAtomics::InterlockedIncrement(&Generation);
+
+	SET_DWORD_STAT(STAT_VaOceanQueryCacheHits, LastStats.Hits);
+	SET_DWORD_STAT(STAT_VaOceanQueryCacheMisses, LastStats.Misses);
+	SET_DWORD_STAT(STAT_VaOceanQueryCacheBypasses, LastStats.Bypasses);
+	SET_FLOAT_STAT(STAT_VaOceanQueryCacheHitRate, LastStats.GetHitRate() * 100.f);
+}
+
+float FVaOceanQueryCache::SampleHeight(const FVector2D& UV, FResolveHeights Resolve) const
+{
+	check(IsInitialized());
+
+	// Texel centers are at (i + 0.5) / Dim, see FVaOceanCPUBackend::GetBilinearTaps
+	const float X = UV.X * Dim - 0.5f;
+	const float Y = UV.Y * Dim - 0.5f;
+	const float X0 = FMath::FloorToFloat(X);
+	const float Y0 = FMath::FloorToFloat(Y);
+	const int32 Mask = Dim - 1;
+	const int32 IX = (int32)X0 & Mask;
+	const int32 IY = (int32)Y0 & Mask;
+
+	const int32 TileX = IX >> TileShift;
+	const int32 TileY = IY >> TileShift;
+	const int32 TileKey = TileY * TilesPerRow + TileX;
+	const int32 LocalX = IX - (TileX << TileShift);
+	const int32 LocalY = IY - (TileY << TileShift);
+
+	const int32 CurrentGeneration = Generation;
+	const int64 ReadyTag = MakeTag(CurrentGeneration, TileKey, true);
+	const int64 ResolvingTag = MakeTag(CurrentGeneration, TileKey, false);
+
+	// Multiplicative hash spreads neighbour tiles of all rows over the table
+	const int32 FirstSlot = (int32)(((uint32)TileKey * 2654435761u) >> SlotShift);
+
+	for (int32 Probe = 0; Probe < QUERY_CACHE_MAX_PROBES;)
+	{
+		const int32 SlotIndex = (FirstSlot + Probe) & SlotMask;
+		const int64 Tag = Tags[SlotIndex];
+
+		if (Tag == ReadyTag)
+		{
+			FPlatformMisc::MemoryBarrier();
+			const float Height = SampleTile(SlotIndex, LocalX, LocalY, X - X0, Y - Y0);
+			FPlatformMisc::MemoryBarrier();
+
+			// Next generation could claim the slot while it was read
+			if (Tags[SlotIndex] == ReadyTag)
+			{
+				HitCount.Increment();
+				return Height;
+			}
+			break;
+		}
+
+		// Another thread resolves the tile right now, there is no point in waiting for it
+		if (Tag == ResolvingTag)
+		{
+			break;
+		}
+
+		// Resolved slots of older generations are free, the one that wins the race resolves the tile.
+		// Slot still resolved by an older generation is being written, and a newer generation's one is not ours to take.
+		if ((Tag & 1) && CurrentGeneration - (int32)(Tag >> 32) > 0)
+		{
+			if (FPlatformAtomics::InterlockedCompareExchange(&Tags[SlotIndex], ResolvingTag, Tag) != Tag)
+			{
+				// Slot was claimed meanwhile, look at it again
+				continue;
+			}
+
+			ResolveTile(SlotIndex, TileX, TileY, Resolve);
+
+			// Taken before publishing: once the tile is ready, the next generation may overwrite it
+			const float Height = SampleTile(SlotIndex, LocalX, LocalY, X - X0, Y - Y0);
+			FPlatformMisc::MemoryBarrier();
+
+			// Nobody else takes a slot while it's resolved, so publishing always succeeds
+			FPlatformAtomics::InterlockedExchange(&Tags[SlotIndex], ReadyTag);
+			MissCount.Increment();
+			return Height;
+		}
+
+		// Slot holds another tile, or is being written by a resolver of another generation
+		Probe++;
+	}
+
+	BypassCount.Increment();
+
+	float Height;
+	Resolve(&UV, 1, &Height);
+	return Height;
+}
+
+const FVaOceanQueryCacheStats& FVaOceanQueryCache::GetLastStats() const
+{
+	return LastStats;
+}
+
+int64 FVaOceanQueryCache::MakeTag(int32 InGeneration, int32 TileKey, bool bReady)
+{
+	return ((int64)InGeneration << 32) | ((int64)TileKey << 1) | (bReady ? 1 : 0);
+}
+
+void FVaOceanQueryCache::ResolveTile(int32 SlotIndex, int32 TileX, int32 TileY, FResolveHeights Resolve) const
+{
+	// Texel centers of the tile and its right and bottom neighbours, the last ones may wrap around the grid
+	TArray<FVector2D, TInlineAllocator<(QUERY_CACHE_MAX_TILE_SIZE + 1) * (QUERY_CACHE_MAX_TILE_SIZE + 1)>> UVs;
+	UVs.SetNumUninitialized(SamplesPerTile);
+
+	const float TexelSize = 1.f / Dim;
+	const int32 FirstX = TileX << TileShift;
+	const int32 FirstY = TileY << TileShift;
+
+	for (int32 y = 0; y < SampleRowSize; y++)
+	{
+		for (int32 x = 0; x < SampleRowSize; x++)
+		{
+			UVs[y * SampleRowSize + x] = FVector2D((FirstX + x + 0.5f) * TexelSize, (FirstY + y + 0.5f) * TexelSize);
+		}
+	}
+
+	Resolve(UVs.GetData(), SamplesPerTile, Samples + SlotIndex * SamplesPerTile);
+}
+
+float FVaOceanQueryCache::SampleTile(int32 SlotIndex, int32 LocalX, int32 LocalY, float TX, float TY) const
+{
+	const float* Tile = Samples + SlotIndex * SamplesPerTile + LocalY * SampleRowSize + LocalX;
+
+	// Same filter as FVaOceanBilinearTaps::Sample
+	const float Top = Tile[0] * (1.f - TX) + Tile[1] * TX;
+	const float Bottom = Tile[SampleRowSize] * (1.f - TX) + Tile[SampleRowSize + 1] * TX;
+
+	return Top * (1.f - TY) + Bottom * TY;
+}
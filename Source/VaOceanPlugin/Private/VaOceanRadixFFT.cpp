@@ -2,103 +2,159 @@
 
 #include "VaOceanPluginPrivatePCH.h"
 
+static TAutoConsoleVariable<int32> CVarVaOceanFFTPassPermutations(
+	TEXT("r.VaOcean.FFTPassPermutations"),
+	1,
+	TEXT("0: FFT passes read strides from uniform buffer (generic shaders)\n")
+	TEXT("1: FFT passes use permutations with compile-time strides (default)"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarVaOceanFFTPassTiming(
+	TEXT("r.VaOcean.FFTPassTiming"),
+	0,
+	TEXT("1: measure each FFT pass with GPU timestamps and log the average of every 64 transforms, for comparing\n")
+	TEXT("r.VaOcean.FFTPassPermutations values. Transforms on async compute are not measured."),
+	ECVF_RenderThreadSafe);
+
+#define RADIX_PASS_SHADERS(LogDim) \
+	{ \
+		&GetRadixPassShader<LogDim, 0>, &GetRadixPassShader<LogDim, 1>, &GetRadixPassShader<LogDim, 2>, &GetRadixPassShader<LogDim, 3>, \
+		&GetRadixPassShader<LogDim, 4>, &GetRadixPassShader<LogDim, 5>, &GetRadixPassShader<LogDim, 6>, &GetRadixPassShader<LogDim, 7> \
+	}
+
+/** Pass permutations of each transform size, indexed by log2(Dim) - 1 and pass */
+static const FRadixPassShaderGetter GRadixPassShaders[FFT_MAX_LOG_DIM][FFT_PARAM_SETS] =
+{
+	RADIX_PASS_SHADERS(1), RADIX_PASS_SHADERS(2), RADIX_PASS_SHADERS(3),
+	RADIX_PASS_SHADERS(4), RADIX_PASS_SHADERS(5), RADIX_PASS_SHADERS(6),
+	RADIX_PASS_SHADERS(7), RADIX_PASS_SHADERS(8), RADIX_PASS_SHADERS(9),
+};
+
+template<typename TRHICmdList>
 void Radix008A(
-	FRHICommandListImmediate & RHICmdList,
+	TRHICmdList& RHICmdList,
 	FRadixPlan512* Plan,
 	uint32 ParamSet,
+	bool bPassPermutations,
 	FUnorderedAccessViewRHIRef pUAV_Dst,
-	FShaderResourceViewRHIRef pSRV_Src,
-	uint32 ThreadCount,
-	uint32 istride)
+	FShaderResourceViewRHIRef pSRV_Src)
 {
-	check(ParamSet < FFT_PARAM_SETS);
+	check(ParamSet < Plan->PassCount);
 	const auto FeatureLevel = GMaxRHIFeatureLevel;
 	// Setup execution configuration
-	uint32 grid = ThreadCount / COHERENCY_GRANULARITY;
+	const FRadix008A_CSPerFrame& PerFrame = Plan->PerFrame[ParamSet];
+	uint32 grid = (PerFrame.ThreadCount + COHERENCY_GRANULARITY - 1) / COHERENCY_GRANULARITY;
+
+	// Strides are compiled into the pass, so only thread count and buffers are set
+	if (PerFrame.PassShader && bPassPermutations)
+	{
+		FRadixPassCS* RadixPassCS = PerFrame.PassShader(GetGlobalShaderMap(FeatureLevel));
+		RHICmdList.SetComputeShader(RadixPassCS->GetComputeShader());
+
+		RadixPassCS->SetParameters(RHICmdList, PerFrame.ThreadCount, pSRV_Src, pUAV_Dst);
+
+		RHICmdList.DispatchComputeShader(grid, 1, 1);
+
+		RadixPassCS->UnsetParameters(RHICmdList);
+		return;
+	}
 
 	FRadixFFTUniformParameters Parameters;
-	Parameters.ThreadCount = Plan->PerFrame[ParamSet].ThreadCount;
-	Parameters.ostride = Plan->PerFrame[ParamSet].ostride;
-	Parameters.istride = Plan->PerFrame[ParamSet].istride;
-	Parameters.pstride = Plan->PerFrame[ParamSet].pstride;
-	Parameters.PhaseBase = Plan->PerFrame[ParamSet].PhaseBase;
+	Parameters.ThreadCount = PerFrame.ThreadCount;
+	Parameters.ostride = PerFrame.ostride;
+	Parameters.istride = PerFrame.istride;
+	Parameters.pstride = PerFrame.pstride;
+	Parameters.PhaseBase = PerFrame.PhaseBase;
 
 	FRadixFFTUniformBufferRef UniformBuffer =
 		FRadixFFTUniformBufferRef::CreateUniformBufferImmediate(Parameters, EUniformBufferUsage::UniformBuffer_SingleFrame);
 
-	if (istride > 1)
+	if (PerFrame.Radix == FFT_RADIX_2)
 	{
-		TShaderMapRef<FRadix008A_CS> Radix008A_CS(GetGlobalShaderMap(FeatureLevel));
-		RHICmdList.SetComputeShader(Radix008A_CS->GetComputeShader());
+		TShaderMapRef<FRadix002A_CS> Radix002A_CS(GetGlobalShaderMap(FeatureLevel));
+		RHICmdList.SetComputeShader(Radix002A_CS->GetComputeShader());
 
-		Radix008A_CS->SetParameters(RHICmdList, UniformBuffer);
-		Radix008A_CS->SetParameters(RHICmdList, pSRV_Src, pUAV_Dst);
+		Radix002A_CS->SetParameters(RHICmdList, UniformBuffer);
+		Radix002A_CS->SetParameters(RHICmdList, pSRV_Src, pUAV_Dst);
 
 		RHICmdList.DispatchComputeShader(grid, 1, 1);
 
-		Radix008A_CS->UnsetParameters(RHICmdList);
+		Radix002A_CS->UnsetParameters(RHICmdList);
 	}
 	else
 	{
-		TShaderMapRef<FRadix008A_CS2> Radix008A_CS2(GetGlobalShaderMap(FeatureLevel));
-		RHICmdList.SetComputeShader(Radix008A_CS2->GetComputeShader());
+		TShaderMapRef<FRadix008A_CS> Radix008A_CS(GetGlobalShaderMap(FeatureLevel));
+		RHICmdList.SetComputeShader(Radix008A_CS->GetComputeShader());
 
-		Radix008A_CS2->SetParameters(RHICmdList, UniformBuffer);
-		Radix008A_CS2->SetParameters(RHICmdList, pSRV_Src, pUAV_Dst);
+		Radix008A_CS->SetParameters(RHICmdList, UniformBuffer);
+		Radix008A_CS->SetParameters(RHICmdList, pSRV_Src, pUAV_Dst);
 
 		RHICmdList.DispatchComputeShader(grid, 1, 1);
 
-		Radix008A_CS2->UnsetParameters(RHICmdList);
+		Radix008A_CS->UnsetParameters(RHICmdList);
 	}
 }
 
-void RadixSetPerFrameParams(FRadixPlan512* Plan,
-	uint32 ParamSet,
-	uint32 ThreadCount,
-	uint32 ostride,
-	uint32 istride,
-	uint32 pstride,
-	float PhaseBase)
+uint32 RadixGetPasses(uint32 Dim, uint32 Slices, FRadix008A_CSPerFrame* OutPasses)
 {
-	check(ParamSet < FFT_PARAM_SETS);
+	check(FMath::IsPowerOfTwo(Dim) && Dim >= 2 && Dim <= (1 << FFT_MAX_LOG_DIM));
 
-	Plan->PerFrame[ParamSet].ThreadCount = ThreadCount;
-	Plan->PerFrame[ParamSet].ostride = ostride;
-	Plan->PerFrame[ParamSet].istride = istride;
-	Plan->PerFrame[ParamSet].pstride = pstride;
-	Plan->PerFrame[ParamSet].PhaseBase = PhaseBase;
-}
-
-void RadixCreatePlan(FRadixPlan512* Plan, uint32 Slices)
-{
-	Plan->Slices = Slices;
-
-	// Create 6 param sets for 512x512 transform
-	const uint32 thread_count = Plan->Slices * (512 * 512) / 8;
-	uint32 ostride = 512 * 512 / 8;
-	uint32 istride = ostride;
-	uint32 pstride = 512;
-	double phase_base = -TWO_PI / (512.0 * 512.0);
-
-	RadixSetPerFrameParams(Plan, 0, thread_count, ostride, istride, pstride, (float)phase_base);
+	// Radix-8 passes first, then radix-2 ones for the remainder (at most two of them)
+	uint32 radices[FFT_PARAM_SETS / 2];
+	uint32 radix_count = 0;
+	for (uint32 n = Dim; n > 1; radix_count++)
+	{
+		radices[radix_count] = (n % 8 == 0) ? FFT_RADIX_8 : FFT_RADIX_2;
+		n /= radices[radix_count];
+	}
 
-	for (int i = 1; i < FFT_PARAM_SETS; i++)
+	// Columns are transformed first: the whole row is one element of size Dim (pstride), then rows.
+	// For 512x512 config it gives 6 param sets of radix 8.
+	uint32 pass_count = 0;
+	for (uint32 dimension = 0; dimension < 2; dimension++)
 	{
-		istride /= 8;
-		phase_base *= 8.0;
+		const uint32 size = (dimension == 0) ? Dim * Dim : Dim;
+		const uint32 pstride = (dimension == 0) ? Dim : 1;
+		uint32 istride = size;
 
-		if (i == 3)
+		for (uint32 i = 0; i < radix_count; i++)
 		{
-			ostride /= 512;
-			pstride = 1;
+			const uint32 radix = radices[i];
+			istride /= radix;
+
+			FRadix008A_CSPerFrame& Pass = OutPasses[pass_count++];
+			Pass.ThreadCount = Slices * (Dim * Dim) / radix;
+			Pass.ostride = size / radix;
+			Pass.istride = istride;
+			Pass.pstride = pstride;
+			Pass.PhaseBase = (float)(-TWO_PI / ((double)istride * radix));
+			Pass.Radix = radix;
+			Pass.PassShader = nullptr;
 		}
+	}
 
-		RadixSetPerFrameParams(Plan, i, thread_count, ostride, istride, pstride, (float)phase_base);
+	return pass_count;
+}
+
+void RadixCreatePlan(FRadixPlan512* Plan, uint32 Slices, uint32 Dim)
+{
+	Plan->Slices = Slices;
+	Plan->Dim = Dim;
+	Plan->PassCount = RadixGetPasses(Dim, Slices, Plan->PerFrame);
+	Plan->bTimingPending = false;
+	Plan->TimingFrames = 0;
+	FMemory::Memzero(Plan->TimingSums);
+
+	// Each pass of each size has its own permutation
+	const uint32 LogDim = FMath::FloorLog2(Dim);
+	for (uint32 i = 0; i < Plan->PassCount; i++)
+	{
+		Plan->PerFrame[i].PassShader = GRadixPassShaders[LogDim - 1][i];
 	}
 	
 	// Temp buffers
 	uint32 BytesPerElement = sizeof(float) * 2;
-	uint32 NumElements = (512 * Plan->Slices) * 512;
+	uint32 NumElements = (Dim * Plan->Slices) * Dim;
 
 	FRHIResourceCreateInfo ResourceCreateInfo;
 	ResourceCreateInfo.BulkData = nullptr;
@@ -114,36 +170,207 @@ void RadixDestroyPlan(FRadixPlan512* Plan)
 	Plan->pBuffer_Tmp.SafeRelease();
 	Plan->pUAV_Tmp.SafeRelease();
 	Plan->pSRV_Tmp.SafeRelease();
+
+	for (FRenderQueryRHIRef& Query : Plan->TimingQueries)
+	{
+		Query.SafeRelease();
+	}
+	Plan->bTimingPending = false;
+}
+
+void RadixPrewarmShaders(TShaderMap<FGlobalShaderType>* ShaderMap)
+{
+	FRadix008A_CSPerFrame Passes[FFT_PARAM_SETS];
+
+	for (uint32 LogDim = 1; LogDim <= FFT_MAX_LOG_DIM; LogDim++)
+	{
+		const uint32 PassCount = RadixGetPasses(1 << LogDim, 1, Passes);
+		for (uint32 i = 0; i < PassCount; i++)
+		{
+			GRadixPassShaders[LogDim - 1][i](ShaderMap)->GetComputeShader();
+		}
+	}
+}
+
+/** Read back timestamps of the previous timed transform, if GPU is done with it, and log averages of the finished series */
+static void RadixGatherTiming(FRadixPlan512* Plan)
+{
+	if (!Plan->bTimingPending)
+	{
+		return;
+	}
+
+	uint64 Timestamps[FFT_PARAM_SETS + 1];
+	for (uint32 i = 0; i <= Plan->PassCount; i++)
+	{
+		if (!RHIGetRenderQueryResult(Plan->TimingQueries[i], Timestamps[i], false))
+		{
+			return;
+		}
+	}
+
+	Plan->bTimingPending = false;
+	for (uint32 i = 0; i < Plan->PassCount; i++)
+	{
+		Plan->TimingSums[i] += Timestamps[i + 1] - Timestamps[i];
+	}
+
+	if (++Plan->TimingFrames < FFT_TIMING_FRAMES)
+	{
+		return;
+	}
+
+	FString Passes;
+	uint64 Total = 0;
+	for (uint32 i = 0; i < Plan->PassCount; i++)
+	{
+		Passes += FString::Printf(TEXT(" %.1f"), (float)Plan->TimingSums[i] / Plan->TimingFrames);
+		Total += Plan->TimingSums[i];
+	}
+
+	UE_LOG(LogVaOcean, Log, TEXT("FFT %dx%d, %d slices, FFTPassPermutations %d: passes (us)%s, total %.1f us"),
+		Plan->Dim, Plan->Dim, Plan->Slices, CVarVaOceanFFTPassPermutations.GetValueOnRenderThread(), *Passes, (float)Total / Plan->TimingFrames);
+
+	FMemory::Memzero(Plan->TimingSums);
+	Plan->TimingFrames = 0;
+}
+
+/** Timestamp queries exist on graphics command list only */
+static bool RadixBeginTiming(FRHICommandListImmediate& RHICmdList, FRadixPlan512* Plan)
+{
+	if (CVarVaOceanFFTPassTiming.GetValueOnRenderThread() == 0)
+	{
+		return false;
+	}
+
+	// One transform is timed at a time, the ones in between are skipped until its results are back
+	RadixGatherTiming(Plan);
+	if (Plan->bTimingPending)
+	{
+		return false;
+	}
+
+	for (uint32 i = 0; i <= Plan->PassCount; i++)
+	{
+		if (!Plan->TimingQueries[i].IsValid())
+		{
+			Plan->TimingQueries[i] = RHICreateRenderQuery(RQT_AbsoluteTime);
+		}
+	}
+
+	RHICmdList.EndRenderQuery(Plan->TimingQueries[0]);
+	return true;
+}
+
+static bool RadixBeginTiming(FRHIAsyncComputeCommandListImmediate& RHICmdList, FRadixPlan512* Plan)
+{
+	return false;
+}
+
+static void RadixEndPassTiming(FRHICommandListImmediate& RHICmdList, FRadixPlan512* Plan, uint32 Pass)
+{
+	RHICmdList.EndRenderQuery(Plan->TimingQueries[Pass + 1]);
+	Plan->bTimingPending = (Pass + 1 == Plan->PassCount);
+}
+
+static void RadixEndPassTiming(FRHIAsyncComputeCommandListImmediate& RHICmdList, FRadixPlan512* Plan, uint32 Pass)
+{
+}
+
+/** Ping-pong between temp and destination buffers: Src -> Tmp -> Dst -> Tmp -> ... -> Dst */
+template<typename TRHICmdList>
+static void RadixPass(
+	TRHICmdList& RHICmdList,
+	FRadixPlan512* Plan,
+	uint32 Pass,
+	bool bPassPermutations,
+	FUnorderedAccessViewRHIRef pUAV_Dst,
+	FShaderResourceViewRHIRef pSRV_Dst,
+	FShaderResourceViewRHIRef pSRV_Src)
+{
+	if (Pass % 2 == 0)
+	{
+		Radix008A(RHICmdList, Plan, Pass, bPassPermutations, Plan->pUAV_Tmp, (Pass == 0) ? pSRV_Src : pSRV_Dst);
+	}
+	else
+	{
+		Radix008A(RHICmdList, Plan, Pass, bPassPermutations, pUAV_Dst, Plan->pSRV_Tmp);
+	}
 }
 
+template<typename TRHICmdList>
 void RadixCompute(
-	FRHICommandListImmediate& RHICmdList,
+	TRHICmdList& RHICmdList,
 	FRadixPlan512* Plan,
 	FUnorderedAccessViewRHIRef pUAV_Dst,
 	FShaderResourceViewRHIRef pSRV_Dst,
 	FShaderResourceViewRHIRef pSRV_Src)
 {
-	const uint32 thread_count = Plan->Slices * (512 * 512) / 8;
-	uint32 istride = 512 * 512;
+	const bool bPassPermutations = CVarVaOceanFFTPassPermutations.GetValueOnRenderThread() != 0;
+	const bool bTiming = RadixBeginTiming(RHICmdList, Plan);
 
-	FUnorderedAccessViewRHIRef pUAV_Tmp = Plan->pUAV_Tmp;
-	FShaderResourceViewRHIRef pSRV_Tmp = Plan->pSRV_Tmp;
+	for (uint32 i = 0; i < Plan->PassCount; i++)
+	{
+		RadixPass(RHICmdList, Plan, i, bPassPermutations, pUAV_Dst, pSRV_Dst, pSRV_Src);
+
+		if (bTiming)
+		{
+			RadixEndPassTiming(RHICmdList, Plan, i);
+		}
+	}
+}
+
+template void RadixCompute<FRHICommandListImmediate>(FRHICommandListImmediate&, FRadixPlan512*, FUnorderedAccessViewRHIRef, FShaderResourceViewRHIRef, FShaderResourceViewRHIRef);
+template void RadixCompute<FRHIAsyncComputeCommandListImmediate>(FRHIAsyncComputeCommandListImmediate&, FRadixPlan512*, FUnorderedAccessViewRHIRef, FShaderResourceViewRHIRef, FShaderResourceViewRHIRef);
+
+void RadixMeasurePasses(
+	FRHICommandListImmediate& RHICmdList,
+	FRadixPlan512* Plan,
+	bool bPassPermutations,
+	uint32 Iterations,
+	FUnorderedAccessViewRHIRef pUAV_Dst,
+	FShaderResourceViewRHIRef pSRV_Dst,
+	FShaderResourceViewRHIRef pSRV_Src,
+	float* OutPassMicroseconds)
+{
+	FRenderQueryRHIRef Queries[FFT_PARAM_SETS + 1];
+	for (uint32 i = 0; i <= Plan->PassCount; i++)
+	{
+		Queries[i] = RHICreateRenderQuery(RQT_AbsoluteTime);
+	}
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 0, pUAV_Tmp, pSRV_Src, thread_count, istride);
+	uint64 Sums[FFT_PARAM_SETS] = { 0 };
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 1, pUAV_Dst, pSRV_Tmp, thread_count, istride);
+	// The first transform isn't counted, it pays for shader and buffer first use
+	for (uint32 Iteration = 0; Iteration <= Iterations; Iteration++)
+	{
+		RHICmdList.EndRenderQuery(Queries[0]);
+		for (uint32 i = 0; i < Plan->PassCount; i++)
+		{
+			RadixPass(RHICmdList, Plan, i, bPassPermutations, pUAV_Dst, pSRV_Dst, pSRV_Src);
+			RHICmdList.EndRenderQuery(Queries[i + 1]);
+		}
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 2, pUAV_Tmp, pSRV_Dst, thread_count, istride);
+		// Each transform is waited for, so passes of neighbour transforms don't overlap
+		RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 3, pUAV_Dst, pSRV_Tmp, thread_count, istride);
+		uint64 Timestamps[FFT_PARAM_SETS + 1];
+		for (uint32 i = 0; i <= Plan->PassCount; i++)
+		{
+			RHIGetRenderQueryResult(Queries[i], Timestamps[i], true);
+		}
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 4, pUAV_Tmp, pSRV_Dst, thread_count, istride);
+		if (Iteration > 0)
+		{
+			for (uint32 i = 0; i < Plan->PassCount; i++)
+			{
+				Sums[i] += Timestamps[i + 1] - Timestamps[i];
+			}
+		}
+	}
 
-	istride /= 8;
-	Radix008A(RHICmdList, Plan, 5, pUAV_Dst, pSRV_Tmp, thread_count, istride);
+	for (uint32 i = 0; i < Plan->PassCount; i++)
+	{
+		OutPassMicroseconds[i] = (float)Sums[i] / FMath::Max(Iterations, 1u);
+	}
 }
@@ -0,0 +1,178 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+/** Bisection steps used to refine crossing */
+#define RAYCAST_REFINE_ITERATIONS 8
+
+/** Fine march steps taken over one displacement texel */
+#define RAYCAST_STEPS_PER_TEXEL 2
+
+/** Minimal horizontal part of direction used to compute step along steep rays */
+#define RAYCAST_MIN_HORIZONTAL 0.1f
+
+FVaOceanRayCaster::FVaOceanRayCaster(const FVaOceanCPUBackend& InBackend, float InPatchLength, float InSeaLevel)
+	: Backend(InBackend)
+	, PatchLength(InPatchLength)
+	, SeaLevel(InSeaLevel)
+{
+	const int32 Dim = FMath::Max(Backend.GetDimension(), 1);
+	TexelSize = PatchLength / Dim;
+	TileSize = TexelSize * FMath::Min(BOUNDS_TILE_SIZE, Dim);
+}
+
+void FVaOceanRayCaster::RaycastBatch(const TArray<FVaOceanRay>& Rays, TArray<FVaOceanRayHit>& OutHits) const
+{
+	OutHits.SetNumUninitialized(Rays.Num());
+
+	const int32 BatchCount = (Rays.Num() + RAYCAST_BATCH_SIZE - 1) / RAYCAST_BATCH_SIZE;
+	VaOceanParallelFor(BatchCount, [&](int32 Batch)
+	{
+		const int32 First = Batch * RAYCAST_BATCH_SIZE;
+		const int32 Last = FMath::Min(First + RAYCAST_BATCH_SIZE, Rays.Num());
+
+		for (int32 i = First; i < Last; i++)
+		{
+			Raycast(Rays[i], OutHits[i]);
+		}
+	});
+}
+
+bool FVaOceanRayCaster::Raycast(const FVaOceanRay& Ray, FVaOceanRayHit& OutHit) const
+{
+	OutHit.bHit = false;
+	OutHit.Distance = Ray.MaxDistance;
+	OutHit.Location = Ray.Origin + Ray.Direction * Ray.MaxDistance;
+
+	if (!Backend.IsInitialized())
+	{
+		return false;
+	}
+
+	// Clip the ray to the slab occupied by the surface
+	const FVaOceanTileBounds GlobalBounds = Backend.GetGlobalBounds();
+	const float SlabMin = SeaLevel + GlobalBounds.MinHeight;
+	const float SlabMax = SeaLevel + GlobalBounds.MaxHeight;
+
+	float TMin = 0.f;
+	float TMax = Ray.MaxDistance;
+	if (FMath::Abs(Ray.Direction.Z) > SMALL_NUMBER)
+	{
+		float T0 = (SlabMin - Ray.Origin.Z) / Ray.Direction.Z;
+		float T1 = (SlabMax - Ray.Origin.Z) / Ray.Direction.Z;
+		if (T0 > T1)
+		{
+			Swap(T0, T1);
+		}
+
+		TMin = FMath::Max(TMin, T0);
+		TMax = FMath::Min(TMax, T1);
+	}
+	else if (Ray.Origin.Z < SlabMin || Ray.Origin.Z > SlabMax)
+	{
+		return false;
+	}
+
+	if (TMin > TMax)
+	{
+		return false;
+	}
+
+	// Steps are measured along the surface, so steep rays don't take tiny steps
+	const float HorizontalScale = 1.f / FMath::Max(FVector2D(Ray.Direction.X, Ray.Direction.Y).Size(), RAYCAST_MIN_HORIZONTAL);
+	const float CoarseStep = TileSize * HorizontalScale;
+	const float FineStep = TexelSize * HorizontalScale / RAYCAST_STEPS_PER_TEXEL;
+
+	// Crossing is detected by sign change, so rays from under water hit the surface too
+	float PrevT = TMin;
+	const bool bStartAbove = GetHeightAboveSurface(Ray.Origin + Ray.Direction * PrevT) >= 0.f;
+
+	// Both marches are driven by step indices: accumulated T stops advancing on long rays once the step is below float precision
+	const int32 SegmentCount = FMath::CeilToInt(FMath::Min((TMax - TMin) / CoarseStep, (float)MAX_int32 - 1.f));
+	const int32 FineStepCount = FMath::Max(FMath::CeilToInt(CoarseStep / FineStep), 1);
+
+	for (int32 Segment = 0; Segment < SegmentCount; Segment++)
+	{
+		const float SegmentStart = TMin + Segment * CoarseStep;
+		const float SegmentEnd = (Segment == SegmentCount - 1) ? TMax : FMath::Min(TMin + (Segment + 1) * CoarseStep, TMax);
+		const FVector Start = Ray.Origin + Ray.Direction * SegmentStart;
+		const FVector End = Ray.Origin + Ray.Direction * SegmentEnd;
+
+		// Skip segments that can't touch the surface
+		float MinHeight, MaxHeight;
+		GetSegmentBounds(Start, End, MinHeight, MaxHeight);
+
+		const float SegmentMinZ = FMath::Min(Start.Z, End.Z);
+		const float SegmentMaxZ = FMath::Max(Start.Z, End.Z);
+		if ((bStartAbove && SegmentMinZ > MaxHeight) || (!bStartAbove && SegmentMaxZ < MinHeight))
+		{
+			PrevT = SegmentEnd;
+			continue;
+		}
+
+		// Fine march inside the segment
+		for (int32 Step = 1; Step <= FineStepCount; Step++)
+		{
+			const float T = (Step == FineStepCount) ? SegmentEnd : FMath::Min(SegmentStart + Step * FineStep, SegmentEnd);
+
+			if ((GetHeightAboveSurface(Ray.Origin + Ray.Direction * T) >= 0.f) != bStartAbove)
+			{
+				// Refine crossing between PrevT and T
+				float A = PrevT;
+				float B = T;
+				for (int32 Iteration = 0; Iteration < RAYCAST_REFINE_ITERATIONS; Iteration++)
+				{
+					const float Mid = (A + B) * 0.5f;
+					if ((GetHeightAboveSurface(Ray.Origin + Ray.Direction * Mid) >= 0.f) == bStartAbove)
+					{
+						A = Mid;
+					}
+					else
+					{
+						B = Mid;
+					}
+				}
+
+				OutHit.bHit = true;
+				OutHit.Distance = (A + B) * 0.5f;
+				OutHit.Location = Ray.Origin + Ray.Direction * OutHit.Distance;
+				return true;
+			}
+
+			PrevT = T;
+
+			if (T >= SegmentEnd)
+			{
+				break;
+			}
+		}
+	}
+
+	return false;
+}
+
+float FVaOceanRayCaster::GetHeightAt(const FVector2D& WorldXY) const
+{
+	return SeaLevel + Backend.SampleHeight(WorldXY / PatchLength);
+}
+
+float FVaOceanRayCaster::GetHeightAboveSurface(const FVector& Point) const
+{
+	return Point.Z - GetHeightAt(FVector2D(Point.X, Point.Y));
+}
+
+void FVaOceanRayCaster::GetSegmentBounds(const FVector& Start, const FVector& End, float& OutMinHeight, float& OutMaxHeight) const
+{
+	const FVaOceanTileBounds GlobalBounds = Backend.GetGlobalBounds();
+
+	// Surface over the segment can come from texels moved in horizontally
+	const FVector2D Padding(GlobalBounds.MaxAbsX, GlobalBounds.MaxAbsY);
+	const FVector2D WorldMin(FMath::Min(Start.X, End.X), FMath::Min(Start.Y, End.Y));
+	const FVector2D WorldMax(FMath::Max(Start.X, End.X), FMath::Max(Start.Y, End.Y));
+
+	const FVaOceanTileBounds Bounds = Backend.GetBounds((WorldMin - Padding) / PatchLength, (WorldMax + Padding) / PatchLength);
+
+	OutMinHeight = SeaLevel + Bounds.MinHeight;
+	OutMaxHeight = SeaLevel + Bounds.MaxHeight;
+}
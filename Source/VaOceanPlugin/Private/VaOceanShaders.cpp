@@ -3,13 +3,92 @@
 #include "VaOceanPluginPrivatePCH.h"
 
 IMPLEMENT_SHADER_TYPE(, FUpdateSpectrumCS, TEXT("VaOcean_CS"), TEXT("UpdateSpectrumCS"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FBuildBoundsCS, TEXT("VaOcean_CS"), TEXT("BuildBoundsCS"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FReduceBoundsCS, TEXT("VaOcean_CS"), TEXT("ReduceBoundsCS"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FCompactSpawnListCS, TEXT("VaOcean_CS"), TEXT("CompactSpawnListCS"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FFinalizeSpawnArgsCS, TEXT("VaOcean_CS"), TEXT("FinalizeSpawnArgsCS"), SF_Compute);
 IMPLEMENT_SHADER_TYPE(, FRadix008A_CS, TEXT("VaOcean_FFT"), TEXT("Radix008A_CS"), SF_Compute);
-IMPLEMENT_SHADER_TYPE(, FRadix008A_CS2, TEXT("VaOcean_FFT"), TEXT("Radix008A_CS2"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FRadix002A_CS, TEXT("VaOcean_FFT"), TEXT("Radix002A_CS"), SF_Compute);
+
+#define IMPLEMENT_RADIX_PASS_SHADER(LogDim, Pass) \
+	typedef TRadixPassCS<LogDim, Pass> TRadixPassCS##LogDim##_##Pass; \
+	IMPLEMENT_SHADER_TYPE(template<>, TRadixPassCS##LogDim##_##Pass, TEXT("VaOcean_FFT"), TEXT("RadixPassCS"), SF_Compute);
+
+#define IMPLEMENT_RADIX_PASS_SHADERS(LogDim) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 0) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 1) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 2) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 3) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 4) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 5) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 6) \
+	IMPLEMENT_RADIX_PASS_SHADER(LogDim, 7)
+
+IMPLEMENT_RADIX_PASS_SHADERS(1)
+IMPLEMENT_RADIX_PASS_SHADERS(2)
+IMPLEMENT_RADIX_PASS_SHADERS(3)
+IMPLEMENT_RADIX_PASS_SHADERS(4)
+IMPLEMENT_RADIX_PASS_SHADERS(5)
+IMPLEMENT_RADIX_PASS_SHADERS(6)
+IMPLEMENT_RADIX_PASS_SHADERS(7)
+IMPLEMENT_RADIX_PASS_SHADERS(8)
+IMPLEMENT_RADIX_PASS_SHADERS(9)
 
 IMPLEMENT_SHADER_TYPE(, FQuadVS, TEXT("VaOcean_VS_PS"), TEXT("QuadVS"), SF_Vertex);
 IMPLEMENT_SHADER_TYPE(, FUpdateDisplacementPS, TEXT("VaOcean_VS_PS"), TEXT("UpdateDisplacementPS"), SF_Pixel);
+IMPLEMENT_SHADER_TYPE(, FUpdateVelocityPS, TEXT("VaOcean_VS_PS"), TEXT("UpdateVelocityPS"), SF_Pixel);
+IMPLEMENT_SHADER_TYPE(, FGerstnerDisplacementPS, TEXT("VaOcean_VS_PS"), TEXT("GerstnerDisplacementPS"), SF_Pixel);
+IMPLEMENT_SHADER_TYPE(, FGerstnerVelocityPS, TEXT("VaOcean_VS_PS"), TEXT("GerstnerVelocityPS"), SF_Pixel);
 IMPLEMENT_SHADER_TYPE(, FGenGradientFoldingPS, TEXT("VaOcean_VS_PS"), TEXT("GenGradientFoldingPS"), SF_Pixel);
+IMPLEMENT_SHADER_TYPE(, FGenGradientFoldingMipPS, TEXT("VaOcean_VS_PS"), TEXT("GenGradientFoldingMipPS"), SF_Pixel);
+
+IMPLEMENT_SHADER_TYPE(, FWakeStepCS, TEXT("VaOcean_CS"), TEXT("WakeStepCS"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FWakeGradientPS, TEXT("VaOcean_VS_PS"), TEXT("WakeGradientPS"), SF_Pixel);
 
 IMPLEMENT_UNIFORM_BUFFER_STRUCT(FUpdateSpectrumUniformParameters, TEXT("PerFrameSp"));
 IMPLEMENT_UNIFORM_BUFFER_STRUCT(FUpdateDisplacementUniformParameters, TEXT("PerFrameDisp"));
 IMPLEMENT_UNIFORM_BUFFER_STRUCT(FRadixFFTUniformParameters, TEXT("PerFrameFFT"));
+
+void PrewarmOceanShaders(TShaderMap<FGlobalShaderType>* ShaderMap)
+{
+	check(IsInRenderingThread());
+
+	TShaderMapRef<FUpdateSpectrumCS> UpdateSpectrumCS(ShaderMap);
+	TShaderMapRef<FBuildBoundsCS> BuildBoundsCS(ShaderMap);
+	TShaderMapRef<FReduceBoundsCS> ReduceBoundsCS(ShaderMap);
+	TShaderMapRef<FCompactSpawnListCS> CompactSpawnListCS(ShaderMap);
+	TShaderMapRef<FFinalizeSpawnArgsCS> FinalizeSpawnArgsCS(ShaderMap);
+	TShaderMapRef<FRadix008A_CS> Radix008A_CS(ShaderMap);
+	TShaderMapRef<FRadix002A_CS> Radix002A_CS(ShaderMap);
+
+	UpdateSpectrumCS->GetComputeShader();
+	BuildBoundsCS->GetComputeShader();
+	ReduceBoundsCS->GetComputeShader();
+	CompactSpawnListCS->GetComputeShader();
+	FinalizeSpawnArgsCS->GetComputeShader();
+	Radix008A_CS->GetComputeShader();
+	Radix002A_CS->GetComputeShader();
+	RadixPrewarmShaders(ShaderMap);
+
+	TShaderMapRef<FWakeStepCS> WakeStepCS(ShaderMap);
+	WakeStepCS->GetComputeShader();
+
+	TShaderMapRef<FQuadVS> QuadVS(ShaderMap);
+	TShaderMapRef<FUpdateDisplacementPS> UpdateDisplacementPS(ShaderMap);
+	TShaderMapRef<FUpdateVelocityPS> UpdateVelocityPS(ShaderMap);
+	TShaderMapRef<FGerstnerDisplacementPS> GerstnerDisplacementPS(ShaderMap);
+	TShaderMapRef<FGerstnerVelocityPS> GerstnerVelocityPS(ShaderMap);
+	TShaderMapRef<FGenGradientFoldingPS> GenGradientFoldingPS(ShaderMap);
+	TShaderMapRef<FGenGradientFoldingMipPS> GenGradientFoldingMipPS(ShaderMap);
+
+	QuadVS->GetVertexShader();
+	UpdateDisplacementPS->GetPixelShader();
+	UpdateVelocityPS->GetPixelShader();
+	GerstnerDisplacementPS->GetPixelShader();
+	GerstnerVelocityPS->GetPixelShader();
+	GenGradientFoldingPS->GetPixelShader();
+	GenGradientFoldingMipPS->GetPixelShader();
+
+	TShaderMapRef<FWakeGradientPS> WakeGradientPS(ShaderMap);
+	WakeGradientPS->GetPixelShader();
+}
@@ -1,6 +1,8 @@
 // Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
 
 #include "VaOceanPluginPrivatePCH.h"
+#include "UnrealNetwork.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
 
 #define HALF_SQRT_2	0.7071068f
 #define GRAV_ACCEL	981.0f	// The acceleration of gravity, cm/s^2
@@ -8,6 +10,10 @@
 #define BLOCK_SIZE_X 16
 #define BLOCK_SIZE_Y 16
 
+#define DISPLACEMENT_BOUND_SIGMA 4.0f	// Displacement is gaussian, so 4 sigma covers practically everything
+
+#define POINT_QUERY_FFT_COST 8.0f	// CPU grid FFT step costs about as many point wave evaluations per N^2 * log2(N)
+
 /** Vertex declaration for the fullscreen 2D quad */
 TGlobalResource<FQuadVertexDeclaration> GQuadVertexDeclaration;
 
@@ -16,10 +22,10 @@ TGlobalResource<FQuadVertexDeclaration> GQuadVertexDeclaration;
 // Height map generation helpers
 
 /** Generating gaussian random number with mean 0 and standard deviation 1 */
-float Gauss()
+float Gauss(FRandomStream& Stream)
 {
-	float u1 = rand() / (float)RAND_MAX;
-	float u2 = rand() / (float)RAND_MAX;
+	float u1 = Stream.GetFraction();
+	float u2 = Stream.GetFraction();
 
 	if (u1 < 1e-6f)
 	{
@@ -56,6 +62,49 @@ float Phillips(FVector2D K, FVector2D W, float v, float a, float dir_depend)
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+// Simulation chain helpers
+
+/** H(0) -> H(t), D(x, t), D(y, t) -> FFT. Recorded on graphics or async compute command list. */
+template<typename TRHICmdList>
+void DispatchSpectrumFFT(TRHICmdList& RHICmdList, const FUpdateSpectrumCSImmutable& ImmutableParams, const FUpdateSpectrumCSPerFrame& PerFrameParams, FRadixPlan512* pPlan)
+{
+	FUpdateSpectrumUniformParameters Parameters;
+	Parameters.Time = PerFrameParams.g_Time;
+	Parameters.TimeScale = PerFrameParams.g_TimeScale;
+	Parameters.SpectrumBlend = PerFrameParams.g_SpectrumBlend;
+
+	FUpdateSpectrumUniformBufferRef UniformBuffer = 
+		FUpdateSpectrumUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+
+	TShaderMapRef<FUpdateSpectrumCS> UpdateSpectrumCS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	RHICmdList.SetComputeShader(UpdateSpectrumCS->GetComputeShader());
+
+	UpdateSpectrumCS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
+		ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
+		ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset, ImmutableParams.g_VelocityAddressOffset);
+	UpdateSpectrumCS->SetBandLimitParameters(RHICmdList, ImmutableParams.g_SpectrumOffset, ImmutableParams.g_SpectrumShift);
+
+	// Texels outside of the energy-bearing region were cleared when the band was set
+	uint32 region_offset, region_size;
+	GetSpectrumBandRegion(ImmutableParams.g_OutWidth, PerFrameParams.g_BandRadius, region_offset, region_size);
+	UpdateSpectrumCS->SetRegionParameters(RHICmdList, region_offset, region_size);
+
+	UpdateSpectrumCS->SetParameters(RHICmdList, UniformBuffer, PerFrameParams.m_pSRV_H0, PerFrameParams.m_pSRV_Omega, PerFrameParams.m_pSRV_H0Target);
+	UpdateSpectrumCS->SetOutput(RHICmdList, PerFrameParams.m_pUAV_Ht);
+
+	uint32 group_count_x = (region_size + BLOCK_SIZE_X - 1) / BLOCK_SIZE_X;
+	uint32 group_count_y = (region_size + BLOCK_SIZE_Y - 1) / BLOCK_SIZE_Y;
+	RHICmdList.DispatchComputeShader(group_count_x, group_count_y, 1);
+
+	UpdateSpectrumCS->UnsetParameters(RHICmdList);
+	UpdateSpectrumCS->UnbindBuffers(RHICmdList);
+
+	// Perform FFT
+	RadixCompute(RHICmdList, pPlan, PerFrameParams.m_pUAV_Dxyz, PerFrameParams.m_pSRV_Dxyz, PerFrameParams.m_pSRV_Ht);
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 // Phillips spectrum simulator
 
@@ -67,7 +116,65 @@ AVaOceanSimulator::AVaOceanSimulator(const FObjectInitializer& ObjectInitializer
 	bReplicates = true;
 	NetUpdateFrequency = 10.f;
 
+	bSimulateOnCPU = false;
+	bUseAsyncCompute = false;
+	bSimulateVelocity = false;
+	VelocityTexture = nullptr;
+	bBandLimitedMips = false;
+	SpectrumEnergyCutoff = 1e-6f;
+	bAsyncComputeActive = false;
+	bAsyncComputeResultReady = false;
+	AsyncComputeResultTime = 0.f;
+
+	FoamTextures[0] = nullptr;
+	FoamTextures[1] = nullptr;
+	FoamWriteIndex = 0;
+
+	SimulationRate = 0.f;
+	SimulationParameters = nullptr;
+	PrevDisplacementTexture = nullptr;
+	PrevGradientTexture = nullptr;
+
+	SpectrumSeed = 0;
+	SimulationEpoch = 0.f;
 	SimulationWorldTime = 0.f;
+	SimulationStep = INDEX_NONE;
+	SimulationAlpha = 1.f;
+	DisplacementBound = FVector::ZeroVector;
+
+	SpectrumTaskSeed = 0;
+	bSpectrumTaskIsTarget = false;
+	SpectrumH0 = nullptr;
+	SpectrumOmega = nullptr;
+	SpectrumTaskDisplacementBound = FVector::ZeroVector;
+	SpectrumTaskBandRadius = 0;
+	SpectrumBandRadius = INDEX_NONE;
+
+	QueuedTransitionDuration = 0.f;
+	QueuedTransitionStartTime = 0.f;
+	bTransitionQueued = false;
+	TransitionDuration = 0.f;
+	TransitionStartTime = 0.f;
+	TransitionChainTime = 0.f;
+	bTransitionActive = false;
+	TransitionDisplacementBound = FVector::ZeroVector;
+	TransitionBandRadius = 0;
+
+	PointQueryWavesIndex = 0;
+	GridQueryIdleTime = 0.f;
+	PointQueryModeDeltaTime = 0.f;
+	bPointQueryMode = false;
+	LastStepTime = 0.f;
+	LastStepDeltaTime = 0.f;
+	bGridStale = false;
+
+	QueryCacheTime = 0.f;
+
+	WakeTexture = nullptr;
+	WakeCenter = FVector2D::ZeroVector;
+	WakeTimeAccumulator = 0.f;
+	WakeReadIndex = 0;
+	WakeSourceRingSlice = 0;
 
 	// Vertex to draw on render targets
 	m_pQuadVB[0].Set(-1.0f, -1.0f, 0.0f, 1.0f);
@@ -78,62 +185,369 @@ AVaOceanSimulator::AVaOceanSimulator(const FObjectInitializer& ObjectInitializer
 
 void AVaOceanSimulator::InitializeInternalData()
 {
+	// Spectrum is regenerated from SpectrumConfig, transition starts over when it's ready
+	CancelSpectrumTransition();
+
+	// Spectrum is generated on a worker thread, so spawning an ocean doesn't stall the game thread
+	if (!SpectrumTask.IsValid())
+	{
+		BeginSpectrumGeneration();
+	}
+
+	if (!SpectrumTask->IsComplete())
+	{
+		return;
+	}
+
+	SpectrumTask = nullptr;
+
+	// Seed was changed while the task was running
+	if (SpectrumTaskSeed != SpectrumSeed)
+	{
+		BeginSpectrumGeneration();
+		return;
+	}
+
+	const FVector4* h0_data = SpectrumH0;
+	const float* omega_data = SpectrumOmega;
+	DisplacementBound = SpectrumTaskDisplacementBound;
+
+	// CPU simulation copies spectrum into its own arena
+	if (MemoryPlan.bCPUSimulation)
+	{
+		CPUBackend.Initialize(MemoryPlan.Dim, h0_data, omega_data, bSimulateVelocity, (MemoryPlan.GerstnerWaveCount > 0) ? &GerstnerWaves : nullptr,
+			MemoryPlan.SpawnListCapacity);
+	}
+
+	// Backend starts with the whole spectrum, so the band is applied again
+	SpectrumBandRadius = INDEX_NONE;
+	SetSpectrumBand(SpectrumTaskBandRadius);
+
+	// Tiles of the old spectrum are dropped even if simulation time stands still
+	if (QueryCache.IsInitialized())
+	{
+		QueryCache.Invalidate();
+	}
+
+	// Analytic waves replace H(0) and omega on GPU
+	if (MemoryPlan.GerstnerWaveCount > 0)
+	{
+		TArray<FVector4> GerstnerData;
+		GerstnerWaves.GetShaderData(GerstnerData);
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+			UploadGerstnerWavesCommand,
+			FStructuredBufferRHIRef, WavesBuffer, m_pBuffer_Float4_GerstnerWaves,
+			TArray<FVector4>, GerstnerData, GerstnerData,
+			{
+				const uint32 WavesBytes = GerstnerData.Num() * sizeof(FVector4);
+				void* WavesDst = RHILockStructuredBuffer(WavesBuffer, 0, WavesBytes, RLM_WriteOnly);
+				FMemory::Memcpy(WavesDst, GerstnerData.GetData(), WavesBytes);
+				RHIUnlockStructuredBuffer(WavesBuffer);
+			});
+	}
+	else
+	{
+		ENQUEUE_UNIQUE_RENDER_COMMAND_FIVEPARAMETER(
+			UploadSpectrumCommand,
+			FStructuredBufferRHIRef, H0Buffer, m_pBuffer_Float4_H0,
+			FStructuredBufferRHIRef, OmegaBuffer, m_pBuffer_Float_Omega,
+			const FVector4*, h0_data, h0_data,
+			const float*, omega_data, omega_data,
+			FVaOceanMemoryPlan, Plan, MemoryPlan,
+			{
+				void* H0Dst = RHILockStructuredBuffer(H0Buffer, 0, Plan.H0Bytes, RLM_WriteOnly);
+				FMemory::Memcpy(H0Dst, h0_data, Plan.H0Bytes);
+				RHIUnlockStructuredBuffer(H0Buffer);
+
+				void* OmegaDst = RHILockStructuredBuffer(OmegaBuffer, 0, Plan.OmegaBytes, RLM_WriteOnly);
+				FMemory::Memcpy(OmegaDst, omega_data, Plan.OmegaBytes);
+				RHIUnlockStructuredBuffer(OmegaBuffer);
+			});
+	}
+	SpectrumUploadFence.BeginFence();
+
+	// Async result and previous step belong to the old spectrum
+	DiscardAsyncSpectrum();
+	SimulationStep = INDEX_NONE;
+
+	// Turn the flag on
+	bSimulatorInitializated = true;
+}
+
+void AVaOceanSimulator::BeginSpectrumGeneration()
+{
+	check(!SpectrumTask.IsValid());
+
 	// Cache shader immutable parameters (looks ugly, but nicely used then)
 	UpdateSpectrumCSImmutableParams.g_ActualDim = SpectrumConfig.DispMapDimension;
-	UpdateSpectrumCSImmutableParams.g_InWidth = UpdateSpectrumCSImmutableParams.g_ActualDim + 4;
+	UpdateSpectrumCSImmutableParams.g_InWidth = UpdateSpectrumCSImmutableParams.g_ActualDim;
 	UpdateSpectrumCSImmutableParams.g_OutWidth = UpdateSpectrumCSImmutableParams.g_ActualDim;
 	UpdateSpectrumCSImmutableParams.g_OutHeight = UpdateSpectrumCSImmutableParams.g_ActualDim;
 	UpdateSpectrumCSImmutableParams.g_DtxAddressOffset = FMath::Square(UpdateSpectrumCSImmutableParams.g_ActualDim);
 	UpdateSpectrumCSImmutableParams.g_DtyAddressOffset = FMath::Square(UpdateSpectrumCSImmutableParams.g_ActualDim) * 2;
+	UpdateSpectrumCSImmutableParams.g_VelocityAddressOffset = bSimulateVelocity ? FMath::Square(UpdateSpectrumCSImmutableParams.g_ActualDim) * 3 : 0;
+	UpdateSpectrumCSImmutableParams.g_SpectrumOffset = 0;
+	UpdateSpectrumCSImmutableParams.g_SpectrumShift = 0.f;
+
+	// Buffers are kept while configuration stays the same, reset only regenerates the spectrum
+	const FVaOceanMemoryPlan Plan(SpectrumConfig.DispMapDimension, bSimulateVelocity, bUseAsyncCompute && GSupportsEfficientAsyncCompute, bBandLimitedMips, ShouldSimulateOnCPU(),
+		WakeConfig.bEnableWakes ? WakeConfig.Resolution : 0, WakeConfig.MaxSources, GerstnerConfig.bUseGerstnerWaves ? GerstnerConfig.WaveCount : 0,
+		PointQueryConfig.bEnablePointQueries ? PointQueryConfig.WaveCount : 0,
+		QueryCacheConfig.TileSize, QueryCacheConfig.bEnableQueryCache ? QueryCacheConfig.TileCount : 0,
+		SpawnListConfig.bEnableSpawnList ? SpawnListConfig.MaxTexels : 0);
+	if (Plan != MemoryPlan)
+	{
+		ClearInternalData();
+		AllocateInternalData(Plan);
+	}
+
+	// Waves are picked again by the task, queries use the grid of the old spectrum until it's ready
+	bPointQueryMode = false;
+	if (bGridStale)
+	{
+		UpdateCPUGrid();
+	}
+
+	LaunchSpectrumTask(SpectrumConfig, &SpectrumTaskDisplacementBound, &SpectrumTaskBandRadius, (MemoryPlan.GerstnerWaveCount > 0) ? &GerstnerWaves : nullptr,
+		(MemoryPlan.PointQueryWaveCount > 0) ? &PointQueryWaves[PointQueryWavesIndex] : nullptr);
+}
+
+void AVaOceanSimulator::LaunchSpectrumTask(const FSpectrumData& Params, FVector* OutBound, int32* OutBandRadius, FVaOceanGerstnerWaves* OutWaves, FVaOceanGerstnerWaves* OutPointQueryWaves)
+{
+	check(!SpectrumTask.IsValid());
+
+	// Staging memory can still be read by the previous upload
+	SpectrumUploadFence.Wait();
 
 	// Height map H(0)
-	int32 height_map_size = (SpectrumConfig.DispMapDimension + 4) * (SpectrumConfig.DispMapDimension + 1);
-	TResourceArray<FVector2D> h0_data;
-	h0_data.Init(FVector2D::ZeroVector, height_map_size);
-	TResourceArray<float> omega_data;
-	omega_data.Init(0.0f, height_map_size);
-	InitHeightMap(SpectrumConfig, h0_data, omega_data);
-
-	int hmap_dim = SpectrumConfig.DispMapDimension;
-	int input_full_size = (hmap_dim + 4) * (hmap_dim + 1);
-	// This value should be (hmap_dim / 2 + 1) * hmap_dim, but we use full sized buffer here for simplicity.
-	int input_half_size = hmap_dim * hmap_dim;
-	int output_size = hmap_dim * hmap_dim;
-
-	// For filling the buffer with zeroes
-	TResourceArray<float> zero_data;
-	zero_data.Init(0.0f, 3 * output_size * 2);
-
-	// RW buffer allocations
-	// H0
+	StagingArena.Reserve(MemoryPlan.StagingBytes);
+	SpectrumH0 = (FVector4*)StagingArena.Allocate(MemoryPlan.H0Bytes);
+	SpectrumOmega = (float*)StagingArena.Allocate(MemoryPlan.OmegaBytes);
+	FVector2D* h0_full = (FVector2D*)StagingArena.Allocate(MemoryPlan.SpectrumGenBytes);
+
+	// Task works on its own copy of parameters, staging memory isn't touched by game thread until it's complete
+	SpectrumTaskSeed = SpectrumSeed;
+
+	const int32 Seed = SpectrumTaskSeed;
+	FVector4* h0_data = SpectrumH0;
+	float* omega_data = SpectrumOmega;
+
+	const int32 GerstnerWaveCount = MemoryPlan.GerstnerWaveCount;
+	const int32 GerstnerDirectionBins = GerstnerConfig.DirectionBins;
+	const int32 PointQueryWaveCount = MemoryPlan.PointQueryWaveCount;
+	const float EnergyCutoff = SpectrumEnergyCutoff;
+
+	SpectrumTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Params, Seed, h0_data, omega_data, h0_full, OutBound, OutBandRadius, EnergyCutoff,
+		OutWaves, GerstnerWaveCount, GerstnerDirectionBins, OutPointQueryWaves, PointQueryWaveCount]()
+	{
+		InitHeightMap(Params, Seed, h0_data, omega_data, h0_full);
+		InitDisplacementBound(Params, h0_data, *OutBound);
+		*OutBandRadius = InitSpectrumBand(Params, h0_data, EnergyCutoff);
+
+		// Sum of a few waves can't exceed their amplitudes, which is often tighter than the statistical bound
+		if (OutWaves)
+		{
+			OutWaves->Initialize(Params.DispMapDimension, h0_data, omega_data, GerstnerWaveCount, GerstnerDirectionBins);
+			*OutBound = OutBound->ComponentMin(OutWaves->GetDisplacementBound(Params.ChoppyScale));
+		}
+
+		// Strongest waves as they are, so point queries converge to the grid surface
+		if (OutPointQueryWaves)
+		{
+			OutPointQueryWaves->Initialize(Params.DispMapDimension, h0_data, omega_data, PointQueryWaveCount, 0);
+		}
+	}, TStatId(), nullptr, ENamedThreads::AnyThread);
+}
+
+void AVaOceanSimulator::PrewarmInternalData()
+{
+	if (!bSimulatorInitializated && !SpectrumTask.IsValid())
+	{
+		BeginSpectrumGeneration();
+	}
+
+	// Shaders are created on first use otherwise, in the middle of the first simulated frame
+	ENQUEUE_UNIQUE_RENDER_COMMAND(
+		PrewarmOceanShadersCommand,
+		{
+			PrewarmOceanShaders(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		});
+}
+
+void AVaOceanSimulator::AllocateInternalData(const FVaOceanMemoryPlan& Plan)
+{
+	MemoryPlan = Plan;
+
+	// New H(t) buffers are not cleared yet
+	SpectrumBandRadius = INDEX_NONE;
+
+	uint32 fft_slices = Plan.FFTSlices;
+	int hmap_dim = Plan.Dim;
+
+	// Buffers are created without initial data: H0 and omega are filled by spectrum upload, all the others
+	// are completely overwritten on each step before they are read
 	uint32 float2_stride = 2 * sizeof(float);
-	CreateBufferAndUAV(&h0_data, input_full_size * float2_stride, float2_stride, &m_pBuffer_Float2_H0, &m_pUAV_H0, &m_pSRV_H0);
+	uint32 float4_stride = 4 * sizeof(float);
+
+	// Analytic waves take the place of spectrum and FFT buffers
+	if (Plan.GerstnerWaveCount > 0)
+	{
+		CreateBufferAndUAV(nullptr, Plan.GerstnerBytes, float4_stride, &m_pBuffer_Float4_GerstnerWaves, &m_pUAV_GerstnerWaves, &m_pSRV_GerstnerWaves);
+	}
+	else
+	{
+		CreateBufferAndUAV(nullptr, Plan.H0Bytes, float4_stride, &m_pBuffer_Float4_H0, &m_pUAV_H0, &m_pSRV_H0);
+		CreateBufferAndUAV(nullptr, Plan.H0Bytes, float4_stride, &m_pBuffer_Float4_H0Target, &m_pUAV_H0Target, &m_pSRV_H0Target);
+		CreateBufferAndUAV(nullptr, Plan.OmegaBytes, sizeof(float), &m_pBuffer_Float_Omega, &m_pUAV_Omega, &m_pSRV_Omega);
+
+		// Notice: The following buffers should be half sized buffer because of conjugate symmetric input. But
+		// we use full sized buffers due to the CS4.0 restriction.
+
+		// Put H(t), Dx(t) and Dy(t) into one buffer because CS4.0 allows only 1 UAV at a time
+		CreateBufferAndUAV(nullptr, Plan.SliceBytes, float2_stride, &m_pBuffer_Float2_Ht, &m_pUAV_Ht, &m_pSRV_Ht);
+
+		// Notice: The following 3 should be real number data. But here we use the complex numbers and C2C FFT
+		// due to the CS4.0 restriction.
+		// Put Dz, Dx and Dy into one buffer because CS4.0 allows only 1 UAV at a time
+		CreateBufferAndUAV(nullptr, Plan.SliceBytes, float2_stride, &m_pBuffer_Float_Dxyz, &m_pUAV_Dxyz, &m_pSRV_Dxyz);
+
+		// Second Dxyz is written by async compute while graphics reads the first one
+		bAsyncComputeActive = Plan.bAsyncCompute;
+		bAsyncComputeResultReady = false;
+		if (bAsyncComputeActive)
+		{
+			CreateBufferAndUAV(nullptr, Plan.SliceBytes, float2_stride, &m_pBuffer_Float_DxyzAsync, &m_pUAV_DxyzAsync, &m_pSRV_DxyzAsync);
+
+			// Pipe hand-over fences are written once per step, so they are reused instead of created each time
+			AsyncGraphicsFence = RHICreateComputeFence(FName(TEXT("VaOceanGraphicsDone")));
+			AsyncComputeFence = RHICreateComputeFence(FName(TEXT("VaOceanComputeDone")));
+		}
+	}
 
-	// Notice: The following 3 buffers should be half sized buffer because of conjugate symmetric input. But
-	// we use full sized buffers due to the CS4.0 restriction.
+	// Bounds pyramid, all levels in one buffer. It's exposed to render thread consumers before the first step,
+	// so it's cleared on GPU instead of uploading zeroes.
+	CreateBufferAndUAV(nullptr, Plan.BoundsBytes, float4_stride, &m_pBuffer_Float4_Bounds, &m_pUAV_Bounds, &m_pSRV_Bounds);
 
-	// Put H(t), Dx(t) and Dy(t) into one buffer because CS4.0 allows only 1 UAV at a time
-	CreateBufferAndUAV(&zero_data, 3 * input_half_size * float2_stride, float2_stride, &m_pBuffer_Float2_Ht, &m_pUAV_Ht, &m_pSRV_Ht);
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+		ClearBoundsCommand,
+		FUnorderedAccessViewRHIRef, m_pUAV_Bounds, m_pUAV_Bounds,
+		{
+			const uint32 ZeroValues[4] = { 0, 0, 0, 0 };
+			RHICmdList.ClearUAV(m_pUAV_Bounds, ZeroValues);
+		});
+
+	// Spawn list arguments are read by indirect dispatches before the first step, so they start at zero
+	if (Plan.SpawnListCapacity > 0)
+	{
+		CreateBufferAndUAV(nullptr, Plan.SpawnListCapacity * float4_stride, float4_stride, &m_pBuffer_Float4_SpawnList, &m_pUAV_SpawnList, &m_pSRV_SpawnList);
+
+		FRHIResourceCreateInfo ResourceCreateInfo;
+		m_pBuffer_Uint_SpawnArgs = RHICreateVertexBuffer(SPAWN_LIST_ARGS_SIZE * sizeof(uint32), (BUF_UnorderedAccess | BUF_ShaderResource | BUF_DrawIndirect), ResourceCreateInfo);
+		m_pUAV_SpawnArgs = RHICreateUnorderedAccessView(m_pBuffer_Uint_SpawnArgs, PF_R32_UINT);
+		m_pSRV_SpawnArgs = RHICreateShaderResourceView(m_pBuffer_Uint_SpawnArgs, sizeof(uint32), PF_R32_UINT);
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			ClearSpawnArgsCommand,
+			FUnorderedAccessViewRHIRef, m_pUAV_SpawnArgs, m_pUAV_SpawnArgs,
+			{
+				const uint32 ZeroValues[4] = { 0, 0, 0, 0 };
+				RHICmdList.ClearUAV(m_pUAV_SpawnArgs, ZeroValues);
+			});
+	}
+
+	// Height query cache is resolved from CPU simulation
+	if (Plan.QueryCacheTileCount > 0)
+	{
+		QueryCache.Initialize(Plan.Dim, Plan.QueryCacheTileSize, Plan.QueryCacheTileCount);
+	}
 
-	// omega
-	CreateBufferAndUAV(&omega_data, input_full_size * sizeof(float), sizeof(float), &m_pBuffer_Float_Omega, &m_pUAV_Omega, &m_pSRV_Omega);
+	// Wake layer starts at rest. Its height ring is read before it is completely written, so it's cleared too.
+	if (Plan.WakeDim > 0)
+	{
+		const uint32 wake_bytes = Plan.WakeDim * Plan.WakeDim * sizeof(float);
+		for (int32 i = 0; i < 3; i++)
+		{
+			CreateBufferAndUAV(nullptr, wake_bytes, sizeof(float), &m_pBuffer_Float_Wake[i], &m_pUAV_Wake[i], &m_pSRV_Wake[i]);
+		}
+		CreateBufferAndUAV(nullptr, Plan.WakeSourceCount * float4_stride, float4_stride, &m_pBuffer_Float4_WakeSources, &m_pUAV_WakeSources, &m_pSRV_WakeSources);
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+			ClearWakeCommand,
+			FUnorderedAccessViewRHIRef, m_pUAV_Wake0, m_pUAV_Wake[0],
+			FUnorderedAccessViewRHIRef, m_pUAV_Wake1, m_pUAV_Wake[1],
+			FUnorderedAccessViewRHIRef, m_pUAV_Wake2, m_pUAV_Wake[2],
+			{
+				const uint32 ZeroValues[4] = { 0, 0, 0, 0 };
+				RHICmdList.ClearUAV(m_pUAV_Wake0, ZeroValues);
+				RHICmdList.ClearUAV(m_pUAV_Wake1, ZeroValues);
+				RHICmdList.ClearUAV(m_pUAV_Wake2, ZeroValues);
+			});
+
+		const float WakeCellSize = WakeConfig.GridSize / Plan.WakeDim;
+		const FIntPoint WakeOrigin = FVaOceanWakeSolver::GetOriginForCenter(WakeCenter, Plan.WakeDim, WakeCellSize);
+
+		WakeReadIndex = 0;
+		for (int32 i = 0; i < 3; i++)
+		{
+			WakeBufferOrigin[i] = WakeOrigin;
+		}
+
+		WakeSources.Empty(Plan.WakeSourceCount);
+		WakeSourceRing.SetNumUninitialized(Plan.WakeSourceCount * WAKE_SOURCE_RING_SIZE);
+		WakeSourceRingSlice = 0;
 
-	// Re-init the array because it was discarded by previous buffer creation
-	zero_data.Empty();
-	zero_data.Init(0.0f, 3 * output_size * 2);
-	// Notice: The following 3 should be real number data. But here we use the complex numbers and C2C FFT
-	// due to the CS4.0 restriction.
-	// Put Dz, Dx and Dy into one buffer because CS4.0 allows only 1 UAV at a time
-	CreateBufferAndUAV(&zero_data, 3 * output_size * float2_stride, float2_stride, &m_pBuffer_Float_Dxyz, &m_pUAV_Dxyz, &m_pSRV_Dxyz);
+		if (Plan.bCPUSimulation)
+		{
+			WakeSolver.Initialize(Plan.WakeDim, WakeCellSize);
+			WakeSolver.SetCenter(WakeCenter);
+		}
+	}
+	WakeTimeAccumulator = 0.f;
 
 	// FFT
-	RadixCreatePlan(&FFTPlan, 3); 
+	if (fft_slices > 0)
+	{
+		RadixCreatePlan(&FFTPlan, fft_slices, hmap_dim);
+	}
 
-	// Turn the flag on
-	bSimulatorInitializated = true;
+	// Band-limited gradient mips: mip M transforms central (hmap_dim >> M)^2 wave numbers. Smaller FFT evaluates
+	// the same band-limited sum at every 2^M-th texel, phase shift moves the samples to mip texel centers.
+	SpectrumMips.Reserve(Plan.SpectrumMipCount);
+	for (int32 mip_dim = hmap_dim / 2, mip_scale = 2; SpectrumMips.Num() < Plan.SpectrumMipCount; mip_dim /= 2, mip_scale *= 2)
+	{
+		FVaOceanSpectrumMip& SpectrumMip = SpectrumMips[SpectrumMips.AddDefaulted()];
+
+		SpectrumMip.ImmutableParams = UpdateSpectrumCSImmutableParams;
+		SpectrumMip.ImmutableParams.g_OutWidth = mip_dim;
+		SpectrumMip.ImmutableParams.g_OutHeight = mip_dim;
+		SpectrumMip.ImmutableParams.g_DtxAddressOffset = mip_dim * mip_dim;
+		SpectrumMip.ImmutableParams.g_DtyAddressOffset = mip_dim * mip_dim * 2;
+		SpectrumMip.ImmutableParams.g_VelocityAddressOffset = 0;
+		SpectrumMip.ImmutableParams.g_SpectrumOffset = (hmap_dim - mip_dim) / 2;
+		SpectrumMip.ImmutableParams.g_SpectrumShift = (float)(-TWO_PI * (mip_scale - 1) * 0.5 / hmap_dim);
+
+		const uint32 mip_bytes = 3 * mip_dim * mip_dim * float2_stride;
+
+		CreateBufferAndUAV(nullptr, mip_bytes, float2_stride, &SpectrumMip.m_pBuffer_Float2_Ht, &SpectrumMip.m_pUAV_Ht, &SpectrumMip.m_pSRV_Ht);
+		CreateBufferAndUAV(nullptr, mip_bytes, float2_stride, &SpectrumMip.m_pBuffer_Float_Dxyz, &SpectrumMip.m_pUAV_Dxyz, &SpectrumMip.m_pSRV_Dxyz);
+
+		RadixCreatePlan(&SpectrumMip.FFTPlan, 3, mip_dim);
+	}
+
+	// Foam history
+	FIntPoint FoamTargetSize(hmap_dim, hmap_dim);
+	for (int32 i = 0; i < 2; i++)
+	{
+		FoamTextures[i] = CreateRenderTarget(true, true, PF_R16F, FoamTargetSize);
+	}
+	FoamWriteIndex = 0;
+
+	UE_LOG(LogVaOcean, Log, TEXT("Ocean simulator %dx%d: %.2f MB of GPU buffers, %.2f MB of CPU memory"),
+		hmap_dim, hmap_dim, Plan.GetGPUBytes() / (1024.f * 1024.f), Plan.GetCPUBytes() / (1024.f * 1024.f));
 }
 
-void AVaOceanSimulator::InitHeightMap(const FSpectrumData& Params, TResourceArray<FVector2D>& out_h0, TResourceArray<float>& out_omega)
+void AVaOceanSimulator::InitHeightMap(const FSpectrumData& Params, int32 Seed, FVector4* out_h0, float* out_omega, FVector2D* h0_full) const
 {
 	int32 i, j;
 	FVector2D K, Kn;
@@ -148,8 +562,11 @@ void AVaOceanSimulator::InitHeightMap(const FSpectrumData& Params, TResourceArra
 	int height_map_dim = Params.DispMapDimension;
 	float patch_length = Params.PatchLength;
 
-	// Initialize random generator.
-	srand(0);
+	// The spectrum is generated for (dim + 1)^2 wave vectors first, so h0(-k) is available for every output texel
+	int gen_width = height_map_dim + 1;
+
+	// Initialize random generator. Stream is platform independent, so every machine gets the same waves
+	FRandomStream RandomStream(Seed);
 
 	for (i = 0; i <= height_map_dim; i++)
 	{
@@ -162,8 +579,13 @@ void AVaOceanSimulator::InitHeightMap(const FSpectrumData& Params, TResourceArra
 
 			float phil = (K.X == 0 && K.Y == 0) ? 0 : sqrtf(Phillips(K, wind_dir, v, a, dir_depend));
 
-			out_h0[i * (height_map_dim + 4) + j].X = float(phil * Gauss() * HALF_SQRT_2);
-			out_h0[i * (height_map_dim + 4) + j].Y = float(phil * Gauss() * HALF_SQRT_2);
+			h0_full[i * gen_width + j].X = float(phil * Gauss(RandomStream) * HALF_SQRT_2);
+			h0_full[i * gen_width + j].Y = float(phil * Gauss(RandomStream) * HALF_SQRT_2);
+
+			if (i == height_map_dim || j == height_map_dim)
+			{
+				continue;
+			}
 
 			// The angular frequency is following the dispersion relation:
 			//            out_omega^2 = g*k
@@ -173,9 +595,175 @@ void AVaOceanSimulator::InitHeightMap(const FSpectrumData& Params, TResourceArra
 			// Gerstner wave shows that a point on a simple sinusoid wave is doing a uniform circular
 			// motion with the center (x0, y0, z0), radius A, and the circular plane is parallel to
 			// vector K.
-			out_omega[i * (height_map_dim + 4) + j] = sqrtf(GRAV_ACCEL * sqrtf(K.X * K.X + K.Y * K.Y));
+			out_omega[i * height_map_dim + j] = sqrtf(GRAV_ACCEL * sqrtf(K.X * K.X + K.Y * K.Y));
+		}
+	}
+
+	// Pack h0(k) and conj(h0(-k)) into one texel, so UpdateSpectrumCS does a single fetch
+	for (i = 0; i < height_map_dim; i++)
+	{
+		for (j = 0; j < height_map_dim; j++)
+		{
+			const FVector2D& h0_k = h0_full[i * gen_width + j];
+			const FVector2D& h0_mk = h0_full[(height_map_dim - i) * gen_width + (height_map_dim - j)];
+
+			out_h0[i * height_map_dim + j] = FVector4(h0_k.X, h0_k.Y, h0_mk.X, -h0_mk.Y);
+		}
+	}
+
+	// h0(-k) of the Nyquist row and column comes from the extra generated row and column, not from the texel
+	// it wraps to, so H(t) is not Hermitian there. Only the real part of the FFT is used, which is the FFT of the
+	// Hermitian part, but velocity packs two real transforms into one slice and picks up the imaginary part too.
+	// Keep just the Hermitian part: displacement doesn't change, velocity becomes its time derivative again.
+	for (i = 0; i < height_map_dim; i++)
+	{
+		for (j = 0; j < height_map_dim; j++)
+		{
+			if (i != 0 && j != 0)
+			{
+				continue;
+			}
+
+			const int32 k_index = i * height_map_dim + j;
+			const int32 mk_index = ((height_map_dim - i) % height_map_dim) * height_map_dim + (height_map_dim - j) % height_map_dim;
+			if (mk_index < k_index)
+			{
+				continue;
+			}
+
+			// Pair (k, -k) is resolved at once: h0'(k) = (h0(k) + conj(c(-k))) / 2, c'(k) = (c(k) + conj(h0(-k))) / 2,
+			// then texel -k is (conj(c'(k)), conj(h0'(k)))
+			const FVector4 h0_k = out_h0[k_index];
+			const FVector4 h0_mk = out_h0[mk_index];
+
+			const FVector4 h0_herm((h0_k.X + h0_mk.Z) * 0.5f, (h0_k.Y - h0_mk.W) * 0.5f, (h0_k.Z + h0_mk.X) * 0.5f, (h0_k.W - h0_mk.Y) * 0.5f);
+
+			out_h0[k_index] = h0_herm;
+			out_h0[mk_index] = FVector4(h0_herm.Z, -h0_herm.W, h0_herm.X, -h0_herm.Y);
+		}
+	}
+}
+
+void AVaOceanSimulator::InitDisplacementBound(const FSpectrumData& Params, const FVector4* h0, FVector& OutBound) const
+{
+	int height_map_dim = Params.DispMapDimension;
+
+	// Surface is a sum of waves with random phases, so variance of each component equals
+	// the sum of energy of H(t) = h0(k) * exp(i * w * t) + conj(h0(-k)) * exp(-i * w * t).
+	double var_x = 0, var_y = 0, var_z = 0;
+	for (int i = 0; i < height_map_dim; i++)
+	{
+		float ky = i - height_map_dim * 0.5f;
+
+		for (int j = 0; j < height_map_dim; j++)
+		{
+			float kx = j - height_map_dim * 0.5f;
+			float sqr_k = kx * kx + ky * ky;
+
+			const FVector4& h = h0[i * height_map_dim + j];
+			double energy = h.X * h.X + h.Y * h.Y + h.Z * h.Z + h.W * h.W;
+
+			var_z += energy;
+			if (sqr_k > 1e-12f)
+			{
+				var_x += energy * kx * kx / sqr_k;
+				var_y += energy * ky * ky / sqr_k;
+			}
+		}
+	}
+
+	OutBound.X = DISPLACEMENT_BOUND_SIGMA * Params.ChoppyScale * (float)FMath::Sqrt(var_x);
+	OutBound.Y = DISPLACEMENT_BOUND_SIGMA * Params.ChoppyScale * (float)FMath::Sqrt(var_y);
+	OutBound.Z = DISPLACEMENT_BOUND_SIGMA * (float)FMath::Sqrt(var_z);
+}
+
+int32 AVaOceanSimulator::InitSpectrumBand(const FSpectrumData& Params, const FVector4* h0, float EnergyCutoff) const
+{
+	int height_map_dim = Params.DispMapDimension;
+	int half_dim = height_map_dim / 2;
+
+	// Height and slope energy of each square ring max(|kx|, |ky|) = r. Slope grows with k, so it keeps
+	// the short waves that still show up in normals and foam.
+	TArray<double> ring_height;
+	TArray<double> ring_slope;
+	ring_height.SetNumZeroed(half_dim + 1);
+	ring_slope.SetNumZeroed(half_dim + 1);
+
+	double total_height = 0, total_slope = 0;
+	for (int i = 0; i < height_map_dim; i++)
+	{
+		int ky = i - half_dim;
+
+		for (int j = 0; j < height_map_dim; j++)
+		{
+			int kx = j - half_dim;
+			int ring = FMath::Max(FMath::Abs(kx), FMath::Abs(ky));
+
+			const FVector4& h = h0[i * height_map_dim + j];
+			double energy = h.X * h.X + h.Y * h.Y + h.Z * h.Z + h.W * h.W;
+			double slope = energy * (kx * kx + ky * ky);
+
+			ring_height[ring] += energy;
+			ring_slope[ring] += slope;
+			total_height += energy;
+			total_slope += slope;
 		}
 	}
+
+	// Outer rings are dropped while both energies fit into the cutoff
+	double dropped_height = 0, dropped_slope = 0;
+
+	int band_radius = half_dim;
+	while (band_radius > 1
+		&& dropped_height + ring_height[band_radius] <= total_height * EnergyCutoff
+		&& dropped_slope + ring_slope[band_radius] <= total_slope * EnergyCutoff)
+	{
+		dropped_height += ring_height[band_radius];
+		dropped_slope += ring_slope[band_radius];
+		band_radius--;
+	}
+
+	return band_radius;
+}
+
+void AVaOceanSimulator::SetSpectrumBand(int32 BandRadius)
+{
+	if (BandRadius == SpectrumBandRadius)
+	{
+		return;
+	}
+
+	// Texels left out of the new band could still hold values of the old one
+	SpectrumBandRadius = BandRadius;
+
+	if (MemoryPlan.bCPUSimulation)
+	{
+		CPUBackend.SetSpectrumBand(BandRadius);
+	}
+
+	TArray<FUnorderedAccessViewRHIRef> HtUAVs;
+	if (m_pUAV_Ht)
+	{
+		HtUAVs.Add(m_pUAV_Ht);
+	}
+	for (const FVaOceanSpectrumMip& SpectrumMip : SpectrumMips)
+	{
+		HtUAVs.Add(SpectrumMip.m_pUAV_Ht);
+	}
+
+	if (HtUAVs.Num() > 0)
+	{
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			ClearSpectrumCommand,
+			TArray<FUnorderedAccessViewRHIRef>, HtUAVs, HtUAVs,
+			{
+				const uint32 ZeroValues[4] = { 0, 0, 0, 0 };
+				for (const FUnorderedAccessViewRHIRef& HtUAV : HtUAVs)
+				{
+					RHICmdList.ClearUAV(HtUAV, ZeroValues);
+				}
+			});
+	}
 }
 
 void AVaOceanSimulator::CreateBufferAndUAV(FResourceArrayInterface* Data, uint32 byte_width, uint32 byte_stride,
@@ -183,7 +771,7 @@ void AVaOceanSimulator::CreateBufferAndUAV(FResourceArrayInterface* Data, uint32
 {
 	FRHIResourceCreateInfo ResourceCreateInfo;
 	ResourceCreateInfo.ResourceArray = Data;
-	*ppBuffer = RHICreateStructuredBuffer(byte_stride, Data->GetResourceDataSize(), (BUF_UnorderedAccess | BUF_ShaderResource), ResourceCreateInfo);
+	*ppBuffer = RHICreateStructuredBuffer(byte_stride, Data ? Data->GetResourceDataSize() : byte_width, (BUF_UnorderedAccess | BUF_ShaderResource), ResourceCreateInfo);
 
 	*ppUAV = RHICreateUnorderedAccessView(*ppBuffer, false, false);
 	*ppSRV = RHICreateShaderResourceView(*ppBuffer);
@@ -191,12 +779,44 @@ void AVaOceanSimulator::CreateBufferAndUAV(FResourceArrayInterface* Data, uint32
 
 void AVaOceanSimulator::ClearInternalData()
 {
+	// Spectrum generation and upload use staging memory on other threads
+	if (SpectrumTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(SpectrumTask);
+		SpectrumTask = nullptr;
+	}
+	SpectrumUploadFence.Wait();
+	StagingArena.Release();
+	bSpectrumTaskIsTarget = false;
+	bTransitionActive = false;
+	MemoryPlan = FVaOceanMemoryPlan();
+
 	RadixDestroyPlan(&FFTPlan);
 
-	m_pBuffer_Float2_H0.SafeRelease();
+	for (FVaOceanSpectrumMip& SpectrumMip : SpectrumMips)
+	{
+		RadixDestroyPlan(&SpectrumMip.FFTPlan);
+	}
+	SpectrumMips.Empty();
+
+	CPUBackend.Release();
+	GerstnerWaves.Release();
+	PointQueryWaves[0].Release();
+	PointQueryWaves[1].Release();
+	PointQueryWavesIndex = 0;
+	bPointQueryMode = false;
+	bGridStale = false;
+	QueryCache.Release();
+	WakeSolver.Release();
+
+	m_pBuffer_Float4_H0.SafeRelease();
 	m_pUAV_H0.SafeRelease();
 	m_pSRV_H0.SafeRelease();
 
+	m_pBuffer_Float4_H0Target.SafeRelease();
+	m_pUAV_H0Target.SafeRelease();
+	m_pSRV_H0Target.SafeRelease();
+
 	m_pBuffer_Float_Omega.SafeRelease();
 	m_pUAV_Omega.SafeRelease();
 	m_pSRV_Omega.SafeRelease();
@@ -206,16 +826,88 @@ void AVaOceanSimulator::ClearInternalData()
 	m_pSRV_Ht.SafeRelease();
 
 	m_pBuffer_Float_Dxyz.SafeRelease();
-	m_pUAV_Dxyz;
-	m_pSRV_Dxyz;
+	m_pUAV_Dxyz.SafeRelease();
+	m_pSRV_Dxyz.SafeRelease();
+
+	m_pBuffer_Float_DxyzAsync.SafeRelease();
+	m_pUAV_DxyzAsync.SafeRelease();
+	m_pSRV_DxyzAsync.SafeRelease();
+	AsyncGraphicsFence.SafeRelease();
+	AsyncComputeFence.SafeRelease();
+
+	bAsyncComputeActive = false;
+	bAsyncComputeResultReady = false;
+
+	m_pBuffer_Float4_Bounds.SafeRelease();
+	m_pUAV_Bounds.SafeRelease();
+	m_pSRV_Bounds.SafeRelease();
+
+	m_pBuffer_Float4_SpawnList.SafeRelease();
+	m_pUAV_SpawnList.SafeRelease();
+	m_pSRV_SpawnList.SafeRelease();
+	m_pBuffer_Uint_SpawnArgs.SafeRelease();
+	m_pUAV_SpawnArgs.SafeRelease();
+	m_pSRV_SpawnArgs.SafeRelease();
+
+	m_pBuffer_Float4_GerstnerWaves.SafeRelease();
+	m_pUAV_GerstnerWaves.SafeRelease();
+	m_pSRV_GerstnerWaves.SafeRelease();
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		m_pBuffer_Float_Wake[i].SafeRelease();
+		m_pUAV_Wake[i].SafeRelease();
+		m_pSRV_Wake[i].SafeRelease();
+	}
+
+	m_pBuffer_Float4_WakeSources.SafeRelease();
+	m_pUAV_WakeSources.SafeRelease();
+	m_pSRV_WakeSources.SafeRelease();
+
+	// Render thread could still read packed sources of the last step
+	WakeSourceFence.Wait();
+	WakeSources.Empty();
+	WakeSourceRing.Empty();
+
+	FoamTextures[0] = nullptr;
+	FoamTextures[1] = nullptr;
 
 	bSimulatorInitializated = false;
 }
 
 void AVaOceanSimulator::ResetInternalData()
 {
-	ClearInternalData();
-	InitializeInternalData();
+	CancelSpectrumTransition();
+
+	// Result of running task is stale, configuration has changed since it was started
+	if (SpectrumTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(SpectrumTask);
+		SpectrumTask = nullptr;
+	}
+
+	// Buffers of unchanged configuration are reused, simulation continues when the new spectrum is ready
+	bSimulatorInitializated = false;
+	BeginSpectrumGeneration();
+}
+
+void AVaOceanSimulator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Waves start from the moment server has spawned the ocean
+	if (HasAuthority())
+	{
+		UWorld* World = GetWorld();
+		AGameState* GameState = World ? World->GetGameState() : nullptr;
+
+		SimulationEpoch = GameState ? GameState->GetServerWorldTimeSeconds() : 0.f;
+	}
+
+	// Wake layer is allocated around the ocean until something else is followed
+	WakeCenter = FVector2D(GetActorLocation());
+
+	PrewarmInternalData();
 }
 
 void AVaOceanSimulator::BeginDestroy()
@@ -239,6 +931,14 @@ void AVaOceanSimulator::PostEditChangeProperty(FPropertyChangedEvent& PropertyCh
 }
 #endif // WITH_EDITOR
 
+void AVaOceanSimulator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AVaOceanSimulator, SpectrumSeed);
+	DOREPLIFETIME(AVaOceanSimulator, SimulationEpoch);
+}
+
 bool AVaOceanSimulator::ShouldTickIfViewportsOnly() const
 {
 	return true;
@@ -248,76 +948,394 @@ void AVaOceanSimulator::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	// Check that data is initializated
+	// Check that data is initializated, waves appear when spectrum generation is complete
 	if (!bSimulatorInitializated)
 	{
 		InitializeInternalData();
+
+		if (!bSimulatorInitializated)
+		{
+			return;
+		}
 	}
 
 	// Tick world time
-	SimulationWorldTime += DeltaSeconds;
+	UpdateSimulationTime(DeltaSeconds);
 
-	// Process simulation shaders
-	UpdateDisplacementMap(SimulationWorldTime);
-}
+	// Sea state transition uses simulation time, so it's updated after it
+	UpdateSpectrumTransition();
 
-void AVaOceanSimulator::UpdateDisplacementMap(float WorldTime)
-{
-	if (!DisplacementTexture || !GradientTexture)
-		return;
+	// Query demand is measured over all ticks since the last step
+	PointQueryModeDeltaTime += DeltaSeconds;
 
-	// ---------------------------- H(0) -> H(t), D(x, t), D(y, t) --------------------------------
-	FUpdateSpectrumCSPerFrame UpdateSpectrumCSPerFrameParams;
-	UpdateSpectrumCSPerFrameParams.g_Time = WorldTime * SpectrumConfig.TimeScale;
-	UpdateSpectrumCSPerFrameParams.g_ChoppyScale = SpectrumConfig.ChoppyScale;
-	UpdateSpectrumCSPerFrameParams.m_pSRV_H0 = m_pSRV_H0;
-	UpdateSpectrumCSPerFrameParams.m_pSRV_Omega = m_pSRV_Omega;
-	UpdateSpectrumCSPerFrameParams.m_pUAV_Ht = m_pUAV_Ht;
+	if (SimulationRate <= 0.f)
+	{
+		// Simulate each frame
+		UpdatePointQueryMode(PointQueryModeDeltaTime);
+		RunSimulationStep(SimulationWorldTime, DeltaSeconds);
+		SimulationStep = INDEX_NONE;
+		SimulationAlpha = 1.f;
+	}
+	else
+	{
+		// Steps are simulated one step ahead, so current time always lies between the last two of them
+		const float StepDuration = 1.f / SimulationRate;
+		const int32 TargetStep = FMath::FloorToInt(SimulationWorldTime * SimulationRate) + 1;
 
-	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
-		UpdateSpectrumCSCommand,
-		FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,
-		FUpdateSpectrumCSPerFrame, PerFrameParams, UpdateSpectrumCSPerFrameParams,
+		if (TargetStep != SimulationStep)
 		{
-			FUpdateSpectrumUniformParameters Parameters;
-			const auto FeatureLevel = GMaxRHIFeatureLevel;
-			Parameters.Time = PerFrameParams.g_Time;
+			// Both steps of a hitch are simulated in the same mode
+			UpdatePointQueryMode(PointQueryModeDeltaTime);
+
+			// After a hitch or a time correction the previous step is stale, so it's simulated again
+			if (SimulationStep == INDEX_NONE || TargetStep != SimulationStep + 1)
+			{
+				DiscardAsyncSpectrum();
+				RunSimulationStep((TargetStep - 1) * StepDuration, StepDuration);
+			}
+
+			RunSimulationStep(TargetStep * StepDuration, StepDuration);
+			SimulationStep = TargetStep;
+		}
 
-			FUpdateSpectrumUniformBufferRef UniformBuffer = 
-				FUpdateSpectrumUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+		SimulationAlpha = FMath::Clamp(SimulationWorldTime * SimulationRate - (TargetStep - 1), 0.f, 1.f);
+	}
 
-			TShaderMapRef<FUpdateSpectrumCS> UpdateSpectrumCS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-			RHICmdList.SetComputeShader(UpdateSpectrumCS->GetComputeShader());
+	CPUBackend.SetInterpolationAlpha(SimulationAlpha);
 
-			UpdateSpectrumCS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
-				ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
-				ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset);
+	// Resolved tiles hold the surface of one moment
+	if (QueryCache.IsInitialized() && SimulationWorldTime != QueryCacheTime)
+	{
+		QueryCache.Invalidate();
+		QueryCacheTime = SimulationWorldTime;
+	}
 
-			UpdateSpectrumCS->SetParameters(RHICmdList, UniformBuffer, PerFrameParams.m_pSRV_H0, PerFrameParams.m_pSRV_Omega);
-			UpdateSpectrumCS->SetOutput(RHICmdList, PerFrameParams.m_pUAV_Ht);
+	// Local wave layer steps with its own fixed rate
+	UpdateWakes(DeltaSeconds);
 
-			uint32 group_count_x = (ImmutableParams.g_ActualDim + BLOCK_SIZE_X - 1) / BLOCK_SIZE_X;
-			uint32 group_count_y = (ImmutableParams.g_ActualDim + BLOCK_SIZE_Y - 1) / BLOCK_SIZE_Y;
-			RHICmdList.DispatchComputeShader(group_count_x, group_count_y, 1);
+	// Hulls float on the surface of this frame, wakes included
+	UpdateBuoyancy();
 
-			UpdateSpectrumCS->UnsetParameters(RHICmdList);
-			UpdateSpectrumCS->UnbindBuffers(RHICmdList);
-		});
+	if (SimulationParameters)
+	{
+		static const FName SimulationAlphaParameterName(TEXT("OceanSimulationAlpha"));
+		GetWorld()->GetParameterCollectionInstance(SimulationParameters)->SetScalarParameterValue(SimulationAlphaParameterName, SimulationAlpha);
+	}
+}
 
-	// ------------------------------------ Perform FFT -------------------------------------------
-	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
-		RadixFFTCommand,
-		FRadixPlan512*, pPlan, &FFTPlan,
-		FUnorderedAccessViewRHIRef, m_pUAV_Dxyz, m_pUAV_Dxyz,
-		FShaderResourceViewRHIRef, m_pSRV_Dxyz, m_pSRV_Dxyz,
-		FShaderResourceViewRHIRef, m_pSRV_Ht, m_pSRV_Ht,
-		{
-			RadixCompute(RHICmdList, pPlan, m_pUAV_Dxyz, m_pSRV_Dxyz, m_pSRV_Ht);
-		});
+void AVaOceanSimulator::RunSimulationStep(float WorldTime, float DeltaTime)
+{
+	// Keep last results for interpolation
+	if (SimulationRate > 0.f)
+	{
+		CopyToPreviousFrame();
+	}
 
-	// --------------------------------- Wrap Dx, Dy and Dz ---------------------------------------
-	FUpdateDisplacementPSPerFrame UpdateDisplacementPSPerFrameParams;
-	UpdateDisplacementPSPerFrameParams.g_ChoppyScale = SpectrumConfig.ChoppyScale;
+	// Process simulation shaders
+	UpdateDisplacementMap(WorldTime, DeltaTime);
+
+	// Keep CPU copy of the waves for gameplay queries
+	if (CPUBackend.IsInitialized())
+	{
+		LastStepTime = WorldTime;
+		LastStepDeltaTime = DeltaTime;
+
+		// Grid is skipped while point queries are cheaper to sum directly
+		if (bPointQueryMode)
+		{
+			bGridStale = true;
+		}
+		else
+		{
+			UpdateCPUGrid();
+		}
+	}
+}
+
+FVaOceanCPUPerFrame AVaOceanSimulator::MakeCPUPerFrame(float WorldTime, float DeltaTime) const
+{
+	FVaOceanCPUPerFrame PerFrame;
+	PerFrame.Time = WorldTime * SpectrumConfig.TimeScale;
+	PerFrame.TimeScale = SpectrumConfig.TimeScale;
+	PerFrame.ChoppyScale = GetChoppyScale(WorldTime);
+	PerFrame.SpectrumBlend = GetSpectrumBlend(WorldTime);
+	PerFrame.GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
+	PerFrame.FoamFade = FMath::Exp(-FoamConfig.FoamDecay * DeltaTime);
+	PerFrame.FoamInjection = FoamConfig.FoamInjection * DeltaTime;
+	PerFrame.FoamThreshold = FoamConfig.FoamThreshold;
+	PerFrame.SpawnFoldThreshold = SpawnListConfig.FoldThreshold;
+	return PerFrame;
+}
+
+void AVaOceanSimulator::UpdateCPUGrid()
+{
+	// Previous step was skipped too, but interpolation needs it
+	if (bGridStale && SimulationRate > 0.f)
+	{
+		CPUBackend.Update(MakeCPUPerFrame(LastStepTime - LastStepDeltaTime, LastStepDeltaTime));
+	}
+
+	CPUBackend.Update(MakeCPUPerFrame(LastStepTime, LastStepDeltaTime));
+	bGridStale = false;
+}
+
+void AVaOceanSimulator::RequireCPUGrid() const
+{
+	GridQueryCount.Increment();
+
+	// Point query mode leaves the grid at an older step. It's simulated once here, mode returns to the grid on the next step.
+	if (bGridStale)
+	{
+		FScopeLock Lock(&GridStepLock);
+		if (bGridStale)
+		{
+			const_cast<AVaOceanSimulator*>(this)->UpdateCPUGrid();
+		}
+	}
+}
+
+void AVaOceanSimulator::CopyToPreviousFrame()
+{
+	if (!DisplacementTexture || !GradientTexture || !PrevDisplacementTexture || !PrevGradientTexture)
+		return;
+
+	FTextureRenderTargetResource* DisplacementRenderTarget = DisplacementTexture->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* GradientRenderTarget = GradientTexture->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* PrevDisplacementRenderTarget = PrevDisplacementTexture->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* PrevGradientRenderTarget = PrevGradientTexture->GameThread_GetRenderTargetResource();
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FIVEPARAMETER(
+		CopyToPreviousFrameCommand,
+		FTextureRenderTargetResource*, DisplacementRenderTarget, DisplacementRenderTarget,
+		FTextureRenderTargetResource*, GradientRenderTarget, GradientRenderTarget,
+		FTextureRenderTargetResource*, PrevDisplacementRenderTarget, PrevDisplacementRenderTarget,
+		FTextureRenderTargetResource*, PrevGradientRenderTarget, PrevGradientRenderTarget,
+		bool, bCopyMips, bBandLimitedMips,
+		{
+			RHICmdList.CopyToResolveTarget(DisplacementRenderTarget->GetRenderTargetTexture(), PrevDisplacementRenderTarget->TextureRHI, true, FResolveParams());
+			RHICmdList.CopyToResolveTarget(GradientRenderTarget->GetRenderTargetTexture(), PrevGradientRenderTarget->TextureRHI, true, FResolveParams());
+
+			if (bCopyMips)
+			{
+				// Band-limited mips can't be rebuilt from the top one
+				const int32 NumMips = FMath::Min(GradientRenderTarget->TextureRHI->GetNumMips(), PrevGradientRenderTarget->TextureRHI->GetNumMips());
+				for (int32 MipIndex = 1; MipIndex < NumMips; MipIndex++)
+				{
+					RHICmdList.CopyToResolveTarget(GradientRenderTarget->GetRenderTargetTexture(), PrevGradientRenderTarget->TextureRHI, true,
+						FResolveParams(FResolveRect(), CubeFace_PosX, MipIndex));
+				}
+			}
+			else
+			{
+				// Only the top mip is copied
+				RHICmdList.GenerateMips(PrevGradientRenderTarget->TextureRHI);
+			}
+		});
+}
+
+void AVaOceanSimulator::UpdateSimulationTime(float DeltaSeconds)
+{
+	UWorld* World = GetWorld();
+	AGameState* GameState = World ? World->GetGameState() : nullptr;
+
+	if (GameState)
+	{
+		// Server world time is replicated by game state, so clients don't drift away from server
+		SimulationWorldTime = GameState->GetServerWorldTimeSeconds() - SimulationEpoch;
+	}
+	else
+	{
+		// Editor viewports have no game state
+		SimulationWorldTime += DeltaSeconds;
+	}
+}
+
+void AVaOceanSimulator::UpdateDisplacementMap(float WorldTime, float DeltaTime)
+{
+	if (!DisplacementTexture || !GradientTexture)
+		return;
+
+	// Displacement and velocity maps of the step
+	if (MemoryPlan.GerstnerWaveCount > 0)
+	{
+		UpdateGerstnerDisplacement(WorldTime);
+	}
+	else
+	{
+		UpdateSpectrumDisplacement(WorldTime, DeltaTime);
+	}
+
+	FTextureRenderTargetResource* DisplacementRenderTarget = DisplacementTexture->GameThread_GetRenderTargetResource();
+
+	// ------------------------------- Displacement bounds pyramid --------------------------------
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+		BuildBoundsCSCommand,
+		FTextureRenderTargetResource*, DisplacementRenderTarget, DisplacementRenderTarget,
+		uint32, DispMapDimension, UpdateSpectrumCSImmutableParams.g_ActualDim,
+		FUnorderedAccessViewRHIRef, m_pUAV_Bounds, m_pUAV_Bounds,
+		{
+			const auto FeatureLevel = GMaxRHIFeatureLevel;
+
+			// Displacement is read by compute shader, so it can't stay bound as render target
+			SetRenderTarget(RHICmdList, FTextureRHIRef(), FTextureRHIRef());
+
+			// Level 0: one thread group per tile
+			uint32 dst_dim = FMath::Max(DispMapDimension / BOUNDS_TILE_SIZE, 1u);
+			uint32 dst_offset = 0;
+
+			TShaderMapRef<FBuildBoundsCS> BuildBoundsCS(GetGlobalShaderMap(FeatureLevel));
+			RHICmdList.SetComputeShader(BuildBoundsCS->GetComputeShader());
+
+			BuildBoundsCS->SetParameters(RHICmdList, dst_offset, dst_dim, DisplacementRenderTarget->TextureRHI);
+			BuildBoundsCS->SetOutput(RHICmdList, m_pUAV_Bounds);
+
+			RHICmdList.DispatchComputeShader(dst_dim, dst_dim, 1);
+
+			BuildBoundsCS->UnbindBuffers(RHICmdList);
+
+			// Upper levels
+			TShaderMapRef<FReduceBoundsCS> ReduceBoundsCS(GetGlobalShaderMap(FeatureLevel));
+			RHICmdList.SetComputeShader(ReduceBoundsCS->GetComputeShader());
+
+			while (dst_dim > 1)
+			{
+				uint32 src_dim = dst_dim;
+				uint32 src_offset = dst_offset;
+				dst_offset += src_dim * src_dim;
+				dst_dim /= 2;
+
+				ReduceBoundsCS->SetParameters(RHICmdList, src_offset, src_dim, dst_offset, dst_dim);
+				ReduceBoundsCS->SetOutput(RHICmdList, m_pUAV_Bounds);
+
+				uint32 group_count = (dst_dim + BOUNDS_REDUCE_BLOCK - 1) / BOUNDS_REDUCE_BLOCK;
+				RHICmdList.DispatchComputeShader(group_count, group_count, 1);
+			}
+
+			ReduceBoundsCS->UnbindBuffers(RHICmdList);
+		});
+
+	// ------------------------------- Generate Normal and Foam -----------------------------------
+	FGenGradientFoldingPSPerFrame GenGradientFoldingPSPerFrameParams;
+	GenGradientFoldingPSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	GenGradientFoldingPSPerFrameParams.g_GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
+	GenGradientFoldingPSPerFrameParams.g_FoamFade = FMath::Exp(-FoamConfig.FoamDecay * DeltaTime);
+	GenGradientFoldingPSPerFrameParams.g_FoamInjection = FoamConfig.FoamInjection * DeltaTime;
+	GenGradientFoldingPSPerFrameParams.g_FoamThreshold = FoamConfig.FoamThreshold;
+	FMemory::Memcpy(GenGradientFoldingPSPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
+
+	FTextureRenderTargetResource* GradientRenderTarget = GradientTexture->GameThread_GetRenderTargetResource();
+
+	// Foam is ping-ponged: read the history written last frame, write the other one
+	FTextureRenderTargetResource* FoamReadRenderTarget = FoamTextures[1 - FoamWriteIndex]->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* FoamWriteRenderTarget = FoamTextures[FoamWriteIndex]->GameThread_GetRenderTargetResource();
+	FoamWriteIndex = 1 - FoamWriteIndex;
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_SIXPARAMETER(
+		GenGradientFoldingPSCommand,
+		FTextureRenderTargetResource*, TextureRenderTarget, GradientRenderTarget,
+		FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,		// We're using the same params as for CS
+		FGenGradientFoldingPSPerFrame, PerFrameParams, GenGradientFoldingPSPerFrameParams,
+		FTextureRenderTargetResource*, DisplacementRenderTarget, DisplacementRenderTarget,
+		FTextureRenderTargetResource*, FoamReadRenderTarget, FoamReadRenderTarget,
+		FTextureRenderTargetResource*, FoamWriteRenderTarget, FoamWriteRenderTarget,
+		{
+			FUpdateDisplacementUniformParameters Parameters;
+			const auto FeatureLevel = GMaxRHIFeatureLevel;
+			Parameters.ChoppyScale = PerFrameParams.g_ChoppyScale;
+			Parameters.GridLen = PerFrameParams.g_GridLen;
+			Parameters.FoamFade = PerFrameParams.g_FoamFade;
+			Parameters.FoamInjection = PerFrameParams.g_FoamInjection;
+			Parameters.FoamThreshold = PerFrameParams.g_FoamThreshold;
+
+			FUpdateDisplacementUniformBufferRef UniformBuffer = FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+
+			// Gradient and foam history are written by the same pass
+			FTextureRHIParamRef RenderTargets[2] =
+			{
+				TextureRenderTarget->GetRenderTargetTexture(),
+				FoamWriteRenderTarget->GetRenderTargetTexture()
+			};
+			SetRenderTargets(RHICmdList, 2, RenderTargets, FTextureRHIRef(), 0, nullptr);
+			RHICmdList.Clear(true, FLinearColor::Transparent, false, 0.f, false, 0, FIntRect());
+
+			// Be sure we're blending right without any alpha influence on Color blending
+			RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
+
+			TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+			TShaderMapRef<FGenGradientFoldingPS> GenGradientFoldingPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+			static FGlobalBoundShaderState UpdateDisplacementBoundShaderState;
+			SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, UpdateDisplacementBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *GenGradientFoldingPS);
+
+			GenGradientFoldingPS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
+				ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
+				ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset);
+
+			GenGradientFoldingPS->SetParameters(RHICmdList, UniformBuffer, DisplacementRenderTarget->TextureRHI, FoamReadRenderTarget->TextureRHI);
+
+			DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
+
+			GenGradientFoldingPS->UnsetParameters(RHICmdList);
+	});
+
+	// ------------------------------------ Gradient mips -----------------------------------------
+	UpdateGradientMips(WorldTime, FoamWriteRenderTarget);
+
+	// ------------------------------------ Fold spawn list ---------------------------------------
+	if (MemoryPlan.SpawnListCapacity > 0)
+	{
+		UpdateSpawnList(GradientRenderTarget);
+	}
+}
+
+void AVaOceanSimulator::UpdateSpectrumDisplacement(float WorldTime, float DeltaTime)
+{
+	// ---------------------------- H(0) -> H(t), D(x, t), D(y, t) --------------------------------
+	FUpdateSpectrumCSPerFrame UpdateSpectrumCSPerFrameParams;
+	UpdateSpectrumCSPerFrameParams.g_Time = WorldTime * SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_TimeScale = SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_SpectrumBlend = GetSpectrumBlend(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_BandRadius = SpectrumBandRadius;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0 = m_pSRV_H0;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0Target = m_pSRV_H0Target;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Omega = m_pSRV_Omega;
+	UpdateSpectrumCSPerFrameParams.m_pUAV_Ht = m_pUAV_Ht;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Ht = m_pSRV_Ht;
+	UpdateSpectrumCSPerFrameParams.m_pUAV_Dxyz = m_pUAV_Dxyz;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Dxyz = m_pSRV_Dxyz;
+
+	// Async step was computed for the time the next fixed step was expected at, a hitch or time correction moves it
+	if (!bAsyncComputeResultReady || AsyncComputeResultTime != WorldTime)
+	{
+		DiscardAsyncSpectrum();
+
+		// Spectrum and FFT on graphics pipe
+		ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+			UpdateSpectrumCSCommand,
+			FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,
+			FUpdateSpectrumCSPerFrame, PerFrameParams, UpdateSpectrumCSPerFrameParams,
+			FRadixPlan512*, pPlan, &FFTPlan,
+			{
+				DispatchSpectrumFFT(RHICmdList, ImmutableParams, PerFrameParams, pPlan);
+			});
+	}
+	else
+	{
+		// Dxyz was computed by the previous async step
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			WaitAsyncComputeCommand,
+			FComputeFenceRHIRef, ComputeDoneFence, AsyncComputeFence,
+			{
+				RHICmdList.WaitComputeFence(ComputeDoneFence);
+			});
+
+		bAsyncComputeResultReady = false;
+	}
+
+	// --------------------------------- Wrap Dx, Dy and Dz ---------------------------------------
+	FUpdateDisplacementPSPerFrame UpdateDisplacementPSPerFrameParams;
+	UpdateDisplacementPSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
 	UpdateDisplacementPSPerFrameParams.g_GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
 	UpdateDisplacementPSPerFrameParams.g_InputDxyz = m_pSRV_Dxyz;
 	FMemory::Memcpy(UpdateDisplacementPSPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
@@ -334,6 +1352,9 @@ void AVaOceanSimulator::UpdateDisplacementMap(float WorldTime)
 			FUpdateDisplacementUniformParameters Parameters;
 			Parameters.ChoppyScale = PerFrameParams.g_ChoppyScale;
 			Parameters.GridLen = PerFrameParams.g_GridLen;
+			Parameters.FoamFade = 0.f;
+			Parameters.FoamInjection = 0.f;
+			Parameters.FoamThreshold = 0.f;
 
 			FUpdateDisplacementUniformBufferRef UniformBuffer =
 				FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
@@ -361,62 +1382,1087 @@ void AVaOceanSimulator::UpdateDisplacementMap(float WorldTime)
 			UpdateDisplacementPS->UnsetParameters(RHICmdList);
 		});
 
-	// ----------------------------------- Generate Normal ----------------------------------------
-	FGenGradientFoldingPSPerFrame GenGradientFoldingPSPerFrameParams;
-	GenGradientFoldingPSPerFrameParams.g_ChoppyScale = SpectrumConfig.ChoppyScale;
-	GenGradientFoldingPSPerFrameParams.g_GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
-	FMemory::Memcpy(GenGradientFoldingPSPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
+	// ------------------------------ Wrap velocity slices -----------------------------------------
+	if (VelocityTexture && bSimulateVelocity)
+	{
+		FTextureRenderTargetResource* VelocityRenderTarget = VelocityTexture->GameThread_GetRenderTargetResource();
 
-	FTextureRenderTargetResource* GradientRenderTarget = GradientTexture->GameThread_GetRenderTargetResource();
+		ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+			UpdateVelocityPSCommand,
+			FTextureRenderTargetResource*, TextureRenderTarget, VelocityRenderTarget,
+			FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,		// We're using the same params as for CS
+			FUpdateDisplacementPSPerFrame, PerFrameParams, UpdateDisplacementPSPerFrameParams,
+			{
+				FUpdateDisplacementUniformParameters Parameters;
+				Parameters.ChoppyScale = PerFrameParams.g_ChoppyScale;
+				Parameters.GridLen = PerFrameParams.g_GridLen;
+				Parameters.FoamFade = 0.f;
+				Parameters.FoamInjection = 0.f;
+				Parameters.FoamThreshold = 0.f;
+
+				FUpdateDisplacementUniformBufferRef UniformBuffer =
+					FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+
+				SetRenderTarget(RHICmdList, TextureRenderTarget->GetRenderTargetTexture(), NULL);
+				RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
+
+				TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				TShaderMapRef<FUpdateVelocityPS> UpdateVelocityPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+				static FGlobalBoundShaderState UpdateVelocityBoundShaderState;
+				SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, UpdateVelocityBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *UpdateVelocityPS);
+
+				UpdateVelocityPS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
+					ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
+					ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset);
+				UpdateVelocityPS->SetVelocityParameters(RHICmdList, ImmutableParams.g_VelocityAddressOffset);
+
+				UpdateVelocityPS->SetParameters(RHICmdList, UniformBuffer, PerFrameParams.g_InputDxyz);
+
+				DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
+
+				UpdateVelocityPS->UnsetParameters(RHICmdList);
+			});
+	}
+
+	// -------------------------- Spectrum and FFT of the next step --------------------------------
+	// Only fixed rate steps know when the next one is, frame deltas are not known ahead
+	if (bAsyncComputeActive && SimulationRate > 0.f)
+	{
+		// The same expression Tick uses for step time, so the time of the next step matches exactly
+		const float StepDuration = 1.f / SimulationRate;
+		UpdateSpectrumAsync((FMath::RoundToInt(WorldTime * SimulationRate) + 1) * StepDuration);
+	}
+}
+
+void AVaOceanSimulator::UpdateGerstnerDisplacement(float WorldTime)
+{
+	// ------------------------------ Sum of analytic waves ---------------------------------------
+	FGerstnerPSPerFrame GerstnerPSPerFrameParams;
+	GerstnerPSPerFrameParams.g_GerstnerWaves = m_pSRV_GerstnerWaves;
+	GerstnerPSPerFrameParams.g_GerstnerWaveCount = GerstnerWaves.Num();
+	GerstnerPSPerFrameParams.g_Time = WorldTime * SpectrumConfig.TimeScale;
+	GerstnerPSPerFrameParams.g_TimeScale = SpectrumConfig.TimeScale;
+	GerstnerPSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	GerstnerPSPerFrameParams.g_GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
+	FMemory::Memcpy(GerstnerPSPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
+
+	FTextureRenderTargetResource* DisplacementRenderTarget = DisplacementTexture->GameThread_GetRenderTargetResource();
+	FTextureRenderTargetResource* VelocityRenderTarget = (VelocityTexture && bSimulateVelocity) ? VelocityTexture->GameThread_GetRenderTargetResource() : nullptr;
 
 	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
-		GenGradientFoldingPSCommand,
-		FTextureRenderTargetResource*, TextureRenderTarget, GradientRenderTarget,
-		FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,		// We're using the same params as for CS
-		FGenGradientFoldingPSPerFrame, PerFrameParams, GenGradientFoldingPSPerFrameParams,
+		GerstnerPSCommand,
 		FTextureRenderTargetResource*, DisplacementRenderTarget, DisplacementRenderTarget,
+		FTextureRenderTargetResource*, VelocityRenderTarget, VelocityRenderTarget,
+		uint32, DispMapDimension, UpdateSpectrumCSImmutableParams.g_ActualDim,
+		FGerstnerPSPerFrame, PerFrameParams, GerstnerPSPerFrameParams,
 		{
 			FUpdateDisplacementUniformParameters Parameters;
-			const auto FeatureLevel = GMaxRHIFeatureLevel;
 			Parameters.ChoppyScale = PerFrameParams.g_ChoppyScale;
 			Parameters.GridLen = PerFrameParams.g_GridLen;
+			Parameters.FoamFade = 0.f;
+			Parameters.FoamInjection = 0.f;
+			Parameters.FoamThreshold = 0.f;
 
-			FUpdateDisplacementUniformBufferRef UniformBuffer = FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+			FUpdateDisplacementUniformBufferRef UniformBuffer =
+				FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
 
-			SetRenderTarget(RHICmdList, TextureRenderTarget->GetRenderTargetTexture(), FTextureRHIRef());
-			RHICmdList.Clear(true, FLinearColor::Transparent, false, 0.f, false, 0, FIntRect());
+			TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
 
-			// Be sure we're blending right without any alpha influence on Color blending
+			// Displacement
+			SetRenderTarget(RHICmdList, DisplacementRenderTarget->GetRenderTargetTexture(), NULL);
 			RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
 
-			TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-			TShaderMapRef<FGenGradientFoldingPS> GenGradientFoldingPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
-
-			static FGlobalBoundShaderState UpdateDisplacementBoundShaderState;
-			SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, UpdateDisplacementBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *GenGradientFoldingPS);
+			TShaderMapRef<FGerstnerDisplacementPS> GerstnerDisplacementPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
 
-			GenGradientFoldingPS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
-				ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
-				ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset);
+			static FGlobalBoundShaderState GerstnerDisplacementBoundShaderState;
+			SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, GerstnerDisplacementBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *GerstnerDisplacementPS);
 
-			GenGradientFoldingPS->SetParameters(RHICmdList, UniformBuffer, DisplacementRenderTarget->TextureRHI);
+			GerstnerDisplacementPS->SetParameters(RHICmdList, UniformBuffer, DispMapDimension,
+				PerFrameParams.g_GerstnerWaveCount, PerFrameParams.g_Time, PerFrameParams.g_TimeScale, PerFrameParams.g_GerstnerWaves);
 
 			DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
 
-			GenGradientFoldingPS->UnsetParameters(RHICmdList);
+			GerstnerDisplacementPS->UnsetParameters(RHICmdList);
 
-			// Generate new mipmaps now
-			RHICmdList.GenerateMips(TextureRenderTarget->TextureRHI);
-	});
-	
+			// Velocity
+			if (VelocityRenderTarget)
+			{
+				SetRenderTarget(RHICmdList, VelocityRenderTarget->GetRenderTargetTexture(), NULL);
+				RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
+
+				TShaderMapRef<FGerstnerVelocityPS> GerstnerVelocityPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+				static FGlobalBoundShaderState GerstnerVelocityBoundShaderState;
+				SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, GerstnerVelocityBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *GerstnerVelocityPS);
+
+				GerstnerVelocityPS->SetParameters(RHICmdList, UniformBuffer, DispMapDimension,
+					PerFrameParams.g_GerstnerWaveCount, PerFrameParams.g_Time, PerFrameParams.g_TimeScale, PerFrameParams.g_GerstnerWaves);
+
+				DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
+
+				GerstnerVelocityPS->UnsetParameters(RHICmdList);
+			}
+		});
 }
 
-//////////////////////////////////////////////////////////////////////////
-// Spectrum configuration
+void AVaOceanSimulator::UpdateGradientMips(float WorldTime, FTextureRenderTargetResource* FoamRenderTarget)
+{
+	FTextureRenderTargetResource* GradientRenderTarget = GradientTexture->GameThread_GetRenderTargetResource();
 
-const FSpectrumData& AVaOceanSimulator::GetSpectrumConfig() const
+	if (SpectrumMips.Num() == 0)
+	{
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			GenerateGradientMipsCommand,
+			FTextureRenderTargetResource*, TextureRenderTarget, GradientRenderTarget,
+			{
+				// Generate new mipmaps now
+				RHICmdList.GenerateMips(TextureRenderTarget->TextureRHI);
+			});
+
+		return;
+	}
+
+	FUpdateSpectrumCSPerFrame UpdateSpectrumCSPerFrameParams;
+	UpdateSpectrumCSPerFrameParams.g_Time = WorldTime * SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_TimeScale = SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_SpectrumBlend = GetSpectrumBlend(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_BandRadius = SpectrumBandRadius;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0 = m_pSRV_H0;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0Target = m_pSRV_H0Target;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Omega = m_pSRV_Omega;
+
+	FUpdateDisplacementPSPerFrame UpdateDisplacementPSPerFrameParams;
+	UpdateDisplacementPSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	UpdateDisplacementPSPerFrameParams.g_GridLen = SpectrumConfig.DispMapDimension / SpectrumConfig.PatchLength;
+	FMemory::Memcpy(UpdateDisplacementPSPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FIVEPARAMETER(
+		GenGradientMipsCommand,
+		FTextureRenderTargetResource*, TextureRenderTarget, GradientRenderTarget,
+		FTextureRenderTargetResource*, FoamRenderTarget, FoamRenderTarget,
+		TArray<FVaOceanSpectrumMip>*, pSpectrumMips, &SpectrumMips,
+		FUpdateSpectrumCSPerFrame, SpectrumPerFrameParams, UpdateSpectrumCSPerFrameParams,
+		FUpdateDisplacementPSPerFrame, PerFrameParams, UpdateDisplacementPSPerFrameParams,
+		{
+			FUpdateDisplacementUniformParameters Parameters;
+			Parameters.ChoppyScale = PerFrameParams.g_ChoppyScale;
+			Parameters.GridLen = PerFrameParams.g_GridLen;
+			Parameters.FoamFade = 0.f;
+			Parameters.FoamInjection = 0.f;
+			Parameters.FoamThreshold = 0.f;
+
+			FUpdateDisplacementUniformBufferRef UniformBuffer =
+				FUpdateDisplacementUniformBufferRef::CreateUniformBufferImmediate(Parameters, UniformBuffer_SingleFrame);
+
+			const int32 NumMips = FMath::Min<int32>(TextureRenderTarget->TextureRHI->GetNumMips() - 1, pSpectrumMips->Num());
+			for (int32 i = 0; i < NumMips; i++)
+			{
+				FVaOceanSpectrumMip& SpectrumMip = (*pSpectrumMips)[i];
+				const FUpdateSpectrumCSImmutable& ImmutableParams = SpectrumMip.ImmutableParams;
+				const int32 MipIndex = i + 1;
+
+				// Central region of H(0) -> H(t), D(x, t), D(y, t) -> FFT
+				FUpdateSpectrumCSPerFrame MipPerFrameParams = SpectrumPerFrameParams;
+				MipPerFrameParams.m_pUAV_Ht = SpectrumMip.m_pUAV_Ht;
+				MipPerFrameParams.m_pSRV_Ht = SpectrumMip.m_pSRV_Ht;
+				MipPerFrameParams.m_pUAV_Dxyz = SpectrumMip.m_pUAV_Dxyz;
+				MipPerFrameParams.m_pSRV_Dxyz = SpectrumMip.m_pSRV_Dxyz;
+
+				DispatchSpectrumFFT(RHICmdList, ImmutableParams, MipPerFrameParams, &SpectrumMip.FFTPlan);
+
+				// Dx, Dy, Dz -> Normal, Folding, Foam of the mip
+				SetRenderTarget(RHICmdList, TextureRenderTarget->GetRenderTargetTexture(), MipIndex, 0, FTextureRHIRef());
+				RHICmdList.SetViewport(0, 0, 0.f, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight, 1.f);
+				RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
+
+				TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				TShaderMapRef<FGenGradientFoldingMipPS> GenGradientFoldingMipPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+				static FGlobalBoundShaderState GenGradientFoldingMipBoundShaderState;
+				SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, GenGradientFoldingMipBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *GenGradientFoldingMipPS);
+
+				GenGradientFoldingMipPS->SetParameters(RHICmdList, ImmutableParams.g_ActualDim,
+					ImmutableParams.g_InWidth, ImmutableParams.g_OutWidth, ImmutableParams.g_OutHeight,
+					ImmutableParams.g_DtxAddressOffset, ImmutableParams.g_DtyAddressOffset);
+				GenGradientFoldingMipPS->SetMipParameters(RHICmdList, (float)(1 << MipIndex), FoamRenderTarget->TextureRHI);
+
+				GenGradientFoldingMipPS->SetParameters(RHICmdList, UniformBuffer, SpectrumMip.m_pSRV_Dxyz);
+
+				DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
+
+				GenGradientFoldingMipPS->UnsetParameters(RHICmdList);
+			}
+		});
+}
+
+void AVaOceanSimulator::UpdateSpawnList(FTextureRenderTargetResource* GradientRenderTarget)
 {
-	return SpectrumConfig;
+	ENQUEUE_UNIQUE_RENDER_COMMAND_SIXPARAMETER(
+		UpdateSpawnListCommand,
+		FTextureRenderTargetResource*, GradientRenderTarget, GradientRenderTarget,
+		uint32, DispMapDimension, MemoryPlan.Dim,
+		uint32, SpawnListCapacity, MemoryPlan.SpawnListCapacity,
+		float, FoldThreshold, SpawnListConfig.FoldThreshold,
+		FUnorderedAccessViewRHIRef, m_pUAV_SpawnList, m_pUAV_SpawnList,
+		FUnorderedAccessViewRHIRef, m_pUAV_SpawnArgs, m_pUAV_SpawnArgs,
+		{
+			const auto FeatureLevel = GMaxRHIFeatureLevel;
+
+			// Gradient is read by compute shader, so it can't stay bound as render target
+			SetRenderTarget(RHICmdList, FTextureRHIRef(), FTextureRHIRef());
+
+			// Entry count is appended to, list itself is overwritten up to it
+			const uint32 ZeroValues[4] = { 0, 0, 0, 0 };
+			RHICmdList.ClearUAV(m_pUAV_SpawnArgs, ZeroValues);
+
+			TShaderMapRef<FCompactSpawnListCS> CompactSpawnListCS(GetGlobalShaderMap(FeatureLevel));
+			RHICmdList.SetComputeShader(CompactSpawnListCS->GetComputeShader());
+
+			CompactSpawnListCS->SetParameters(RHICmdList, DispMapDimension, DispMapDimension, SpawnListCapacity, FoldThreshold, GradientRenderTarget->TextureRHI);
+			CompactSpawnListCS->SetOutput(RHICmdList, m_pUAV_SpawnList, m_pUAV_SpawnArgs);
+
+			uint32 group_count = (DispMapDimension + BLOCK_SIZE_X - 1) / BLOCK_SIZE_X;
+			RHICmdList.DispatchComputeShader(group_count, group_count, 1);
+
+			CompactSpawnListCS->UnbindBuffers(RHICmdList);
+
+			// Count -> indirect arguments of consumers
+			TShaderMapRef<FFinalizeSpawnArgsCS> FinalizeSpawnArgsCS(GetGlobalShaderMap(FeatureLevel));
+			RHICmdList.SetComputeShader(FinalizeSpawnArgsCS->GetComputeShader());
+
+			FinalizeSpawnArgsCS->SetParameters(RHICmdList, SpawnListCapacity);
+			FinalizeSpawnArgsCS->SetOutput(RHICmdList, m_pUAV_SpawnArgs);
+
+			RHICmdList.DispatchComputeShader(1, 1, 1);
+
+			FinalizeSpawnArgsCS->UnbindBuffers(RHICmdList);
+		});
+}
+
+void AVaOceanSimulator::UpdateSpectrumAsync(float WorldTime)
+{
+	FUpdateSpectrumCSPerFrame UpdateSpectrumCSPerFrameParams;
+	UpdateSpectrumCSPerFrameParams.g_Time = WorldTime * SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_TimeScale = SpectrumConfig.TimeScale;
+	UpdateSpectrumCSPerFrameParams.g_ChoppyScale = GetChoppyScale(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_SpectrumBlend = GetSpectrumBlend(WorldTime);
+	UpdateSpectrumCSPerFrameParams.g_BandRadius = SpectrumBandRadius;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0 = m_pSRV_H0;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_H0Target = m_pSRV_H0Target;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Omega = m_pSRV_Omega;
+	UpdateSpectrumCSPerFrameParams.m_pUAV_Ht = m_pUAV_Ht;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Ht = m_pSRV_Ht;
+	UpdateSpectrumCSPerFrameParams.m_pUAV_Dxyz = m_pUAV_DxyzAsync;
+	UpdateSpectrumCSPerFrameParams.m_pSRV_Dxyz = m_pSRV_DxyzAsync;
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_SIXPARAMETER(
+		UpdateSpectrumAsyncCommand,
+		FUpdateSpectrumCSImmutable, ImmutableParams, UpdateSpectrumCSImmutableParams,
+		FUpdateSpectrumCSPerFrame, PerFrameParams, UpdateSpectrumCSPerFrameParams,
+		FRadixPlan512*, pPlan, &FFTPlan,
+		FComputeFenceRHIRef, GraphicsDoneFence, AsyncGraphicsFence,
+		FComputeFenceRHIRef, ComputeDoneFence, AsyncComputeFence,
+		FUnorderedAccessViewRHIRef, m_pUAV_DxyzRead, m_pUAV_Dxyz,
+		{
+			// Hand buffers over to compute pipe. Output was read by graphics on the previous step, H(t) and
+			// FFT temp buffer could be written on graphics pipe before the first async step.
+			FUnorderedAccessViewRHIParamRef GraphicsUAVs[4] = { m_pUAV_DxyzRead, PerFrameParams.m_pUAV_Dxyz, PerFrameParams.m_pUAV_Ht, pPlan->pUAV_Tmp };
+			GraphicsDoneFence->Reset();
+			RHICmdList.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EGfxToCompute, GraphicsUAVs, 4, GraphicsDoneFence);
+
+			FRHIAsyncComputeCommandListImmediate& RHICmdListCompute = FRHICommandListExecutor::GetImmediateAsyncComputeCommandList();
+			RHICmdListCompute.WaitComputeFence(GraphicsDoneFence);
+
+			DispatchSpectrumFFT(RHICmdListCompute, ImmutableParams, PerFrameParams, pPlan);
+
+			// Hand the result over to graphics
+			FUnorderedAccessViewRHIParamRef ComputeUAVs[1] = { PerFrameParams.m_pUAV_Dxyz };
+			ComputeDoneFence->Reset();
+			RHICmdListCompute.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EComputeToGfx, ComputeUAVs, 1, ComputeDoneFence);
+
+			FRHIAsyncComputeCommandListImmediate::ImmediateDispatch(RHICmdListCompute);
+		});
+
+	// Graphics passes of the next step read the async result
+	Swap(m_pBuffer_Float_Dxyz, m_pBuffer_Float_DxyzAsync);
+	Swap(m_pUAV_Dxyz, m_pUAV_DxyzAsync);
+	Swap(m_pSRV_Dxyz, m_pSRV_DxyzAsync);
+	bAsyncComputeResultReady = true;
+	AsyncComputeResultTime = WorldTime;
+}
+
+void AVaOceanSimulator::DiscardAsyncSpectrum()
+{
+	if (!bAsyncComputeResultReady)
+	{
+		return;
+	}
+
+	// Graphics pipe may overwrite Dxyz only when async pipe is done with it
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+		WaitDiscardedAsyncComputeCommand,
+		FComputeFenceRHIRef, ComputeDoneFence, AsyncComputeFence,
+		{
+			RHICmdList.WaitComputeFence(ComputeDoneFence);
+		});
+
+	bAsyncComputeResultReady = false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Wakes
+
+void AVaOceanSimulator::AddWakeSource(const FVector& WorldLocation, float Radius, float Strength)
+{
+	if (MemoryPlan.WakeDim == 0 || WakeSources.Num() >= MemoryPlan.WakeSourceCount)
+		return;
+
+	FVaOceanWakeSource Source;
+	Source.Location = FVector2D(WorldLocation.X, WorldLocation.Y);
+	Source.Radius = Radius;
+	Source.Strength = Strength;
+
+	WakeSources.Add(Source);
+}
+
+void AVaOceanSimulator::SetWakeCenter(const FVector& WorldLocation)
+{
+	WakeCenter = FVector2D(WorldLocation.X, WorldLocation.Y);
+}
+
+void AVaOceanSimulator::UpdateWakes(float DeltaSeconds)
+{
+	if (MemoryPlan.WakeDim == 0)
+		return;
+
+	// Fixed steps keep the wave equation stable and its cost bounded, time over the step budget is dropped
+	const float StepDuration = 1.f / FMath::Max(WakeConfig.StepRate, 1.f);
+	WakeTimeAccumulator += DeltaSeconds;
+
+	const int32 NumSteps = FMath::Min(FMath::FloorToInt(WakeTimeAccumulator / StepDuration), FMath::Max(WakeConfig.MaxStepsPerFrame, 1));
+	WakeTimeAccumulator = FMath::Min(WakeTimeAccumulator - NumSteps * StepDuration, StepDuration);
+
+	// Callers add their sources every tick, keeping them for the next step would splat them twice
+	if (NumSteps == 0)
+	{
+		WakeSources.Reset();
+		return;
+	}
+
+	const int32 WakeDim = MemoryPlan.WakeDim;
+	const float CellSize = WakeConfig.GridSize / WakeDim;
+	const FVaOceanWakeStep StepParams(WakeConfig.WaveSpeed, WakeConfig.WaveDecay, StepDuration, CellSize);
+	const FIntPoint Origin = FVaOceanWakeSolver::GetOriginForCenter(WakeCenter, WakeDim, CellSize);
+
+	// CPU copy for gameplay queries
+	if (WakeSolver.IsInitialized())
+	{
+		WakeSolver.SetCenter(WakeCenter);
+
+		for (int32 i = 0; i < NumSteps; i++)
+		{
+			WakeSolver.Step(StepParams, WakeSources.GetData(), WakeSources.Num());
+		}
+	}
+
+	if (WakeTexture)
+	{
+		FWakeStepPerFrame WakeStepPerFrameParams;
+		FMemory::Memcpy(WakeStepPerFrameParams.m_pQuadVB, m_pQuadVB, sizeof(m_pQuadVB[0]) * 4);
+
+		for (int32 i = 0; i < 3; i++)
+		{
+			WakeStepPerFrameParams.m_pUAV_Height[i] = m_pUAV_Wake[i];
+			WakeStepPerFrameParams.m_pSRV_Height[i] = m_pSRV_Wake[i];
+			WakeStepPerFrameParams.BufferOrigin[i] = WakeBufferOrigin[i];
+		}
+
+		WakeStepPerFrameParams.m_pBuffer_Sources = m_pBuffer_Float4_WakeSources;
+		WakeStepPerFrameParams.m_pSRV_Sources = m_pSRV_WakeSources;
+
+		// Sources are packed in grid cells, the same way FVaOceanWakeSolver splats them. Game thread runs at most
+		// one frame ahead of render thread, so the slice isn't written again before the command reads it.
+		FVector4* PackedSources = WakeSourceRing.GetData() + WakeSourceRingSlice * MemoryPlan.WakeSourceCount;
+		WakeSourceRingSlice = (WakeSourceRingSlice + 1) % WAKE_SOURCE_RING_SIZE;
+
+		for (int32 i = 0; i < WakeSources.Num(); i++)
+		{
+			const FVaOceanWakeSource& Source = WakeSources[i];
+			PackedSources[i] = FVector4(
+				Source.Location.X / CellSize - Origin.X,
+				Source.Location.Y / CellSize - Origin.Y,
+				FMath::Clamp(Source.Radius / CellSize, 1.f, WAKE_MAX_SOURCE_CELLS),
+				Source.Strength);
+		}
+
+		WakeStepPerFrameParams.Sources = PackedSources;
+		WakeStepPerFrameParams.NumSources = WakeSources.Num();
+
+		WakeStepPerFrameParams.g_WakeDim = WakeDim;
+		WakeStepPerFrameParams.g_WakeCellSize = CellSize;
+		WakeStepPerFrameParams.g_WakeStep = FVector4(StepParams.Courant2, StepParams.DampingA, StepParams.DampingB, StepParams.DeltaTime);
+		WakeStepPerFrameParams.Origin = Origin;
+		WakeStepPerFrameParams.ReadIndex = WakeReadIndex;
+		WakeStepPerFrameParams.NumSteps = NumSteps;
+
+		FTextureRenderTargetResource* WakeRenderTarget = WakeTexture->GameThread_GetRenderTargetResource();
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+			UpdateWakesCommand,
+			FTextureRenderTargetResource*, TextureRenderTarget, WakeRenderTarget,
+			FWakeStepPerFrame, PerFrameParams, WakeStepPerFrameParams,
+			{
+				const int32 NumSources = PerFrameParams.NumSources;
+				if (NumSources > 0)
+				{
+					const uint32 SourceBytes = NumSources * sizeof(FVector4);
+					void* SourcesDst = RHILockStructuredBuffer(PerFrameParams.m_pBuffer_Sources, 0, SourceBytes, RLM_WriteOnly);
+					FMemory::Memcpy(SourcesDst, PerFrameParams.Sources, SourceBytes);
+					RHIUnlockStructuredBuffer(PerFrameParams.m_pBuffer_Sources);
+				}
+
+				// Steps rotate three buffers: current and previous height are read, the next one is written
+				TShaderMapRef<FWakeStepCS> WakeStepCS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				RHICmdList.SetComputeShader(WakeStepCS->GetComputeShader());
+
+				FIntPoint BufferOrigin[3] = { PerFrameParams.BufferOrigin[0], PerFrameParams.BufferOrigin[1], PerFrameParams.BufferOrigin[2] };
+				uint32 group_count = (PerFrameParams.g_WakeDim + BLOCK_SIZE_X - 1) / BLOCK_SIZE_X;
+
+				for (int32 i = 0; i < PerFrameParams.NumSteps; i++)
+				{
+					const int32 cur = (PerFrameParams.ReadIndex + i) % 3;
+					const int32 prev = (cur + 2) % 3;
+					const int32 next = (cur + 1) % 3;
+
+					// Grid could have moved since the heights were written
+					WakeStepCS->SetParameters(RHICmdList, PerFrameParams.g_WakeDim,
+						PerFrameParams.Origin - BufferOrigin[cur], PerFrameParams.Origin - BufferOrigin[prev],
+						PerFrameParams.g_WakeStep, NumSources, PerFrameParams.m_pSRV_Sources,
+						PerFrameParams.m_pSRV_Height[cur], PerFrameParams.m_pSRV_Height[prev]);
+					WakeStepCS->SetOutput(RHICmdList, PerFrameParams.m_pUAV_Height[next]);
+
+					RHICmdList.DispatchComputeShader(group_count, group_count, 1);
+
+					WakeStepCS->UnbindBuffers(RHICmdList);
+					BufferOrigin[next] = PerFrameParams.Origin;
+				}
+
+				// Height -> (height, gradient) for materials
+				const int32 last = (PerFrameParams.ReadIndex + PerFrameParams.NumSteps) % 3;
+
+				SetRenderTarget(RHICmdList, TextureRenderTarget->GetRenderTargetTexture(), NULL);
+				RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
+
+				TShaderMapRef<FQuadVS> QuadVS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+				TShaderMapRef<FWakeGradientPS> WakeGradientPS(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+				static FGlobalBoundShaderState WakeGradientBoundShaderState;
+				SetGlobalBoundShaderState(RHICmdList, GMaxRHIFeatureLevel, WakeGradientBoundShaderState, GQuadVertexDeclaration.VertexDeclarationRHI, *QuadVS, *WakeGradientPS);
+
+				WakeGradientPS->SetParameters(RHICmdList, PerFrameParams.g_WakeDim, PerFrameParams.g_WakeCellSize, PerFrameParams.m_pSRV_Height[last]);
+
+				DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, PerFrameParams.m_pQuadVB, sizeof(PerFrameParams.m_pQuadVB[0]));
+
+				WakeGradientPS->UnsetParameters(RHICmdList);
+			});
+
+		WakeSourceFence.BeginFence();
+
+		// Mirror ring rotation of the render thread
+		for (int32 i = 1; i <= NumSteps; i++)
+		{
+			WakeBufferOrigin[(WakeReadIndex + i) % 3] = Origin;
+		}
+		WakeReadIndex = (WakeReadIndex + NumSteps) % 3;
+	}
+
+	WakeSources.Reset();
+
+	// Material places WakeTexture with (min x, min y, size, 1 / size) of the grid, cell centers are at texel centers
+	if (SimulationParameters)
+	{
+		static const FName WakeRectParameterName(TEXT("OceanWakeRect"));
+		const FLinearColor WakeRect((Origin.X - 0.5f) * CellSize, (Origin.Y - 0.5f) * CellSize, WakeConfig.GridSize, 1.f / WakeConfig.GridSize);
+		GetWorld()->GetParameterCollectionInstance(SimulationParameters)->SetVectorParameterValue(WakeRectParameterName, WakeRect);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Buoyancy
+
+void AVaOceanSimulator::RegisterBuoyancyComponent(UVaOceanBuoyancyComponent* Component)
+{
+	BuoyancyComponents.AddUnique(Component);
+}
+
+void AVaOceanSimulator::UnregisterBuoyancyComponent(UVaOceanBuoyancyComponent* Component)
+{
+	BuoyancyComponents.Remove(Component);
+}
+
+void AVaOceanSimulator::UpdateBuoyancy()
+{
+	// Components destroyed without EndPlay are nulled by GC
+	BuoyancyComponents.Remove(nullptr);
+
+	// Transforms and bodies are read on game thread, so gathering is serial.
+	// Components left without water this frame are skipped, so they don't keep the ratio of the last batch.
+	const bool bCanFloat = ShouldSimulateOnCPU() && CPUBackend.IsInitialized();
+
+	BuoyancyBatch.Reset();
+	for (UVaOceanBuoyancyComponent* Component : BuoyancyComponents)
+	{
+		BuoyancyBatch.AddHull(bCanFloat ? Component->GatherPontoons(BuoyancyBatch.GetLocations()) : 0);
+	}
+
+	const float ActorZ = GetActorLocation().Z;
+
+	// Pontoons of all hulls share tiles of the query cache
+	BuoyancyBatch.Resolve(bSimulateVelocity, [&](const FVector* InLocations, int32 InNum, float* OutHeights, FVector* OutVelocities)
+	{
+		FVector2D UVs[BUOYANCY_BATCH_SIZE];
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			UVs[Index] = FVector2D(InLocations[Index]) / SpectrumConfig.PatchLength;
+		}
+
+		if (QueryCache.IsInitialized())
+		{
+			for (int32 Index = 0; Index < InNum; Index++)
+			{
+				OutHeights[Index] = QueryCache.SampleHeight(UVs[Index], [this](const FVector2D* InUVs, int32 InResolveNum, float* OutResolveHeights)
+				{
+					ResolveQueryHeights(InUVs, InResolveNum, OutResolveHeights);
+				});
+			}
+		}
+		else
+		{
+			ResolveQueryHeights(UVs, InNum, OutHeights);
+		}
+
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			OutHeights[Index] += ActorZ + WakeSolver.SampleHeight(FVector2D(InLocations[Index]));
+		}
+
+		if (OutVelocities)
+		{
+			if (!bPointQueryMode)
+			{
+				PointQueryDemand.Add(InNum);
+			}
+
+			for (int32 Index = 0; Index < InNum; Index++)
+			{
+				if (bPointQueryMode)
+				{
+					FVector Displacement;
+					EvaluatePointQuery(UVs[Index], &Displacement, &OutVelocities[Index]);
+				}
+				else
+				{
+					OutVelocities[Index] = CPUBackend.SampleVelocity(UVs[Index]);
+				}
+			}
+		}
+	});
+
+	// Each body gets its summed force once
+	const float GravityZ = GetWorld()->GetGravityZ();
+
+	BuoyancyBatch.Apply([&](int32 HullIndex, const FVector* Locations, const float* WaterHeights, const FVector* WaterVelocities, int32 Num)
+	{
+		if (Num > 0)
+		{
+			BuoyancyComponents[HullIndex]->ApplyBuoyancy(Locations, WaterHeights, WaterVelocities, GravityZ);
+		}
+		else
+		{
+			BuoyancyComponents[HullIndex]->ClearBuoyancy();
+		}
+	});
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Spawn list
+
+FShaderResourceViewRHIRef AVaOceanSimulator::GetSpawnListSRV() const
+{
+	return m_pSRV_SpawnList;
+}
+
+FVertexBufferRHIRef AVaOceanSimulator::GetSpawnArgsBuffer() const
+{
+	return m_pBuffer_Uint_SpawnArgs;
+}
+
+FShaderResourceViewRHIRef AVaOceanSimulator::GetSpawnArgsSRV() const
+{
+	return m_pSRV_SpawnArgs;
+}
+
+const FVaOceanFoldTexel* AVaOceanSimulator::GetSpawnTexels(int32& OutNum) const
+{
+	// List is built by the grid step, so point query mode can't skip it
+	GridQueryCount.Increment();
+	return CPUBackend.GetSpawnList(OutNum);
+}
+
+int32 AVaOceanSimulator::GetSpawnLocations(const FVector& Center, TArray<FVector>& OutLocations) const
+{
+	int32 Num;
+	const FVaOceanFoldTexel* Texels = GetSpawnTexels(Num);
+
+	OutLocations.Reset(Num);
+	if (Num == 0)
+	{
+		return 0;
+	}
+
+	const float PatchLength = SpectrumConfig.PatchLength;
+	const float TexelSize = PatchLength / CPUBackend.GetDimension();
+	const float ActorZ = GetActorLocation().Z;
+
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		// List is of the last step, so displacement is not interpolated either
+		const FVaOceanFoldTexel& Texel = Texels[Index];
+		const FVector4 Displacement = CPUBackend.GetDisplacementTexel(Texel.X, Texel.Y);
+
+		// Texel centers are at (i + 0.5) / Dim of the patch
+		FVector2D Location((Texel.X + 0.5f) * TexelSize + Displacement.X, (Texel.Y + 0.5f) * TexelSize + Displacement.Y);
+		Location.X += FMath::RoundToFloat((Center.X - Location.X) / PatchLength) * PatchLength;
+		Location.Y += FMath::RoundToFloat((Center.Y - Location.Y) / PatchLength) * PatchLength;
+
+		OutLocations.Add(FVector(Location, ActorZ + Displacement.Z));
+	}
+
+	return Num;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Spectrum configuration
+
+const FSpectrumData& AVaOceanSimulator::GetSpectrumConfig() const
+{
+	return SpectrumConfig;
+}
+
+FVector AVaOceanSimulator::GetDisplacementBound() const
+{
+	return DisplacementBound;
+}
+
+void AVaOceanSimulator::SetSpectrumSeed(int32 NewSeed)
+{
+	if (SpectrumSeed != NewSeed)
+	{
+		SpectrumSeed = NewSeed;
+		OnRep_SpectrumSeed();
+	}
+}
+
+void AVaOceanSimulator::OnRep_SpectrumSeed()
+{
+	// Spectrum is regenerated on next tick, buffers are kept
+	bSimulatorInitializated = false;
+}
+
+void AVaOceanSimulator::TransitionToSpectrum(const FSpectrumData& TargetConfig, float Duration, float StartTime)
+{
+	FSpectrumData Target = TargetConfig;
+
+	// Not editable because of FFT shader config
+	Target.DispMapDimension = SpectrumConfig.DispMapDimension;
+
+	// Omega depends on patch length, so different patches can't be blended. Nothing is blended before the first spectrum too.
+	// Analytic waves of two sea states are picked independently, so they are replaced at once.
+	if (Duration <= 0.f || Target.PatchLength != SpectrumConfig.PatchLength || !bSimulatorInitializated || MemoryPlan.GerstnerWaveCount > 0)
+	{
+		SpectrumConfig = Target;
+		ResetInternalData();
+
+		// Queued transition was from the replaced sea state
+		bTransitionQueued = false;
+		TransitionChainTime = 0.f;
+		return;
+	}
+
+	// Time scale change moves the phase of every wave, it can't be blended
+	Target.TimeScale = SpectrumConfig.TimeScale;
+
+	// Newer request replaces the queued one, it starts when the running transition is complete
+	QueuedTransitionTarget = Target;
+	QueuedTransitionDuration = Duration;
+	QueuedTransitionStartTime = StartTime;
+	bTransitionQueued = true;
+}
+
+float AVaOceanSimulator::GetSimulationTime() const
+{
+	return SimulationWorldTime;
+}
+
+bool AVaOceanSimulator::IsSpectrumTransitionActive() const
+{
+	return bTransitionActive || bSpectrumTaskIsTarget || bTransitionQueued;
+}
+
+void AVaOceanSimulator::UpdateSpectrumTransition()
+{
+	// Target spectrum is generated: upload it and blend it in from the shared start time.
+	// Local generation time differs between machines, so it must not affect the blend.
+	if (bSpectrumTaskIsTarget && SpectrumTask->IsComplete())
+	{
+		SpectrumTask = nullptr;
+		bSpectrumTaskIsTarget = false;
+
+		if (MemoryPlan.bCPUSimulation)
+		{
+			CPUBackend.SetTargetSpectrum(SpectrumH0);
+		}
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+			UploadTargetSpectrumCommand,
+			FStructuredBufferRHIRef, H0TargetBuffer, m_pBuffer_Float4_H0Target,
+			const FVector4*, h0_data, SpectrumH0,
+			uint32, H0Bytes, MemoryPlan.H0Bytes,
+			{
+				void* H0Dst = RHILockStructuredBuffer(H0TargetBuffer, 0, H0Bytes, RLM_WriteOnly);
+				FMemory::Memcpy(H0Dst, h0_data, H0Bytes);
+				RHIUnlockStructuredBuffer(H0TargetBuffer);
+			});
+		SpectrumUploadFence.BeginFence();
+
+		// Surface can reach the bound of any of two sea states while they're blended
+		DisplacementBound = DisplacementBound.ComponentMax(TransitionDisplacementBound);
+		SetSpectrumBand(FMath::Max(SpectrumBandRadius, TransitionBandRadius));
+
+		bTransitionActive = true;
+	}
+
+	// Target is fully blended in, it becomes the current sea state. Steps simulated ahead already use it with full weight.
+	if (bTransitionActive && GetSpectrumBlend(SimulationWorldTime) >= 1.f)
+	{
+		Swap(m_pBuffer_Float4_H0, m_pBuffer_Float4_H0Target);
+		Swap(m_pUAV_H0, m_pUAV_H0Target);
+		Swap(m_pSRV_H0, m_pSRV_H0Target);
+
+		if (MemoryPlan.bCPUSimulation)
+		{
+			CPUBackend.CommitTargetSpectrum();
+		}
+
+		PointQueryWavesIndex = 1 - PointQueryWavesIndex;
+
+		SpectrumConfig = TransitionTarget;
+		DisplacementBound = TransitionDisplacementBound;
+		SetSpectrumBand(TransitionBandRadius);
+		TransitionChainTime = TransitionStartTime + TransitionDuration;
+		bTransitionActive = false;
+	}
+
+	// Next transition starts from the committed sea state
+	if (bTransitionQueued && !bTransitionActive && !SpectrumTask.IsValid())
+	{
+		TransitionTarget = QueuedTransitionTarget;
+		TransitionDuration = QueuedTransitionDuration;
+		bTransitionQueued = false;
+
+		// Chained transition starts when the previous one ends on every machine, not when it's committed here
+		TransitionStartTime = FMath::Max(QueuedTransitionStartTime, TransitionChainTime);
+
+		// Same seed gives the same random phases, so only wave amplitudes change during blend
+		bSpectrumTaskIsTarget = true;
+		LaunchSpectrumTask(TransitionTarget, &TransitionDisplacementBound, &TransitionBandRadius, nullptr,
+			(MemoryPlan.PointQueryWaveCount > 0) ? &PointQueryWaves[1 - PointQueryWavesIndex] : nullptr);
+	}
+}
+
+void AVaOceanSimulator::CancelSpectrumTransition()
+{
+	if (bSpectrumTaskIsTarget)
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(SpectrumTask);
+		SpectrumTask = nullptr;
+		bSpectrumTaskIsTarget = false;
+	}
+	else if (!bTransitionActive)
+	{
+		return;
+	}
+
+	if (!bTransitionQueued)
+	{
+		QueuedTransitionTarget = TransitionTarget;
+		QueuedTransitionDuration = TransitionDuration;
+		QueuedTransitionStartTime = TransitionStartTime;
+		bTransitionQueued = true;
+	}
+
+	bTransitionActive = false;
+}
+
+float AVaOceanSimulator::GetSpectrumBlend(float WorldTime) const
+{
+	// Held at 0 until target H(0) is uploaded
+	if (!bTransitionActive)
+	{
+		return 0.f;
+	}
+
+	return FMath::Clamp((WorldTime - TransitionStartTime) / TransitionDuration, 0.f, 1.f);
+}
+
+float AVaOceanSimulator::GetChoppyScale(float WorldTime) const
+{
+	if (!bTransitionActive)
+	{
+		return SpectrumConfig.ChoppyScale;
+	}
+
+	return FMath::Lerp(SpectrumConfig.ChoppyScale, TransitionTarget.ChoppyScale, GetSpectrumBlend(WorldTime));
+}
+
+float AVaOceanSimulator::GetSimulationAlpha() const
+{
+	return SimulationAlpha;
+}
+
+FShaderResourceViewRHIRef AVaOceanSimulator::GetBoundsPyramidSRV() const
+{
+	return m_pSRV_Bounds;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPU simulation
+
+bool AVaOceanSimulator::ShouldSimulateOnCPU() const
+{
+	return bSimulateOnCPU || IsRunningDedicatedServer();
+}
+
+const FVaOceanCPUBackend& AVaOceanSimulator::GetCPUBackend() const
+{
+	RequireCPUGrid();
+	return CPUBackend;
+}
+
+FVector AVaOceanSimulator::GetOceanDisplacement(const FVector& WorldLocation) const
+{
+	const FVector2D UV(WorldLocation.X / SpectrumConfig.PatchLength, WorldLocation.Y / SpectrumConfig.PatchLength);
+
+	if (bPointQueryMode)
+	{
+		FVector Displacement;
+		EvaluatePointQuery(UV, &Displacement, nullptr);
+		return Displacement;
+	}
+
+	PointQueryDemand.Increment();
+	return CPUBackend.SampleDisplacement(UV);
+}
+
+FVector AVaOceanSimulator::GetOceanVelocity(const FVector& WorldLocation) const
+{
+	const FVector2D UV(WorldLocation.X / SpectrumConfig.PatchLength, WorldLocation.Y / SpectrumConfig.PatchLength);
+
+	// Velocity stays zero without bSimulateVelocity, the same as the grid one
+	if (bPointQueryMode && bSimulateVelocity)
+	{
+		FVector Displacement, Velocity;
+		EvaluatePointQuery(UV, &Displacement, &Velocity);
+		return Velocity;
+	}
+
+	if (bSimulateVelocity)
+	{
+		PointQueryDemand.Increment();
+	}
+
+	return CPUBackend.SampleVelocity(UV);
+}
+
+float AVaOceanSimulator::GetOceanFoam(const FVector& WorldLocation) const
+{
+	const FVector2D UV(WorldLocation.X / SpectrumConfig.PatchLength, WorldLocation.Y / SpectrumConfig.PatchLength);
+	RequireCPUGrid();
+	return CPUBackend.SampleFoam(UV);
+}
+
+bool AVaOceanSimulator::GetOceanHeightBounds(const FVector2D& WorldMin, const FVector2D& WorldMax, float& OutMinHeight, float& OutMaxHeight) const
+{
+	RequireCPUGrid();
+
+	if (!CPUBackend.IsInitialized())
+	{
+		OutMinHeight = -DisplacementBound.Z;
+		OutMaxHeight = DisplacementBound.Z;
+		return false;
+	}
+
+	// Surface over the rect can come from texels moved in horizontally
+	const FVaOceanTileBounds GlobalBounds = CPUBackend.GetGlobalBounds();
+	const FVector2D Padding(GlobalBounds.MaxAbsX, GlobalBounds.MaxAbsY);
+
+	const FVaOceanTileBounds Bounds = CPUBackend.GetBounds(
+		(WorldMin - Padding) / SpectrumConfig.PatchLength,
+		(WorldMax + Padding) / SpectrumConfig.PatchLength);
+
+	// Wakes are local, so any of them could be within the rect
+	const float WakeBound = WakeSolver.GetMaxAbsHeight();
+
+	OutMinHeight = Bounds.MinHeight - WakeBound;
+	OutMaxHeight = Bounds.MaxHeight + WakeBound;
+	return true;
+}
+
+float AVaOceanSimulator::GetOceanHeight(const FVector& WorldLocation) const
+{
+	const FVector2D Location(WorldLocation.X, WorldLocation.Y);
+	const FVector2D UV = Location / SpectrumConfig.PatchLength;
+
+	float Height;
+	if (QueryCache.IsInitialized())
+	{
+		Height = QueryCache.SampleHeight(UV, [this](const FVector2D* InUVs, int32 InNum, float* OutHeights)
+		{
+			ResolveQueryHeights(InUVs, InNum, OutHeights);
+		});
+	}
+	else
+	{
+		ResolveQueryHeights(&UV, 1, &Height);
+	}
+
+	return GetActorLocation().Z + Height + WakeSolver.SampleHeight(Location);
+}
+
+bool AVaOceanSimulator::OceanLineTrace(const FVector& Start, const FVector& End, FVector& OutHitLocation) const
+{
+	FVaOceanRay Ray;
+	Ray.Origin = Start;
+	(End - Start).ToDirectionAndLength(Ray.Direction, Ray.MaxDistance);
+
+	RequireCPUGrid();
+
+	FVaOceanRayHit Hit;
+	const FVaOceanRayCaster RayCaster(CPUBackend, SpectrumConfig.PatchLength, GetActorLocation().Z);
+	RayCaster.Raycast(Ray, Hit);
+
+	OutHitLocation = Hit.Location;
+	return Hit.bHit;
+}
+
+void AVaOceanSimulator::OceanRaycastBatch(const TArray<FVaOceanRay>& Rays, TArray<FVaOceanRayHit>& OutHits) const
+{
+	RequireCPUGrid();
+
+	const FVaOceanRayCaster RayCaster(CPUBackend, SpectrumConfig.PatchLength, GetActorLocation().Z);
+	RayCaster.RaycastBatch(Rays, OutHits);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Point queries
+
+bool AVaOceanSimulator::IsPointQueryModeActive() const
+{
+	return bPointQueryMode;
+}
+
+void AVaOceanSimulator::UpdatePointQueryMode(float DeltaTime)
+{
+	// Only one of them is counted while the mode holds: real evaluations or those the grid saved
+	const int32 Evaluations = PointQueryEvaluations.Reset() + PointQueryDemand.Reset();
+	const int32 GridQueries = GridQueryCount.Reset();
+	PointQueryModeDeltaTime = 0.f;
+
+	GridQueryIdleTime = (GridQueries > 0) ? 0.f : GridQueryIdleTime + DeltaTime;
+
+	// Blended sea state is only simulated by the grid
+	const FVaOceanGerstnerWaves& Waves = GetPointQueryWaves();
+	if (!PointQueryConfig.bEnablePointQueries || !Waves.IsInitialized() || IsSpectrumTransitionActive() || GridQueryIdleTime < PointQueryConfig.GridIdleTime)
+	{
+		bPointQueryMode = false;
+		return;
+	}
+
+	// Cost of one grid step in point wave evaluations. Analytic grid evaluates every wave at every texel.
+	const float Dim = MemoryPlan.Dim;
+	const float GridCost = (MemoryPlan.GerstnerWaveCount > 0) ? Dim * Dim * Waves.Num() : POINT_QUERY_FFT_COST * Dim * Dim * FMath::Log2(Dim);
+
+	// Grid comes back only when points cost more than it, so mode doesn't flip each step near the threshold
+	const float PointCost = (float)Evaluations * Waves.Num();
+	bPointQueryMode = PointCost < (bPointQueryMode ? GridCost : GridCost * 0.5f);
+}
+
+const FVaOceanGerstnerWaves& AVaOceanSimulator::GetPointQueryWaves() const
+{
+	return (MemoryPlan.GerstnerWaveCount > 0) ? GerstnerWaves : PointQueryWaves[PointQueryWavesIndex];
+}
+
+void AVaOceanSimulator::EvaluatePointQuery(const FVector2D& UV, FVector* OutDisplacement, FVector* OutVelocity) const
+{
+	// Grid texel centers are at (i + 0.5) / Dim, waves put texel i at i / Dim
+	const float HalfTexel = 0.5f / MemoryPlan.Dim;
+	const FVector2D WaveUV(UV.X - HalfTexel, UV.Y - HalfTexel);
+	PointQueryEvaluations.Increment();
+
+	// Waves are summed at current time, so there is nothing to interpolate
+	GetPointQueryWaves().EvaluatePoints(&WaveUV, 1, SimulationWorldTime * SpectrumConfig.TimeScale, SpectrumConfig.TimeScale,
+		SpectrumConfig.ChoppyScale, OutDisplacement, OutVelocity);
+}
+
+float AVaOceanSimulator::EvaluatePointQueryHeight(const FVector2D& UV) const
+{
+	// Find the point that choppy displacement moves onto UV, see FVaOceanCPUBackend::UpdateHeightField
+	FVector Displacement;
+	EvaluatePointQuery(UV, &Displacement, nullptr);
+
+	for (int32 Iteration = 1; Iteration < CHOPPY_INVERSE_ITERATIONS; Iteration++)
+	{
+		const FVector2D SourceUV(UV.X - Displacement.X / SpectrumConfig.PatchLength, UV.Y - Displacement.Y / SpectrumConfig.PatchLength);
+		EvaluatePointQuery(SourceUV, &Displacement, nullptr);
+	}
+
+	return Displacement.Z;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Query cache
+
+float AVaOceanSimulator::GetQueryCacheHitRate() const
+{
+	return QueryCache.GetLastStats().GetHitRate();
+}
+
+void AVaOceanSimulator::ResolveQueryHeights(const FVector2D* InUVs, int32 InNum, float* OutHeights) const
+{
+	if (bPointQueryMode)
+	{
+		for (int32 Index = 0; Index < InNum; Index++)
+		{
+			OutHeights[Index] = EvaluatePointQueryHeight(InUVs[Index]);
+		}
+		return;
+	}
+
+	// Cached tiles are counted as the points they resolve, so point query mode would see the real cost of its heights
+	PointQueryDemand.Add(InNum * CHOPPY_INVERSE_ITERATIONS);
+
+	for (int32 Index = 0; Index < InNum; Index++)
+	{
+		OutHeights[Index] = CPUBackend.SampleHeight(InUVs[Index]);
+	}
 }
 
 
@@ -0,0 +1,197 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+
+UVaOceanSurfaceComponent::UVaOceanSurfaceComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+	bTickInEditor = true;
+
+	OceanSimulator = nullptr;
+	OceanExtent = 400000.f;
+	MinPatchSize = 2000.f;
+	LODCount = 8;
+	LODBaseRange = 4000.f;
+	MorphStartRatio = 0.7f;
+	PatchResolution = 64;
+	DisplacementScale = 1.f;
+
+	SurfaceMaterial = nullptr;
+	RenderedSurfaceZ = 0.f;
+	RenderedMeshSize = 0.f;
+
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	CastShadow = false;
+}
+
+void UVaOceanSurfaceComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (GetMaterial(0) && !SurfaceMaterial)
+	{
+		SurfaceMaterial = CreateAndSetMaterialInstanceDynamic(0);
+	}
+
+	UpdateMaterialParameters();
+}
+
+void UVaOceanSurfaceComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Nothing is rendered on a dedicated server, so patches aren't selected at all
+	if (!StaticMesh || IsRunningDedicatedServer())
+	{
+		return;
+	}
+
+	UpdateQuadTreeSettings();
+
+	FVector ViewOrigin;
+	GetView(ViewOrigin, ViewFrustum);
+	QuadTree.Select(ViewOrigin, ViewFrustum, SelectedPatches);
+
+	UpdateInstances();
+}
+
+int32 UVaOceanSurfaceComponent::GetVisiblePatchCount() const
+{
+	return SelectedPatches.Num();
+}
+
+void UVaOceanSurfaceComponent::GetView(FVector& OutViewOrigin, TArray<FPlane>& OutFrustum) const
+{
+	OutFrustum.Reset();
+	OutViewOrigin = GetComponentLocation();
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (PlayerController && PlayerController->PlayerCameraManager)
+	{
+		APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager;
+
+		int32 ViewportX = 0, ViewportY = 0;
+		PlayerController->GetViewportSize(ViewportX, ViewportY);
+		const float AspectRatio = (ViewportY > 0) ? (float)ViewportX / (float)ViewportY : 1.f;
+
+		const FRotationMatrix CameraRotation(CameraManager->GetCameraRotation());
+		OutViewOrigin = CameraManager->GetCameraLocation();
+
+		// Far plane is limited by the whole ocean
+		const float FarDistance = OceanExtent * 2.f + FMath::Abs(OutViewOrigin.Z - GetComponentLocation().Z);
+
+		FVaOceanQuadTree::BuildFrustum(OutViewOrigin,
+			CameraRotation.GetScaledAxis(EAxis::X), CameraRotation.GetScaledAxis(EAxis::Y), CameraRotation.GetScaledAxis(EAxis::Z),
+			FMath::DegreesToRadians(CameraManager->GetFOVAngle() * 0.5f), AspectRatio, FarDistance, OutFrustum);
+	}
+	else if (World->ViewLocationsRenderedLastFrame.Num() > 0)
+	{
+		// Editor viewports: location is known, so LOD works without culling
+		OutViewOrigin = World->ViewLocationsRenderedLastFrame[0];
+	}
+}
+
+void UVaOceanSurfaceComponent::UpdateQuadTreeSettings()
+{
+	FVaOceanQuadTreeSettings Settings;
+	Settings.Center = FVector2D(GetComponentLocation());
+	Settings.Extent = OceanExtent;
+	Settings.MinPatchSize = MinPatchSize;
+	Settings.LODCount = LODCount;
+	Settings.LODBaseRange = LODBaseRange;
+	Settings.MorphStartRatio = MorphStartRatio;
+
+	// Displaced surface bounds
+	const FVector Bound = OceanSimulator ? OceanSimulator->GetDisplacementBound() * DisplacementScale : FVector::ZeroVector;
+	Settings.MinHeight = GetComponentLocation().Z - Bound.Z;
+	Settings.MaxHeight = GetComponentLocation().Z + Bound.Z;
+	Settings.HorizontalPadding = FMath::Max(Bound.X, Bound.Y);
+
+	QuadTree.SetSettings(Settings);
+}
+
+void UVaOceanSurfaceComponent::UpdateInstances()
+{
+	const float MeshSize = StaticMesh->GetBounds().BoxExtent.X * 2.f;
+	if (MeshSize <= KINDA_SMALL_NUMBER)
+	{
+		return;
+	}
+
+	const int32 PatchCount = SelectedPatches.Num();
+	const float SurfaceZ = GetComponentLocation().Z;
+
+	// Most frames select the same patches, scene proxy is rebuilt only when instances change
+	if (SurfaceZ == RenderedSurfaceZ && MeshSize == RenderedMeshSize && IsSameSelection(SelectedPatches, RenderedPatches))
+	{
+		return;
+	}
+
+	// Instances are reused, only the tail is added or removed
+	while (GetInstanceCount() > PatchCount)
+	{
+		RemoveInstance(GetInstanceCount() - 1);
+	}
+
+	for (int32 i = 0; i < PatchCount; i++)
+	{
+		const FVaOceanPatch& Patch = SelectedPatches[i];
+		const float Scale = Patch.Size / MeshSize;
+		const FTransform PatchTransform(FRotator::ZeroRotator, FVector(Patch.Center.X, Patch.Center.Y, SurfaceZ), FVector(Scale, Scale, 1.f));
+
+		if (i < GetInstanceCount())
+		{
+			UpdateInstanceTransform(i, PatchTransform, true, false);
+		}
+		else
+		{
+			AddInstanceWorldSpace(PatchTransform);
+		}
+	}
+
+	RenderedPatches = SelectedPatches;
+	RenderedSurfaceZ = SurfaceZ;
+	RenderedMeshSize = MeshSize;
+
+	MarkRenderStateDirty();
+}
+
+bool UVaOceanSurfaceComponent::IsSameSelection(const TArray<FVaOceanPatch>& A, const TArray<FVaOceanPatch>& B)
+{
+	if (A.Num() != B.Num())
+	{
+		return false;
+	}
+
+	// Selection is deterministic, so unchanged patches are bitwise equal
+	for (int32 i = 0; i < A.Num(); i++)
+	{
+		if (A[i].Center != B[i].Center || A[i].Size != B[i].Size)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UVaOceanSurfaceComponent::UpdateMaterialParameters()
+{
+	if (!SurfaceMaterial)
+	{
+		return;
+	}
+
+	SurfaceMaterial->SetScalarParameterValue(TEXT("OceanLODBaseRange"), LODBaseRange);
+	SurfaceMaterial->SetScalarParameterValue(TEXT("OceanMorphStartRatio"), MorphStartRatio);
+	SurfaceMaterial->SetScalarParameterValue(TEXT("OceanMinPatchSize"), MinPatchSize);
+	SurfaceMaterial->SetScalarParameterValue(TEXT("OceanPatchResolution"), (float)PatchResolution);
+}
@@ -0,0 +1,302 @@
+// Copyright 2014-2016 Vladimir Alyamkin. All Rights Reserved.
+
+#include "VaOceanPluginPrivatePCH.h"
+#include "VaOceanParallelFor.h"
+
+/** Rows of wake grid processed by one worker task */
+#define WAKE_BLOCK_ROWS 16
+
+/** 2D wave equation is stable while WaveSpeed * DeltaTime / CellSize <= 1 / sqrt(2) */
+#define WAKE_MAX_COURANT2 0.5f
+
+FVaOceanWakeStep::FVaOceanWakeStep(float WaveSpeed, float WaveDecay, float InDeltaTime, float CellSize)
+{
+	Courant2 = FMath::Min(FMath::Square(WaveSpeed * InDeltaTime / CellSize), WAKE_MAX_COURANT2);
+	DampingA = 2.f - WaveDecay * InDeltaTime;
+	DampingB = 1.f / (1.f + WaveDecay * InDeltaTime);
+	DeltaTime = InDeltaTime;
+}
+
+FVaOceanWakeSolver::FVaOceanWakeSolver()
+	: Dim(0)
+	, Stride(0)
+	, CellSize(1.f)
+	, Origin(0, 0)
+	, Height(nullptr)
+	, PrevHeight(nullptr)
+	, MaxAbsHeight(0.f)
+{
+}
+
+void FVaOceanWakeSolver::Initialize(int32 InDim, float InCellSize)
+{
+	check(FMath::IsPowerOfTwo(InDim));
+
+	Dim = InDim;
+	Stride = FVaOceanCPUArena::GetPlaneStride(Dim);
+	CellSize = InCellSize;
+	Origin = FIntPoint(0, 0);
+
+	// Memory of the same size is reused, planes start at rest
+	Arena.Reserve(GetArenaSize(Dim));
+	Height = Arena.AllocatePlane(Dim);
+	PrevHeight = Arena.AllocatePlane(Dim);
+
+	BlockMaxHeight.Reset();
+	BlockMaxHeight.AddZeroed(FMath::DivideAndRoundUp(Dim - 2, WAKE_BLOCK_ROWS));
+	MaxAbsHeight = 0.f;
+}
+
+SIZE_T FVaOceanWakeSolver::GetArenaSize(int32 InDim)
+{
+	return 2 * FVaOceanCPUArena::GetPlaneSize(InDim);
+}
+
+void FVaOceanWakeSolver::Release()
+{
+	Dim = 0;
+	Stride = 0;
+	Height = nullptr;
+	PrevHeight = nullptr;
+	MaxAbsHeight = 0.f;
+
+	BlockMaxHeight.Empty();
+	Arena.Release();
+}
+
+bool FVaOceanWakeSolver::IsInitialized() const
+{
+	return Dim > 0;
+}
+
+FIntPoint FVaOceanWakeSolver::GetOriginForCenter(const FVector2D& Center, int32 InDim, float InCellSize)
+{
+	return FIntPoint(FMath::FloorToInt(Center.X / InCellSize) - InDim / 2, FMath::FloorToInt(Center.Y / InCellSize) - InDim / 2);
+}
+
+void FVaOceanWakeSolver::SetCenter(const FVector2D& Center)
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	const FIntPoint NewOrigin = GetOriginForCenter(Center, Dim, CellSize);
+	if (NewOrigin != Origin)
+	{
+		Scroll(NewOrigin - Origin);
+		Origin = NewOrigin;
+	}
+}
+
+FIntPoint FVaOceanWakeSolver::GetOrigin() const
+{
+	return Origin;
+}
+
+void FVaOceanWakeSolver::Scroll(const FIntPoint& Shift)
+{
+	const int32 CopyWidth = Dim - FMath::Abs(Shift.X);
+	const int32 DstX = FMath::Max(0, -Shift.X);
+	const int32 SrcX = FMath::Max(0, Shift.X);
+
+	float* Planes[2] = { Height, PrevHeight };
+	for (float* Plane : Planes)
+	{
+		// Grid has moved further than its size
+		if (CopyWidth <= 0 || FMath::Abs(Shift.Y) >= Dim)
+		{
+			FMemory::Memzero(Plane, Stride * Dim * sizeof(float));
+			continue;
+		}
+
+		// Rows are visited in the order that doesn't overwrite sources before they're read
+		for (int32 i = 0; i < Dim; i++)
+		{
+			const int32 y = (Shift.Y >= 0) ? i : Dim - 1 - i;
+			const int32 SrcY = y + Shift.Y;
+			float* Row = Plane + y * Stride;
+
+			if (SrcY < 0 || SrcY >= Dim)
+			{
+				FMemory::Memzero(Row, Dim * sizeof(float));
+				continue;
+			}
+
+			FMemory::Memmove(Row + DstX, Plane + SrcY * Stride + SrcX, CopyWidth * sizeof(float));
+			FMemory::Memzero(Row + (Shift.X > 0 ? CopyWidth : 0), (Dim - CopyWidth) * sizeof(float));
+		}
+
+		// Border cells are at rest
+		FMemory::Memzero(Plane, Dim * sizeof(float));
+		FMemory::Memzero(Plane + (Dim - 1) * Stride, Dim * sizeof(float));
+		for (int32 y = 1; y < Dim - 1; y++)
+		{
+			Plane[y * Stride] = 0.f;
+			Plane[y * Stride + Dim - 1] = 0.f;
+		}
+	}
+}
+
+void FVaOceanWakeSolver::AddSources(const FVaOceanWakeSource* Sources, int32 NumSources, float DeltaTime)
+{
+	for (int32 i = 0; i < NumSources; i++)
+	{
+		const FVaOceanWakeSource& Source = Sources[i];
+
+		// Cell centers are at integer coordinates
+		const float cx = Source.Location.X / CellSize - Origin.X;
+		const float cy = Source.Location.Y / CellSize - Origin.Y;
+		const float r = FMath::Clamp(Source.Radius / CellSize, 1.f, WAKE_MAX_SOURCE_CELLS);
+
+		const int32 x0 = FMath::Max(1, FMath::CeilToInt(cx - r));
+		const int32 x1 = FMath::Min(Dim - 2, FMath::FloorToInt(cx + r));
+		const int32 y0 = FMath::Max(1, FMath::CeilToInt(cy - r));
+		const int32 y1 = FMath::Min(Dim - 2, FMath::FloorToInt(cy + r));
+
+		const float Amount = Source.Strength * DeltaTime;
+		const float InvRadius2 = 1.f / (r * r);
+
+		for (int32 y = y0; y <= y1; y++)
+		{
+			float* Row = Height + y * Stride;
+			const float dy2 = FMath::Square(y - cy);
+
+			for (int32 x = x0; x <= x1; x++)
+			{
+				// Smooth (1 - d^2)^2 footprint doesn't excite grid-sized ripples
+				const float d2 = (FMath::Square(x - cx) + dy2) * InvRadius2;
+				if (d2 < 1.f)
+				{
+					Row[x] += Amount * FMath::Square(1.f - d2);
+					MaxAbsHeight = FMath::Max(MaxAbsHeight, FMath::Abs(Row[x]));
+				}
+			}
+		}
+	}
+}
+
+void FVaOceanWakeSolver::Step(const FVaOceanWakeStep& StepParams, const FVaOceanWakeSource* Sources, int32 NumSources)
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	// Interior cells only, new height is written over the previous one in-place
+	VaOceanParallelFor(BlockMaxHeight.Num(), [&](int32 Block)
+	{
+		const VectorRegister Courant2 = VectorSetFloat1(StepParams.Courant2);
+		const VectorRegister DampingA = VectorSetFloat1(StepParams.DampingA);
+		const VectorRegister DampingB = VectorSetFloat1(StepParams.DampingB);
+		const VectorRegister Four = VectorSetFloat1(4.f);
+		VectorRegister MaxAbs = VectorZero();
+		float ScalarMaxAbs = 0.f;
+
+		const int32 FirstRow = 1 + Block * WAKE_BLOCK_ROWS;
+		const int32 LastRow = FMath::Min(FirstRow + WAKE_BLOCK_ROWS, Dim - 1);
+
+		for (int32 y = FirstRow; y < LastRow; y++)
+		{
+			const float* Row = Height + y * Stride;
+			const float* Up = Row - Stride;
+			const float* Down = Row + Stride;
+			float* Prev = PrevHeight + y * Stride;
+
+			int32 x = 1;
+			for (; x + 4 <= Dim - 1; x += 4)
+			{
+				const VectorRegister h = VectorLoad(Row + x);
+
+				VectorRegister Laplacian = VectorAdd(VectorAdd(VectorLoad(Row + x - 1), VectorLoad(Row + x + 1)), VectorAdd(VectorLoad(Up + x), VectorLoad(Down + x)));
+				Laplacian = VectorSubtract(Laplacian, VectorMultiply(h, Four));
+
+				const VectorRegister NewHeight = VectorMultiply(DampingB,
+					VectorAdd(VectorSubtract(VectorMultiply(DampingA, h), VectorLoad(Prev + x)), VectorMultiply(Courant2, Laplacian)));
+
+				VectorStore(NewHeight, Prev + x);
+				MaxAbs = VectorMax(MaxAbs, VectorAbs(NewHeight));
+			}
+
+			// Tail of the row
+			for (; x < Dim - 1; x++)
+			{
+				const float Laplacian = Row[x - 1] + Row[x + 1] + Up[x] + Down[x] - 4.f * Row[x];
+				Prev[x] = StepParams.DampingB * (StepParams.DampingA * Row[x] - Prev[x] + StepParams.Courant2 * Laplacian);
+				ScalarMaxAbs = FMath::Max(ScalarMaxAbs, FMath::Abs(Prev[x]));
+			}
+		}
+
+		float Lanes[4];
+		VectorStore(MaxAbs, Lanes);
+		BlockMaxHeight[Block] = FMath::Max(FMath::Max(ScalarMaxAbs, Lanes[0]), FMath::Max(FMath::Max(Lanes[1], Lanes[2]), Lanes[3]));
+	});
+
+	Swap(Height, PrevHeight);
+
+	MaxAbsHeight = 0.f;
+	for (float BlockMax : BlockMaxHeight)
+	{
+		MaxAbsHeight = FMath::Max(MaxAbsHeight, BlockMax);
+	}
+
+	// Sources are added to the new height, the same way WakeStepCS does
+	AddSources(Sources, NumSources, StepParams.DeltaTime);
+}
+
+float FVaOceanWakeSolver::SampleHeight(const FVector2D& WorldLocation) const
+{
+	if (!IsInitialized())
+	{
+		return 0.f;
+	}
+
+	const float fx = WorldLocation.X / CellSize - Origin.X;
+	const float fy = WorldLocation.Y / CellSize - Origin.Y;
+
+	// Outside of the grid water is at rest
+	if (fx < 0.f || fy < 0.f || fx >= Dim - 1 || fy >= Dim - 1)
+	{
+		return 0.f;
+	}
+
+	const int32 x = FMath::FloorToInt(fx);
+	const int32 y = FMath::FloorToInt(fy);
+	const float tx = fx - x;
+	const float ty = fy - y;
+
+	const float* Row = Height + y * Stride + x;
+	const float Top = FMath::Lerp(Row[0], Row[1], tx);
+	const float Bottom = FMath::Lerp(Row[Stride], Row[Stride + 1], tx);
+
+	return FMath::Lerp(Top, Bottom, ty);
+}
+
+float FVaOceanWakeSolver::GetMaxAbsHeight() const
+{
+	return MaxAbsHeight;
+}
+
+FVaOceanCPUMapView FVaOceanWakeSolver::GetHeightView() const
+{
+	FVaOceanCPUMapView View;
+	if (IsInitialized())
+	{
+		View.Planes[0] = Height;
+		View.PlaneCount = 1;
+		View.Dim = Dim;
+		View.Stride = Stride;
+	}
+
+	return View;
+}
+
+int32 FVaOceanWakeSolver::GetDimension() const
+{
+	return Dim;
+}
+
+float FVaOceanWakeSolver::GetCellSize() const
+{
+	return CellSize;
+}